@@ -0,0 +1,81 @@
+/*
+ * admission_control.cpp
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "admission_control.hpp"
+
+using namespace std;
+
+namespace meica
+{
+/**
+ * Credit of at most two computations, so fractional credits are not lost and
+ * only short bursts are computed after an idle time.
+ */
+static constexpr double MAX_CREDIT = 2.0;
+
+admission_controller::admission_controller(const admission_params &params)
+	: params_(params), stats_(), last_arrival_(0.0), interval_(0.0),
+	  compute_time_(0.0), credit_(1.0), has_arrival_(false)
+{
+	if (!(params.max_utilization > 0.0) || !(params.ewma_weight > 0.0) ||
+	    params.ewma_weight > 1.0) {
+		throw invalid_argument("Invalid admission control parameters.");
+	}
+}
+
+void admission_controller::on_arrival(double now)
+{
+	double dt;
+
+	if (has_arrival_) {
+		dt = max(now - last_arrival_, 0.0);
+		interval_ = (interval_ > 0.0) ?
+				    interval_ + params_.ewma_weight *
+							(dt - interval_) :
+				    dt;
+		// No credit is needed before the first computation.
+		if (compute_time_ > 0.0) {
+			credit_ = min(credit_ + dt * params_.max_utilization /
+							compute_time_,
+				      MAX_CREDIT);
+		}
+	}
+	last_arrival_ = now;
+	has_arrival_ = true;
+}
+
+bool admission_controller::admit(double free_pool)
+{
+	if (free_pool < params_.min_free_pool) {
+		stats_.shed += 1;
+		stats_.shed_by_pool += 1;
+		return false;
+	}
+	// Tolerate the rounding of the credits of steady arrivals.
+	if (credit_ + 1e-9 < 1.0) {
+		stats_.shed += 1;
+		return false;
+	}
+	credit_ -= 1.0;
+	stats_.admitted += 1;
+	return true;
+}
+
+void admission_controller::on_compute(double seconds)
+{
+	compute_time_ = (compute_time_ > 0.0) ?
+				compute_time_ + params_.ewma_weight *
+							(seconds - compute_time_) :
+				seconds;
+}
+
+double admission_controller::utilization() const
+{
+	return (interval_ > 0.0) ? compute_time_ / interval_ : 0.0;
+}
+
+} // namespace meica
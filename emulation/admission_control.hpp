@@ -0,0 +1,81 @@
+/*
+ * admission_control.hpp
+ *
+ * Load shedding of the compute of the VNFs under overload.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace meica
+{
+struct admission_params {
+	// Fraction of the time the VNF may compute, above it messages are
+	// shed.
+	double max_utilization;
+	// Messages are shed while less than this fraction of the chunk mbufs
+	// is free.
+	double min_free_pool;
+	// Weight of a new sample in the moving averages of the compute time
+	// and the time between messages.
+	double ewma_weight;
+};
+
+struct admission_stats {
+	uint64_t admitted;
+	uint64_t shed;
+	// Shed because of the mbuf pool, included in shed.
+	uint64_t shed_by_pool;
+};
+
+/**
+ * Decide per message if it is computed or only passed through.
+ *
+ * Each message earns credit in proportion to the time since the previous
+ * message divided by the mean compute time scaled by max_utilization. A
+ * message is computed if its credit is at least one computation, so at most
+ * max_utilization of the time is spent on compute in steady state. The
+ * credit is capped at two computations. Messages that queued up during a
+ * computation arrive back-to-back and earn little credit, so a backlog is
+ * drained by shedding.
+ */
+class admission_controller {
+public:
+	explicit admission_controller(const admission_params &params);
+
+	/* The message arrives at time now (s), before admit(). */
+	void on_arrival(double now);
+
+	/**
+	 * Return true if the message is computed. free_pool is the fraction
+	 * of free chunk mbufs.
+	 */
+	bool admit(double free_pool);
+
+	/**
+	 * A computation of an admitted message took the given time (s). Only
+	 * actual computations are recorded, e.g. not result cache hits.
+	 */
+	void on_compute(double seconds);
+
+	const admission_stats &stats() const
+	{
+		return stats_;
+	}
+
+	/* Mean compute time divided by the mean time between messages. */
+	double utilization() const;
+
+private:
+	admission_params params_;
+	admission_stats stats_;
+	double last_arrival_;
+	double interval_;
+	double compute_time_;
+	double credit_;
+	bool has_arrival_;
+};
+
+} // namespace meica
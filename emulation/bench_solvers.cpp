@@ -0,0 +1,253 @@
+/*
+ * bench_solvers.cpp
+ *
+ * Compare the latency and the separation quality of the native ICA solvers
+ * on the mixtures of the google_dataset.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "meica_batch.hpp"
+#include "meica_compute.hpp"
+#include "meica_testbed.hpp"
+
+using namespace std;
+
+static vector<string> split(const string &s)
+{
+	vector<string> out;
+	string item;
+	istringstream iss(s);
+	while (getline(iss, item, ',')) {
+		out.push_back(item);
+	}
+	return out;
+}
+
+static double percentile(vector<double> v, double p)
+{
+	sort(v.begin(), v.end());
+	size_t idx = static_cast<size_t>(p / 100.0 * (v.size() - 1) + 0.5);
+	return v[min(idx, v.size() - 1)];
+}
+
+/**
+ * Latency per message of MEICA on batches of messages with the same shape,
+ * reported as the algorithm meica_batch<K>.
+ */
+static void bench_batch(const meica::matrix &S, uint32_t batch,
+			uint32_t repeat, ofstream &out)
+{
+	const size_t source_number = S.rows;
+	const string name = "meica_batch" + to_string(batch);
+	vector<double> latencies;
+	double sdr = 0.0;
+	double amari = 0.0;
+	mt19937_64 rng(0);
+
+	for (uint32_t r = 0; r < repeat; ++r) {
+		vector<meica::matrix> As;
+		vector<meica::matrix> Xs;
+		vector<meica::matrix_view> views;
+		for (uint32_t b = 0; b < batch; ++b) {
+			As.push_back(meica::generate_matrix_A(source_number, rng));
+			Xs.push_back(meica::matmul(As.back(), S));
+		}
+		for (const auto &X : Xs) {
+			views.push_back(meica::matrix_view::of(X));
+		}
+		auto params =
+			meica::default_solver_params(meica::ica_algorithm::MEICA);
+		params.seed = r;
+		meica::meica_batch_solver solver(params);
+		vector<meica::solver_state> states(batch, meica::solver_state{});
+
+		auto start = chrono::steady_clock::now();
+		solver.run_batch(views, states, 0);
+		auto end = chrono::steady_clock::now();
+
+		latencies.push_back(
+			chrono::duration<double, milli>(end - start).count() /
+			batch);
+		for (uint32_t b = 0; b < batch; ++b) {
+			sdr += meica::mean_si_sdr(S, meica::matmul(states[b].uW,
+								   Xs[b]));
+			amari += meica::amari_index(states[b].uW, As[b]);
+		}
+	}
+	sdr /= repeat * batch;
+	amari /= repeat * batch;
+
+	cout << fixed << setprecision(3) << "- " << name
+	     << ", sources: " << source_number
+	     << ", latency per message (ms): median "
+	     << percentile(latencies, 50) << ", p99 "
+	     << percentile(latencies, 99) << "; SI-SDR (dB): " << sdr
+	     << "; Amari index: " << amari << endl;
+	out << name << "," << source_number << "," << percentile(latencies, 50)
+	    << "," << percentile(latencies, 99) << "," << sdr << "," << amari
+	    << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+	string folder = "../google_dataset/32000_wav_factory";
+	string algorithms = "meica,fastica,cdica,aeica,ufica";
+	string sources = "2,4,8";
+	string csv = "solver_benchmark.csv";
+	double duration = 1.0;
+	uint32_t repeat = 10;
+	uint32_t batch = 1;
+	size_t stochastic = 0;
+	bool mixed_precision = false;
+	uint32_t speculative = 1;
+
+	try {
+		po::options_description desc(
+			"Benchmark of the native ICA solvers, usage:");
+		// clang-format off
+		desc.add_options()
+                        ("help,h", "Produce help message")
+                        ("folder", po::value<string>(), "Folder of the wav files.")
+                        ("algorithms", po::value<string>(), "Algorithms (split by comma) to compare.")
+                        ("sources", po::value<string>(), "Source numbers (split by comma) to test.")
+                        ("duration", po::value<double>(), "Duration (seconds) of the sources.")
+                        ("repeat", po::value<uint32_t>(), "Number of runs for each algorithm and source number.")
+                        ("batch", po::value<uint32_t>(), "Also run MEICA on batches of this number of messages with the batched solver.")
+                        ("stochastic", po::value<size_t>(), "Run the Newton iterations on subsets of at least this number of samples first, the algorithm is reported with the suffix _sto.")
+                        ("mixed_precision", "Run the Newton kernels on float32 samples, the algorithm is reported with the suffix _f32.")
+                        ("speculative", po::value<uint32_t>(), "Run this number of parallel starts at the first MEICA level, the algorithm is reported with the suffix _spec<R>.")
+                        ("csv", po::value<string>(), "CSV file to append the results to.");
+		// clang-format on
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			cout << desc << "\n";
+			return 1;
+		}
+		if (vm.count("folder")) {
+			folder = vm["folder"].as<string>();
+		}
+		if (vm.count("algorithms")) {
+			algorithms = vm["algorithms"].as<string>();
+		}
+		if (vm.count("sources")) {
+			sources = vm["sources"].as<string>();
+		}
+		if (vm.count("duration")) {
+			duration = vm["duration"].as<double>();
+		}
+		if (vm.count("repeat")) {
+			repeat = max(vm["repeat"].as<uint32_t>(), 1U);
+		}
+		if (vm.count("batch")) {
+			batch = max(vm["batch"].as<uint32_t>(), 1U);
+		}
+		if (vm.count("stochastic")) {
+			stochastic = vm["stochastic"].as<size_t>();
+		}
+		if (vm.count("mixed_precision")) {
+			mixed_precision = true;
+		}
+		if (vm.count("speculative")) {
+			speculative = max(vm["speculative"].as<uint32_t>(), 1U);
+		}
+		if (vm.count("csv")) {
+			csv = vm["csv"].as<string>();
+		}
+	} catch (exception &e) {
+		cerr << "Error:" << e.what() << endl;
+		return 1;
+	}
+
+	ofstream out(csv, ios::app);
+	if (!out) {
+		cerr << "Error: Can not open " << csv << endl;
+		return 1;
+	}
+
+	for (const auto &src : split(sources)) {
+		size_t source_number = stoul(src);
+		meica::matrix S;
+		if (!meica::wavs_to_matrix_S(folder, duration, source_number,
+					     S)) {
+			cerr << "Error: Failed to load " << source_number
+			     << " sources from " << folder << endl;
+			return 1;
+		}
+
+		for (const auto &name : split(algorithms)) {
+			meica::ica_algorithm algo;
+			if (!meica::parse_algorithm(name, algo)) {
+				cerr << "Error: Unknown algorithm: " << name
+				     << endl;
+				return 1;
+			}
+			vector<double> latencies;
+			double sdr = 0.0;
+			double amari = 0.0;
+			mt19937_64 rng(0);
+
+			for (uint32_t r = 0; r < repeat; ++r) {
+				meica::matrix A =
+					meica::generate_matrix_A(source_number, rng);
+				meica::matrix X = meica::matmul(A, S);
+				auto params = meica::default_solver_params(algo);
+				params.seed = r;
+				params.stochastic_min_samples = stochastic;
+				params.mixed_precision = mixed_precision;
+				params.speculative_starts = speculative;
+				auto solver = meica::make_solver(algo, params);
+
+				auto start = chrono::steady_clock::now();
+				meica::matrix W = meica::separate(
+					*solver, meica::matrix_view::of(X));
+				auto end = chrono::steady_clock::now();
+
+				latencies.push_back(
+					chrono::duration<double, milli>(end - start)
+						.count());
+				sdr += meica::mean_si_sdr(S, meica::matmul(W, X));
+				amari += meica::amari_index(W, A);
+			}
+			sdr /= repeat;
+			amari /= repeat;
+
+			const string label = name + (stochastic ? "_sto" : "") +
+					     (mixed_precision ? "_f32" : "") +
+					     (speculative > 1 ?
+						      "_spec" + to_string(speculative) :
+						      "");
+			cout << fixed << setprecision(3) << "- " << label
+			     << ", sources: " << source_number
+			     << ", latency (ms): median "
+			     << percentile(latencies, 50) << ", p99 "
+			     << percentile(latencies, 99)
+			     << "; SI-SDR (dB): " << sdr
+			     << "; Amari index: " << amari << endl;
+			out << label << "," << source_number << ","
+			    << percentile(latencies, 50) << ","
+			    << percentile(latencies, 99) << "," << sdr << ","
+			    << amari << "\n";
+		}
+
+		if (batch > 1) {
+			bench_batch(S, batch, repeat, out);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,360 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+
+"""
+About: Compare the throughput and latency of the VNF port backends.
+
+A veth pair is created locally (without ComNetsEmu): one end is moved into a
+network namespace and used by the traffic generator, the other end is used by
+the VNF running in store and forward mode. Since the VNF sends the chunks back
+through the same interface, both the round-trip latency and the forwarding
+throughput can be measured with a single AF_PACKET socket in the namespace.
+
+With --chain N, chains of N VNFs on the host are compared instead: chained via
+veth pairs (each VNF sends on the veth of the next one) or via memif (shared
+memory between the DPDK processes, without the kernel). The chains receive
+from the generator on one veth pair and send to it on a second one.
+"""
+
+import argparse
+import csv
+import json
+import os
+import shlex
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+import numpy as np
+
+import meica_host
+
+NETNS: str = "meica_bench"
+GEN_IFACE: str = "mbench0"
+VNF_IFACE: str = "mbench1"
+GEN_OUT_IFACE: str = "mbench2"
+VNF_OUT_IFACE: str = "mbench3"
+MEMIF_DIR: str = "/tmp/meica_bench_memif"
+
+ETH_P_ALL = 0x0003
+PROBE_HDR = "!QQ"  # sequence number, send timestamp (ns)
+
+
+def run(cmd, check=True):
+    return subprocess.run(shlex.split(cmd), check=check)
+
+
+def setup_veth():
+    run(f"ip netns add {NETNS}")
+    run(f"ip link add {GEN_IFACE} type veth peer name {VNF_IFACE}")
+    run(f"ip link set {GEN_IFACE} netns {NETNS}")
+    run(f"ip netns exec {NETNS} ip link set {GEN_IFACE} up")
+    run(f"ip netns exec {NETNS} ip link set {GEN_IFACE} promisc on")
+    run(f"ip link set {VNF_IFACE} up")
+
+
+def setup_chain_veth(chain_len):
+    """Add the output veth pair and the veth pairs between the VNFs."""
+    run(f"ip link add {GEN_OUT_IFACE} type veth peer name {VNF_OUT_IFACE}")
+    run(f"ip link set {GEN_OUT_IFACE} netns {NETNS}")
+    run(f"ip netns exec {NETNS} ip link set {GEN_OUT_IFACE} up")
+    run(f"ip netns exec {NETNS} ip link set {GEN_OUT_IFACE} promisc on")
+    run(f"ip link set {VNF_OUT_IFACE} up")
+    for i in range(1, chain_len):
+        run(f"ip link add mchain{i}a type veth peer name mchain{i}b")
+        run(f"ip link set mchain{i}a up")
+        run(f"ip link set mchain{i}b up")
+
+
+def cleanup_veth(chain_len=0):
+    for i in range(1, chain_len):
+        run(f"ip link del mchain{i}a", check=False)
+    run(f"ip link del {VNF_OUT_IFACE}", check=False)
+    run(f"ip link del {VNF_IFACE}", check=False)
+    run(f"ip netns del {NETNS}", check=False)
+
+
+def ipv4_cksum(hdr: bytes) -> int:
+    s = sum(struct.unpack("!10H", hdr))
+    s = (s & 0xFFFF) + (s >> 16)
+    s = (s & 0xFFFF) + (s >> 16)
+    return ~s & 0xFFFF
+
+
+def build_frame(seq: int, payload_len: int) -> bytes:
+    """Build a chunk with the MEICA service header, UDP checksum is disabled."""
+    probe = struct.pack(PROBE_HDR, seq, time.monotonic_ns())
+    payload = probe + b"P" * max(0, payload_len - len(probe))
+    hdr = meica_host.ServiceHeader(
+        msg_type=0,
+        total_chunk_num=1,
+        chunk_num=0,
+        chunk_len=len(payload) + meica_host.ServiceHeader.length,
+        data_chunk_num=1,
+    )
+    udp_payload = hdr.serialize() + payload
+    udp = struct.pack("!HHHH", 9999, 9999, 8 + len(udp_payload), 0)
+    ip_total_len = 20 + len(udp) + len(udp_payload)
+    ip = struct.pack(
+        "!BBHHHBBH4s4s",
+        0x45,
+        0,
+        ip_total_len,
+        seq & 0xFFFF,
+        0,
+        64,
+        socket.IPPROTO_UDP,
+        0,
+        socket.inet_aton("10.0.1.11"),
+        socket.inet_aton("10.0.3.11"),
+    )
+    ip = ip[:10] + struct.pack("!H", ipv4_cksum(ip)) + ip[12:]
+    eth = b"\x02\x00\x00\x00\x00\x02" + b"\x02\x00\x00\x00\x00\x01" + b"\x08\x00"
+    return eth + ip + udp + udp_payload
+
+
+def parse_probe(frame: bytes):
+    offset = 14 + 20 + 8 + meica_host.ServiceHeader.length
+    if len(frame) < offset + struct.calcsize(PROBE_HDR):
+        return None
+    return struct.unpack_from(PROBE_HDR, frame, offset)
+
+
+def open_socket(iface):
+    sock = socket.socket(socket.AF_PACKET, socket.SOCK_RAW, socket.htons(ETH_P_ALL))
+    sock.bind((iface, 0))
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 8 * 1024 * 1024)
+    return sock
+
+
+def recv_forwarded(sock):
+    """Receive the next frame sent back by the VNF (skip own outgoing frames)."""
+    while True:
+        frame, addr = sock.recvfrom(65535)
+        if addr[2] != socket.PACKET_OUTGOING:
+            return frame
+
+
+def measure_latency(sock, rx_sock, probe_num, payload_len):
+    latencies = list()
+    rx_sock.settimeout(1.0)
+    for seq in range(probe_num):
+        sock.send(build_frame(seq, payload_len))
+        try:
+            while True:
+                probe = parse_probe(recv_forwarded(rx_sock))
+                if probe and probe[0] == seq:
+                    latencies.append((time.monotonic_ns() - probe[1]) / 1e3)
+                    break
+        except socket.timeout:
+            continue
+    return latencies
+
+
+def measure_throughput(sock, rx_sock, chunk_num, payload_len):
+    frames = [build_frame(seq, payload_len) for seq in range(chunk_num)]
+    received = 0
+    rx_sock.settimeout(1.0)
+
+    def sender():
+        for f in frames:
+            sock.send(f)
+
+    start = time.monotonic()
+    t = threading.Thread(target=sender)
+    t.start()
+    try:
+        while received < chunk_num:
+            recv_forwarded(rx_sock)
+            received += 1
+            last = time.monotonic()
+    except socket.timeout:
+        pass
+    t.join()
+    if received == 0:
+        return 0, 0.0
+    duration = last - start
+    return received, duration
+
+
+def run_measurement(args):
+    """Executed inside the network namespace, print the result as JSON."""
+    sock = open_socket(GEN_IFACE)
+    # A chain sends the chunks back on the output veth pair.
+    rx_sock = open_socket(GEN_OUT_IFACE) if args.chain > 0 else sock
+    latencies = measure_latency(sock, rx_sock, args.probe_num, args.payload_len)
+    received, duration = measure_throughput(
+        sock, rx_sock, args.chunk_num, args.payload_len
+    )
+    if rx_sock is not sock:
+        rx_sock.close()
+    sock.close()
+    print(
+        json.dumps(
+            {
+                "latencies": latencies,
+                "received": received,
+                "duration": duration,
+            }
+        )
+    )
+
+
+def get_chain_args(chaining, chain_len):
+    """Get the port options of each VNF of the chain."""
+    chain_args = list()
+    for n in range(1, chain_len + 1):
+        if chaining == "memif":
+            args = [f"--iface {VNF_IFACE}"]
+            if n > 1:
+                args.append(f"--memif_rx {MEMIF_DIR}/vnf{n-1}.sock")
+            if n < chain_len:
+                args.append(f"--memif_tx {MEMIF_DIR}/vnf{n}.sock")
+            else:
+                args.append(f"--tx_iface {VNF_OUT_IFACE}")
+        else:
+            rx_iface = VNF_IFACE if n == 1 else f"mchain{n-1}b"
+            tx_iface = VNF_OUT_IFACE if n == chain_len else f"mchain{n}a"
+            args = [f"--iface {rx_iface}", f"--tx_iface {tx_iface}"]
+        chain_args.append(" ".join(args))
+    return chain_args
+
+
+def run_vnfs(name, vnf_args, args):
+    """Run the VNFs and the measurement in the namespace, return a CSV row."""
+    print(f"* Benchmark: {name}")
+    cores = args.core.split(",")
+    vnfs = list()
+    try:
+        for idx, a in enumerate(vnf_args):
+            vnfs.append(
+                subprocess.Popen(
+                    shlex.split(
+                        f"./build/meica_vnf --mode store_forward {a} "
+                        f"--core {cores[idx % len(cores)]} --file_prefix meica_bench{idx}"
+                    ),
+                    stdout=subprocess.DEVNULL,
+                    stderr=subprocess.DEVNULL,
+                )
+            )
+        time.sleep(3)  # Wait for the EAL initialization.
+        out = subprocess.check_output(
+            shlex.split(
+                f"ip netns exec {NETNS} {sys.executable} {os.path.abspath(__file__)} --measure "
+                f"--probe_num {args.probe_num} --chunk_num {args.chunk_num} --payload_len {args.payload_len} "
+                f"--chain {args.chain}"
+            )
+        )
+    finally:
+        for vnf in vnfs:
+            vnf.terminate()
+            vnf.wait()
+
+    result = json.loads(out.decode())
+    latencies = np.asarray(result["latencies"])
+    received, duration = result["received"], result["duration"]
+    pps = received / duration if duration > 0 else 0.0
+    frame_len = len(build_frame(0, args.payload_len))
+    row = [
+        name,
+        f"{np.median(latencies):.2f}" if len(latencies) else "nan",
+        f"{np.percentile(latencies, 99):.2f}" if len(latencies) else "nan",
+        f"{pps:.0f}",
+        f"{pps * frame_len * 8 / 1e6:.2f}",
+        f"{1.0 - received / args.chunk_num:.4f}",
+    ]
+    print(
+        f"- Latency (us): median {row[1]}, p99 {row[2]}; "
+        f"Throughput: {row[3]} pps, {row[4]} Mbps; Loss: {row[5]}"
+    )
+    return row
+
+
+def run_backend(backend, args):
+    return run_vnfs(backend, [f"--backend {backend} --iface {VNF_IFACE}"], args)
+
+
+def run_chain(chaining, backend, args):
+    vnf_args = [
+        f"--backend {backend} {a}" for a in get_chain_args(chaining, args.chain)
+    ]
+    return run_vnfs(f"{chaining}_chain{args.chain}", vnf_args, args)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="Compare the throughput and latency of the VNF port backends."
+    )
+    parser.add_argument(
+        "--backends",
+        type=str,
+        default="af_packet,af_xdp",
+        help="Comma separated list of the backends to compare.",
+    )
+    parser.add_argument(
+        "--probe_num", type=int, default=1000, help="Number of latency probes."
+    )
+    parser.add_argument(
+        "--chunk_num",
+        type=int,
+        default=100000,
+        help="Number of chunks sent for the throughput test.",
+    )
+    parser.add_argument(
+        "--payload_len",
+        type=int,
+        default=meica_host.MEICA_IP_TOTAL_LEN,
+        help="Payload length of each chunk in bytes.",
+    )
+    parser.add_argument(
+        "--chain",
+        type=int,
+        default=0,
+        help="Compare veth and memif chains of this number of VNFs using the first backend.",
+    )
+    parser.add_argument(
+        "--core",
+        type=str,
+        default="1",
+        help="CPU cores (split by comma) of the VNFs, one per VNF of a chain.",
+    )
+    parser.add_argument(
+        "--csv",
+        type=str,
+        default="port_backend_benchmark.csv",
+        help="CSV file to store the results.",
+    )
+    parser.add_argument("--measure", action="store_true", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.measure:
+        run_measurement(args)
+        sys.exit(0)
+
+    if os.geteuid() != 0:
+        print("Run this script with sudo.", file=sys.stderr)
+        sys.exit(1)
+
+    rows = list()
+    try:
+        setup_veth()
+        if args.chain > 0:
+            setup_chain_veth(args.chain)
+            os.makedirs(MEMIF_DIR, exist_ok=True)
+            backend = args.backends.split(",")[0]
+            for chaining in ("veth", "memif"):
+                rows.append(run_chain(chaining, backend, args))
+        else:
+            for backend in args.backends.split(","):
+                rows.append(run_backend(backend, args))
+    finally:
+        cleanup_veth(args.chain)
+
+    with open(args.csv, "a+") as csvfile:
+        writer = csv.writer(csvfile, delimiter=",")
+        for row in rows:
+            writer.writerow(row)
@@ -14,6 +14,7 @@ import time
 import typing
 
 import meica_host
+from mixture_cache import MixtureCache
 
 sys.path.insert(0, "../")
 
@@ -30,7 +31,13 @@ class Client(meica_host.MEICAHost):
         client_address_data,
         server_address_data,
         verbose,
+        x_format="raw",
+        algorithm="meica",
+        mixture_cache=None,
     ):
+        self.x_format = x_format
+        self.mixture_cache = mixture_cache
+        self.msg_flags = meica_host.ALGORITHMS.index(algorithm)
         self.server_address_control = server_address_control
         self.sock_control = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
 
@@ -45,6 +52,14 @@ class Client(meica_host.MEICAHost):
             self.logger = meica_host.get_logger("info")
 
     def generate_data(self, wav_range, source_number):
+        if self.mixture_cache:
+            cache = MixtureCache(self.mixture_cache)
+            if not cache.matches(wav_range, source_number):
+                raise RuntimeError(
+                    f"The mixture cache {self.mixture_cache} has another wav range or source number, write it with: ./build/meica_sender --write_cache --mixture_cache {self.mixture_cache} --wav_range {wav_range} --source_number {source_number}"
+                )
+            # The raw X is sent from the mapping of the cache without copies.
+            return cache.X_raw if self.x_format == "raw" else cache.X
         folder_address = "/in-network_bss/google_dataset/32000_wav_factory"
         # Use the fixed combination of source files which only depends on
         # source_number.
@@ -89,7 +104,12 @@ class Client(meica_host.MEICAHost):
         for msg_num in range(total_msg_num):
             start_ts = time.time()
             chunks, msg_len = self.fragment(
-                X, msg_type=0, total_msg_num=total_msg_num, msg_num=msg_num
+                X,
+                msg_type=0,
+                total_msg_num=total_msg_num,
+                msg_num=msg_num,
+                fmt=self.x_format,
+                msg_flags=self.msg_flags,
             )
             self.logger.debug(
                 f"Message number: {msg_num} ,size: {msg_len}. Start sending {len(chunks)} chunks to the server..."
@@ -127,7 +147,14 @@ class Client(meica_host.MEICAHost):
         # 2 for fast break (msg_type: 2) and 8 for without fast break (msg_type: 1)
         for source_number in [2, 8]:
             X = self.generate_data(DURATION_OF_EACH_MSG, source_number)
-            chunks, msg_len = self.fragment(X, msg_type=0, total_msg_num=1, msg_num=0)
+            chunks, msg_len = self.fragment(
+                X,
+                msg_type=0,
+                total_msg_num=1,
+                msg_num=0,
+                fmt=self.x_format,
+                msg_flags=self.msg_flags,
+            )
             data_chunk_num = len(chunks)
             total_chunk_num = data_chunk_num
             if total_chunk_num > meica_host.MAX_CHUNK_NUM:
@@ -200,6 +227,26 @@ if __name__ == "__main__":
     parser.add_argument(
         "-v", "--verbose", action="store_true", help="Enable verbose mode."
     )
+    parser.add_argument(
+        "--x_format",
+        type=str,
+        default="raw",
+        choices=["pickle", "raw"],
+        help="Serialization format of the X matrix. The raw format is read by the VNFs without copies.",
+    )
+    parser.add_argument(
+        "--algorithm",
+        type=str,
+        default="meica",
+        choices=meica_host.ALGORITHMS,
+        help="The ICA algorithm used by the VNFs and the server. Algorithms other than meica are only supported by the native engine of the VNF.",
+    )
+    parser.add_argument(
+        "--mixture_cache",
+        type=str,
+        default="",
+        help="Cache file of S, A and X written by ./build/meica_sender --write_cache, used instead of the wav files.",
+    )
     parser.add_argument("--probe", action="store_true", help="Send probing packets.")
     parser.add_argument(
         "--test",
@@ -226,6 +273,9 @@ if __name__ == "__main__":
         client_address_data,
         server_address_data,
         args.verbose,
+        args.x_format,
+        args.algorithm,
+        args.mixture_cache,
     )
 
     try:
@@ -0,0 +1,501 @@
+/*
+ * cnn_compute.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "cnn_compute.hpp"
+
+using namespace std;
+
+namespace meica
+{
+// Columns of B and C processed together, so a tile of a row of C stays in L1.
+static constexpr size_t GEMM_TILE_N = 512;
+
+static uint16_t load_le16(const uint8_t *p)
+{
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t load_le32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) |
+	       (static_cast<uint32_t>(p[1]) << 8) |
+	       (static_cast<uint32_t>(p[2]) << 16) |
+	       (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void store_le16(vector<uint8_t> &out, uint16_t v)
+{
+	out.push_back(static_cast<uint8_t>(v & 0xff));
+	out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+static void store_le32(vector<uint8_t> &out, uint32_t v)
+{
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(static_cast<uint8_t>((v >> (8 * i)) & 0xff));
+	}
+}
+
+static bool has_weights(cnn_layer_type type)
+{
+	return type == cnn_layer_type::CONV1D || type == cnn_layer_type::DENSE;
+}
+
+static void dequantize(cnn_layer &l)
+{
+	const size_t cols = l.qweight.size() / l.out_channels;
+	l.weight.resize(l.qweight.size());
+	for (size_t o = 0; o < l.out_channels; ++o) {
+		for (size_t i = 0; i < cols; ++i) {
+			l.weight[o * cols + i] =
+				l.scale[o] * l.qweight[o * cols + i];
+		}
+	}
+}
+
+void gemm_bias_act(const float *A, const float *B, float *C, size_t M,
+		   size_t K, size_t N, const float *bias, cnn_activation act)
+{
+	size_t i, j, k, j0, nb;
+
+	for (j0 = 0; j0 < N; j0 += GEMM_TILE_N) {
+		nb = min(GEMM_TILE_N, N - j0);
+		for (i = 0; i < M; ++i) {
+			float *c = C + i * N + j0;
+			const float *a = A + i * K;
+			for (j = 0; j < nb; ++j) {
+				c[j] = bias[i];
+			}
+			// The inner loop runs on contiguous rows of B and C.
+			for (k = 0; k < K; ++k) {
+				const float aik = a[k];
+				const float *b = B + k * N + j0;
+				for (j = 0; j < nb; ++j) {
+					c[j] += aik * b[j];
+				}
+			}
+			if (act == cnn_activation::RELU) {
+				for (j = 0; j < nb; ++j) {
+					c[j] = max(c[j], 0.0f);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * col[(c * kernel + t), j] = in[c, j * stride + t - padding], zero outside.
+ */
+static void im2col(const float *in, cnn_shape s, const cnn_layer &l,
+		   size_t out_len, float *col)
+{
+	size_t c, t, j;
+
+	for (c = 0; c < s.channels; ++c) {
+		const float *x = in + c * s.length;
+		for (t = 0; t < l.kernel; ++t) {
+			float *row = col + (c * l.kernel + t) * out_len;
+			for (j = 0; j < out_len; ++j) {
+				const long pos = static_cast<long>(j * l.stride + t) -
+						 static_cast<long>(l.padding);
+				row[j] = (pos >= 0 && pos < static_cast<long>(
+								     s.length)) ?
+						 x[pos] :
+						 0.0f;
+			}
+		}
+	}
+}
+
+cnn_model::cnn_model() : in_channels_(0), act_size_(0), col_size_(0)
+{
+}
+
+bool cnn_model::load(const string &path)
+{
+	ifstream in(path, ios::binary);
+	if (!in) {
+		return false;
+	}
+	vector<uint8_t> data((istreambuf_iterator<char>(in)),
+			     istreambuf_iterator<char>());
+	return load(data.data(), data.size());
+}
+
+bool cnn_model::load(const uint8_t *data, size_t len)
+{
+	vector<cnn_layer> layers;
+	size_t off = CNN_MODEL_HEADER_LEN;
+	uint32_t layer_num;
+	uint32_t channels;
+
+	if (len < CNN_MODEL_HEADER_LEN ||
+	    memcmp(data, CNN_MODEL_MAGIC, sizeof(CNN_MODEL_MAGIC)) != 0) {
+		return false;
+	}
+	channels = load_le32(data + 4);
+	layer_num = load_le32(data + 8);
+
+	for (uint32_t i = 0; i < layer_num; ++i) {
+		cnn_layer l;
+		if (len - off < CNN_LAYER_HEADER_LEN) {
+			return false;
+		}
+		const uint8_t *p = data + off;
+		if (p[0] > static_cast<uint8_t>(cnn_layer_type::DENSE) ||
+		    p[1] > static_cast<uint8_t>(cnn_activation::RELU)) {
+			return false;
+		}
+		l.type = static_cast<cnn_layer_type>(p[0]);
+		l.activation = static_cast<cnn_activation>(p[1]);
+		l.kernel = load_le16(p + 2);
+		l.stride = load_le16(p + 4);
+		l.padding = load_le16(p + 6);
+		l.in_channels = load_le32(p + 8);
+		l.out_channels = load_le32(p + 12);
+		off += CNN_LAYER_HEADER_LEN;
+		if (l.kernel == 0 || l.stride == 0) {
+			return false;
+		}
+		if (has_weights(l.type)) {
+			if (l.type == cnn_layer_type::DENSE && l.kernel != 1) {
+				return false;
+			}
+			const size_t n = l.out_channels;
+			const size_t wn = n * l.in_channels * l.kernel;
+			if (n == 0 || (len - off) / 9 < n ||
+			    len - off < 8 * n + wn) {
+				return false;
+			}
+			l.scale.resize(n);
+			l.bias.resize(n);
+			l.qweight.resize(wn);
+			memcpy(l.scale.data(), data + off, 4 * n);
+			memcpy(l.bias.data(), data + off + 4 * n, 4 * n);
+			memcpy(l.qweight.data(), data + off + 8 * n, wn);
+			off += 8 * n + wn;
+			dequantize(l);
+		}
+		layers.push_back(std::move(l));
+	}
+	if (off != len) {
+		return false;
+	}
+	in_channels_ = channels;
+	layers_ = std::move(layers);
+	return true;
+}
+
+void cnn_model::save(vector<uint8_t> &out) const
+{
+	out.clear();
+	out.insert(out.end(), CNN_MODEL_MAGIC,
+		   CNN_MODEL_MAGIC + sizeof(CNN_MODEL_MAGIC));
+	store_le32(out, static_cast<uint32_t>(in_channels_));
+	store_le32(out, static_cast<uint32_t>(layers_.size()));
+	store_le32(out, 0);
+	for (const auto &l : layers_) {
+		out.push_back(static_cast<uint8_t>(l.type));
+		out.push_back(static_cast<uint8_t>(l.activation));
+		store_le16(out, l.kernel);
+		store_le16(out, l.stride);
+		store_le16(out, l.padding);
+		store_le32(out, l.in_channels);
+		store_le32(out, l.out_channels);
+		store_le32(out, 0);
+		if (has_weights(l.type)) {
+			const uint8_t *scale =
+				reinterpret_cast<const uint8_t *>(l.scale.data());
+			const uint8_t *bias =
+				reinterpret_cast<const uint8_t *>(l.bias.data());
+			const uint8_t *w =
+				reinterpret_cast<const uint8_t *>(l.qweight.data());
+			out.insert(out.end(), scale, scale + 4 * l.scale.size());
+			out.insert(out.end(), bias, bias + 4 * l.bias.size());
+			out.insert(out.end(), w, w + l.qweight.size());
+		}
+	}
+}
+
+void cnn_model::add_layer(cnn_layer_type type, cnn_activation activation,
+			  uint32_t in_channels, uint32_t out_channels,
+			  uint16_t kernel, uint16_t stride, uint16_t padding,
+			  const vector<float> &weight,
+			  const vector<float> &bias)
+{
+	cnn_layer l;
+
+	if (layers_.empty()) {
+		in_channels_ = in_channels;
+	}
+	l.type = type;
+	l.activation = activation;
+	l.kernel = kernel;
+	l.stride = stride;
+	l.padding = padding;
+	l.in_channels = in_channels;
+	l.out_channels = out_channels;
+	if (has_weights(type)) {
+		const size_t cols = static_cast<size_t>(in_channels) * kernel;
+		if (weight.size() != out_channels * cols ||
+		    bias.size() != out_channels) {
+			throw invalid_argument("Invalid shape of the weights.");
+		}
+		l.scale.resize(out_channels);
+		l.qweight.resize(weight.size());
+		l.bias = bias;
+		// Symmetric quantization per output channel.
+		for (size_t o = 0; o < out_channels; ++o) {
+			float amax = 0.0f;
+			for (size_t i = 0; i < cols; ++i) {
+				amax = max(amax, fabs(weight[o * cols + i]));
+			}
+			l.scale[o] = amax > 0.0f ? amax / 127.0f : 1.0f;
+			for (size_t i = 0; i < cols; ++i) {
+				l.qweight[o * cols + i] = static_cast<int8_t>(
+					lround(weight[o * cols + i] /
+					       l.scale[o]));
+			}
+		}
+		dequantize(l);
+	}
+	layers_.push_back(std::move(l));
+}
+
+bool cnn_model::layer_output_shape(const cnn_layer &l, cnn_shape in,
+				   cnn_shape &out) const
+{
+	switch (l.type) {
+	case cnn_layer_type::CONV1D:
+		if (in.channels != l.in_channels ||
+		    in.length + 2 * l.padding < l.kernel) {
+			return false;
+		}
+		out.channels = l.out_channels;
+		out.length = (in.length + 2 * l.padding - l.kernel) / l.stride +
+			     1;
+		return true;
+	case cnn_layer_type::MAX_POOL1D:
+		if (in.length < l.kernel) {
+			return false;
+		}
+		out.channels = in.channels;
+		out.length = (in.length - l.kernel) / l.stride + 1;
+		return true;
+	case cnn_layer_type::GLOBAL_AVG_POOL:
+		if (in.length == 0) {
+			return false;
+		}
+		out.channels = in.channels;
+		out.length = 1;
+		return true;
+	case cnn_layer_type::DENSE:
+		if (in.channels * in.length != l.in_channels) {
+			return false;
+		}
+		out.channels = l.out_channels;
+		out.length = 1;
+		return true;
+	}
+	return false;
+}
+
+bool cnn_model::output_shape(size_t first, size_t last, cnn_shape in,
+			     cnn_shape &out) const
+{
+	if (first > last || last > layers_.size()) {
+		return false;
+	}
+	out = in;
+	for (size_t i = first; i < last; ++i) {
+		cnn_shape next;
+		if (!layer_output_shape(layers_[i], out, next)) {
+			return false;
+		}
+		out = next;
+	}
+	return true;
+}
+
+bool cnn_model::plan(cnn_shape in, size_t first, size_t last)
+{
+	size_t act_size = in.channels * in.length;
+	size_t col_size = 0;
+	cnn_shape s = in;
+
+	if (first > last || last > layers_.size()) {
+		return false;
+	}
+	for (size_t i = first; i < last; ++i) {
+		const cnn_layer &l = layers_[i];
+		cnn_shape next;
+		if (!layer_output_shape(l, s, next)) {
+			return false;
+		}
+		if (l.type == cnn_layer_type::CONV1D) {
+			col_size = max(col_size, static_cast<size_t>(l.in_channels) *
+							 l.kernel * next.length);
+		}
+		act_size = max(act_size, next.channels * next.length);
+		s = next;
+	}
+	if (act_size > act_size_ || col_size > col_size_) {
+		act_size_ = max(act_size, act_size_);
+		col_size_ = max(col_size, col_size_);
+		arena_.resize(2 * act_size_ + col_size_);
+	}
+	return true;
+}
+
+const float *cnn_model::run(const float *input, cnn_shape in, cnn_shape &out,
+			    size_t first, size_t last)
+{
+	if (!plan(in, first, last)) {
+		throw invalid_argument("Input does not fit the CNN layers.");
+	}
+	float *bufs[2] = { arena_.data(), arena_.data() + act_size_ };
+	float *col = arena_.data() + 2 * act_size_;
+	const float *x = input;
+	cnn_shape s = in;
+	size_t cur = 0;
+	size_t c, j, t;
+
+	for (size_t i = first; i < last; ++i) {
+		const cnn_layer &l = layers_[i];
+		float *y = bufs[cur];
+		cnn_shape next;
+		layer_output_shape(l, s, next);
+
+		switch (l.type) {
+		case cnn_layer_type::CONV1D: {
+			const float *B = x;
+			// Pointwise convolutions need no lowering.
+			if (l.kernel != 1 || l.stride != 1 || l.padding != 0) {
+				im2col(x, s, l, next.length, col);
+				B = col;
+			}
+			gemm_bias_act(l.weight.data(), B, y, l.out_channels,
+				      static_cast<size_t>(l.in_channels) *
+					      l.kernel,
+				      next.length, l.bias.data(), l.activation);
+			break;
+		}
+		case cnn_layer_type::MAX_POOL1D:
+			for (c = 0; c < s.channels; ++c) {
+				const float *xc = x + c * s.length;
+				for (j = 0; j < next.length; ++j) {
+					float v = xc[j * l.stride];
+					for (t = 1; t < l.kernel; ++t) {
+						v = max(v, xc[j * l.stride + t]);
+					}
+					y[c * next.length + j] = v;
+				}
+			}
+			break;
+		case cnn_layer_type::GLOBAL_AVG_POOL:
+			for (c = 0; c < s.channels; ++c) {
+				const float *xc = x + c * s.length;
+				float sum = 0.0f;
+				for (j = 0; j < s.length; ++j) {
+					sum += xc[j];
+				}
+				y[c] = sum / s.length;
+			}
+			break;
+		case cnn_layer_type::DENSE:
+			gemm_bias_act(l.weight.data(), x, y, l.out_channels,
+				      l.in_channels, 1, l.bias.data(),
+				      l.activation);
+			break;
+		}
+		x = y;
+		s = next;
+		cur ^= 1;
+	}
+	out = s;
+	return x;
+}
+
+vector<double> measure_layer_costs(cnn_model &model, cnn_shape in,
+				   uint32_t repeat)
+{
+	const size_t n = model.layers().size();
+	vector<double> costs(n, 0.0);
+	vector<float> x(in.channels * in.length, 0.5f);
+	vector<float> y;
+	cnn_shape s = in;
+
+	repeat = max(repeat, 1U);
+	if (!model.plan(in, 0, n)) {
+		throw invalid_argument("Input does not fit the CNN layers.");
+	}
+	for (size_t i = 0; i < n; ++i) {
+		cnn_shape out;
+		const float *r = nullptr;
+		auto start = chrono::steady_clock::now();
+		for (uint32_t k = 0; k < repeat; ++k) {
+			r = model.run(x.data(), s, out, i, i + 1);
+		}
+		auto end = chrono::steady_clock::now();
+		costs[i] = chrono::duration<double>(end - start).count() /
+			   repeat;
+		// The output of this layer is the input of the next one.
+		y.assign(r, r + out.channels * out.length);
+		x.swap(y);
+		s = out;
+	}
+	return costs;
+}
+
+vector<size_t> balance_layer_split(const vector<double> &costs, size_t parts)
+{
+	const size_t n = costs.size();
+	vector<double> prefix(n + 1, 0.0);
+	size_t i, j, k;
+
+	parts = max(min(parts, n), static_cast<size_t>(1));
+	for (i = 0; i < n; ++i) {
+		prefix[i + 1] = prefix[i] + costs[i];
+	}
+	// best[k][j]: minimal maximal cost of the first j layers in k ranges.
+	vector<vector<double> > best(
+		parts + 1,
+		vector<double>(n + 1, numeric_limits<double>::infinity()));
+	vector<vector<size_t> > from(parts + 1, vector<size_t>(n + 1, 0));
+	best[0][0] = 0.0;
+	for (k = 1; k <= parts; ++k) {
+		for (j = 1; j <= n; ++j) {
+			for (i = k - 1; i < j; ++i) {
+				double c = max(best[k - 1][i],
+					       prefix[j] - prefix[i]);
+				if (c < best[k][j]) {
+					best[k][j] = c;
+					from[k][j] = i;
+				}
+			}
+		}
+	}
+
+	vector<size_t> bounds(parts + 1);
+	bounds[parts] = n;
+	for (k = parts, j = n; k > 0; --k) {
+		j = from[k][j];
+		bounds[k - 1] = j;
+	}
+	// Empty ranges are never better, but drop them to be safe.
+	bounds.erase(unique(bounds.begin(), bounds.end()), bounds.end());
+	return bounds;
+}
+
+} // namespace meica
@@ -0,0 +1,174 @@
+/*
+ * cnn_compute.hpp
+ *
+ * Native CPU inference of 1D convolutional audio models for ./cnn_vnf.cpp.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace meica
+{
+/**
+ * Flat weight file of a model, all fields are little-endian:
+ *
+ * - Model header (16B): magic "CNN1" (4B), in_channels (4B), layer number (4B),
+ *   reserved (4B).
+ * - For each layer, a layer header (20B): type (1B), activation (1B),
+ *   kernel (2B), stride (2B), padding (2B), in_channels (4B),
+ *   out_channels (4B), reserved (4B).
+ * - For CONV1D and DENSE layers, followed by float32 scale[out_channels],
+ *   float32 bias[out_channels] and int8 weights[out_channels][in_channels]
+ *   [kernel] (kernel is 1 for DENSE). The weight of output channel o is
+ *   scale[o] * weights[o].
+ *
+ * in_channels of a DENSE layer is the flattened size channels * length of its
+ * input.
+ */
+constexpr uint8_t CNN_MODEL_MAGIC[4] = { 'C', 'N', 'N', '1' };
+constexpr size_t CNN_MODEL_HEADER_LEN = 16;
+constexpr size_t CNN_LAYER_HEADER_LEN = 20;
+
+enum class cnn_layer_type : uint8_t {
+	CONV1D = 0,
+	MAX_POOL1D = 1,
+	GLOBAL_AVG_POOL = 2,
+	DENSE = 3,
+};
+
+enum class cnn_activation : uint8_t {
+	NONE = 0,
+	RELU = 1,
+};
+
+struct cnn_layer {
+	cnn_layer_type type;
+	cnn_activation activation;
+	uint16_t kernel;
+	uint16_t stride;
+	uint16_t padding;
+	uint32_t in_channels;
+	uint32_t out_channels;
+	std::vector<float> scale;
+	std::vector<float> bias;
+	std::vector<int8_t> qweight;
+	// Dequantized weights of the shape (out_channels, in_channels * kernel)
+	// for the float32 GEMM.
+	std::vector<float> weight;
+};
+
+/**
+ * Shape (channels, length) of an activation tensor. Tensors are stored
+ * channel-major, i.e. element (c, t) is at c * length + t.
+ */
+struct cnn_shape {
+	size_t channels;
+	size_t length;
+};
+
+/**
+ * 1D CNN with int8 weights.
+ *
+ * Convolutions are lowered with im2col to a float32 GEMM with the bias and the
+ * activation fused into the GEMM epilogue. Activations live in an arena that
+ * is sized by plan() for the longest input seen so far, so run() does not
+ * allocate in the steady state.
+ */
+class cnn_model {
+public:
+	cnn_model();
+
+	/* Load a flat weight file, return false if it is invalid. */
+	bool load(const std::string &path);
+	bool load(const uint8_t *data, size_t len);
+	void save(std::vector<uint8_t> &out) const;
+
+	/**
+	 * Append a layer, weights are quantized to int8 per output channel.
+	 * weight has the shape (out_channels, in_channels * kernel).
+	 */
+	void add_layer(cnn_layer_type type, cnn_activation activation,
+		       uint32_t in_channels, uint32_t out_channels,
+		       uint16_t kernel, uint16_t stride, uint16_t padding,
+		       const std::vector<float> &weight,
+		       const std::vector<float> &bias);
+
+	size_t in_channels() const
+	{
+		return in_channels_;
+	}
+	const std::vector<cnn_layer> &layers() const
+	{
+		return layers_;
+	}
+
+	/**
+	 * Output shape of the layers [first, last) for the given input shape,
+	 * return false if the input does not fit the layers.
+	 */
+	bool output_shape(size_t first, size_t last, cnn_shape in,
+			  cnn_shape &out) const;
+
+	/**
+	 * Grow the arena for the layers [first, last) on inputs of shape in,
+	 * return false if the input does not fit the layers.
+	 */
+	bool plan(cnn_shape in, size_t first, size_t last);
+	bool plan(size_t length)
+	{
+		return plan(cnn_shape{ in_channels_, length }, 0, layers_.size());
+	}
+
+	/**
+	 * Run the layers [first, last) on the input tensor of shape in. The
+	 * result stays valid until the next run. Throw invalid_argument if
+	 * the input does not fit the layers.
+	 */
+	const float *run(const float *input, cnn_shape in, cnn_shape &out,
+			 size_t first, size_t last);
+	const float *run(const float *input, cnn_shape in, cnn_shape &out)
+	{
+		return run(input, in, out, 0, layers_.size());
+	}
+
+private:
+	bool layer_output_shape(const cnn_layer &l, cnn_shape in,
+				cnn_shape &out) const;
+
+	size_t in_channels_;
+	std::vector<cnn_layer> layers_;
+	// Two ping-pong activation buffers and the im2col buffer.
+	std::vector<float> arena_;
+	size_t act_size_;
+	size_t col_size_;
+};
+
+/**
+ * Average run time (seconds) of each layer of the model on inputs of shape in
+ * over repeat runs.
+ */
+std::vector<double> measure_layer_costs(cnn_model &model, cnn_shape in,
+					uint32_t repeat);
+
+/**
+ * Split the layers with the given costs into at most parts contiguous ranges
+ * so that the maximal cost of a range is minimal. Return the boundaries
+ * 0 = b_0 < b_1 < ... < b_k = costs.size(), range i is [b_i, b_(i+1)).
+ */
+std::vector<size_t> balance_layer_split(const std::vector<double> &costs,
+					size_t parts);
+
+/**
+ * C = act(A @ B + bias[:, None]) with A of the shape (M, K) and B of the shape
+ * (K, N), all row-major.
+ */
+void gemm_bias_act(const float *A, const float *B, float *C, size_t M,
+		   size_t K, size_t N, const float *bias, cnn_activation act);
+
+} // namespace meica
@@ -9,10 +9,13 @@
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <numeric>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -38,7 +41,10 @@ namespace py = pybind11;
 namespace po = boost::program_options;
 #include <boost/asio/ip/host_name.hpp>
 
+#include "cnn_compute.hpp"
+#include "matrix_codec.hpp"
 #include "meica_vnf_utils.hpp"
+#include "py_worker.hpp"
 
 using namespace std;
 
@@ -46,10 +52,17 @@ namespace meica
 {
 /* MEICA VNF related constants */
 static constexpr uint16_t BURST_SIZE = 128; // burst size for both RX and TX.
-static constexpr uint16_t MAX_CHUNK_SIZE = 1400; // bytes
+// Mbufs of the RX pool for jumbo chunks.
+static constexpr unsigned int NUM_RX_MBUFS = 8191;
+// Message type of the inference results.
+static constexpr uint8_t CNN_RESULT_MSG_TYPE = 2;
+// Message type of the intermediate activations of the layer-split pipeline,
+// iter_num is the index of the next layer to run.
+static constexpr uint8_t CNN_ACTIVATION_MSG_TYPE = 3;
 
 /* TODO:  <26-01-21, Zuo>: Remove this global variable. */
 struct rte_mempool *fast_forward_pool = NULL;
+struct tx_cksum_conf tx_cksum_conf;
 
 /**
  * Working states of the MEICA VNF.
@@ -73,6 +86,9 @@ struct vnf_info {
 /* Global variables.*/
 static volatile bool g_force_quit = false;
 static bool g_verbose = false;
+// Local maximal chunk payload size, the chunk size of a flow is negotiated up
+// to it.
+static uint16_t g_max_chunk_size = DEFAULT_CHUNK_SIZE;
 
 static void signal_handler(int signum)
 {
@@ -81,6 +97,27 @@ static void signal_handler(int signum)
 	}
 }
 
+/**
+ * Prepare checksums and send a burst of chunks. Unsent chunks are freed.
+ */
+uint16_t send_burst(const struct ffpp_munf_manager &manager,
+		    struct rte_mbuf **tx_buf, uint16_t nb_pkts)
+{
+	uint16_t nb_prep = 0;
+	uint16_t nb_tx = 0;
+	uint16_t i;
+
+	if (nb_pkts == 0) {
+		return 0;
+	}
+	nb_prep = prepare_tx_cksum(tx_cksum_conf, tx_buf, nb_pkts);
+	nb_tx = rte_eth_tx_burst(manager.tx_port_id, 0, tx_buf, nb_prep);
+	for (i = nb_tx; i < nb_pkts; ++i) {
+		rte_pktmbuf_free(tx_buf[i]);
+	}
+	return nb_tx;
+}
+
 /**
  * Main loop for store and forward mode.
  */
@@ -111,42 +148,34 @@ void run_store_forward_loop(const struct ffpp_munf_manager &manager)
 				rte_pktmbuf_free(m);
 				continue;
 			}
-			disable_udp_cksum(m);
 			tx_buf[t] = rx_buf[r];
 			++t;
 		}
 
-		fw_num +=
-			rte_eth_tx_burst(manager.tx_port_id, 0, tx_buf, nb_rx);
+		fw_num += send_burst(manager, tx_buf, t);
 		RTE_LOG(DEBUG, USER1, "[FWD] Totally forwarded %lu packets.\n",
 			fw_num);
 	}
 }
 
 /**
- * De-fragment all chunks of a message and return the message data.
+ * De-fragment all chunks of a message into msg_data.
+ *
+ * msg_data is reused across messages to avoid reallocations.
  */
-string defragment(const vector<struct rte_mbuf *> &chunk_buf,
-		  const vector<struct service_header_cpu> &service_hdr_buf)
+void defragment(const vector<struct rte_mbuf *> &chunk_buf,
+		const vector<struct service_header_cpu> &service_hdr_buf,
+		vector<uint8_t> &msg_data)
 {
-	service_header_cpu service_hdr;
-
-	string msg_data;
-	const uint8_t *payload = nullptr;
 	assert(chunk_buf.size() == service_hdr_buf.size());
 	auto iter_hdr = service_hdr_buf.cbegin();
 	auto iter_chunk = chunk_buf.cbegin();
 
+	msg_data.clear();
 	for (iter_hdr, iter_chunk; iter_hdr < service_hdr_buf.cend();
 	     ++iter_hdr, ++iter_chunk) {
-		payload = rte_pktmbuf_mtod_offset((*iter_chunk), uint8_t *,
-						  SERVICE_HEADER_OFFSET +
-							  SERVICE_HEADER_LEN);
-		msg_data.append((char *)payload,
-				((*iter_hdr).chunk_len - SERVICE_HEADER_LEN));
+		append_chunk_payload(*iter_chunk, *iter_hdr, msg_data);
 	}
-
-	return msg_data;
 }
 
 void reset_bufs(vector<struct rte_mbuf *> &chunk_buf,
@@ -181,16 +210,24 @@ bool inline check_service_hdr_buf(
 	return true;
 }
 
+/**
+ * Receive all chunks of a message. Data messages are fast forwarded unless
+ * forward_X is false, i.e. the X is consumed by the first hop of the
+ * layer-split pipeline.
+ */
 bool recv_chunks(const struct ffpp_munf_manager &manager,
 		 vector<struct rte_mbuf *> &chunk_buf,
-		 vector<struct service_header_cpu> &service_hdr_buf)
+		 vector<struct service_header_cpu> &service_hdr_buf,
+		 bool forward_X)
 {
 	struct rte_mbuf *m;
 	struct rte_mbuf *m_copy;
 	struct rte_mbuf *rx_buf[BURST_SIZE];
+	struct rte_mbuf *tx_buf[BURST_SIZE];
 	struct service_header_cpu service_hdr;
 
 	uint16_t r = 0;
+	uint16_t t = 0;
 	uint16_t nb_rx = 0;
 	bool recv_timeout = false;
 
@@ -205,6 +242,7 @@ bool recv_chunks(const struct ffpp_munf_manager &manager,
 			rte_delay_us_sleep(1e3);
 			continue;
 		}
+		t = 0;
 		for (r = 0; r < nb_rx; ++r) {
 			m = rx_buf[r];
 			if (!is_valid_chunk(m)) {
@@ -212,16 +250,22 @@ bool recv_chunks(const struct ffpp_munf_manager &manager,
 				continue;
 			}
 			service_hdr = unpack_service_header(m);
+			if (!chunk_lengths_valid(m, service_hdr)) {
+				RTE_LOG(DEBUG, USER1,
+					"Drop a chunk with invalid lengths.\n");
+				rte_pktmbuf_free(m);
+				continue;
+			}
 			// Fast forward all data messages
-			if (service_hdr.msg_type == 0) {
+			if (service_hdr.msg_type == 0 && forward_X) {
 				m_copy = deepcopy_chunk(fast_forward_pool, m);
-				disable_udp_cksum(m_copy);
-				rte_eth_tx_burst(manager.tx_port_id, 0, &m_copy,
-						 1);
+				tx_buf[t] = m_copy;
+				++t;
 			}
 			chunk_buf.push_back(m);
 			service_hdr_buf.push_back(service_hdr);
 		}
+		send_burst(manager, tx_buf, t);
 		if (service_hdr_buf.back().chunk_num ==
 		    service_hdr_buf.back().total_chunk_num - 1) {
 			break;
@@ -274,63 +318,137 @@ void recover_chunks(vector<struct rte_mbuf *> &chunk_buf,
 	reorder(service_hdr_buf, indices);
 }
 
-/**
- * Update IP and UDP total length fields with the given chunk payload length.
- */
-void update_l3_l4_header(struct rte_mbuf *m, uint32_t payload_len)
-{
-	struct rte_ipv4_hdr *ipv4_hdr;
-	struct rte_udp_hdr *udp_hdr;
-	ipv4_hdr = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
-					   sizeof(struct rte_ether_hdr));
-	udp_hdr = (struct rte_udp_hdr *)((unsigned char *)ipv4_hdr +
-					 sizeof(struct rte_ipv4_hdr));
-
-	uint16_t udp_dgram_len =
-		payload_len + SERVICE_HEADER_LEN + sizeof(struct rte_udp_hdr);
-	uint16_t ip_total_length = udp_dgram_len + sizeof(struct rte_ipv4_hdr);
-	udp_hdr->dgram_len = rte_cpu_to_be_16(udp_dgram_len);
-	ipv4_hdr->total_length = rte_cpu_to_be_16(ip_total_length);
-}
-
 // This is the function that calls the run_cnn_dist function in ./cnn_vnf.py
 // to process the received X data.
-string process_chunks(const struct ffpp_munf_manager &manager,
-		      const struct rte_mbuf *m_data_full,
+string process_chunks(py_worker &worker, const struct rte_mbuf *m_data_full,
 		      struct service_header_cpu hdr_template,
-		      const string &X_bytes)
+		      const vector<uint8_t> &X_bytes)
 {
-	auto cnn_vnf_module = py::module::import("cnn_vnf");
-	auto run_cnn_dist_func = cnn_vnf_module.attr("run_cnn_dist");
+	string bytes_out;
 
 	/* TODO: <He> Add metadata of processed data if needed. */
-	string bytes_out = run_cnn_dist_func(static_cast<py::bytes>(X_bytes))
-				   .cast<string>();
+	worker.run([&](const py::object &run_cnn_dist_func) {
+		py::buffer out = run_cnn_dist_func(
+			make_memoryview(X_bytes.data(), X_bytes.size()));
+		py::buffer_info info = out.request();
+		bytes_out.assign(static_cast<const char *>(info.ptr),
+				 info.size * info.itemsize);
+	});
 
 	return bytes_out;
 }
 
+/**
+ * Copy a raw matrix of any dtype and order into the float32 input tensor, the
+ * rows of the matrix are the channels. Return false if data is not a raw
+ * matrix.
+ */
+bool raw_matrix_to_tensor(const uint8_t *data, size_t len, vector<float> &input,
+			  struct cnn_shape &shape)
+{
+	struct raw_matrix_header hdr;
+	const uint8_t *p = data + RAW_MATRIX_HEADER_LEN;
+	size_t i, j, idx;
+
+	if (!parse_raw_matrix(data, len, hdr)) {
+		return false;
+	}
+	shape.channels = hdr.rows;
+	shape.length = hdr.cols;
+	input.resize(shape.channels * shape.length);
+	for (i = 0; i < shape.channels; ++i) {
+		for (j = 0; j < shape.length; ++j) {
+			idx = (hdr.order == raw_order::C) ?
+				      i * shape.length + j :
+				      j * shape.channels + i;
+			if (hdr.dtype == raw_dtype::FLOAT64) {
+				double v;
+				memcpy(&v, p + idx * sizeof(v), sizeof(v));
+				input[i * shape.length + j] =
+					static_cast<float>(v);
+			} else {
+				memcpy(&input[i * shape.length + j],
+				       p + idx * sizeof(float), sizeof(float));
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Run the layers [first, last) of the native model on X (or the activations of
+ * the previous hop), the output tensor is encoded as a raw float32 matrix into
+ * bytes_out. Return false if X does not fit the layers.
+ */
+bool process_chunks_native(cnn_model &model, const vector<uint8_t> &X_bytes,
+			   size_t first, size_t last, vector<float> &input,
+			   vector<uint8_t> &bytes_out)
+{
+	struct cnn_shape in;
+	struct cnn_shape out;
+
+	if (!raw_matrix_to_tensor(X_bytes.data(), X_bytes.size(), input, in) ||
+	    !model.plan(in, first, last)) {
+		return false;
+	}
+	const float *y = model.run(input.data(), in, out, first, last);
+	encode_raw_matrix_f32(y, out.channels, out.length, bytes_out);
+	return true;
+}
+
+/**
+ * Index of the last layer (exclusive) of the pipeline stage which starts at
+ * first. split holds the stage boundaries, an empty split is a single stage.
+ */
+size_t stage_end(const vector<size_t> &split, size_t first, size_t layer_num)
+{
+	auto it = upper_bound(split.begin(), split.end(), first);
+	return (it == split.end()) ? layer_num : min(*it, layer_num);
+}
+
+/**
+ * Replace the X chunks with the result chunks of the message. A result of the
+ * layers up to next_layer of a model with layer_num layers is sent as
+ * activations.
+ */
+void update_chunk_buf(vector<struct rte_mbuf *> &chunk_buf,
+		      vector<struct service_header_cpu> &service_hdr_buf,
+		      const struct chunk_header_template &hdr_tmpl,
+		      const uint8_t *result, size_t result_len,
+		      size_t next_layer, size_t layer_num)
+{
+	struct service_header_cpu new_hdr = service_hdr_buf.front();
+	new_hdr.msg_type = (next_layer < layer_num) ? CNN_ACTIVATION_MSG_TYPE :
+						      CNN_RESULT_MSG_TYPE;
+	new_hdr.msg_flags = 0;
+	new_hdr.data_chunk_num = 0;
+	new_hdr.iter_num =
+		(next_layer < layer_num) ? static_cast<uint16_t>(next_layer) : 0;
+
+	reset_bufs(chunk_buf, service_hdr_buf);
+	if (!create_chunks(fast_forward_pool, hdr_tmpl, new_hdr, result,
+			   result_len, hdr_tmpl.chunk_size, chunk_buf)) {
+		rte_exit(EXIT_FAILURE, "Failed to create result chunks!\n");
+	}
+}
+
 /**
  * The operation performed before sending all chunks.
  *
- * - Handle checksums.
  * - Could be used to add recoded chunks with RLNC.
  */
 void pre_send_chunks(vector<struct rte_mbuf *> &chunk_buf)
 {
-	for (auto c : chunk_buf) {
-		recalc_ipv4_udp_cksum(c);
-	}
 }
 
 void send_chunks(const struct ffpp_munf_manager &manager,
 		 vector<struct rte_mbuf *> &chunk_buf)
 {
 	pre_send_chunks(chunk_buf);
-	uint64_t tx_num = 0;
-	// TODO (Zuo): Optimize to burst TX.
-	for (auto c : chunk_buf) {
-		tx_num += rte_eth_tx_burst(manager.tx_port_id, 0, &c, 1);
+	for (size_t i = 0; i < chunk_buf.size(); i += BURST_SIZE) {
+		uint16_t nb_tx = std::min(static_cast<size_t>(BURST_SIZE),
+					  chunk_buf.size() - i);
+		send_burst(manager, chunk_buf.data() + i, nb_tx);
 	}
 	RTE_LOG(DEBUG, USER1, "[CNN] Send %lu chunks.\n", chunk_buf.size());
 }
@@ -339,8 +457,12 @@ void send_chunks(const struct ffpp_munf_manager &manager,
  * Main loop for compute and forward mode.
  */
 void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
-			      bool is_leader, uint32_t max_rounds)
+			      bool is_leader, uint32_t max_rounds,
+			      const string &engine, cnn_model &model,
+			      const vector<size_t> &split)
 {
+	const size_t layer_num = model.layers().size();
+	const bool pipeline = !split.empty();
 	struct rte_mbuf *m;
 	struct rte_mbuf *rx_buf[BURST_SIZE];
 	struct rte_mbuf *tx_buf[BURST_SIZE];
@@ -354,17 +476,37 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 
 	cout << "[CNN] Enter compute and forward loop." << endl;
 	cout << "\t- Maximal allowed processing rounds: " << max_rounds << endl;
+	cout << "\t- Compute engine: " << engine << endl;
+	if (pipeline) {
+		cout << "\t- Layer split:";
+		for (auto b : split) {
+			cout << " " << b;
+		}
+		cout << endl;
+	}
 
 	vector<struct rte_mbuf *> X_chunk_buf;
-	string X_bytes = "";
+	// Reassembly buffer, reused for all messages.
+	vector<uint8_t> X_bytes;
 	vector<struct service_header_cpu> X_service_hdr_buf;
+	// Input tensor and result of the native engine, reused for all
+	// messages.
+	vector<float> input;
+	vector<uint8_t> result_bytes;
+	struct chunk_header_template hdr_tmpl = {};
+	// Layers [first, last) of the message run on this hop.
+	size_t first = 0;
+	size_t last = layer_num;
 
 	struct vnf_info info = {
 		.state = VNF_STATE::RECV_X_CHUNKS,
 		.message_count = 0,
 	};
 
-	py::scoped_interpreter guard{};
+	py_worker worker("cnn_vnf", "run_cnn_dist");
+	if (engine == "python") {
+		worker.start();
+	}
 	while (!g_force_quit) {
 		switch (info.state) {
 		case VNF_STATE::RESET:
@@ -378,8 +520,8 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 			       X_service_hdr_buf.size() == 0);
 			RTE_LOG(DEBUG, USER1,
 				"State: Receive and send X chunks.\n");
-			if (recv_chunks(manager, X_chunk_buf,
-					X_service_hdr_buf) == true) {
+			if (recv_chunks(manager, X_chunk_buf, X_service_hdr_buf,
+					!pipeline) == true) {
 				info.state = VNF_STATE::PROCESS_CHUNKS;
 			} else {
 				info.state = VNF_STATE::RESET;
@@ -399,24 +541,48 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 				rte_exit(EXIT_FAILURE,
 					 "Failed to recover data chunks!");
 			}
+			// Results of the last pipeline stage are only forwarded.
+			if (X_service_hdr_buf.front().msg_type ==
+			    CNN_RESULT_MSG_TYPE) {
+				info.state = VNF_STATE::SEND_RESULT_CHUNKS;
+				break;
+			}
 			// MARK: ASSUME result chunks are always in order.
-			X_bytes = defragment(X_chunk_buf, X_service_hdr_buf);
-
-			auto bytes_out =
-				process_chunks(manager, X_chunk_buf.front(),
-					       X_service_hdr_buf.front(),
-					       X_bytes);
-
-			/* TODO: <He> Update the X_chunk_buf and X_service_hdr_buf
-             * with the processed data: bytes_out.
-             *
-             * Something like:
-             *
-             * update_chunk_buf(X_chunk_buf, X_service_hdr_buf, bytes_out);
-             *
-             * The function rte_pktmbuf_free() can be used to free the redudant
-             * mbufs in the chunk_buf.
-             * */
+			defragment(X_chunk_buf, X_service_hdr_buf, X_bytes);
+			if (!header_template_matches(hdr_tmpl,
+						     X_chunk_buf.front())) {
+				capture_header_template(hdr_tmpl,
+							X_chunk_buf.front());
+			}
+			update_flow_chunk_size(hdr_tmpl, X_service_hdr_buf,
+					       g_max_chunk_size);
+
+			if (engine == "native") {
+				first = 0;
+				if (X_service_hdr_buf.front().msg_type ==
+				    CNN_ACTIVATION_MSG_TYPE) {
+					first = X_service_hdr_buf.front().iter_num;
+				}
+				last = stage_end(split, first, layer_num);
+				if (first >= layer_num ||
+				    !process_chunks_native(model, X_bytes, first,
+							   last, input,
+							   result_bytes)) {
+					RTE_LOG(WARNING, USER1,
+						"X does not fit the model, drop the message.\n");
+					info.state = VNF_STATE::RESET;
+					break;
+				}
+			} else {
+				auto bytes_out = process_chunks(
+					worker, X_chunk_buf.front(),
+					X_service_hdr_buf.front(), X_bytes);
+				result_bytes.assign(bytes_out.begin(),
+						    bytes_out.end());
+			}
+			update_chunk_buf(X_chunk_buf, X_service_hdr_buf,
+					 hdr_tmpl, result_bytes.data(),
+					 result_bytes.size(), last, layer_num);
 
 			info.state = VNF_STATE::SEND_RESULT_CHUNKS;
 			break;
@@ -437,7 +603,7 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 			g_force_quit = true;
 		}
 	}
-} // Python interpretor stops here (RAII).
+} // Python worker stops here (RAII).
 } // namespace meica
 
 int main(int argc, char *argv[])
@@ -445,10 +611,27 @@ int main(int argc, char *argv[])
 	bool is_leader = false;
 	string mode = "store_forward";
 	uint32_t max_rounds = 4;
+	string engine = "python";
+	string model_path;
+	string layer_split;
+	uint32_t pipeline_hops = 1;
+	uint32_t split_length = 32000;
+	vector<size_t> split;
 	string core = "1";
 	uint32_t mem = 512;
 	string host_name = boost::asio::ip::host_name();
+	string file_prefix;
 	string iface = host_name + "-s" + host_name.back();
+	struct meica::port_backend_conf backend_conf = {
+		.backend = "af_packet",
+		.iface = "",
+		.pcap_rx = "",
+		.pcap_tx = "",
+		.memif_rx = "",
+		.memif_tx = "",
+		.tx_iface = "",
+		.max_chunk_size = meica::DEFAULT_CHUNK_SIZE,
+	};
 	meica::g_force_quit = false;
 
 	try {
@@ -459,9 +642,22 @@ int main(int argc, char *argv[])
                         ("verbose,v", "Enable verbose mode.")
                         ("leader,l", "Run as the leader node.")
                         ("iface,i", po::value<string>(), "The name of the IO interface.")
+                        ("backend,b", po::value<string>(), "Set the port backend: af_packet, af_xdp, pcap or ring. The default is af_packet.")
+                        ("pcap_rx", po::value<string>(), "The pcap file to read packets from (pcap backend).")
+                        ("pcap_tx", po::value<string>(), "The pcap file to write packets to (pcap backend).")
+                        ("memif_rx", po::value<string>(), "Receive chunks from the memif socket of the upstream VNF on the same host instead of the IO interface.")
+                        ("memif_tx", po::value<string>(), "Send chunks to the downstream VNF on the same host via a memif port listening on this socket.")
+                        ("tx_iface", po::value<string>(), "Send chunks on this interface instead of the IO interface.")
+                        ("file_prefix", po::value<string>(), "The EAL file prefix, it must differ for the VNFs on the same host. The default is the host name.")
                         ("mode,m", po::value<string>(), "Set VNF mode. The default is store_forward.")
                         ("max_rounds", po::value<uint32_t>(), "Set the maximal allowed computing iterations.")
-                        ("core,c", po::value<string>(), "The CPU cores (split by comma) to use. For example, 0,1 will use first two CPU cores.")
+                        ("engine,e", po::value<string>(), "Set the compute engine: native or python. The default is python.")
+                        ("model", po::value<string>(), "The flat weight file of the model of the native engine, check ./cnn_compute.hpp for the format.")
+                        ("layer_split", po::value<string>(), "Run the model as a pipeline over several hops (native engine). Either the first layer of each stage after the first (split by comma), e.g. 3,5, or auto to balance the measured layer costs over --pipeline_hops stages.")
+                        ("pipeline_hops", po::value<uint32_t>(), "The number of pipeline stages of --layer_split auto. The default is 1.")
+                        ("split_length", po::value<uint32_t>(), "The input length used to measure the layer costs of --layer_split auto. The default is 32000.")
+                        ("core,c", po::value<string>(), "The CPU cores (split by comma) to use. For example, 0,1 will use first two CPU cores. The second core runs the Python compute worker.")
+                        ("max_chunk_size", po::value<uint32_t>(), "The maximal chunk payload size (bytes), up to 8956 for a 9000B jumbo frame MTU. The chunk size of a flow is the sender's one up to it. The default is 1400.")
                         ("mem", po::value<uint32_t>(), "Set the amount of memory to preallocate at startup.");
 		po::variables_map vm;
 		po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -481,15 +677,59 @@ int main(int argc, char *argv[])
                 if (vm.count("iface")) {
                         iface = vm["iface"].as<string>();
                 }
+                if (vm.count("backend")) {
+                        backend_conf.backend = vm["backend"].as<string>();
+                }
+                if (vm.count("pcap_rx")) {
+                        backend_conf.pcap_rx = vm["pcap_rx"].as<string>();
+                }
+                if (vm.count("pcap_tx")) {
+                        backend_conf.pcap_tx = vm["pcap_tx"].as<string>();
+                }
+                if (vm.count("memif_rx")) {
+                        backend_conf.memif_rx = vm["memif_rx"].as<string>();
+                }
+                if (vm.count("memif_tx")) {
+                        backend_conf.memif_tx = vm["memif_tx"].as<string>();
+                }
+                if (vm.count("tx_iface")) {
+                        backend_conf.tx_iface = vm["tx_iface"].as<string>();
+                }
+                if (vm.count("file_prefix")) {
+                        file_prefix = vm["file_prefix"].as<string>();
+                }
                 if (vm.count("mode")) {
                         mode = vm["mode"].as<string>();
                 }
                 if (vm.count("max_rounds")) {
                         max_rounds = vm["max_rounds"].as<uint32_t>();
                 }
+                if (vm.count("engine")) {
+                        engine = vm["engine"].as<string>();
+                }
+                if (vm.count("model")) {
+                        model_path = vm["model"].as<string>();
+                }
+                if (vm.count("layer_split")) {
+                        layer_split = vm["layer_split"].as<string>();
+                }
+                if (vm.count("pipeline_hops")) {
+                        pipeline_hops = vm["pipeline_hops"].as<uint32_t>();
+                }
+                if (vm.count("split_length")) {
+                        split_length = vm["split_length"].as<uint32_t>();
+                }
                 if (vm.count("core")) {
                         core = vm["core"].as<string>();
                 }
+                if (vm.count("max_chunk_size")) {
+                        uint32_t chunk_size = vm["max_chunk_size"].as<uint32_t>();
+                        if (chunk_size == 0 || chunk_size > meica::MAX_JUMBO_CHUNK_SIZE) {
+                                cerr << "Error: Invalid maximal chunk size: " << chunk_size << endl;
+                                return 1;
+                        }
+                        meica::g_max_chunk_size = static_cast<uint16_t>(chunk_size);
+                }
                 if (vm.count("mem")) {
                         mem = vm["mem"].as<uint32_t>();
                 }
@@ -504,7 +744,80 @@ int main(int argc, char *argv[])
 		cerr << "Error: Unknown mode: " << mode << endl;
 		return 0;
 	}
-                cout << "- Iterface name: " << iface << endl;
+	if (engine != "native" && engine != "python") {
+		cerr << "Error: Unknown engine: " << engine << endl;
+		return 0;
+	}
+	meica::cnn_model model;
+	if (engine == "native") {
+		if (!model.load(model_path)) {
+			cerr << "Error: Invalid model file: " << model_path << endl;
+			return 1;
+		}
+		cout << "- Model: " << model_path << ", "
+		     << model.layers().size() << " layers" << endl;
+	}
+	if (!layer_split.empty()) {
+		if (engine != "native") {
+			cerr << "Error: The layer split requires the native engine."
+			     << endl;
+			return 1;
+		}
+		if (layer_split == "auto") {
+			const meica::cnn_shape shape = { model.in_channels(),
+							 split_length };
+			if (!model.plan(shape, 0, model.layers().size())) {
+				cerr << "Error: The split length does not fit the model."
+				     << endl;
+				return 1;
+			}
+			// All hops must use the same split, so it is printed to
+			// be pinned on the other hops.
+			vector<double> costs =
+				meica::measure_layer_costs(model, shape, 10);
+			split = meica::balance_layer_split(costs, pipeline_hops);
+			cout << "- Layer costs (ms):";
+			for (auto c : costs) {
+				cout << " " << c * 1e3;
+			}
+			cout << endl;
+			cout << "- Balanced layer split: --layer_split ";
+			for (size_t i = 1; i + 1 < split.size(); ++i) {
+				cout << (i > 1 ? "," : "") << split[i];
+			}
+			cout << endl;
+		} else {
+			istringstream iss(layer_split);
+			string b;
+			split.push_back(0);
+			while (getline(iss, b, ',')) {
+				if (b.empty() ||
+				    b.find_first_not_of("0123456789") != string::npos) {
+					cerr << "Error: Invalid layer split: "
+					     << layer_split << endl;
+					return 1;
+				}
+				split.push_back(stoul(b));
+			}
+			split.push_back(model.layers().size());
+			if (!is_sorted(split.begin(), split.end()) ||
+			    adjacent_find(split.begin(), split.end()) != split.end()) {
+				cerr << "Error: Invalid layer split: " << layer_split
+				     << endl;
+				return 1;
+			}
+		}
+	}
+	if (!meica::is_valid_backend(backend_conf.backend)) {
+		cerr << "Error: Unknown backend: " << backend_conf.backend << endl;
+		return 0;
+	}
+	backend_conf.iface = iface;
+	backend_conf.max_chunk_size = meica::g_max_chunk_size;
+	if (file_prefix.empty()) {
+		file_prefix = host_name;
+	}
+                cout << "- Iterface name: " << iface << "; Backend: " << backend_conf.backend << endl;
         cout << "- Core list: " << core << "; Preallocated memory: " << mem <<endl;
         cout << "- Host name: " << host_name << endl;
 	if (is_leader == true) {
@@ -512,16 +825,21 @@ int main(int argc, char *argv[])
 	}
 
         // Init DPDK EAL.
-        string file_prefix_conf = "--file-prefix=" + host_name;
-        string vdev_conf = "net_af_packet0,iface=" + iface;
-        const char *rte_argv[] = {
+        string file_prefix_conf = "--file-prefix=" + file_prefix;
+        const vector<string> vdev_confs = meica::get_vdev_confs(backend_conf);
+        string mem_conf = to_string(mem);
+        vector<const char *> rte_argv = {
                 "-l", core.c_str(),
-                "-m", to_string(mem).c_str(), "--no-huge", "--no-pci", file_prefix_conf.c_str(),
-                "--vdev", vdev_conf.c_str(),
-                nullptr};
-        int rte_argc = static_cast<int>(sizeof(rte_argv) / sizeof(rte_argv[0])) - 1;
+                "-m", mem_conf.c_str(), "--no-huge", "--no-pci", file_prefix_conf.c_str()};
+        for (const string &vdev_conf : vdev_confs) {
+                cout << "- EAL vdev: " << vdev_conf << endl;
+                rte_argv.push_back("--vdev");
+                rte_argv.push_back(vdev_conf.c_str());
+        }
+        rte_argv.push_back(nullptr);
+        int rte_argc = static_cast<int>(rte_argv.size()) - 1;
 	int ret;
-        ret = rte_eal_init(rte_argc, const_cast<char **>(rte_argv));
+        ret = rte_eal_init(rte_argc, const_cast<char **>(rte_argv.data()));
 	if (ret < 0) {
 		rte_exit(EXIT_FAILURE, "Invalid EAL arguments.\n");
 	}
@@ -540,24 +858,50 @@ int main(int argc, char *argv[])
 
         // WARN: Temporary work around... The number of X chunks to buffer is
         // currently too large for typical DPDK applications...
+        // Chunks up to the maximal chunk size fit into a single mbuf.
         meica::fast_forward_pool = rte_pktmbuf_pool_create("fast_forward_pool", 4096,
-                        256, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+                        256, 0, std::max(static_cast<uint16_t>(RTE_MBUF_DEFAULT_BUF_SIZE),
+                                meica::chunk_data_room_size(meica::g_max_chunk_size)),
                 rte_socket_id());
         if (meica::fast_forward_pool== NULL)
                 rte_exit(EXIT_FAILURE, "Cannot init the fast forward pool!\n");
+        // The default RX pool of the munf manager only fits standard frames.
+        if (meica::chunk_data_room_size(meica::g_max_chunk_size) > RTE_MBUF_DEFAULT_BUF_SIZE) {
+                pool = rte_pktmbuf_pool_create("rx_pool", meica::NUM_RX_MBUFS, 256, 0,
+                                meica::chunk_data_room_size(meica::g_max_chunk_size),
+                                rte_socket_id());
+                if (pool == NULL)
+                        rte_exit(EXIT_FAILURE, "Cannot init the RX pool!\n");
+        }
 
 	ffpp_munf_init_manager(&munf_manager, "test_manager", pool);
 	if (ret < 0) {
 		rte_exit(EXIT_FAILURE, "Cannot get the MAC address.\n");
 	}
+	// Chunks are sent on the second port of get_vdev_confs() if there is one.
+	if (vdev_confs.size() > 1 && munf_manager.tx_port_id == munf_manager.rx_port_id) {
+		if (!meica::setup_tx_port(1, meica::fast_forward_pool)) {
+			rte_exit(EXIT_FAILURE, "Cannot init the TX port.\n");
+		}
+		munf_manager.tx_port_id = 1;
+	}
+	meica::tx_cksum_conf = meica::get_tx_cksum_conf(munf_manager.tx_port_id);
+	cout << "- TX checksum offload: IPv4: " << meica::tx_cksum_conf.hw_ipv4_cksum
+	     << ", UDP: " << meica::tx_cksum_conf.hw_udp_cksum << endl;
 
 	if (mode == "store_forward") {
 		meica::run_store_forward_loop(munf_manager);
 	} else if (mode == "compute_forward") {
-		meica::run_compute_forward_loop(munf_manager, is_leader, max_rounds);
+		meica::run_compute_forward_loop(munf_manager, is_leader, max_rounds,
+						engine, model, split);
 	}
 
 	cout << "Main loop ends, run cleanups..." << endl;
+	if (munf_manager.tx_port_id != munf_manager.rx_port_id) {
+		rte_eth_dev_stop(munf_manager.tx_port_id);
+		rte_eth_dev_close(munf_manager.tx_port_id);
+		munf_manager.tx_port_id = munf_manager.rx_port_id;
+	}
 	ffpp_munf_cleanup_manager(&munf_manager);
 	rte_eal_cleanup();
 
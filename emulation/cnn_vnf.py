@@ -7,18 +7,23 @@ About: Python script for distributed CNN processing.
 """
 
 import pickle
-import struct
 import sys
 import typing
 
 sys.path.insert(0, "../")
 
+import matrix_codec
+
 
 def run_cnn_dist(
-    X_bytes: bytes,
+    X_bytes: memoryview,
 ) -> bytes:
-    """Run distributed CNN on bytes_in and return the calculated result."""
-    X = pickle.loads(X_bytes)
+    """Run distributed CNN on bytes_in and return the calculated result.
+
+    X_bytes is a memoryview over the reassembly buffer of the VNF, it is only
+    valid during the call.
+    """
+    X = matrix_codec.decode(X_bytes)
 
     # TODO: <He> Process the X data with the fancy neural network.
     result_data = X
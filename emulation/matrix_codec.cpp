@@ -0,0 +1,158 @@
+/*
+ * matrix_codec.cpp
+ */
+
+#include <cstring>
+
+#include "matrix_codec.hpp"
+
+using namespace std;
+
+namespace meica
+{
+/* All fields are little-endian. */
+static uint32_t load_le32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) |
+	       (static_cast<uint32_t>(p[1]) << 8) |
+	       (static_cast<uint32_t>(p[2]) << 16) |
+	       (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void store_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+bool is_raw_matrix(const uint8_t *data, size_t len)
+{
+	return len >= RAW_MATRIX_HEADER_LEN && data[0] == RAW_MATRIX_MAGIC[0] &&
+	       data[1] == RAW_MATRIX_MAGIC[1];
+}
+
+bool parse_raw_matrix_header(const uint8_t *data, size_t len,
+			     raw_matrix_header &hdr)
+{
+	if (!is_raw_matrix(data, len) || data[2] > 1 || data[3] > 1) {
+		return false;
+	}
+	hdr.dtype = static_cast<raw_dtype>(data[2]);
+	hdr.order = static_cast<raw_order>(data[3]);
+	hdr.rows = load_le32(data + 4);
+	hdr.cols = load_le32(data + 8);
+	// The solvers and the level arithmetic divide by the dimensions.
+	return hdr.rows != 0 && hdr.cols != 0;
+}
+
+bool parse_raw_matrix(const uint8_t *data, size_t len, raw_matrix_header &hdr)
+{
+	size_t itemsize;
+
+	if (!parse_raw_matrix_header(data, len, hdr)) {
+		return false;
+	}
+	itemsize = (hdr.dtype == raw_dtype::FLOAT64) ? 8 : 4;
+	// Divided instead of multiplied, the product of a crafted header may
+	// overflow.
+	return static_cast<uint64_t>(hdr.rows) * hdr.cols <=
+	       (len - RAW_MATRIX_HEADER_LEN) / itemsize;
+}
+
+bool view_raw_matrix(const uint8_t *data, size_t len, matrix_view &view)
+{
+	raw_matrix_header hdr;
+
+	if (!parse_raw_matrix(data, len, hdr) ||
+	    hdr.dtype != raw_dtype::FLOAT64 ||
+	    reinterpret_cast<uintptr_t>(data) % alignof(double) != 0) {
+		return false;
+	}
+	view.data = reinterpret_cast<const double *>(data +
+						     RAW_MATRIX_HEADER_LEN);
+	view.rows = hdr.rows;
+	view.cols = hdr.cols;
+	if (hdr.order == raw_order::C) {
+		view.row_stride = hdr.cols;
+		view.col_stride = 1;
+	} else {
+		view.row_stride = 1;
+		view.col_stride = hdr.rows;
+	}
+	return true;
+}
+
+bool decode_raw_matrix(const uint8_t *data, size_t len, matrix &m)
+{
+	raw_matrix_header hdr;
+	const uint8_t *p = data + RAW_MATRIX_HEADER_LEN;
+	size_t i, j, idx;
+
+	if (!parse_raw_matrix(data, len, hdr)) {
+		return false;
+	}
+	m = matrix(hdr.rows, hdr.cols);
+	for (i = 0; i < hdr.rows; ++i) {
+		for (j = 0; j < hdr.cols; ++j) {
+			idx = (hdr.order == raw_order::C) ? i * hdr.cols + j :
+							    j * hdr.rows + i;
+			if (hdr.dtype == raw_dtype::FLOAT64) {
+				double v;
+				memcpy(&v, p + idx * sizeof(v), sizeof(v));
+				m(i, j) = v;
+			} else {
+				float v;
+				memcpy(&v, p + idx * sizeof(v), sizeof(v));
+				m(i, j) = v;
+			}
+		}
+	}
+	return true;
+}
+
+void encode_raw_matrix(const matrix &m, vector<uint8_t> &out, raw_order order)
+{
+	const size_t data_len = m.data.size() * sizeof(double);
+	uint8_t *p;
+	size_t i, j;
+
+	out.resize(RAW_MATRIX_HEADER_LEN + data_len);
+	memset(out.data(), 0, RAW_MATRIX_HEADER_LEN);
+	out[0] = RAW_MATRIX_MAGIC[0];
+	out[1] = RAW_MATRIX_MAGIC[1];
+	out[2] = static_cast<uint8_t>(raw_dtype::FLOAT64);
+	out[3] = static_cast<uint8_t>(order);
+	store_le32(out.data() + 4, static_cast<uint32_t>(m.rows));
+	store_le32(out.data() + 8, static_cast<uint32_t>(m.cols));
+	p = out.data() + RAW_MATRIX_HEADER_LEN;
+	if (order == raw_order::C) {
+		memcpy(p, m.data.data(), data_len);
+		return;
+	}
+	for (j = 0; j < m.cols; ++j) {
+		for (i = 0; i < m.rows; ++i) {
+			memcpy(p, &m.data[i * m.cols + j], sizeof(double));
+			p += sizeof(double);
+		}
+	}
+}
+
+void encode_raw_matrix_f32(const float *data, size_t rows, size_t cols,
+			   vector<uint8_t> &out)
+{
+	const size_t data_len = rows * cols * sizeof(float);
+
+	out.resize(RAW_MATRIX_HEADER_LEN + data_len);
+	memset(out.data(), 0, RAW_MATRIX_HEADER_LEN);
+	out[0] = RAW_MATRIX_MAGIC[0];
+	out[1] = RAW_MATRIX_MAGIC[1];
+	out[2] = static_cast<uint8_t>(raw_dtype::FLOAT32);
+	out[3] = static_cast<uint8_t>(raw_order::C);
+	store_le32(out.data() + 4, static_cast<uint32_t>(rows));
+	store_le32(out.data() + 8, static_cast<uint32_t>(cols));
+	memcpy(out.data() + RAW_MATRIX_HEADER_LEN, data, data_len);
+}
+
+} // namespace meica
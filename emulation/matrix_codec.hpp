@@ -0,0 +1,77 @@
+/*
+ * matrix_codec.hpp
+ *
+ * Raw matrix encoding, check ./matrix_codec.py for the definition.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "meica_compute.hpp"
+
+namespace meica
+{
+constexpr uint8_t RAW_MATRIX_MAGIC[2] = { 'M', 'X' };
+constexpr size_t RAW_MATRIX_HEADER_LEN = 16;
+
+enum class raw_dtype : uint8_t {
+	FLOAT64 = 0,
+	FLOAT32 = 1,
+};
+
+enum class raw_order : uint8_t {
+	C = 0,
+	F = 1,
+};
+
+struct raw_matrix_header {
+	raw_dtype dtype;
+	raw_order order;
+	uint32_t rows;
+	uint32_t cols;
+};
+
+bool is_raw_matrix(const uint8_t *data, size_t len);
+
+/**
+ * Parse only the header of a raw matrix, the elements may not be available
+ * yet, e.g. when the matrix is still being received. Matrices without rows or
+ * columns are rejected.
+ */
+bool parse_raw_matrix_header(const uint8_t *data, size_t len,
+			     raw_matrix_header &hdr);
+
+/**
+ * Parse and validate the header of a raw matrix, return false if data is not
+ * a complete raw matrix.
+ */
+bool parse_raw_matrix(const uint8_t *data, size_t len, raw_matrix_header &hdr);
+
+/**
+ * Get a view on a raw float64 matrix without copies. data must be 8 bytes
+ * aligned.
+ */
+bool view_raw_matrix(const uint8_t *data, size_t len, matrix_view &view);
+
+/**
+ * Copy a raw matrix of any dtype and order into m.
+ */
+bool decode_raw_matrix(const uint8_t *data, size_t len, matrix &m);
+
+/**
+ * Encode m as a float64 raw matrix in the given order into out.
+ */
+void encode_raw_matrix(const matrix &m, std::vector<uint8_t> &out,
+		       raw_order order = raw_order::C);
+
+/**
+ * Encode the C order float32 matrix at data as a raw matrix into out.
+ */
+void encode_raw_matrix_f32(const float *data, size_t rows, size_t cols,
+			   std::vector<uint8_t> &out);
+
+} // namespace meica
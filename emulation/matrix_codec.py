@@ -0,0 +1,76 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+
+"""
+About: Serialization of matrices carried in MEICA messages.
+
+Two encodings are supported:
+
+- pickle: The original encoding, requires a full copy and unpickling.
+- raw: A 16 bytes header followed by the matrix elements. The header is:
+  magic "MX" (2B), dtype (1B), order (1B), rows (4B), cols (4B), reserved (4B).
+  All fields are little-endian. The elements can be viewed with np.frombuffer
+  directly on the reassembly buffer of the VNF, i.e. without any copy.
+
+Keep this module free of heavy dependencies, it is imported by the embedded
+Python interpreter of the VNFs.
+"""
+
+import pickle
+import struct
+import typing
+
+import numpy as np
+
+RAW_MAGIC: typing.Final[bytes] = b"MX"
+RAW_HEADER_FMT: typing.Final[str] = "<2sBBIII"
+RAW_HEADER_LEN: typing.Final[int] = struct.calcsize(RAW_HEADER_FMT)
+
+DTYPES: typing.Final[dict] = {0: np.dtype("<f8"), 1: np.dtype("<f4")}
+ORDERS: typing.Final[dict] = {0: "C", 1: "F"}
+
+FORMATS: typing.Final[tuple] = ("pickle", "raw")
+
+
+def is_raw(data) -> bool:
+    return len(data) >= RAW_HEADER_LEN and bytes(data[:2]) == RAW_MAGIC
+
+
+def encode_raw(array: np.ndarray, order: str = "C") -> bytes:
+    """Encode a 2D array with the raw encoding."""
+    array = np.asarray(array)
+    if array.ndim != 2:
+        raise ValueError("Only 2D arrays can be encoded.")
+    dtype_id = 1 if array.dtype == np.float32 else 0
+    order_id = 1 if order == "F" else 0
+    data = np.asarray(array, dtype=DTYPES[dtype_id], order=order).tobytes(order=order)
+    hdr = struct.pack(
+        RAW_HEADER_FMT, RAW_MAGIC, dtype_id, order_id, array.shape[0], array.shape[1], 0
+    )
+    return hdr + data
+
+
+def decode_raw(data) -> np.ndarray:
+    """Return a read-only array view over data, no copy is performed."""
+    magic, dtype_id, order_id, rows, cols, _ = struct.unpack_from(RAW_HEADER_FMT, data)
+    assert magic == RAW_MAGIC
+    dtype = DTYPES[dtype_id]
+    flat = np.frombuffer(data, dtype=dtype, count=rows * cols, offset=RAW_HEADER_LEN)
+    flat.flags.writeable = False
+    return flat.reshape((rows, cols), order=ORDERS[order_id])
+
+
+def encode(array: np.ndarray, fmt: str = "raw", order: str = "C") -> bytes:
+    if fmt == "raw":
+        return encode_raw(array, order)
+    if fmt == "pickle":
+        return pickle.dumps(array)
+    raise ValueError(f"Unknown matrix format: {fmt}")
+
+
+def decode(data) -> np.ndarray:
+    """Decode a matrix in bytes-like data, the encoding is detected."""
+    if is_raw(data):
+        return decode_raw(data)
+    return pickle.loads(data)
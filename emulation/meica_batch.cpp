@@ -0,0 +1,319 @@
+/*
+ * meica_batch.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+#include "meica_batch.hpp"
+
+using namespace std;
+
+namespace meica
+{
+void whiten_batch(const vector<matrix_view> &uXs, whitening_batch &w)
+{
+	const size_t lanes = uXs.size();
+	whitening lane;
+	size_t b, j, k;
+
+	assert(lanes > 0);
+	w.n = uXs.front().rows;
+	w.m = uXs.front().cols;
+	w.lanes = lanes;
+	w.Xt.resize(w.m * w.n * lanes);
+	w.V.resize(lanes);
+	w.V_inv.resize(lanes);
+	for (b = 0; b < lanes; ++b) {
+		assert(uXs[b].rows == w.n && uXs[b].cols == w.m);
+		whiten_with_inv_V(uXs[b], lane);
+		for (j = 0; j < w.m; ++j) {
+			for (k = 0; k < w.n; ++k) {
+				w.Xt[(j * w.n + k) * lanes + b] =
+					lane.Xt.data[j * w.n + k];
+			}
+		}
+		w.V[b] = std::move(lane.V);
+		w.V_inv[b] = std::move(lane.V_inv);
+	}
+}
+
+void compact_batch(whitening_batch &w, const vector<bool> &keep)
+{
+	const size_t old_lanes = w.lanes;
+	const size_t rows = w.m * w.n;
+	size_t lanes = 0;
+	size_t b, r, out;
+
+	assert(keep.size() == old_lanes);
+	for (b = 0; b < old_lanes; ++b) {
+		if (keep[b]) {
+			if (lanes != b) {
+				w.V[lanes] = std::move(w.V[b]);
+				w.V_inv[lanes] = std::move(w.V_inv[b]);
+			}
+			lanes += 1;
+		}
+	}
+	if (lanes == old_lanes) {
+		return;
+	}
+	// In place: the output of a row never overtakes its input.
+	out = 0;
+	for (r = 0; r < rows; ++r) {
+		const size_t in = r * old_lanes;
+		for (b = 0; b < old_lanes; ++b) {
+			if (keep[b]) {
+				w.Xt[out++] = w.Xt[in + b];
+			}
+		}
+	}
+	w.Xt.resize(rows * lanes);
+	w.V.resize(lanes);
+	w.V_inv.resize(lanes);
+	w.lanes = lanes;
+}
+
+void newton_step_batch(vector<matrix> &Bs, const whitening_batch &w,
+		       vector<double> &lims)
+{
+	const size_t n = w.n;
+	const size_t L = w.lanes;
+	vector<double> B(n * n * L);
+	vector<double> G(n * n * L, 0.0);
+	vector<double> g_sum(n * L, 0.0);
+	vector<double> y(L);
+	size_t i, j, k, b;
+
+	assert(Bs.size() == L);
+	for (b = 0; b < L; ++b) {
+		for (i = 0; i < n * n; ++i) {
+			B[i * L + b] = Bs[b].data[i];
+		}
+	}
+
+	// All inner loops run over the lanes on contiguous memory.
+	for (j = 0; j < w.m; ++j) {
+		const double *x = &w.Xt[j * n * L];
+		for (i = 0; i < n; ++i) {
+			const double *Bi = &B[i * n * L];
+			for (b = 0; b < L; ++b) {
+				y[b] = 0.0;
+			}
+			for (k = 0; k < n; ++k) {
+				for (b = 0; b < L; ++b) {
+					y[b] += Bi[k * L + b] * x[k * L + b];
+				}
+			}
+			double *gs = &g_sum[i * L];
+			for (b = 0; b < L; ++b) {
+				y[b] = tanh(y[b]);
+				gs[b] += 1.0 - y[b] * y[b];
+			}
+			double *Gi = &G[i * n * L];
+			for (k = 0; k < n; ++k) {
+				for (b = 0; b < L; ++b) {
+					Gi[k * L + b] += y[b] * x[k * L + b];
+				}
+			}
+		}
+	}
+
+	// The n x n part is small, it is done per lane.
+	lims.resize(L);
+	matrix Gb(n, n);
+	for (b = 0; b < L; ++b) {
+		for (i = 0; i < n; ++i) {
+			for (k = 0; k < n; ++k) {
+				Gb(i, k) = G[(i * n + k) * L + b] -
+					   g_sum[i * L + b] * Bs[b](i, k);
+			}
+		}
+		matrix B1 = decorrelation(Gb);
+		double lim = 0.0;
+		for (i = 0; i < n; ++i) {
+			double d = 0.0;
+			for (k = 0; k < n; ++k) {
+				d += B1(i, k) * Bs[b](i, k);
+			}
+			lim = max(lim, fabs(fabs(d) - 1.0));
+		}
+		lims[b] = lim;
+		Bs[b] = std::move(B1);
+	}
+}
+
+/**
+ * State of newton_iteration_auto_break() of a lane.
+ */
+struct auto_break_state {
+	double stack_front;
+	size_t stack_len;
+	double sum;
+	double lim_max;
+};
+
+/**
+ * newton_iteration_auto_break() of all lanes. A lane drops out of the batch
+ * as soon as it breaks, Ws and break_by_tol are indexed by the initial lanes.
+ */
+static void newton_iteration_auto_break_batch(vector<matrix> &Ws,
+					      whitening_batch &w,
+					      const solver_params &params,
+					      vector<bool> &break_by_tol)
+{
+	const size_t lanes = w.lanes;
+	vector<size_t> ids(lanes);
+	vector<auto_break_state> st(lanes, auto_break_state{ 0.0, 0, 0.0, 0.0 });
+	vector<matrix> Bs(Ws);
+	vector<double> lims;
+	vector<bool> keep;
+	size_t b;
+
+	for (b = 0; b < lanes; ++b) {
+		ids[b] = b;
+	}
+	break_by_tol.assign(lanes, false);
+
+	for (uint32_t it = 0; it < params.max_iter && !ids.empty(); ++it) {
+		newton_step_batch(Bs, w, lims);
+		keep.assign(ids.size(), true);
+		for (b = 0; b < ids.size(); ++b) {
+			auto_break_state &s = st[ids[b]];
+			const double lim = lims[b];
+			if (s.stack_len == 0) {
+				s.stack_front = lim;
+			}
+			s.stack_len += 1;
+			if (lim > s.lim_max) {
+				s.lim_max = lim;
+				s.stack_front = lim;
+				s.stack_len = 1;
+				s.sum = 0.0;
+			}
+			s.sum += lim;
+			if (lim < params.tol) {
+				break_by_tol[ids[b]] = true;
+				keep[b] = false;
+			} else if (s.sum < params.break_coef * 0.5 *
+						   (s.stack_front + lim) *
+						   s.stack_len) {
+				keep[b] = false;
+			}
+			Ws[ids[b]] = Bs[b];
+		}
+
+		size_t out = 0;
+		for (b = 0; b < ids.size(); ++b) {
+			if (keep[b]) {
+				if (out != b) {
+					ids[out] = ids[b];
+					Bs[out] = std::move(Bs[b]);
+				}
+				out += 1;
+			}
+		}
+		if (out != ids.size()) {
+			compact_batch(w, keep);
+			ids.resize(out);
+			Bs.resize(out);
+		}
+	}
+}
+
+void meica_batch_solver::run_batch(const vector<matrix_view> &Xs,
+				   vector<solver_state> &states,
+				   uint32_t max_rounds)
+{
+	const size_t K = Xs.size();
+	vector<uint32_t> round_num(K, 0);
+	vector<bool> active(K, false);
+	vector<size_t> lanes;
+	vector<matrix_view> uXs;
+	vector<matrix> Ws;
+	vector<matrix> Vs;
+	vector<bool> break_by_tol;
+	whitening_batch w;
+	uint16_t levels;
+	uint16_t index;
+	size_t b, l;
+
+	if (K == 0) {
+		return;
+	}
+	if (states.size() != K) {
+		throw invalid_argument("Number of states does not match X.");
+	}
+	levels = level_num(Xs.front());
+	index = levels;
+	for (b = 0; b < K; ++b) {
+		const matrix_view &X = Xs[b];
+		solver_state &state = states[b];
+		if (X.rows != Xs.front().rows || X.cols != Xs.front().cols) {
+			throw invalid_argument(
+				"Messages of a batch must have the same shape.");
+		}
+		if (state.iter_num == 0) {
+			state.uW = generate_initial_matrix_B(X.rows);
+		}
+		if (state.uW.rows != X.rows || state.uW.cols != X.rows) {
+			throw invalid_argument("Shape of uW does not match X.");
+		}
+		state.has_final_result = state.iter_num >= levels;
+		if (state.has_final_result) {
+			state.iter_num = levels;
+			continue;
+		}
+		active[b] = true;
+		index = min(index, state.iter_num);
+	}
+
+	for (; index < levels; ++index) {
+		// Messages which continue at this level.
+		lanes.clear();
+		uXs.clear();
+		size_t step = 1;
+		for (uint16_t i = index + 1; i < levels; ++i) {
+			step *= max(params_.ext_multi_ica, 2U);
+		}
+		for (b = 0; b < K; ++b) {
+			if (active[b] && states[b].iter_num == index) {
+				lanes.push_back(b);
+				uXs.push_back(Xs[b].subsample(step));
+			}
+		}
+		if (lanes.empty()) {
+			continue;
+		}
+
+		whiten_batch(uXs, w);
+		Ws.resize(lanes.size());
+		for (l = 0; l < lanes.size(); ++l) {
+			Ws[l] = decorrelation(
+				matmul(states[lanes[l]].uW, w.V_inv[l]));
+		}
+		// V of the dropped lanes is removed from w.
+		Vs = w.V;
+		newton_iteration_auto_break_batch(Ws, w, params_, break_by_tol);
+
+		for (l = 0; l < lanes.size(); ++l) {
+			solver_state &state = states[lanes[l]];
+			state.uW = matmul(Ws[l], Vs[l]);
+			round_num[lanes[l]] += 1;
+			if (break_by_tol[l] || index == levels - 1) {
+				state.has_final_result = true;
+				state.iter_num = levels;
+				active[lanes[l]] = false;
+				continue;
+			}
+			state.iter_num = index + 1;
+			if (round_num[lanes[l]] == max_rounds) {
+				active[lanes[l]] = false;
+			}
+		}
+	}
+}
+
+} // namespace meica
@@ -0,0 +1,64 @@
+/*
+ * meica_batch.hpp
+ *
+ * Batched MEICA for many small concurrent messages.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "meica_compute.hpp"
+
+namespace meica
+{
+/**
+ * Whitened samples of a batch of uXs with the same shape in struct-of-arrays
+ * layout: element k of sample j of lane b is at Xt[(j * n + k) * lanes + b],
+ * so the Newton kernels run with SIMD across the messages.
+ */
+struct whitening_batch {
+	size_t n;
+	size_t m;
+	size_t lanes;
+	std::vector<double> Xt;
+	std::vector<matrix> V;
+	std::vector<matrix> V_inv;
+};
+
+void whiten_batch(const std::vector<matrix_view> &uXs, whitening_batch &w);
+
+/**
+ * Remove the lanes whose keep flag is false, i.e. messages that converged.
+ */
+void compact_batch(whitening_batch &w, const std::vector<bool> &keep);
+
+/**
+ * One Newton iteration of all lanes, Bs[b] is the separation matrix of lane b.
+ * Return the convergence of each lane in lims.
+ */
+void newton_step_batch(std::vector<matrix> &Bs, const whitening_batch &w,
+		       std::vector<double> &lims);
+
+/**
+ * MEICA on K messages with the same shape.
+ *
+ * Each extraction level is computed for all messages at this level together
+ * and messages that break by the tolerance drop out of the batch early. The
+ * result of each message is the same as the one of meica_solver::run() up to
+ * the rounding of the reductions. The subsampled Newton iteration
+ * (solver_params::stochastic_min_samples) is not used, all samples are used.
+ */
+class meica_batch_solver : public meica_solver {
+public:
+	using meica_solver::meica_solver;
+
+	void run_batch(const std::vector<matrix_view> &Xs,
+		       std::vector<solver_state> &states, uint32_t max_rounds);
+};
+
+} // namespace meica
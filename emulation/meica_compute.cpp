@@ -0,0 +1,892 @@
+/*
+ * meica_compute.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "meica_compute.hpp"
+#include "meica_stats.hpp"
+
+using namespace std;
+
+namespace meica
+{
+static constexpr int JACOBI_MAX_SWEEPS = 100;
+static constexpr size_t NEWTON_BLOCK_SIZE = 256;
+
+matrix matrix::identity(size_t n)
+{
+	matrix m(n, n);
+	for (size_t i = 0; i < n; ++i) {
+		m(i, i) = 1.0;
+	}
+	return m;
+}
+
+matrix matmul(const matrix &a, const matrix &b)
+{
+	assert(a.cols == b.rows);
+	matrix c(a.rows, b.cols);
+	for (size_t i = 0; i < a.rows; ++i) {
+		for (size_t k = 0; k < a.cols; ++k) {
+			double aik = a(i, k);
+			for (size_t j = 0; j < b.cols; ++j) {
+				c(i, j) += aik * b(k, j);
+			}
+		}
+	}
+	return c;
+}
+
+matrix transpose(const matrix &a)
+{
+	matrix t(a.cols, a.rows);
+	for (size_t i = 0; i < a.rows; ++i) {
+		for (size_t j = 0; j < a.cols; ++j) {
+			t(j, i) = a(i, j);
+		}
+	}
+	return t;
+}
+
+/**
+ * Gauss-Jordan elimination with partial pivoting.
+ */
+bool inverse(const matrix &a, matrix &inv)
+{
+	const size_t n = a.rows;
+	matrix m = a;
+	size_t i, j, k, p;
+
+	assert(a.rows == a.cols);
+	inv = matrix::identity(n);
+	for (k = 0; k < n; ++k) {
+		p = k;
+		for (i = k + 1; i < n; ++i) {
+			if (fabs(m(i, k)) > fabs(m(p, k))) {
+				p = i;
+			}
+		}
+		if (!(fabs(m(p, k)) > 0.0) || !isfinite(m(p, k))) {
+			return false;
+		}
+		if (p != k) {
+			for (j = 0; j < n; ++j) {
+				swap(m(p, j), m(k, j));
+				swap(inv(p, j), inv(k, j));
+			}
+		}
+		double pivot = m(k, k);
+		for (j = 0; j < n; ++j) {
+			m(k, j) /= pivot;
+			inv(k, j) /= pivot;
+		}
+		for (i = 0; i < n; ++i) {
+			if (i == k) {
+				continue;
+			}
+			double f = m(i, k);
+			if (fabs(f) < numeric_limits<double>::min()) {
+				continue;
+			}
+			for (j = 0; j < n; ++j) {
+				m(i, j) -= f * m(k, j);
+				inv(i, j) -= f * inv(k, j);
+			}
+		}
+	}
+	return true;
+}
+
+void sym_eig(const matrix &a, vector<double> &vals, matrix &vecs)
+{
+	const size_t n = a.rows;
+	matrix m = a;
+	size_t i, p, q, k;
+	double norm = 0.0;
+
+	assert(a.rows == a.cols);
+	vecs = matrix::identity(n);
+	for (double v : m.data) {
+		norm += v * v;
+	}
+
+	for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; ++sweep) {
+		double off = 0.0;
+		for (p = 0; p < n; ++p) {
+			for (q = p + 1; q < n; ++q) {
+				off += m(p, q) * m(p, q);
+			}
+		}
+		if (off <= 1e-26 * norm) {
+			break;
+		}
+
+		for (p = 0; p < n; ++p) {
+			for (q = p + 1; q < n; ++q) {
+				double apq = m(p, q);
+				if (fabs(apq) < numeric_limits<double>::min()) {
+					continue;
+				}
+				double theta = (m(q, q) - m(p, p)) / (2.0 * apq);
+				double t = 1.0 / (fabs(theta) + sqrt(theta * theta + 1.0));
+				if (theta < 0.0) {
+					t = -t;
+				}
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+				for (k = 0; k < n; ++k) {
+					double mkp = m(k, p);
+					double mkq = m(k, q);
+					m(k, p) = c * mkp - s * mkq;
+					m(k, q) = s * mkp + c * mkq;
+				}
+				for (k = 0; k < n; ++k) {
+					double mpk = m(p, k);
+					double mqk = m(q, k);
+					m(p, k) = c * mpk - s * mqk;
+					m(q, k) = s * mpk + c * mqk;
+				}
+				for (k = 0; k < n; ++k) {
+					double vkp = vecs(k, p);
+					double vkq = vecs(k, q);
+					vecs(k, p) = c * vkp - s * vkq;
+					vecs(k, q) = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	vals.resize(n);
+	for (i = 0; i < n; ++i) {
+		vals[i] = m(i, i);
+	}
+}
+
+/**
+ * Whiten X with the row means and the covariance C = Xc @ Xc.T of count
+ * samples. Eigenvalues of a rank-deficient C (linearly dependent rows of X)
+ * are clamped to a small positive floor, so the whitening stays finite.
+ */
+static void whiten_with_cov(const matrix_view &X, const vector<double> &mean,
+			    const matrix &C, size_t count, whitening &w)
+{
+	const size_t n = X.rows;
+	const size_t m = X.cols;
+	vector<double> xc(n);
+	vector<double> D;
+	matrix P;
+	size_t i, j, k;
+
+	sym_eig(C, D, P);
+	// Zero or slightly negative due to rounding if C is singular.
+	const double d_max = *max_element(D.begin(), D.end());
+	const double d_min = max(d_max * n * numeric_limits<double>::epsilon(),
+				 numeric_limits<double>::min());
+
+	// V = D^(-1/2) @ P.T, V_inv = P @ D^(1/2)
+	w.V = matrix(n, n);
+	w.V_inv = matrix(n, n);
+	for (i = 0; i < n; ++i) {
+		double d_half = sqrt(max(D[i], d_min));
+		for (k = 0; k < n; ++k) {
+			w.V(i, k) = P(k, i) / d_half;
+			w.V_inv(k, i) = P(k, i) * d_half;
+		}
+	}
+
+	// Xt = (sqrt(count) * V @ Xc).T
+	const double scale = sqrt(static_cast<double>(count));
+	w.Xt = matrix(m, n);
+	for (j = 0; j < m; ++j) {
+		for (i = 0; i < n; ++i) {
+			xc[i] = X(i, j) - mean[i];
+		}
+		double *out = &w.Xt.data[j * n];
+		for (i = 0; i < n; ++i) {
+			double sum = 0.0;
+			for (k = 0; k < n; ++k) {
+				sum += w.V(i, k) * xc[k];
+			}
+			out[i] = scale * sum;
+		}
+	}
+}
+
+void whiten_with_inv_V(const matrix_view &X, whitening &w)
+{
+	const size_t n = X.rows;
+	const size_t m = X.cols;
+	vector<double> mean(n, 0.0);
+	vector<double> xc(n);
+	matrix C(n, n);
+	size_t i, j, k;
+
+	for (i = 0; i < n; ++i) {
+		double sum = 0.0;
+		for (j = 0; j < m; ++j) {
+			sum += X(i, j);
+		}
+		mean[i] = sum / m;
+	}
+
+	// C = Xc @ Xc.T, only the upper triangle is accumulated.
+	for (j = 0; j < m; ++j) {
+		for (i = 0; i < n; ++i) {
+			xc[i] = X(i, j) - mean[i];
+		}
+		for (i = 0; i < n; ++i) {
+			for (k = i; k < n; ++k) {
+				C(i, k) += xc[i] * xc[k];
+			}
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < i; ++k) {
+			C(i, k) = C(k, i);
+		}
+	}
+
+	whiten_with_cov(X, mean, C, m, w);
+}
+
+void whiten_with_stats(const matrix_view &X, const sample_stats &stats,
+		       whitening &w)
+{
+	const size_t n = X.rows;
+	vector<double> mean(n);
+	matrix C(n, n);
+	size_t i, k;
+
+	assert(stats.count >= X.cols && stats.sum.size() == n);
+	for (i = 0; i < n; ++i) {
+		mean[i] = stats.sum[i] / stats.count;
+	}
+	// Xc @ Xc.T = X @ X.T - count * mean @ mean.T
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < n; ++k) {
+			C(i, k) = stats.outer(i, k) -
+				  stats.count * mean[i] * mean[k];
+		}
+	}
+
+	whiten_with_cov(X, mean, C, stats.count, w);
+}
+
+matrix decorrelation(const matrix &B)
+{
+	const size_t n = B.rows;
+	vector<double> U;
+	matrix S;
+	matrix R(n, n);
+	size_t i, j, k;
+
+	sym_eig(matmul(B, transpose(B)), U, S);
+	// R = S @ diag(U^(-1/2)) @ S.T
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			double sum = 0.0;
+			for (k = 0; k < n; ++k) {
+				sum += S(i, k) * S(j, k) / sqrt(U[k]);
+			}
+			R(i, j) = sum;
+		}
+	}
+	return matmul(R, B);
+}
+
+/**
+ * Newton sums on the samples of type T. The elementwise kernels (B @ X and
+ * tanh) run in T, all reductions over the samples are accumulated in double.
+ */
+template <typename T>
+static void newton_sums_impl(const matrix &B, const T *Xt, size_t rows,
+			     size_t stride, matrix &G, vector<double> &g_sum)
+{
+	const size_t n = B.rows;
+	// Samples 0, stride, 2 * stride, ... are used.
+	const size_t m = (rows + stride - 1) / stride;
+	const size_t x_stride = stride * n;
+	const vector<T> Bt(B.data.begin(), B.data.end());
+	// g(B @ X) of a block of samples, stored source-major so that tanh and
+	// the reductions run on contiguous memory.
+	vector<T> gbx(n * NEWTON_BLOCK_SIZE);
+	size_t i, j, k, b, nb;
+
+	assert(stride > 0);
+	for (j = 0; j < m; j += NEWTON_BLOCK_SIZE) {
+		nb = min(NEWTON_BLOCK_SIZE, m - j);
+		const T *x = &Xt[j * x_stride];
+		for (i = 0; i < n; ++i) {
+			const T *Bi = &Bt[i * n];
+			T *y = &gbx[i * NEWTON_BLOCK_SIZE];
+			for (b = 0; b < nb; ++b) {
+				T sum = 0;
+				for (k = 0; k < n; ++k) {
+					sum += Bi[k] * x[b * x_stride + k];
+				}
+				y[b] = sum;
+			}
+			double s = 0.0;
+			for (b = 0; b < nb; ++b) {
+				y[b] = tanh(y[b]);
+				s += 1 - static_cast<double>(y[b]) * y[b];
+			}
+			g_sum[i] += s;
+		}
+		for (i = 0; i < n; ++i) {
+			const T *y = &gbx[i * NEWTON_BLOCK_SIZE];
+			double *Gi = &G.data[i * n];
+			for (b = 0; b < nb; ++b) {
+				for (k = 0; k < n; ++k) {
+					Gi[k] += static_cast<double>(y[b]) *
+						 x[b * x_stride + k];
+				}
+			}
+		}
+	}
+}
+
+void newton_sums(const matrix &B, const matrix &Xt, matrix &G,
+		 vector<double> &g_sum)
+{
+	assert(Xt.cols == B.rows && G.rows == B.rows && G.cols == B.rows &&
+	       g_sum.size() == B.rows);
+	newton_sums_impl(B, Xt.data.data(), Xt.rows, 1, G, g_sum);
+}
+
+double newton_update(matrix &B, matrix G, const vector<double> &g_sum)
+{
+	const size_t n = B.rows;
+	size_t i, k;
+
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < n; ++k) {
+			G(i, k) -= g_sum[i] * B(i, k);
+		}
+	}
+	matrix B1 = decorrelation(G);
+
+	double lim = 0.0;
+	for (i = 0; i < n; ++i) {
+		double d = 0.0;
+		for (k = 0; k < n; ++k) {
+			d += B1(i, k) * B(i, k);
+		}
+		lim = max(lim, fabs(fabs(d) - 1.0));
+	}
+	B = std::move(B1);
+	return lim;
+}
+
+template <typename T>
+static double newton_step_impl(matrix &B, const T *Xt, size_t rows,
+			       size_t stride)
+{
+	matrix G(B.rows, B.rows);
+	vector<double> g_sum(B.rows, 0.0);
+
+	newton_sums_impl(B, Xt, rows, stride, G, g_sum);
+	return newton_update(B, std::move(G), g_sum);
+}
+
+double newton_step(matrix &B, const matrix &Xt, size_t stride)
+{
+	assert(Xt.cols == B.rows);
+	return newton_step_impl(B, Xt.data.data(), Xt.rows, stride);
+}
+
+double newton_step(matrix &B, const vector<float> &Xt32, size_t stride)
+{
+	assert(Xt32.size() % B.rows == 0);
+	return newton_step_impl(B, Xt32.data(), Xt32.size() / B.rows, stride);
+}
+
+/* Newton step on the float32 samples of w if there are. */
+static double newton_step(matrix &B, const whitening &w, size_t stride)
+{
+	if (!w.Xt32.empty()) {
+		return newton_step(B, w.Xt32, stride);
+	}
+	return newton_step(B, w.Xt, stride);
+}
+
+newton_sampler::newton_sampler(size_t m, size_t min_samples)
+	: m_(m), stride_(1), prev_lim_(HUGE_VAL)
+{
+	if (min_samples == 0) {
+		return;
+	}
+	while (m / (stride_ * 2) >= min_samples) {
+		stride_ *= 2;
+	}
+}
+
+bool newton_sampler::update(double lim)
+{
+	if (stride_ == 1) {
+		return false;
+	}
+	// The change of B on m / stride samples levels off at the sampling
+	// noise, roughly 1 / sqrt(m / stride), so from there on the subset only
+	// jitters around the solution: Double the samples.
+	const double noise = 1.0 / sqrt(static_cast<double>(m_ / stride_));
+	if (lim < noise || lim >= prev_lim_) {
+		stride_ /= 2;
+		prev_lim_ = HUGE_VAL;
+		return true;
+	}
+	prev_lim_ = lim;
+	return false;
+}
+
+double newton_iteration(matrix &B, const whitening &w, uint32_t max_iter,
+			double tol, size_t min_samples)
+{
+	newton_sampler sampler(w.Xt.rows, min_samples);
+	double lim = 0.0;
+	for (uint32_t i = 0; i < max_iter; ++i) {
+		const bool full = sampler.full();
+		lim = newton_step(B, w, sampler.stride());
+		if (!full) {
+			sampler.update(lim);
+			continue;
+		}
+		if (lim < tol) {
+			break;
+		}
+	}
+	return lim;
+}
+
+bool newton_iteration_auto_break(matrix &B, const whitening &w,
+				 uint32_t max_iter, double tol,
+				 double break_coef, size_t min_samples,
+				 const atomic<bool> *cancel)
+{
+	newton_sampler sampler(w.Xt.rows, min_samples);
+	// Only the first and the last element and the length of the stack of
+	// pyfbss are needed.
+	double stack_front = 0.0;
+	size_t stack_len = 0;
+	double sum = 0.0;
+	double lim_max = 0.0;
+
+	for (uint32_t i = 0; i < max_iter; ++i) {
+		if (cancel != nullptr && cancel->load(memory_order_relaxed)) {
+			break;
+		}
+		const bool full = sampler.full();
+		double lim = newton_step(B, w, sampler.stride());
+		// The stack only tracks the full sample iterations, so the
+		// result is the one of the full samples.
+		if (!full) {
+			sampler.update(lim);
+			continue;
+		}
+		if (stack_len == 0) {
+			stack_front = lim;
+		}
+		stack_len += 1;
+		if (lim > lim_max) {
+			lim_max = lim;
+			stack_front = lim;
+			stack_len = 1;
+			sum = 0.0;
+		}
+		sum += lim;
+		if (lim < tol) {
+			return true;
+		}
+		if (sum < break_coef * 0.5 * (stack_front + lim) * stack_len) {
+			break;
+		}
+	}
+	return false;
+}
+
+bool mixing_matrix_estimation(const matrix_view &X, uint32_t ext_initial_matrix,
+			      matrix &A)
+{
+	const matrix_view s =
+		ext_initial_matrix ? X.subsample(ext_initial_matrix) : X;
+	const size_t n = s.rows;
+	vector<size_t> count(n, 0);
+	vector<double> row_max(n);
+	size_t i, j, idx;
+
+	A = matrix(n, n);
+	for (j = 0; j < s.cols; ++j) {
+		idx = 0;
+		for (i = 1; i < n; ++i) {
+			if (fabs(s(i, j)) > fabs(s(idx, j))) {
+				idx = i;
+			}
+		}
+		if (!(s(idx, j) > 0.0)) {
+			continue;
+		}
+		count[idx] += 1;
+		for (i = 0; i < n; ++i) {
+			A(i, idx) += s(i, j);
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		if (count[i] < 5) {
+			return false;
+		}
+	}
+
+	// A = clip(A @ diag(1 / max(A, axis=-1)), 0.01, None)
+	for (i = 0; i < n; ++i) {
+		row_max[i] = *max_element(&A.data[i * n], &A.data[i * n] + n);
+	}
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			A(i, j) = max(A(i, j) / row_max[j], 0.01);
+		}
+	}
+	return true;
+}
+
+static const char *const ALGORITHM_NAMES[ICA_ALGORITHM_NUM] = {
+	"meica", "fastica", "cdica", "aeica", "ufica",
+};
+
+const char *algorithm_name(ica_algorithm algo)
+{
+	uint8_t id = static_cast<uint8_t>(algo);
+	return id < ICA_ALGORITHM_NUM ? ALGORITHM_NAMES[id] : "unknown";
+}
+
+bool parse_algorithm(const string &name, ica_algorithm &algo)
+{
+	for (uint8_t id = 0; id < ICA_ALGORITHM_NUM; ++id) {
+		if (name == ALGORITHM_NAMES[id]) {
+			algo = static_cast<ica_algorithm>(id);
+			return true;
+		}
+	}
+	return false;
+}
+
+solver_params default_solver_params(ica_algorithm algo)
+{
+	solver_params p;
+	p.max_iter = 100;
+	p.tol = 1e-04;
+	p.break_coef = 0.9;
+	// Same as the EXTRACTION_BASE of ./meica_vnf.py
+	p.ext_multi_ica = 2;
+	p.ext_initial_matrix = 0;
+	p.ext_adapt_ica = (algo == ica_algorithm::AEICA) ? 50 : 100;
+	p.seed = 0;
+	p.stochastic_min_samples = 0;
+	p.mixed_precision = false;
+	p.speculative_starts = 1;
+	return p;
+}
+
+solver::solver(const solver_params &params)
+	: params_(params), rng_(params.seed), stats_(nullptr),
+	  observer_(nullptr)
+{
+}
+
+void solver::whiten(const matrix_view &X, size_t step, whitening &w) const
+{
+	const matrix_view uX = X.subsample(step);
+	sample_stats stats;
+
+	if (stats_ != nullptr && stats_->get_stats(step, stats) &&
+	    stats.count == uX.cols && stats.sum.size() == uX.rows) {
+		whiten_with_stats(uX, stats, w);
+	} else {
+		whiten_with_inv_V(uX, w);
+	}
+	if (params_.mixed_precision) {
+		w.Xt32.assign(w.Xt.data.begin(), w.Xt.data.end());
+	} else {
+		w.Xt32.clear();
+	}
+}
+
+matrix solver::generate_initial_matrix_B(size_t n)
+{
+	uniform_real_distribution<double> dist(0.0, 1.0);
+	matrix B(n, n);
+	for (double &v : B.data) {
+		v = dist(rng_);
+	}
+	return decorrelation(B);
+}
+
+matrix solver::adaptive_extraction_iteration(const matrix_view &X, matrix B)
+{
+	const uint32_t grads_num =
+		params_.ext_adapt_ica > 1 ? params_.ext_adapt_ica - 1 : 0;
+	double cur_tol = 1.0;
+	double final_tol = params_.tol;
+	whitening w;
+
+	for (uint32_t i = grads_num - 1; grads_num > 1 && i >= 1; --i) {
+		// Extraction interval is i + 1.
+		double tol_i = params_.tol * sqrt(static_cast<double>(i + 1));
+		final_tol = tol_i;
+		if (cur_tol > tol_i) {
+			whiten(X, i + 1, w);
+			B = decorrelation(matmul(B, w.V_inv));
+			cur_tol = newton_iteration(B, w, params_.max_iter,
+						   tol_i,
+						   params_.stochastic_min_samples);
+			B = matmul(B, w.V);
+		}
+	}
+	whiten(X, 1, w);
+	B = decorrelation(matmul(B, w.V_inv));
+	newton_iteration(B, w, params_.max_iter, final_tol,
+			 params_.stochastic_min_samples);
+	return matmul(B, w.V);
+}
+
+uint16_t meica_level_num(size_t n, size_t m, uint32_t base)
+{
+	const size_t q = m / n;
+	uint16_t grad = 0;
+
+	base = max(base, 2U);
+	for (size_t p = base; p <= q; p *= base) {
+		grad += 1;
+	}
+	// At least the full X is used.
+	return max(grad, static_cast<uint16_t>(1));
+}
+
+uint16_t meica_solver::level_num(const matrix_view &X) const
+{
+	return meica_level_num(X.rows, X.cols, params_.ext_multi_ica);
+}
+
+bool meica_solver::speculative_newton_iteration(const whitening &w, matrix &W)
+{
+	const uint32_t starts = params_.speculative_starts;
+	vector<matrix> Ws(starts);
+	vector<thread> workers;
+	atomic<bool> cancel(false);
+	atomic<int> winner(-1);
+
+	Ws[0] = W;
+	for (uint32_t r = 1; r < starts; ++r) {
+		Ws[r] = decorrelation(
+			matmul(generate_initial_matrix_B(W.rows), w.V_inv));
+	}
+
+	auto chain = [&](uint32_t r) {
+		if (!newton_iteration_auto_break(
+			    Ws[r], w, params_.max_iter, params_.tol,
+			    params_.break_coef, params_.stochastic_min_samples,
+			    &cancel)) {
+			return;
+		}
+		int none = -1;
+		if (winner.compare_exchange_strong(none, static_cast<int>(r))) {
+			cancel.store(true, memory_order_relaxed);
+		}
+	};
+	for (uint32_t r = 1; r < starts; ++r) {
+		workers.emplace_back([&, r]() {
+			if (!worker_cpus_.empty()) {
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET(worker_cpus_[(r - 1) % worker_cpus_.size()],
+					&cpus);
+				pthread_setaffinity_np(pthread_self(),
+						       sizeof(cpus), &cpus);
+			}
+			chain(r);
+		});
+	}
+	// The original start runs on the calling thread.
+	chain(0);
+	for (auto &t : workers) {
+		t.join();
+	}
+
+	const int r = winner.load();
+	if (r < 0) {
+		W = std::move(Ws[0]);
+		return false;
+	}
+	W = std::move(Ws[r]);
+	return true;
+}
+
+void meica_solver::run(const matrix_view &X, solver_state &state,
+		       uint32_t max_rounds)
+{
+	const uint16_t levels = level_num(X);
+	uint16_t index = state.iter_num;
+	uint32_t round_num = 0;
+	whitening w;
+
+	if (state.iter_num == 0) {
+		state.uW = generate_initial_matrix_B(X.rows);
+	}
+	if (state.uW.rows != X.rows || state.uW.cols != X.rows) {
+		throw invalid_argument("Shape of uW does not match X.");
+	}
+	state.has_final_result = false;
+	if (index >= levels) {
+		state.has_final_result = true;
+		state.iter_num = levels;
+		return;
+	}
+
+	for (; index < levels; ++index) {
+		size_t step = 1;
+		for (uint16_t i = index + 1; i < levels; ++i) {
+			step *= max(params_.ext_multi_ica, 2U);
+		}
+		if (observer_ != nullptr) {
+			observer_->level_begin(index);
+		}
+		whiten(X, step, w);
+		matrix W = decorrelation(matmul(state.uW, w.V_inv));
+		bool break_by_tol;
+		if (index == 0 && params_.speculative_starts > 1) {
+			break_by_tol = speculative_newton_iteration(w, W);
+		} else {
+			break_by_tol = newton_iteration_auto_break(
+				W, w, params_.max_iter, params_.tol,
+				params_.break_coef,
+				params_.stochastic_min_samples);
+		}
+		state.uW = matmul(W, w.V);
+		round_num += 1;
+		if (observer_ != nullptr) {
+			observer_->level_end(index);
+		}
+
+		if (break_by_tol || index == levels - 1) {
+			state.has_final_result = true;
+			break;
+		}
+		if (round_num == max_rounds) {
+			break;
+		}
+	}
+	state.iter_num = state.has_final_result ? levels : index + 1;
+}
+
+void fastica_solver::run(const matrix_view &X, solver_state &state,
+			 uint32_t max_rounds)
+{
+	whitening w;
+
+	whiten(X, 1, w);
+	matrix B = generate_initial_matrix_B(X.rows);
+	newton_iteration(B, w, params_.max_iter, params_.tol,
+			 params_.stochastic_min_samples);
+	state.uW = matmul(B, w.V);
+	state.iter_num = 1;
+	state.has_final_result = true;
+}
+
+void cdica_solver::run(const matrix_view &X, solver_state &state,
+		       uint32_t max_rounds)
+{
+	whitening w;
+	matrix A;
+	matrix B;
+
+	whiten(X, 1, w);
+	matrix_view Xw = { w.Xt.data.data(), X.rows, w.Xt.rows, 1, X.rows };
+	if (mixing_matrix_estimation(Xw, params_.ext_initial_matrix, A) &&
+	    inverse(matmul(w.V, A), B)) {
+		B = decorrelation(B);
+	} else {
+		B = generate_initial_matrix_B(X.rows);
+	}
+	newton_iteration(B, w, params_.max_iter, params_.tol,
+			 params_.stochastic_min_samples);
+	state.uW = matmul(B, w.V);
+	state.iter_num = 1;
+	state.has_final_result = true;
+}
+
+void aeica_solver::run(const matrix_view &X, solver_state &state,
+		       uint32_t max_rounds)
+{
+	state.uW = adaptive_extraction_iteration(
+		X, generate_initial_matrix_B(X.rows));
+	state.iter_num = 1;
+	state.has_final_result = true;
+}
+
+void ufica_solver::run(const matrix_view &X, solver_state &state,
+		       uint32_t max_rounds)
+{
+	matrix A;
+	matrix B;
+
+	if (!mixing_matrix_estimation(X, params_.ext_initial_matrix, A) ||
+	    !inverse(A, B)) {
+		B = generate_initial_matrix_B(X.rows);
+	}
+	state.uW = adaptive_extraction_iteration(X, B);
+	state.iter_num = 1;
+	state.has_final_result = true;
+}
+
+unique_ptr<solver> make_solver(ica_algorithm algo, const solver_params &params)
+{
+	switch (algo) {
+	case ica_algorithm::MEICA:
+		return unique_ptr<solver>(new meica_solver(params));
+	case ica_algorithm::FASTICA:
+		return unique_ptr<solver>(new fastica_solver(params));
+	case ica_algorithm::CDICA:
+		return unique_ptr<solver>(new cdica_solver(params));
+	case ica_algorithm::AEICA:
+		return unique_ptr<solver>(new aeica_solver(params));
+	case ica_algorithm::UFICA:
+		return unique_ptr<solver>(new ufica_solver(params));
+	}
+	return nullptr;
+}
+
+matrix separate(solver &s, const matrix_view &X)
+{
+	solver_state state;
+	state.iter_num = 0;
+	state.has_final_result = false;
+	while (!state.has_final_result) {
+		s.run(X, state, 0);
+	}
+	return state.uW;
+}
+
+matrix get_hat_S(const matrix &uW, const matrix_view &X)
+{
+	assert(uW.cols == X.rows);
+	matrix hat_S(uW.rows, X.cols);
+	for (size_t j = 0; j < X.cols; ++j) {
+		for (size_t k = 0; k < X.rows; ++k) {
+			const double xkj = X(k, j);
+			for (size_t i = 0; i < uW.rows; ++i) {
+				hat_S(i, j) += uW(i, k) * xkj;
+			}
+		}
+	}
+	return hat_S;
+}
+
+} // namespace meica
@@ -0,0 +1,424 @@
+/*
+ * meica_compute.hpp
+ *
+ * Native implementation of the ICA algorithms of ../pyfastbss_core.py.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace meica
+{
+class level_stats_accumulator;
+
+/**
+ * Dense row-major matrix.
+ */
+struct matrix {
+	size_t rows;
+	size_t cols;
+	std::vector<double> data;
+
+	matrix() : rows(0), cols(0)
+	{
+	}
+	matrix(size_t r, size_t c, double val = 0.0)
+		: rows(r), cols(c), data(r * c, val)
+	{
+	}
+
+	double &operator()(size_t i, size_t j)
+	{
+		return data[i * cols + j];
+	}
+	double operator()(size_t i, size_t j) const
+	{
+		return data[i * cols + j];
+	}
+	bool empty() const
+	{
+		return data.empty();
+	}
+
+	static matrix identity(size_t n);
+};
+
+/**
+ * Read-only strided view of a (source_number, time_slots_number) matrix.
+ *
+ * Element (i, j) is at data[i * row_stride + j * col_stride], so both C and
+ * Fortran order buffers and the subsampled X[:, ::step] are views without
+ * copies.
+ */
+struct matrix_view {
+	const double *data;
+	size_t rows;
+	size_t cols;
+	size_t row_stride;
+	size_t col_stride;
+
+	double operator()(size_t i, size_t j) const
+	{
+		return data[i * row_stride + j * col_stride];
+	}
+
+	/* Equivalent to X[:, ::step] */
+	matrix_view subsample(size_t step) const
+	{
+		matrix_view v = *this;
+		v.cols = (cols + step - 1) / step;
+		v.col_stride = col_stride * step;
+		return v;
+	}
+
+	static matrix_view of(const matrix &m)
+	{
+		return matrix_view{ m.data.data(), m.rows, m.cols, m.cols, 1 };
+	}
+};
+
+matrix matmul(const matrix &a, const matrix &b);
+matrix transpose(const matrix &a);
+bool inverse(const matrix &a, matrix &inv);
+
+/**
+ * Eigen decomposition of a symmetric matrix with the cyclic Jacobi method.
+ * The columns of vecs are the eigenvectors.
+ */
+void sym_eig(const matrix &a, std::vector<double> &vals, matrix &vecs);
+
+/**
+ * Whitened samples of X and the whitening matrix.
+ *
+ * Samples are stored sample-major, i.e. Xt is the transposed whitened X with
+ * the shape (time_slots_number, source_number), so the Newton iteration
+ * reads memory sequentially. Xt32 is the float32 copy of Xt for the mixed
+ * precision Newton iteration, empty otherwise.
+ */
+struct whitening {
+	matrix Xt;
+	std::vector<float> Xt32;
+	matrix V;
+	matrix V_inv;
+};
+
+/**
+ * Running sums of the samples of a uX: count, sum(x) and sum(x @ x.T).
+ */
+struct sample_stats {
+	size_t count;
+	std::vector<double> sum;
+	matrix outer;
+};
+
+void whiten_with_inv_V(const matrix_view &X, whitening &w);
+/**
+ * Same as whiten_with_inv_V() but the mean and the covariance are taken from
+ * the pre-computed stats of X, so only one pass over X is needed. The stats
+ * can also be the ones of a larger matrix of which X is a column range.
+ */
+void whiten_with_stats(const matrix_view &X, const sample_stats &stats,
+		       whitening &w);
+matrix decorrelation(const matrix &B);
+
+/**
+ * One Newton iteration (tanh contrast) on the samples 0, stride, 2 * stride,
+ * ... of Xt, return the convergence.
+ */
+double newton_step(matrix &B, const matrix &Xt, size_t stride = 1);
+/**
+ * Same as above on float32 samples: The elementwise kernels run in float32,
+ * the n x n reductions are accumulated directly in float64.
+ */
+double newton_step(matrix &B, const std::vector<float> &Xt32,
+		   size_t stride = 1);
+
+/**
+ * The two halves of newton_step(), so the sums can be reduced over samples
+ * that are distributed: newton_sums() adds sum(g(B @ x) @ x.T) to G and
+ * sum(g'(B @ x)) to g_sum over the samples of Xt, newton_update() computes
+ * the new B from the sums of all samples and returns the convergence.
+ */
+void newton_sums(const matrix &B, const matrix &Xt, matrix &G,
+		 std::vector<double> &g_sum);
+double newton_update(matrix &B, matrix G, const std::vector<double> &g_sum);
+
+/**
+ * Sample schedule of the subsampled (stochastic) Newton iteration.
+ *
+ * The early iterations, which are far from the solution, run on a strided
+ * subset of at least min_samples samples. The subset is doubled each time
+ * the convergence reaches the sampling noise of the subset or stops
+ * decreasing, until all samples are used. min_samples 0 always uses all
+ * samples.
+ */
+class newton_sampler {
+public:
+	newton_sampler(size_t m, size_t min_samples);
+
+	size_t stride() const
+	{
+		return stride_;
+	}
+	bool full() const
+	{
+		return stride_ == 1;
+	}
+	/* Account the convergence of a step, return true if the subset grows. */
+	bool update(double lim);
+
+private:
+	size_t m_;
+	size_t stride_;
+	double prev_lim_;
+};
+
+/**
+ * Newton iteration until the convergence is below tol. Convergence is only
+ * checked on all samples, subsets are used before as set by min_samples.
+ * The float32 samples of w are used if there are.
+ */
+double newton_iteration(matrix &B, const whitening &w, uint32_t max_iter,
+			double tol, size_t min_samples = 0);
+/**
+ * Newton iteration which jumps out when the convergence decreases slower,
+ * return true if the iteration breaks by the tolerance. The iteration also
+ * stops (returning false) once cancel is set.
+ */
+bool newton_iteration_auto_break(matrix &B, const whitening &w,
+				 uint32_t max_iter, double tol,
+				 double break_coef, size_t min_samples = 0,
+				 const std::atomic<bool> *cancel = nullptr);
+
+/**
+ * Number of extraction levels of MEICA for X of the shape (n, m), i.e.
+ * int(log(m // n, base)) of pyfbss but at least 1.
+ */
+uint16_t meica_level_num(size_t n, size_t m, uint32_t base);
+
+/**
+ * Rough mixing matrix estimated from the maximal components of X, return
+ * false if there are not enough samples for a source.
+ */
+bool mixing_matrix_estimation(const matrix_view &X, uint32_t ext_initial_matrix,
+			      matrix &A);
+
+/**
+ * ICA algorithms, the value is carried in the lower bits of the msg_flags of
+ * data messages (msg_type 0).
+ */
+enum class ica_algorithm : uint8_t {
+	MEICA = 0,
+	FASTICA = 1,
+	CDICA = 2,
+	AEICA = 3,
+	UFICA = 4,
+};
+
+constexpr uint8_t ICA_ALGORITHM_NUM = 5;
+constexpr uint8_t ICA_ALGORITHM_MASK = 0x0f;
+
+const char *algorithm_name(ica_algorithm algo);
+bool parse_algorithm(const std::string &name, ica_algorithm &algo);
+
+/**
+ * Parameters of the solvers, defaults are the ones of pyfbss.
+ */
+struct solver_params {
+	uint32_t max_iter;
+	double tol;
+	double break_coef;
+	uint32_t ext_multi_ica;
+	uint32_t ext_initial_matrix;
+	uint32_t ext_adapt_ica;
+	uint64_t seed;
+	/* Minimal subset of the subsampled Newton iterations, 0 to disable. */
+	size_t stochastic_min_samples;
+	/* Run the Newton kernels on float32 samples. */
+	bool mixed_precision;
+	/* Number of parallel starts of the first MEICA level, 1 to disable. */
+	uint32_t speculative_starts;
+};
+
+solver_params default_solver_params(ica_algorithm algo);
+
+/**
+ * Hooks of meica_solver around each extraction level (whitening and Newton
+ * iteration), e.g. to sample performance counters.
+ */
+class level_observer {
+public:
+	virtual ~level_observer()
+	{
+	}
+	virtual void level_begin(uint16_t level) = 0;
+	virtual void level_end(uint16_t level) = 0;
+};
+
+/**
+ * Progress of a (distributed) separation, carried by the uW messages.
+ */
+struct solver_state {
+	matrix uW;
+	uint16_t iter_num;
+	bool has_final_result;
+};
+
+/**
+ * Common interface of the ICA solvers.
+ *
+ * run() continues the separation of X from state with at most max_rounds
+ * rounds. The resulting uW is the separation matrix for the original X,
+ * i.e. hat_S = uW @ X.
+ */
+class solver {
+public:
+	explicit solver(const solver_params &params);
+	virtual ~solver()
+	{
+	}
+
+	virtual ica_algorithm algorithm() const = 0;
+	virtual void run(const matrix_view &X, solver_state &state,
+			 uint32_t max_rounds) = 0;
+
+	const solver_params &params() const
+	{
+		return params_;
+	}
+
+	/**
+	 * Use the statistics accumulated during the reception of X for the
+	 * next runs, nullptr to compute them from X.
+	 */
+	void set_level_stats(const level_stats_accumulator *stats)
+	{
+		stats_ = stats;
+	}
+
+	/**
+	 * CPUs of the speculative worker threads, they are not pinned if
+	 * empty.
+	 */
+	void set_worker_cpus(const std::vector<unsigned> &cpus)
+	{
+		worker_cpus_ = cpus;
+	}
+
+	/* Observer of the extraction levels, nullptr for none. */
+	void set_level_observer(level_observer *observer)
+	{
+		observer_ = observer;
+	}
+
+protected:
+	/* Whiten X[:, ::step] with the accumulated statistics if available. */
+	void whiten(const matrix_view &X, size_t step, whitening &w) const;
+	matrix generate_initial_matrix_B(size_t n);
+	matrix adaptive_extraction_iteration(const matrix_view &X, matrix B);
+
+	solver_params params_;
+	std::mt19937_64 rng_;
+	const level_stats_accumulator *stats_;
+	std::vector<unsigned> worker_cpus_;
+	level_observer *observer_;
+};
+
+/**
+ * Multi-level extraction ICA. One round is one extraction level, so the
+ * levels can be distributed over multiple nodes.
+ */
+class meica_solver : public solver {
+public:
+	using solver::solver;
+	ica_algorithm algorithm() const override
+	{
+		return ica_algorithm::MEICA;
+	}
+	void run(const matrix_view &X, solver_state &state,
+		 uint32_t max_rounds) override;
+
+	/* Number of extraction levels (i.e. uXs) of X. */
+	uint16_t level_num(const matrix_view &X) const;
+
+private:
+	/**
+	 * Run the Newton iteration of the first level from W and from
+	 * speculative_starts - 1 other random starts in parallel. The first
+	 * start that breaks by the tolerance wins and cancels the others,
+	 * otherwise the result of W is kept.
+	 */
+	bool speculative_newton_iteration(const whitening &w, matrix &W);
+};
+
+/*
+ * The following solvers run to the final result in a single round.
+ */
+
+class fastica_solver : public solver {
+public:
+	using solver::solver;
+	ica_algorithm algorithm() const override
+	{
+		return ica_algorithm::FASTICA;
+	}
+	void run(const matrix_view &X, solver_state &state,
+		 uint32_t max_rounds) override;
+};
+
+class cdica_solver : public solver {
+public:
+	using solver::solver;
+	ica_algorithm algorithm() const override
+	{
+		return ica_algorithm::CDICA;
+	}
+	void run(const matrix_view &X, solver_state &state,
+		 uint32_t max_rounds) override;
+};
+
+class aeica_solver : public solver {
+public:
+	using solver::solver;
+	ica_algorithm algorithm() const override
+	{
+		return ica_algorithm::AEICA;
+	}
+	void run(const matrix_view &X, solver_state &state,
+		 uint32_t max_rounds) override;
+};
+
+class ufica_solver : public solver {
+public:
+	using solver::solver;
+	ica_algorithm algorithm() const override
+	{
+		return ica_algorithm::UFICA;
+	}
+	void run(const matrix_view &X, solver_state &state,
+		 uint32_t max_rounds) override;
+};
+
+std::unique_ptr<solver> make_solver(ica_algorithm algo,
+				    const solver_params &params);
+
+/**
+ * Run the solver on X until the final result, return uW.
+ */
+matrix separate(solver &s, const matrix_view &X);
+
+/**
+ * hat_S = uW @ X, i.e. meica_dist_get_hat_s of pyfbss.
+ */
+matrix get_hat_S(const matrix &uW, const matrix_view &X);
+
+} // namespace meica
@@ -0,0 +1,238 @@
+/*
+ * meica_data_parallel.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "matrix_codec.hpp"
+#include "meica_data_parallel.hpp"
+#include "service_header.hpp"
+
+using namespace std;
+
+namespace meica
+{
+void encode_dp_message(const dp_message &msg, vector<uint8_t> &out)
+{
+	vector<uint8_t> raw;
+
+	if (!msg.data.empty()) {
+		encode_raw_matrix(msg.data, raw);
+	}
+	out.resize(DP_MESSAGE_HEADER_LEN);
+	out[0] = static_cast<uint8_t>(msg.phase);
+	out[1] = 0;
+	store_be16(out.data() + 2, msg.iter);
+	store_be16(out.data() + 4, static_cast<uint16_t>(msg.count >> 16));
+	store_be16(out.data() + 6, static_cast<uint16_t>(msg.count & 0xffff));
+	out.insert(out.end(), raw.begin(), raw.end());
+}
+
+bool decode_dp_message(const uint8_t *data, size_t len, dp_message &msg)
+{
+	if (len < DP_MESSAGE_HEADER_LEN ||
+	    data[0] > static_cast<uint8_t>(dp_phase::DONE)) {
+		return false;
+	}
+	msg.phase = static_cast<dp_phase>(data[0]);
+	msg.iter = load_be16(data + 2);
+	msg.count = (static_cast<uint32_t>(load_be16(data + 4)) << 16) |
+		    load_be16(data + 6);
+	if (len == DP_MESSAGE_HEADER_LEN) {
+		msg.data = matrix();
+		return true;
+	}
+	return decode_raw_matrix(data + DP_MESSAGE_HEADER_LEN,
+				 len - DP_MESSAGE_HEADER_LEN, msg.data);
+}
+
+void dp_column_range(size_t m, uint32_t rank, uint32_t size, size_t &begin,
+		     size_t &end)
+{
+	assert(rank < size);
+	begin = m * rank / size;
+	end = m * (rank + 1) / size;
+}
+
+dp_node::dp_node(const solver_params &params, uint32_t rank, uint32_t size)
+	: params_(params), rank_(rank), size_(size), rng_(params.seed), X_(),
+	  begin_(0), end_(0), phase_(dp_phase::DONE), iter_(0), w_(), B_()
+{
+	if (size == 0 || rank >= size) {
+		throw invalid_argument("Invalid rank of the data-parallel VNF.");
+	}
+}
+
+void dp_node::start(const matrix_view &X)
+{
+	X_ = X;
+	dp_column_range(X.cols, rank_, size_, begin_, end_);
+	phase_ = dp_phase::WHITENING;
+	iter_ = 0;
+}
+
+void dp_node::begin_reduction(dp_message &msg)
+{
+	msg.phase = phase_;
+	msg.iter = iter_;
+	msg.count = 0;
+	msg.data = matrix(X_.rows, X_.rows + 1);
+	add_partial(msg);
+}
+
+bool dp_node::add_partial(dp_message &msg)
+{
+	const size_t n = X_.rows;
+	size_t i, j, k;
+
+	if (msg.phase != phase_ || msg.iter != iter_ ||
+	    phase_ == dp_phase::DONE || msg.data.rows != n ||
+	    msg.data.cols != n + 1) {
+		return false;
+	}
+	msg.count += static_cast<uint32_t>(end_ - begin_);
+	if (phase_ == dp_phase::WHITENING) {
+		// [sum(x @ x.T) | sum(x)]
+		for (j = begin_; j < end_; ++j) {
+			for (i = 0; i < n; ++i) {
+				const double xi = X_(i, j);
+				for (k = 0; k < n; ++k) {
+					msg.data(i, k) += xi * X_(k, j);
+				}
+				msg.data(i, n) += xi;
+			}
+		}
+		return true;
+	}
+
+	// [G | g_sum]
+	matrix G(n, n);
+	vector<double> g_sum(n, 0.0);
+	newton_sums(B_, w_.Xt, G, g_sum);
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < n; ++k) {
+			msg.data(i, k) += G(i, k);
+		}
+		msg.data(i, n) += g_sum[i];
+	}
+	return true;
+}
+
+void dp_node::whiten_columns(const dp_message &msg)
+{
+	const size_t n = X_.rows;
+	struct sample_stats stats = { msg.count, vector<double>(n),
+				      matrix(n, n) };
+	matrix_view own = X_;
+	size_t i, k;
+
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < n; ++k) {
+			stats.outer(i, k) = msg.data(i, k);
+		}
+		stats.sum[i] = msg.data(i, n);
+	}
+	own.data = X_.data + begin_ * X_.col_stride;
+	own.cols = end_ - begin_;
+	whiten_with_stats(own, stats, w_);
+}
+
+bool dp_node::finish(dp_message &msg, matrix &uW)
+{
+	const size_t n = X_.rows;
+	size_t i, k;
+
+	if (msg.phase != phase_ || msg.iter != iter_ ||
+	    phase_ == dp_phase::DONE || msg.data.rows != n ||
+	    msg.data.cols != n + 1) {
+		throw invalid_argument("Unexpected data-parallel reduction.");
+	}
+	if (phase_ == dp_phase::WHITENING) {
+		whiten_columns(msg);
+		// Same initial B as generate_initial_matrix_B() of the solvers.
+		uniform_real_distribution<double> dist(0.0, 1.0);
+		B_ = matrix(n, n);
+		for (double &v : B_.data) {
+			v = dist(rng_);
+		}
+		B_ = decorrelation(B_);
+		matrix data(n, 2 * n + 1);
+		for (i = 0; i < n; ++i) {
+			for (k = 0; k <= n; ++k) {
+				data(i, k) = msg.data(i, k);
+			}
+			for (k = 0; k < n; ++k) {
+				data(i, n + 1 + k) = B_(i, k);
+			}
+		}
+		msg.data = std::move(data);
+		phase_ = dp_phase::NEWTON;
+		iter_ = 0;
+		return false;
+	}
+
+	matrix G(n, n);
+	vector<double> g_sum(n);
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < n; ++k) {
+			G(i, k) = msg.data(i, k);
+		}
+		g_sum[i] = msg.data(i, n);
+	}
+	const double lim = newton_update(B_, std::move(G), g_sum);
+	iter_ += 1;
+	msg.iter = iter_;
+	if (lim < params_.tol || iter_ >= params_.max_iter) {
+		uW = matmul(B_, w_.V);
+		msg.phase = dp_phase::DONE;
+		msg.data = matrix();
+		phase_ = dp_phase::DONE;
+		return true;
+	}
+	msg.data = B_;
+	return false;
+}
+
+bool dp_node::apply(const dp_message &msg)
+{
+	const size_t n = X_.rows;
+	size_t i, k;
+
+	switch (msg.phase) {
+	case dp_phase::WHITENING:
+		if (phase_ != dp_phase::WHITENING || msg.iter != iter_ ||
+		    msg.data.rows != n || msg.data.cols != 2 * n + 1) {
+			return false;
+		}
+		whiten_columns(msg);
+		B_ = matrix(n, n);
+		for (i = 0; i < n; ++i) {
+			for (k = 0; k < n; ++k) {
+				B_(i, k) = msg.data(i, n + 1 + k);
+			}
+		}
+		phase_ = dp_phase::NEWTON;
+		iter_ = 0;
+		return true;
+	case dp_phase::NEWTON:
+		if (phase_ != dp_phase::NEWTON || msg.iter != iter_ + 1 ||
+		    msg.data.rows != n || msg.data.cols != n) {
+			return false;
+		}
+		B_ = msg.data;
+		iter_ = msg.iter;
+		return true;
+	case dp_phase::DONE:
+		if (phase_ != dp_phase::NEWTON || msg.iter != iter_ + 1) {
+			return false;
+		}
+		phase_ = dp_phase::DONE;
+		iter_ = msg.iter;
+		return true;
+	}
+	return false;
+}
+
+} // namespace meica
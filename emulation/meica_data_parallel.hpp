@@ -0,0 +1,162 @@
+/*
+ * meica_data_parallel.hpp
+ *
+ * Data-parallel Newton iteration of FastICA over the VNFs of a chain.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "meica_compute.hpp"
+
+namespace meica
+{
+/**
+ * Each of the VNFs of the chain owns a column range of X. An iteration is a
+ * reduction message that passes the VNFs downstream, each adds the partial
+ * sums of its columns, and a broadcast message of the result that the last
+ * VNF sends back upstream.
+ *
+ * - WHITENING: The reduction carries sum(x @ x.T) and sum(x), the broadcast
+ *   the totals and the initial B. Each VNF then whitens its columns.
+ * - NEWTON: The reduction carries sum(g(B @ x) @ x.T) and sum(g'(B @ x)) of
+ *   the B of the iteration, the broadcast the new B.
+ * - DONE: Broadcast after the last iteration, the last VNF sends the result
+ *   downstream as a final uW.
+ */
+constexpr uint8_t DP_REDUCTION_MSG_TYPE = 4;
+constexpr uint8_t DP_BROADCAST_MSG_TYPE = 5;
+// UDP destination port of the broadcasts. They use the reversed addresses of
+// the X flow, the port tells them apart from the replies of the sink, so the
+// switches steer them through the upstream VNFs, check
+// ./multi_hop_controller.py.
+constexpr uint16_t DP_BROADCAST_UDP_PORT = 9998;
+
+enum class dp_phase : uint8_t {
+	WHITENING = 0,
+	NEWTON = 1,
+	DONE = 2,
+};
+
+/**
+ * Payload of the reduction and broadcast messages: phase (1B), reserved (1B),
+ * iteration (2B) and sample count (4B), all big-endian, followed by a raw
+ * float64 matrix if the phase has one:
+ *
+ * - WHITENING: (n, n + 1) [sum(x @ x.T) | sum(x)] for the reduction and
+ *   (n, 2n + 1) [sum(x @ x.T) | sum(x) | B] for the broadcast.
+ * - NEWTON: (n, n + 1) [G | g_sum] for the reduction and (n, n) B for the
+ *   broadcast.
+ * - DONE: No matrix.
+ */
+constexpr size_t DP_MESSAGE_HEADER_LEN = 8;
+
+struct dp_message {
+	dp_phase phase;
+	uint16_t iter;
+	uint32_t count;
+	matrix data;
+};
+
+void encode_dp_message(const dp_message &msg, std::vector<uint8_t> &out);
+bool decode_dp_message(const uint8_t *data, size_t len, dp_message &msg);
+
+/**
+ * Columns [begin, end) of the m columns of X owned by the VNF rank of size
+ * VNFs.
+ */
+void dp_column_range(size_t m, uint32_t rank, uint32_t size, size_t &begin,
+		     size_t &end);
+
+/**
+ * State of a VNF in the data-parallel separation of one X.
+ *
+ * The first VNF begins the reduction of each iteration, the last one
+ * finishes it. The other VNFs add their partial sums to the reductions and
+ * apply the broadcasts. The result is the one of fastica_solver::run()
+ * without the subsampled Newton iteration, up to the rounding of the sums.
+ */
+class dp_node {
+public:
+	dp_node(const solver_params &params, uint32_t rank, uint32_t size);
+
+	uint32_t rank() const
+	{
+		return rank_;
+	}
+	bool is_first() const
+	{
+		return rank_ == 0;
+	}
+	bool is_last() const
+	{
+		return rank_ == size_ - 1;
+	}
+	/* Phase and iteration of the next reduction. */
+	dp_phase phase() const
+	{
+		return phase_;
+	}
+	uint16_t iteration() const
+	{
+		return iter_;
+	}
+
+	/**
+	 * Start the separation of a new X. X must stay valid until the
+	 * separation is done.
+	 */
+	void start(const matrix_view &X);
+
+	/* Abort the current separation, e.g. because a new X arrives. */
+	void stop()
+	{
+		phase_ = dp_phase::DONE;
+	}
+
+	/* Begin the reduction of the next iteration (first VNF). */
+	void begin_reduction(dp_message &msg);
+
+	/**
+	 * Add the partial sums of the own columns to a reduction. Return false
+	 * if it is not the reduction of the next iteration.
+	 */
+	bool add_partial(dp_message &msg);
+
+	/**
+	 * Turn the complete reduction msg into the broadcast of its result
+	 * (last VNF), the broadcast is also applied. Return true if the
+	 * separation is done, uW is then the separation matrix for X.
+	 */
+	bool finish(dp_message &msg, matrix &uW);
+
+	/**
+	 * Apply a broadcast of the last VNF. Return false if it is not the
+	 * result of the current iteration.
+	 */
+	bool apply(const dp_message &msg);
+
+private:
+	void whiten_columns(const dp_message &msg);
+
+	solver_params params_;
+	uint32_t rank_;
+	uint32_t size_;
+	std::mt19937_64 rng_;
+	matrix_view X_;
+	size_t begin_;
+	size_t end_;
+	dp_phase phase_;
+	uint16_t iter_;
+	// Whitened own columns.
+	whitening w_;
+	matrix B_;
+};
+
+} // namespace meica
@@ -0,0 +1,93 @@
+/*
+ * meica_eval_py.cpp
+ *
+ * Python bindings of the native BSS evaluation of ./meica_testbed.hpp, used
+ * by ../pyfastbss_testbed.py when the module is built.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+namespace py = pybind11;
+
+#include "meica_testbed.hpp"
+
+using namespace meica;
+
+using double_array = py::array_t<double, py::array::forcecast>;
+
+/* Contiguous copy of a 2D array. */
+static matrix copy_of(const double_array &a)
+{
+	if (a.ndim() != 2) {
+		throw py::value_error("Expect a 2D array.");
+	}
+	auto r = a.unchecked<2>();
+	matrix m(r.shape(0), r.shape(1));
+	for (size_t i = 0; i < m.rows; ++i) {
+		for (size_t j = 0; j < m.cols; ++j) {
+			m(i, j) = r(i, j);
+		}
+	}
+	return m;
+}
+
+/**
+ * View of a 2D array without copies for C and Fortran order arrays and their
+ * slices. Arrays with negative strides are copied into storage.
+ */
+static matrix_view view_of(const double_array &a, matrix &storage)
+{
+	if (a.ndim() != 2) {
+		throw py::value_error("Expect a 2D array.");
+	}
+	if (a.strides(0) < 0 || a.strides(1) < 0) {
+		storage = copy_of(a);
+		return matrix_view::of(storage);
+	}
+	return matrix_view{ a.data(), static_cast<size_t>(a.shape(0)),
+			    static_cast<size_t>(a.shape(1)),
+			    static_cast<size_t>(a.strides(0)) / sizeof(double),
+			    static_cast<size_t>(a.strides(1)) / sizeof(double) };
+}
+
+PYBIND11_MODULE(meica_eval, m)
+{
+	m.doc() = "Native BSS evaluation of the MEICA test bed.";
+
+	m.def(
+		"fast_psnr",
+		[](const double_array &S, const double_array &hat_S,
+		   unsigned threads) {
+			matrix s_storage;
+			matrix e_storage;
+			const matrix_view s = view_of(S, s_storage);
+			const matrix_view e = view_of(hat_S, e_storage);
+			std::vector<size_t> order;
+			double psnr;
+			{
+				py::gil_scoped_release release;
+				psnr = fast_psnr(s, e, order, threads);
+			}
+			return py::make_tuple(psnr, order);
+		},
+		py::arg("S"), py::arg("hat_S"), py::arg("threads") = 0,
+		"Return the PSNR (dB) of hat_S and the row of hat_S matched to each source, same as pyfbss_tb.fast_psnr.");
+	m.def(
+		"mean_si_sdr",
+		[](const double_array &S, const double_array &hat_S) {
+			const matrix s = copy_of(S);
+			const matrix e = copy_of(hat_S);
+			if (s.rows != e.rows || s.cols != e.cols) {
+				throw py::value_error(
+					"S and hat_S must have the same shape.");
+			}
+			py::gil_scoped_release release;
+			return mean_si_sdr(s, e);
+		},
+		py::arg("S"), py::arg("hat_S"),
+		"Mean scale-invariant SDR (dB) of hat_S against S.");
+}
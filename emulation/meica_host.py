@@ -30,13 +30,13 @@ These sources are just used for **PoC**, the long term roadmap is to implement t
 
 import logging
 import math
-import pickle
 import struct
 import sys
 import typing
 
 from dataclasses import dataclass
 
+import matrix_codec
 import utils
 
 import numpy as np
@@ -53,12 +53,25 @@ MEICA_IP_TOTAL_LEN: typing.Final[int] = 1400  # bytes
 # larger data, multiple messages should be used.
 MAX_CHUNK_NUM: typing.Final[int] = 4096
 
+# ICA algorithms which can be selected for each message. The index is carried in
+# the lower bits of the msg_flags of data messages (msg_type 0). Must be aligned
+# with ./meica_compute.hpp.
+ALGORITHMS: typing.Final[tuple] = ("meica", "fastica", "cdica", "aeica", "ufica")
+ALGORITHM_MASK: typing.Final[int] = 0x0F
+
 LEVELS = {
     "debug": logging.DEBUG,
     "info": logging.INFO,
 }
 
 
+def get_algorithm(msg_flags: int) -> str:
+    algo_id = msg_flags & ALGORITHM_MASK
+    if algo_id >= len(ALGORITHMS):
+        raise RuntimeError(f"Unknown algorithm ID: {algo_id}")
+    return ALGORITHMS[algo_id]
+
+
 def get_logger(level):
     log_level = LEVELS.get(level, None)
     if not log_level:
@@ -180,22 +193,35 @@ class MEICAHost(object):
     """Base class for a MEICA-enabled end host."""
 
     @staticmethod
-    def serialize(x_array):
-        return pickle.dumps(x_array)
+    def serialize(x_array, fmt="pickle"):
+        # Column-major: Every sample of X is contiguous in the chunks, so the
+        # VNFs can accumulate the whitening statistics during the reception.
+        return matrix_codec.encode(x_array, fmt, order="F")
 
     def fragment(
-        self, x_array: np.ndarray, msg_type: int, total_msg_num: int, msg_num: int
+        self,
+        x_array: np.ndarray,
+        msg_type: int,
+        total_msg_num: int,
+        msg_num: int,
+        fmt: str = "pickle",
+        msg_flags: int = 0,
     ) -> tuple:
         """Fragment X matrix into chunks.
 
-        :param x_array: X matrix in np.ndarray format.
+        :param x_array: X matrix in np.ndarray format, or a memoryview of X in the raw encoding which is not serialized again.
         :param msg_type: Type of the message.
         :param total_msg_num: Total message number.
         :param msg_num: Current message number.
+        :param fmt: Serialization format of the X matrix, pickle or raw.
+        :param msg_flags: Flags of the message, e.g. the ID of the ICA algorithm.
 
         :return: A tuple of all chunks (header+payload) and the length of the serialized X matrix in bytes.
         """
-        x_bytes = self.serialize(x_array)
+        if isinstance(x_array, memoryview):
+            x_bytes = x_array
+        else:
+            x_bytes = self.serialize(x_array, fmt)
         full_chunks_num = math.floor(len(x_bytes) / MEICA_IP_TOTAL_LEN)
         total_chunk_num = full_chunks_num + 1
         chunks = list()
@@ -203,7 +229,7 @@ class MEICAHost(object):
         for c in range(full_chunks_num):
             hdr = ServiceHeader(
                 msg_type=msg_type,
-                msg_flags=0,
+                msg_flags=msg_flags,
                 total_msg_num=total_msg_num,
                 msg_num=msg_num,
                 total_chunk_num=total_chunk_num,
@@ -222,7 +248,7 @@ class MEICAHost(object):
         # The last chunk.
         hdr = ServiceHeader(
             msg_type=msg_type,
-            msg_flags=0,
+            msg_flags=msg_flags,
             total_msg_num=total_msg_num,
             msg_num=msg_num,
             total_chunk_num=total_chunk_num,
@@ -262,7 +288,7 @@ class MEICAHost(object):
         :return: A tuple of data array and result array.
         """
         array_bytes = b"".join(c[1] for c in chunks)
-        array = pickle.loads(array_bytes)
+        array = matrix_codec.decode(array_bytes)
         return array
 
 
@@ -14,6 +14,8 @@ import time
 import numpy as np
 
 sys.path.insert(0, "../")
+# The native evaluation (meica_eval) used by pyfbss_tb, if it is built.
+sys.path.insert(0, "./build")
 
 from pyfastbss_core import pyfbss
 from pyfastbss_testbed import pyfbss_tb
@@ -61,25 +63,34 @@ def time_meica(duration, source_num, number=50):
     )
 
     latencies = list()
+    psnrs = list()
     for _ in range(number):
-        _, _, X = get_source_data(duration, source_num)
+        S, _, X = get_source_data(duration, source_num)
         start = time.time()
-        _ = pyfbss.meica(X, ext_multi_ica=2)
+        hat_S = pyfbss.meica(X, ext_multi_ica=2)
         latencies.append(time.time() - start)
+        psnrs.append(pyfbss_tb.fast_psnr(S, hat_S)[0])
     avg_latency = np.average(latencies)
-    print(f"- Average latency of centralized: {avg_latency}")
+    print(
+        f"- Average latency of centralized: {avg_latency}, PSNR: {np.average(psnrs):.4f} dB"
+    )
 
-    uXs = pyfbss.meica_generate_uxs(X, ext_multi_ica=2)
-    uW_prev = pyfbss.generate_initial_matrix_B(uXs[0])
     latencies = list()
+    psnrs = list()
     for _ in range(number):
         S, A, X = get_source_data(duration, source_num)
+        # The subsets of the current X, so hat_S is an estimation of S.
+        uXs = pyfbss.meica_generate_uxs(X, ext_multi_ica=2)
+        uW_prev = pyfbss.generate_initial_matrix_B(uXs[0])
         start = time.time()
-        run_meica_dist(X, uXs, uW_prev)
+        hat_S = run_meica_dist(X, uXs, uW_prev)
         latencies.append(time.time() - start)
+        psnrs.append(pyfbss_tb.fast_psnr(S, hat_S)[0])
 
     avg_latency = np.average(latencies)
-    print(f"- Average latency of distributed: {avg_latency}")
+    print(
+        f"- Average latency of distributed: {avg_latency}, PSNR: {np.average(psnrs):.4f} dB"
+    )
 
 
 def time_meica_dist(duration, source_num):
@@ -0,0 +1,148 @@
+/*
+ * meica_online.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+#include "meica_online.hpp"
+
+using namespace std;
+
+namespace meica
+{
+online_params default_online_params()
+{
+	return online_params{
+		.newton_steps = 3,
+		.window = 8000,
+		.memory = 32000,
+		.seed = 0,
+	};
+}
+
+online_separator::online_separator(const online_params &params)
+	: params_(params), rng_(params.seed), n_(0), frames_(0), count_(0.0),
+	  sum_(), outer_(), window_(), uW_(), lim_(0.0)
+{
+	if (params.newton_steps == 0 || params.window == 0 ||
+	    params.memory == 0) {
+		throw invalid_argument("Invalid online separation parameters.");
+	}
+}
+
+void online_separator::reset()
+{
+	n_ = 0;
+	frames_ = 0;
+	count_ = 0.0;
+	sum_.clear();
+	outer_ = matrix();
+	window_.clear();
+	uW_ = matrix();
+	lim_ = 0.0;
+}
+
+void online_separator::update_stats(const matrix_view &frame)
+{
+	const double decay = exp(-static_cast<double>(frame.cols) /
+				 static_cast<double>(params_.memory));
+	size_t i, j, k;
+
+	count_ = count_ * decay + frame.cols;
+	for (i = 0; i < n_; ++i) {
+		sum_[i] *= decay;
+	}
+	for (double &v : outer_.data) {
+		v *= decay;
+	}
+	// Only the upper triangle is accumulated.
+	for (j = 0; j < frame.cols; ++j) {
+		for (i = 0; i < n_; ++i) {
+			const double x = frame(i, j);
+			sum_[i] += x;
+			for (k = i; k < n_; ++k) {
+				outer_(i, k) += x * frame(k, j);
+			}
+		}
+	}
+	for (i = 0; i < n_; ++i) {
+		for (k = 0; k < i; ++k) {
+			outer_(i, k) = outer_(k, i);
+		}
+	}
+}
+
+void online_separator::update_window(const matrix_view &frame)
+{
+	const size_t keep = min(params_.window, frame.cols);
+	const size_t size = window_.size() / n_;
+	size_t i, j;
+
+	// Drop the oldest samples, at most window samples are kept.
+	if (size + keep > params_.window) {
+		window_.erase(window_.begin(),
+			      window_.begin() +
+				      (size + keep - params_.window) * n_);
+	}
+	for (j = frame.cols - keep; j < frame.cols; ++j) {
+		for (i = 0; i < n_; ++i) {
+			window_.push_back(frame(i, j));
+		}
+	}
+}
+
+const matrix &online_separator::update(const matrix_view &frame)
+{
+	whitening w;
+	matrix B;
+
+	assert(frame.rows > 0 && frame.cols > 0);
+	if (frame.rows != n_) {
+		reset();
+		n_ = frame.rows;
+		sum_.assign(n_, 0.0);
+		outer_ = matrix(n_, n_);
+	}
+	update_stats(frame);
+	update_window(frame);
+
+	// The weighted statistics are scaled to an integral sample count of at
+	// least the window, which keeps the mean and the covariance.
+	const size_t size = window_.size() / n_;
+	struct sample_stats stats;
+	stats.count = max(size, static_cast<size_t>(llround(count_)));
+	const double scale = stats.count / count_;
+	stats.sum = sum_;
+	for (double &v : stats.sum) {
+		v *= scale;
+	}
+	stats.outer = outer_;
+	for (double &v : stats.outer.data) {
+		v *= scale;
+	}
+	const matrix_view X = { window_.data(), n_, size, 1, n_ };
+	whiten_with_stats(X, stats, w);
+
+	if (uW_.empty()) {
+		uniform_real_distribution<double> dist(0.0, 1.0);
+		B = matrix(n_, n_);
+		for (double &v : B.data) {
+			v = dist(rng_);
+		}
+	} else {
+		// The previous separation in the new whitened space.
+		B = matmul(uW_, w.V_inv);
+	}
+	B = decorrelation(B);
+	for (uint32_t i = 0; i < params_.newton_steps; ++i) {
+		lim_ = newton_step(B, w.Xt);
+	}
+	uW_ = matmul(B, w.V);
+	frames_ += 1;
+	return uW_;
+}
+
+} // namespace meica
@@ -0,0 +1,89 @@
+/*
+ * meica_online.hpp
+ *
+ * Online (sliding-window) FastICA for continuous audio streams.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "meica_compute.hpp"
+
+namespace meica
+{
+struct online_params {
+	// Newton updates per frame, bounds the compute time of a frame.
+	uint32_t newton_steps;
+	// Number of the latest samples the Newton updates run on.
+	size_t window;
+	// Time constant (samples) of the exponentially weighted whitening
+	// statistics.
+	size_t memory;
+	uint64_t seed;
+};
+
+online_params default_online_params();
+
+/**
+ * Separation state of one stream, X arrives as a sequence of frames.
+ *
+ * Each frame updates the running mean and covariance of the stream and is
+ * appended to a window of the latest samples. B is carried over from the
+ * previous frame (mapped into the whitened space of the new statistics) and
+ * refined with a fixed number of Newton updates on the whitened window, so
+ * the compute time per frame is bounded. Overlapping frames are not
+ * deduplicated, their common samples are weighted more.
+ */
+class online_separator {
+public:
+	explicit online_separator(const online_params &params);
+
+	/* Forget the stream, e.g. after the number of sources changed. */
+	void reset();
+
+	/**
+	 * Update the separation with the next frame of the stream and return
+	 * uW, the separation matrix for the frame, i.e. hat_S = uW @ X. A
+	 * frame with another number of sources starts a new stream.
+	 */
+	const matrix &update(const matrix_view &frame);
+
+	const matrix &uW() const
+	{
+		return uW_;
+	}
+	uint64_t frame_count() const
+	{
+		return frames_;
+	}
+	/* Convergence of the last Newton update. */
+	double convergence() const
+	{
+		return lim_;
+	}
+
+private:
+	void update_stats(const matrix_view &frame);
+	void update_window(const matrix_view &frame);
+
+	online_params params_;
+	std::mt19937_64 rng_;
+	size_t n_;
+	uint64_t frames_;
+	// Exponentially weighted count, sum(x) and sum(x @ x.T).
+	double count_;
+	std::vector<double> sum_;
+	matrix outer_;
+	// Latest samples, sample-major.
+	std::vector<double> window_;
+	matrix uW_;
+	double lim_;
+};
+
+} // namespace meica
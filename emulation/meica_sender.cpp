@@ -0,0 +1,700 @@
+/*
+ * meica_sender.cpp
+ *
+ * Native data source (traffic generator), a drop-in replacement of
+ * ./client.py for load tests.
+ *
+ * X is generated from the wav files of the google_dataset and fragmented only
+ * once. Chunks are either paced precisely (clock_nanosleep or TSC busy
+ * waiting) or sent unpaced in sendmmsg() bursts for max-rate tests. The send
+ * and ACK timestamps of every message are recorded.
+ *
+ * With --frame_len, X is sent as a continuous stream of consecutive or
+ * overlapping frames, one message per frame, for the online mode of the VNFs.
+ *
+ * With --mixture_cache, S, A and X are mapped from a cache file
+ * (./mixture_cache.hpp) instead of decoding and mixing the wav files on every
+ * run, and X is fragmented directly from the mapping.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "matrix_codec.hpp"
+#include "meica_compute.hpp"
+#include "meica_testbed.hpp"
+#include "mixture_cache.hpp"
+#include "service_header.hpp"
+
+using namespace std;
+
+namespace meica
+{
+static bool g_verbose = false;
+
+// Same as ./meica_host.py.
+constexpr size_t MEICA_IP_TOTAL_LEN = 1400;
+constexpr uint16_t MAX_CHUNK_NUM = 4096;
+// Maximal number of chunks sent with one sendmmsg() call.
+constexpr size_t SEND_BATCH_SIZE = 64;
+
+static void sys_error(const string &what)
+{
+	throw runtime_error(what + ": " + strerror(errno));
+}
+
+static uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Wait until absolute deadlines on CLOCK_MONOTONIC.
+ *
+ * - sleep: clock_nanosleep with TIMER_ABSTIME, no drift over many chunks.
+ * - tsc: Busy waiting on the TSC, for gaps below the timer slack of the
+ *   kernel. Falls back to busy waiting on the clock without a TSC.
+ */
+class pacer {
+public:
+	explicit pacer(const string &method)
+		: tsc_(method == "tsc"), tsc_per_ns_(0.0), tsc_base_(0),
+		  ns_base_(0)
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		if (tsc_) {
+			calibrate();
+		}
+#endif
+	}
+
+	void wait_until(uint64_t deadline_ns) const
+	{
+		if (!tsc_) {
+			struct timespec ts;
+			ts.tv_sec = deadline_ns / 1000000000ULL;
+			ts.tv_nsec = deadline_ns % 1000000000ULL;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					       &ts, nullptr) == EINTR) {
+			}
+			return;
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		if (deadline_ns <= ns_base_) {
+			return;
+		}
+		const uint64_t target =
+			tsc_base_ + static_cast<uint64_t>(
+					    (deadline_ns - ns_base_) * tsc_per_ns_);
+		while (__rdtsc() < target) {
+			_mm_pause();
+		}
+#else
+		while (now_ns() < deadline_ns) {
+		}
+#endif
+	}
+
+private:
+#if defined(__x86_64__) || defined(__i386__)
+	void calibrate()
+	{
+		const uint64_t t0 = now_ns();
+		const uint64_t c0 = __rdtsc();
+		this_thread::sleep_for(chrono::milliseconds(50));
+		const uint64_t t1 = now_ns();
+		const uint64_t c1 = __rdtsc();
+
+		tsc_per_ns_ = static_cast<double>(c1 - c0) / (t1 - t0);
+		tsc_base_ = c1;
+		ns_base_ = t1;
+	}
+#endif
+
+	bool tsc_;
+	double tsc_per_ns_;
+	uint64_t tsc_base_;
+	uint64_t ns_base_;
+};
+
+/**
+ * All chunks of a message in one buffer, each chunk is a service header
+ * followed by the payload.
+ */
+struct message_chunks {
+	vector<uint8_t> buf;
+	vector<size_t> offsets;
+	vector<size_t> lens;
+};
+
+/**
+ * Same as MEICAHost.fragment() of ./meica_host.py with chunk_size bytes of
+ * payload per chunk.
+ */
+static void fragment(const uint8_t *data, size_t len, uint8_t msg_type,
+		     uint8_t msg_flags, uint16_t total_msg_num,
+		     size_t chunk_size, struct message_chunks &chunks)
+{
+	const size_t full_chunks_num = len / chunk_size;
+	const size_t total_chunk_num = full_chunks_num + 1;
+	struct service_header_cpu hdr = {};
+	size_t off = 0;
+
+	if (total_chunk_num > MAX_CHUNK_NUM) {
+		throw runtime_error(
+			"Number of chunks " + to_string(total_chunk_num) +
+			" is larger than the maximal allowed chunks: " +
+			to_string(MAX_CHUNK_NUM) + ".");
+	}
+	chunks.buf.resize(total_chunk_num * SERVICE_HEADER_LEN + len);
+	chunks.offsets.clear();
+	chunks.lens.clear();
+
+	hdr.msg_type = msg_type;
+	hdr.msg_flags = msg_flags;
+	hdr.total_msg_num = total_msg_num;
+	hdr.total_chunk_num = total_chunk_num;
+	hdr.data_chunk_num = total_chunk_num;
+	for (size_t c = 0; c < total_chunk_num; ++c) {
+		size_t payload_len = min(chunk_size, len - c * chunk_size);
+		hdr.chunk_num = c;
+		hdr.chunk_len = payload_len + SERVICE_HEADER_LEN;
+		write_service_header(&chunks.buf[off], hdr);
+		memcpy(&chunks.buf[off + SERVICE_HEADER_LEN],
+		       data + c * chunk_size, payload_len);
+		chunks.offsets.push_back(off);
+		chunks.lens.push_back(hdr.chunk_len);
+		off += hdr.chunk_len;
+	}
+}
+
+/**
+ * Columns [begin, begin + len) of X as a column-major raw matrix.
+ */
+static void encode_frame(const matrix_view &X, size_t begin, size_t len,
+			 vector<uint8_t> &out)
+{
+	matrix frame(X.rows, len);
+
+	for (size_t i = 0; i < X.rows; ++i) {
+		for (size_t j = 0; j < len; ++j) {
+			frame(i, j) = X(i, begin + j);
+		}
+	}
+	encode_raw_matrix(frame, out, raw_order::F);
+}
+
+/* msg_num is at the offset 4 of the service header. */
+static void set_msg_num(struct message_chunks &chunks, uint16_t msg_num)
+{
+	for (size_t off : chunks.offsets) {
+		store_be16(&chunks.buf[off + 4], msg_num);
+	}
+}
+
+class sender {
+public:
+	sender(const struct sockaddr_in &client_addr_data,
+	       const struct sockaddr_in &server_addr_data,
+	       const struct sockaddr_in &server_addr_control,
+	       const string &pacing);
+	~sender();
+
+	void start_session(uint32_t wav_range, uint32_t source_number,
+			   uint32_t total_msg_num);
+	/* Send all chunks, return the timestamp of the last chunk. */
+	uint64_t send_chunks(struct message_chunks &chunks, double chunk_gap);
+	void wait_ack();
+
+private:
+	int sock_data_;
+	int sock_control_;
+	struct sockaddr_in server_addr_data_;
+	struct sockaddr_in server_addr_control_;
+	pacer pacer_;
+	vector<struct iovec> iovs_;
+	vector<struct mmsghdr> msgs_;
+};
+
+sender::sender(const struct sockaddr_in &client_addr_data,
+	       const struct sockaddr_in &server_addr_data,
+	       const struct sockaddr_in &server_addr_control,
+	       const string &pacing)
+	: sock_data_(-1), sock_control_(-1), server_addr_data_(server_addr_data),
+	  server_addr_control_(server_addr_control), pacer_(pacing),
+	  iovs_(SEND_BATCH_SIZE), msgs_(SEND_BATCH_SIZE)
+{
+	int sndbuf = 16 * 1024 * 1024;
+
+	sock_data_ = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock_data_ < 0) {
+		sys_error("Failed to create the data socket");
+	}
+	setsockopt(sock_data_, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+	if (bind(sock_data_,
+		 reinterpret_cast<const struct sockaddr *>(&client_addr_data),
+		 sizeof(client_addr_data)) != 0) {
+		sys_error("Failed to bind the data socket");
+	}
+	// Connected, so sendmmsg() does not need the address for each chunk.
+	if (connect(sock_data_,
+		    reinterpret_cast<const struct sockaddr *>(&server_addr_data_),
+		    sizeof(server_addr_data_)) != 0) {
+		sys_error("Failed to connect the data socket");
+	}
+}
+
+sender::~sender()
+{
+	if (sock_control_ >= 0) {
+		close(sock_control_);
+	}
+	if (sock_data_ >= 0) {
+		close(sock_data_);
+	}
+}
+
+void sender::start_session(uint32_t wav_range, uint32_t source_number,
+			   uint32_t total_msg_num)
+{
+	const string context = to_string(wav_range) + "," +
+			       to_string(source_number) + "," +
+			       to_string(total_msg_num);
+	const string close_msg = "CONTROL_CLOSE";
+	char buf[1024];
+	ssize_t n;
+
+	sock_control_ = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock_control_ < 0) {
+		sys_error("Failed to create the control socket");
+	}
+	if (connect(sock_control_,
+		    reinterpret_cast<const struct sockaddr *>(
+			    &server_addr_control_),
+		    sizeof(server_addr_control_)) != 0) {
+		sys_error("Failed to connect to the server");
+	}
+	send(sock_control_, context.data(), context.size(), 0);
+	n = recv(sock_control_, buf, sizeof(buf) - 1, 0);
+	buf[max(n, static_cast<ssize_t>(0))] = '\0';
+	if (string(buf) != "INIT_ACK") {
+		throw runtime_error("Failed to get the INIT ACK from server!");
+	}
+	send(sock_control_, close_msg.data(), close_msg.size(), 0);
+}
+
+uint64_t sender::send_chunks(struct message_chunks &chunks, double chunk_gap)
+{
+	const size_t total = chunks.offsets.size();
+	const uint64_t gap_ns = static_cast<uint64_t>(chunk_gap * 1e9);
+	size_t sent = 0;
+	size_t batch;
+	int ret;
+
+	const uint64_t start = now_ns();
+	while (sent < total) {
+		// Paced chunks are sent one by one at their deadlines.
+		batch = (gap_ns == 0) ? min(SEND_BATCH_SIZE, total - sent) : 1;
+		if (gap_ns != 0 && sent > 0) {
+			pacer_.wait_until(start + sent * gap_ns);
+		}
+		for (size_t i = 0; i < batch; ++i) {
+			iovs_[i].iov_base = &chunks.buf[chunks.offsets[sent + i]];
+			iovs_[i].iov_len = chunks.lens[sent + i];
+			memset(&msgs_[i], 0, sizeof(msgs_[i]));
+			msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+			msgs_[i].msg_hdr.msg_iovlen = 1;
+		}
+		ret = sendmmsg(sock_data_, msgs_.data(), batch, 0);
+		if (ret < 0) {
+			if (errno == EINTR || errno == ENOBUFS ||
+			    errno == EAGAIN) {
+				continue;
+			}
+			sys_error("sendmmsg failed");
+		}
+		sent += static_cast<size_t>(ret);
+	}
+	return now_ns();
+}
+
+void sender::wait_ack()
+{
+	char buf[1024];
+
+	while (recv(sock_data_, buf, sizeof(buf), 0) < 0) {
+		if (errno != EINTR) {
+			sys_error("Failed to receive the ACK");
+		}
+	}
+}
+
+static struct sockaddr_in make_addr(const string &ip, uint16_t port)
+{
+	struct sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+		throw runtime_error("Invalid IPv4 address: " + ip);
+	}
+	return addr;
+}
+
+} // namespace meica
+
+int main(int argc, char *argv[])
+{
+	string mode = "store_forward";
+	string folder = "/in-network_bss/google_dataset/32000_wav_factory";
+	string service_latency_csv = "client_service_latency";
+	string timestamps_csv = "";
+	string mixture_cache_path = "";
+	string algorithm = "meica";
+	string pacing = "sleep";
+	string client_ip = "10.0.1.11";
+	string server_ip = "10.0.3.11";
+	uint16_t port = 9999;
+	uint32_t wav_range = 1;
+	uint32_t source_number = 2;
+	uint32_t total_msg_num = 1;
+	uint32_t frame_len = 0;
+	uint32_t frame_hop = 0;
+	uint64_t seed = 0;
+	double chunk_gap = 0.01;
+	size_t chunk_size = meica::MEICA_IP_TOTAL_LEN;
+	bool msg_wait = true;
+	bool write_cache = false;
+
+	try {
+		po::options_description desc(
+			"Native MEICA client (data source), usage:");
+		// clang-format off
+		desc.add_options()
+                        ("help,h", "Produce help message")
+                        ("verbose,v", "Enable verbose mode.")
+                        ("mode,m", po::value<string>(), "The working mode of the client: store_forward, compute_forward or no_compute. The default is store_forward.")
+                        ("wav_folder", po::value<string>(), "Folder of the wav files.")
+                        ("wav_range", po::value<uint32_t>(), "Time range to generate data.")
+                        ("source_number", po::value<uint32_t>(), "Number of source node.")
+                        ("total_msg_num", po::value<uint32_t>(), "Number of messages to send.")
+                        ("frame_len", po::value<uint32_t>(), "Send X as a stream of frames of this number of samples, one message per frame (online mode of the VNFs). The total message number is the number of frames. The default 0 sends X in every message.")
+                        ("frame_hop", po::value<uint32_t>(), "The number of samples between the starts of two frames, smaller than frame_len for overlapping frames. The default is frame_len.")
+                        ("chunk_gap", po::value<double>(), "Time (seconds) between each chunk in a message, 0 sends unpaced sendmmsg bursts.")
+                        ("chunk_size", po::value<uint32_t>(), "Payload size (bytes) of each chunk, up to 8956 with a 9000B jumbo frame MTU. The VNFs use the same chunk size up to their --max_chunk_size. The default is 1400.")
+                        ("pacing", po::value<string>(), "Pacing of the chunks: sleep (clock_nanosleep) or tsc (busy waiting). The default is sleep.")
+                        ("no_msg_wait", "Send the next message right after the ACK instead of waiting for wav_range seconds.")
+                        ("algorithm", po::value<string>(), "The ICA algorithm used by the VNFs and the server.")
+                        ("seed", po::value<uint64_t>(), "Seed of the mixing matrix.")
+                        ("mixture_cache", po::value<string>(), "Cache file of S, A and X, read by client.py --mixture_cache as well. It is written if it is missing or was generated with another wav range, source number or seed.")
+                        ("write_cache", "Only write the mixture cache and exit.")
+                        ("service_latency_csv", po::value<string>(), "Basename of the CSV file (without extension name) to store service latency results.")
+                        ("timestamps_csv", po::value<string>(), "CSV file to store the send and ACK timestamps (ns) of every message.")
+                        ("use_fastica", "Run FastICA for comparision.")
+                        ("client_ip", po::value<string>(), "IP address of the client.")
+                        ("server_ip", po::value<string>(), "IP address of the server.")
+                        ("port", po::value<uint16_t>(), "UDP port of the data, the control port is port + 1.");
+		// clang-format on
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			cout << desc << "\n";
+			return 1;
+		}
+		if (vm.count("verbose")) {
+			meica::g_verbose = true;
+		}
+		if (vm.count("mode")) {
+			mode = vm["mode"].as<string>();
+		}
+		if (vm.count("wav_folder")) {
+			folder = vm["wav_folder"].as<string>();
+		}
+		if (vm.count("wav_range")) {
+			wav_range = vm["wav_range"].as<uint32_t>();
+		}
+		if (vm.count("source_number")) {
+			source_number = vm["source_number"].as<uint32_t>();
+		}
+		if (vm.count("total_msg_num")) {
+			total_msg_num = vm["total_msg_num"].as<uint32_t>();
+		}
+		if (vm.count("frame_len")) {
+			frame_len = vm["frame_len"].as<uint32_t>();
+		}
+		if (vm.count("frame_hop")) {
+			frame_hop = vm["frame_hop"].as<uint32_t>();
+		}
+		if (vm.count("chunk_size")) {
+			chunk_size = vm["chunk_size"].as<uint32_t>();
+			if (chunk_size == 0 ||
+			    chunk_size > meica::MAX_JUMBO_CHUNK_SIZE) {
+				cerr << "Error: Invalid chunk size: "
+				     << chunk_size << endl;
+				return 1;
+			}
+		}
+		if (vm.count("chunk_gap")) {
+			chunk_gap = vm["chunk_gap"].as<double>();
+		}
+		if (vm.count("pacing")) {
+			pacing = vm["pacing"].as<string>();
+		}
+		if (vm.count("no_msg_wait")) {
+			msg_wait = false;
+		}
+		if (vm.count("algorithm")) {
+			algorithm = vm["algorithm"].as<string>();
+		}
+		if (vm.count("seed")) {
+			seed = vm["seed"].as<uint64_t>();
+		}
+		if (vm.count("mixture_cache")) {
+			mixture_cache_path = vm["mixture_cache"].as<string>();
+		}
+		if (vm.count("write_cache")) {
+			write_cache = true;
+		}
+		if (vm.count("service_latency_csv")) {
+			service_latency_csv =
+				vm["service_latency_csv"].as<string>();
+		}
+		if (vm.count("timestamps_csv")) {
+			timestamps_csv = vm["timestamps_csv"].as<string>();
+		}
+		if (vm.count("use_fastica")) {
+			service_latency_csv = "fastica_" + service_latency_csv;
+		}
+		if (vm.count("client_ip")) {
+			client_ip = vm["client_ip"].as<string>();
+		}
+		if (vm.count("server_ip")) {
+			server_ip = vm["server_ip"].as<string>();
+		}
+		if (vm.count("port")) {
+			port = vm["port"].as<uint16_t>();
+		}
+	} catch (exception &e) {
+		cerr << "Error:" << e.what() << endl;
+		return 1;
+	}
+
+	meica::ica_algorithm algo;
+	if (!meica::parse_algorithm(algorithm, algo)) {
+		cerr << "Error: Unknown algorithm: " << algorithm << endl;
+		return 1;
+	}
+	if (pacing != "sleep" && pacing != "tsc") {
+		cerr << "Error: Unknown pacing: " << pacing << endl;
+		return 1;
+	}
+	if (frame_hop == 0) {
+		frame_hop = frame_len;
+	}
+	if (total_msg_num == 0 || total_msg_num > UINT16_MAX) {
+		cerr << "Error: Invalid total message number." << endl;
+		return 1;
+	}
+	service_latency_csv = service_latency_csv + "_" + mode + ".csv";
+
+	cout << "* Client runs. Mode: " << mode << endl;
+	cout << "- Wav range: " << wav_range
+	     << ", source number: " << source_number
+	     << ", total message number: " << total_msg_num << "." << endl;
+	cout << "- Chunk size: " << chunk_size << " bytes." << endl;
+	cout << "- Chunk gap: " << chunk_gap << " seconds, pacing: "
+	     << (chunk_gap > 0 ? pacing : "none (sendmmsg bursts)") << "."
+	     << endl;
+	cout << "- Service latency CSV file: " << service_latency_csv << endl;
+
+	if (write_cache && mixture_cache_path.empty()) {
+		cerr << "Error: --write_cache requires --mixture_cache." << endl;
+		return 1;
+	}
+
+	// MARK: Use the same X for all messages.
+	meica::mixture_cache cache;
+	meica::matrix X_storage;
+	meica::matrix_view X;
+	// X is encoded column-major like client.py, so the VNFs accumulate the
+	// statistics during the reception.
+	vector<uint8_t> X_bytes;
+	const uint8_t *X_data;
+	size_t X_len;
+	if (!mixture_cache_path.empty()) {
+		const meica::mixture_params params = {
+			.source_number = source_number,
+			.duration = static_cast<double>(wav_range),
+			.seed = seed,
+		};
+		if (!cache.open(mixture_cache_path) || !cache.matches(params)) {
+			cout << "- Write the mixture cache: "
+			     << mixture_cache_path << endl;
+			if (!meica::write_mixture_cache(mixture_cache_path,
+							folder, params) ||
+			    !cache.open(mixture_cache_path)) {
+				cerr << "Error: Failed to write the mixture cache "
+				     << mixture_cache_path << endl;
+				return 1;
+			}
+		}
+		if (write_cache) {
+			return 0;
+		}
+		X = cache.X();
+		X_data = cache.X_raw();
+		X_len = cache.X_raw_len();
+	} else {
+		meica::matrix S;
+		if (!meica::wavs_to_matrix_S(folder, wav_range, source_number,
+					     S)) {
+			cerr << "Error: Failed to load " << source_number
+			     << " sources from " << folder << endl;
+			return 1;
+		}
+		mt19937_64 rng(seed);
+		X_storage = meica::matmul(
+			meica::generate_matrix_A(source_number, rng), S);
+		meica::encode_raw_matrix(X_storage, X_bytes,
+					 meica::raw_order::F);
+		X = meica::matrix_view::of(X_storage);
+		X_data = X_bytes.data();
+		X_len = X_bytes.size();
+	}
+	// Seconds of the stream between two frames.
+	double frame_period = 0.0;
+	if (frame_len > 0) {
+		if (frame_len > X.cols) {
+			cerr << "Error: The frame is longer than X: " << frame_len
+			     << endl;
+			return 1;
+		}
+		total_msg_num = (X.cols - frame_len) / frame_hop + 1;
+		if (total_msg_num > UINT16_MAX) {
+			cerr << "Error: Too many frames: " << total_msg_num
+			     << endl;
+			return 1;
+		}
+		frame_period = static_cast<double>(frame_hop) * wav_range / X.cols;
+		cout << "- Frames: " << total_msg_num << " of " << frame_len
+		     << " samples, hop: " << frame_hop << " samples." << endl;
+	}
+
+	vector<double> service_latencies;
+	ofstream ts_out;
+	if (!timestamps_csv.empty()) {
+		ifstream existing(timestamps_csv);
+		bool has_header = existing.peek() != ifstream::traits_type::eof();
+		ts_out.open(timestamps_csv, ios::app);
+		if (!has_header) {
+			ts_out << "msg_num,send_start_ns,send_end_ns,ack_ns\n";
+		}
+	}
+
+	try {
+		meica::sender s(meica::make_addr(client_ip, port),
+				meica::make_addr(server_ip, port),
+				meica::make_addr(server_ip, port + 1), pacing);
+		struct meica::message_chunks chunks;
+		vector<uint8_t> frame_bytes;
+
+		// Frames are fragmented when they are sent.
+		if (frame_len == 0) {
+			meica::fragment(X_data, X_len, 0,
+					static_cast<uint8_t>(algo),
+					total_msg_num, chunk_size, chunks);
+		}
+		s.start_session(wav_range, source_number, total_msg_num);
+
+		for (uint32_t msg_num = 0; msg_num < total_msg_num; ++msg_num) {
+			if (frame_len > 0) {
+				meica::encode_frame(X, msg_num * frame_hop,
+						    frame_len, frame_bytes);
+				meica::fragment(frame_bytes.data(),
+						frame_bytes.size(), 0,
+						static_cast<uint8_t>(algo),
+						total_msg_num, chunk_size,
+						chunks);
+			}
+			meica::set_msg_num(chunks, msg_num);
+			if (meica::g_verbose) {
+				cout << "Message number: " << msg_num
+				     << ", size: "
+				     << (frame_len > 0 ? frame_bytes.size() :
+							 X_len)
+				     << ". Start sending "
+				     << chunks.offsets.size()
+				     << " chunks to the server..." << endl;
+			}
+			uint64_t start = meica::now_ns();
+			uint64_t send_end = s.send_chunks(chunks, chunk_gap);
+			s.wait_ack();
+			uint64_t ack = meica::now_ns();
+
+			service_latencies.push_back((ack - start) / 1e9);
+			if (ts_out.is_open()) {
+				ts_out << msg_num << "," << start << ","
+				       << send_end << "," << ack << "\n";
+			}
+			if (meica::g_verbose) {
+				cout << "Total service latency: "
+				     << service_latencies.back() << " seconds."
+				     << endl;
+			}
+			// Wait for next message (or frame) to be ready.
+			const uint64_t period =
+				(frame_len > 0) ?
+					static_cast<uint64_t>(frame_period * 1e9) :
+					wav_range * 1000000000ULL;
+			uint64_t elapsed = meica::now_ns() - start;
+			if (msg_wait && elapsed < period) {
+				this_thread::sleep_for(
+					chrono::nanoseconds(period - elapsed));
+			}
+		}
+	} catch (exception &e) {
+		cerr << "Client stops with error: " << e.what() << endl;
+		return 1;
+	}
+
+	ofstream out(service_latency_csv, ios::app);
+	out << setprecision(numeric_limits<double>::max_digits10)
+	    << source_number;
+	for (double l : service_latencies) {
+		out << "," << l;
+	}
+	out << "\r\n";
+
+	return 0;
+}
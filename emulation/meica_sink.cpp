@@ -0,0 +1,771 @@
+/*
+ * meica_sink.cpp
+ *
+ * Native data destination (receiver), a drop-in replacement of ./server.py.
+ *
+ * Chunks are received in batches with recvmmsg() and copied directly to their
+ * position in a pre-sized reassembly buffer. The separation and the final
+ * hat_S = uW @ X are computed with the native solvers, so the measured service
+ * latency does not include the overhead of the Python end host.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include "matrix_codec.hpp"
+#include "meica_compute.hpp"
+#include "service_header.hpp"
+
+using namespace std;
+
+namespace meica
+{
+static volatile bool g_force_quit = false;
+static bool g_verbose = false;
+
+// Number of datagrams received with one recvmmsg() call.
+constexpr unsigned int RECV_BATCH_SIZE = 64;
+// Large enough for jumbo frames.
+constexpr size_t MAX_DATAGRAM_LEN = 9216;
+// Same as ./meica_host.py.
+constexpr uint16_t MAX_CHUNK_NUM = 4096;
+
+static void signal_handler(int signum)
+{
+	if (signum == SIGINT || signum == SIGTERM) {
+		g_force_quit = true;
+	}
+}
+
+static void sys_error(const string &what)
+{
+	throw runtime_error(what + ": " + strerror(errno));
+}
+
+/* Wall clock in ns since the epoch, same as the trace records of the VNFs. */
+static uint64_t wall_clock_ns()
+{
+	return static_cast<uint64_t>(
+		chrono::duration_cast<chrono::nanoseconds>(
+			chrono::system_clock::now().time_since_epoch())
+			.count());
+}
+
+/**
+ * Receive datagrams in batches. Datagrams received beyond the current message
+ * are kept for the next message.
+ */
+class batch_receiver {
+public:
+	explicit batch_receiver(int fd)
+		: fd_(fd), bufs_(RECV_BATCH_SIZE * MAX_DATAGRAM_LEN),
+		  iovs_(RECV_BATCH_SIZE), msgs_(RECV_BATCH_SIZE), num_(0),
+		  next_(0)
+	{
+		for (unsigned int i = 0; i < RECV_BATCH_SIZE; ++i) {
+			iovs_[i].iov_base = &bufs_[i * MAX_DATAGRAM_LEN];
+			iovs_[i].iov_len = MAX_DATAGRAM_LEN;
+			memset(&msgs_[i], 0, sizeof(msgs_[i]));
+			msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+			msgs_[i].msg_hdr.msg_iovlen = 1;
+		}
+	}
+
+	/* Get the next datagram, block until one is available. */
+	const uint8_t *next(size_t &len)
+	{
+		int ret;
+
+		while (next_ == num_) {
+			// Wait for the first datagram, then take all queued ones.
+			ret = recvmmsg(fd_, msgs_.data(), RECV_BATCH_SIZE,
+				       MSG_WAITFORONE, nullptr);
+			if (ret < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				sys_error("recvmmsg failed");
+			}
+			num_ = static_cast<unsigned int>(ret);
+			next_ = 0;
+		}
+		len = msgs_[next_].msg_len;
+		return &bufs_[(next_++) * MAX_DATAGRAM_LEN];
+	}
+
+private:
+	int fd_;
+	vector<uint8_t> bufs_;
+	vector<struct iovec> iovs_;
+	vector<struct mmsghdr> msgs_;
+	unsigned int num_;
+	unsigned int next_;
+};
+
+/**
+ * A reassembled message. Buffers are reused for all messages.
+ */
+struct message {
+	struct service_header_cpu hdr;
+	// Only the first len bytes are valid, the buffer never shrinks.
+	vector<uint8_t> data;
+	size_t len;
+	vector<uint8_t> received;
+	// The last chunk when it arrives before the chunk size is known.
+	vector<uint8_t> tail;
+	// Extension area of the last chunk, see MSG_FLAG_EXT.
+	vector<uint8_t> ext;
+	// Wall clock when the first chunk is received.
+	uint64_t first_ns;
+};
+
+/**
+ * Receive all chunks of a message. Out-of-order chunks are directly copied to
+ * their position, so no sorting is needed.
+ */
+static void recv_message(batch_receiver &rx, struct message &msg)
+{
+	const uint8_t *chunk;
+	size_t len;
+	size_t payload_len;
+	size_t chunk_size = 0;
+	size_t data_len = 0;
+	uint16_t total_chunk_num = 0;
+	uint16_t chunk_counter = 0;
+	bool has_tail = false;
+	struct service_header_cpu hdr;
+
+	msg.ext.clear();
+	while (chunk_counter == 0 || chunk_counter < total_chunk_num) {
+		chunk = rx.next(len);
+		if (len < SERVICE_HEADER_LEN) {
+			continue;
+		}
+		hdr = parse_service_header(chunk);
+		payload_len = min(len, static_cast<size_t>(hdr.chunk_len)) -
+			      min(static_cast<size_t>(hdr.chunk_len),
+				  static_cast<size_t>(SERVICE_HEADER_LEN));
+		if (hdr.total_chunk_num == 0 ||
+		    hdr.total_chunk_num > MAX_CHUNK_NUM ||
+		    hdr.chunk_num >= hdr.total_chunk_num) {
+			throw runtime_error("Invalid chunk number!");
+		}
+
+		if (chunk_counter == 0) {
+			msg.first_ns = wall_clock_ns();
+			total_chunk_num = hdr.total_chunk_num;
+			msg.hdr = hdr;
+			msg.received.assign(total_chunk_num, 0);
+			// Pre-sized for the largest possible message.
+			msg.data.resize(max(msg.data.size(),
+					    static_cast<size_t>(total_chunk_num) *
+						    MAX_DATAGRAM_LEN));
+		} else if (hdr.total_chunk_num != total_chunk_num) {
+			// A stray chunk of another message, msg is sized by the
+			// first chunk.
+			continue;
+		}
+		if (msg.received[hdr.chunk_num] != 0) {
+			continue;
+		}
+		msg.received[hdr.chunk_num] = 1;
+		chunk_counter += 1;
+		if (hdr.chunk_num == 0) {
+			msg.hdr = hdr;
+		}
+
+		if (hdr.chunk_num == total_chunk_num - 1) {
+			data_len += payload_len;
+			if ((hdr.msg_flags & MSG_FLAG_EXT) != 0 &&
+			    len > hdr.chunk_len) {
+				msg.ext.assign(chunk + hdr.chunk_len,
+					       chunk + len);
+			}
+			if (chunk_size == 0 && total_chunk_num > 1) {
+				msg.tail.assign(chunk + SERVICE_HEADER_LEN,
+						chunk + SERVICE_HEADER_LEN +
+							payload_len);
+				has_tail = true;
+				continue;
+			}
+		} else {
+			data_len += payload_len;
+			if (chunk_size == 0) {
+				chunk_size = payload_len;
+				if (has_tail) {
+					if ((total_chunk_num - 1) * chunk_size +
+						    msg.tail.size() >
+					    msg.data.size()) {
+						throw runtime_error(
+							"Invalid chunk length!");
+					}
+					memcpy(&msg.data[(total_chunk_num - 1) *
+							 chunk_size],
+					       msg.tail.data(), msg.tail.size());
+					has_tail = false;
+				}
+			} else if (payload_len != chunk_size) {
+				throw runtime_error("Inconsistent chunk size!");
+			}
+		}
+		if (hdr.chunk_num * chunk_size + payload_len > msg.data.size()) {
+			throw runtime_error("Invalid chunk length!");
+		}
+		memcpy(&msg.data[hdr.chunk_num * chunk_size],
+		       chunk + SERVICE_HEADER_LEN, payload_len);
+		if (g_verbose) {
+			cout << "Recv " << chunk_counter
+			     << " chunks, msg_type: " << unsigned(hdr.msg_type)
+			     << ", number: " << hdr.chunk_num
+			     << ", length: " << hdr.chunk_len << endl;
+		}
+	}
+	msg.len = data_len;
+}
+
+/**
+ * Write trace records as Chrome trace events (JSON array format), which can be
+ * opened with chrome://tracing or Perfetto. Each node is a process, the
+ * receive, compute and send spans of a message are complete events with the
+ * message number as argument. The closing bracket is optional in this format,
+ * so the file is valid after every message.
+ */
+class trace_writer {
+public:
+	explicit trace_writer(const string &path)
+		: out_(path, ios::trunc), named_(), first_(true)
+	{
+		if (!out_) {
+			throw runtime_error("Failed to open the trace file " +
+					    path + "!");
+		}
+		out_ << "[";
+	}
+
+	~trace_writer()
+	{
+		out_ << "\n]\n";
+	}
+
+	void write(uint32_t msg_num, const vector<struct trace_record> &records)
+	{
+		for (const struct trace_record &rec : records) {
+			if (find(named_.begin(), named_.end(), rec.node_id) ==
+			    named_.end()) {
+				named_.push_back(rec.node_id);
+				begin_event();
+				out_ << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"
+				     << rec.node_id << ",\"args\":{\"name\":\""
+				     << (rec.node_id == TRACE_SINK_NODE_ID ?
+						 string("sink") :
+						 "vnf" + to_string(rec.node_id))
+				     << "\"}}";
+			}
+			write_span("rx", rec.node_id, msg_num, rec.rx_first,
+				   rec.rx_last);
+			if (rec.compute_start != 0) {
+				write_span("compute", rec.node_id, msg_num,
+					   rec.compute_start, rec.compute_end);
+			}
+			if (rec.tx != 0) {
+				write_span("tx", rec.node_id, msg_num,
+					   rec.compute_end != 0 ?
+						   rec.compute_end :
+						   rec.rx_last,
+					   rec.tx);
+			}
+		}
+		out_.flush();
+	}
+
+private:
+	void begin_event()
+	{
+		out_ << (first_ ? "\n" : ",\n");
+		first_ = false;
+	}
+
+	/* Timestamps in us with ns precision. */
+	void write_us(uint64_t ns)
+	{
+		out_ << ns / 1000 << "." << setw(3) << setfill('0') << ns % 1000
+		     << setfill(' ');
+	}
+
+	void write_span(const char *name, uint16_t pid, uint32_t msg_num,
+			uint64_t begin, uint64_t end)
+	{
+		begin_event();
+		out_ << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":"
+		     << pid << ",\"tid\":0,\"ts\":";
+		write_us(begin);
+		out_ << ",\"dur\":";
+		write_us(end > begin ? end - begin : 0);
+		out_ << ",\"args\":{\"msg\":" << msg_num << "}}";
+	}
+
+	ofstream out_;
+	vector<uint16_t> named_;
+	bool first_;
+};
+
+class sink {
+public:
+	sink(const struct sockaddr_in &server_addr_data,
+	     const struct sockaddr_in &client_addr_data,
+	     const struct sockaddr_in &server_addr_control);
+	~sink();
+
+	void run(const string &mode, const string &compute_latency_csv,
+		 bool use_fastica);
+	void probe();
+	/* Write the trace records of the messages to a Chrome trace file. */
+	void enable_trace(const string &path);
+
+private:
+	void handle_session(const string &mode, uint32_t source_number,
+			    uint32_t total_msg_num, const string &csv,
+			    bool use_fastica);
+	bool handle_store_forward(bool use_fastica);
+	bool handle_compute_forward(const struct uW_ext &uW);
+	void send_ack();
+
+	int sock_data_;
+	int sock_control_;
+	struct sockaddr_in client_addr_data_;
+	struct sockaddr_in server_addr_control_;
+	unique_ptr<batch_receiver> rx_;
+	vector<unique_ptr<solver> > solvers_;
+	struct message X_;
+	struct message uW_;
+	unique_ptr<trace_writer> trace_;
+	uint32_t trace_msg_num_;
+};
+
+sink::sink(const struct sockaddr_in &server_addr_data,
+	   const struct sockaddr_in &client_addr_data,
+	   const struct sockaddr_in &server_addr_control)
+	: sock_data_(-1), sock_control_(-1),
+	  client_addr_data_(client_addr_data),
+	  server_addr_control_(server_addr_control), trace_msg_num_(0)
+{
+	int rcvbuf = 16 * 1024 * 1024;
+
+	sock_data_ = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock_data_ < 0) {
+		sys_error("Failed to create the data socket");
+	}
+	// Absorb bursts of chunks during the computation.
+	setsockopt(sock_data_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if (bind(sock_data_,
+		 reinterpret_cast<const struct sockaddr *>(&server_addr_data),
+		 sizeof(server_addr_data)) != 0) {
+		sys_error("Failed to bind the data socket");
+	}
+	rx_.reset(new batch_receiver(sock_data_));
+
+	for (uint8_t id = 0; id < ICA_ALGORITHM_NUM; ++id) {
+		auto algo = static_cast<ica_algorithm>(id);
+		solvers_.push_back(make_solver(algo, default_solver_params(algo)));
+	}
+}
+
+sink::~sink()
+{
+	if (sock_control_ >= 0) {
+		close(sock_control_);
+	}
+	if (sock_data_ >= 0) {
+		close(sock_data_);
+	}
+}
+
+void sink::enable_trace(const string &path)
+{
+	trace_.reset(new trace_writer(path));
+}
+
+void sink::send_ack()
+{
+	static const char ack[] = "OK";
+	sendto(sock_data_, ack, sizeof(ack) - 1, 0,
+	       reinterpret_cast<const struct sockaddr *>(&client_addr_data_),
+	       sizeof(client_addr_data_));
+}
+
+bool sink::handle_store_forward(bool use_fastica)
+{
+	matrix_view X;
+	ica_algorithm algo;
+
+	if (X_.hdr.msg_type != 0) {
+		throw runtime_error("Invalid or unknown message type " +
+				    to_string(X_.hdr.msg_type) + "!");
+	}
+	if (!view_raw_matrix(X_.data.data(), X_.len, X)) {
+		cerr << "[SINK] X is not a raw float64 matrix, use server.py for pickled X."
+		     << endl;
+		return false;
+	}
+	algo = static_cast<ica_algorithm>(X_.hdr.msg_flags &
+					  ICA_ALGORITHM_MASK);
+	if (use_fastica) {
+		algo = ica_algorithm::FASTICA;
+	}
+	if (static_cast<uint8_t>(algo) >= ICA_ALGORITHM_NUM) {
+		algo = ica_algorithm::MEICA;
+	}
+	if (g_verbose) {
+		cout << "Start running centralized " << algorithm_name(algo)
+		     << "." << endl;
+	}
+	matrix W = separate(*solvers_[static_cast<uint8_t>(algo)], X);
+	get_hat_S(W, X);
+	send_ack();
+	return true;
+}
+
+/**
+ * uW is either piggybacked on the last X chunk or the uW message.
+ */
+bool sink::handle_compute_forward(const struct uW_ext &uW)
+{
+	matrix_view X;
+	struct solver_state state = {};
+
+	if (!view_raw_matrix(X_.data.data(), X_.len, X) ||
+	    !decode_raw_matrix(uW.data, uW.len, state.uW)) {
+		cerr << "[SINK] X or uW is not a raw matrix, use server.py for pickled matrices."
+		     << endl;
+		return false;
+	}
+
+	if (uW.msg_flags == 0) {
+		state.iter_num = uW.iter_num;
+		if (g_verbose) {
+			cout << "Start running distributed MEICA. Compute from the "
+			     << state.iter_num << "-th MEICA iteration."
+			     << endl;
+		}
+		solver &s = *solvers_[static_cast<uint8_t>(ica_algorithm::MEICA)];
+		while (!state.has_final_result) {
+			s.run(X, state, 0);
+		}
+	} else if (uW.msg_flags != 1) {
+		throw runtime_error("Unknown message flags!");
+	}
+	get_hat_S(state.uW, X);
+	send_ack();
+	return true;
+}
+
+void sink::handle_session(const string &mode, uint32_t source_number,
+			  uint32_t total_msg_num, const string &csv,
+			  bool use_fastica)
+{
+	vector<double> compute_latencies;
+	bool ok;
+
+	if (mode == "no_compute") {
+		for (uint32_t i = 0; i < total_msg_num; ++i) {
+			recv_message(*rx_, X_);
+			send_ack();
+		}
+		// There is no any compute latency
+		return;
+	}
+
+	struct uW_ext uW = {};
+	vector<struct trace_record> records;
+	const vector<uint8_t> *trace_ext;
+	uint64_t rx_last_ns;
+	for (uint32_t i = 0; i < total_msg_num; ++i) {
+		recv_message(*rx_, X_);
+		trace_ext = &X_.ext;
+		// The uW message is only sent if uW is not piggybacked on X.
+		if (mode == "compute_forward" &&
+		    !parse_uW_ext(X_.ext.data(), X_.ext.size(), uW)) {
+			recv_message(*rx_, uW_);
+			// The last uW chunk can have an extension area.
+			uW.msg_flags = uW_.hdr.msg_flags & ~MSG_FLAG_EXT;
+			uW.iter_num = uW_.hdr.iter_num;
+			uW.data = uW_.data.data();
+			uW.len = uW_.len;
+			trace_ext = &uW_.ext;
+		}
+		rx_last_ns = wall_clock_ns();
+		auto start = chrono::steady_clock::now();
+		ok = (mode == "compute_forward") ?
+			     handle_compute_forward(uW) :
+			     handle_store_forward(use_fastica);
+		auto end = chrono::steady_clock::now();
+		if (trace_ && mode == "compute_forward") {
+			if (!parse_trace_ext(trace_ext->data(), trace_ext->size(),
+					     records)) {
+				cerr << "[SINK] Malformed trace records." << endl;
+			}
+			records.push_back(trace_record{
+				TRACE_SINK_NODE_ID, X_.first_ns,
+				rx_last_ns, rx_last_ns,
+				rx_last_ns +
+					static_cast<uint64_t>(
+						chrono::duration_cast<
+							chrono::nanoseconds>(
+							end - start)
+							.count()),
+				0 });
+			trace_->write(trace_msg_num_, records);
+			trace_msg_num_ += 1;
+		}
+		// Broken messages are ignored.
+		if (ok) {
+			compute_latencies.push_back(
+				chrono::duration<double>(end - start).count());
+		}
+	}
+
+	if (compute_latencies.empty()) {
+		throw runtime_error("No message is processed!");
+	}
+	ofstream out(csv, ios::app);
+	out << setprecision(numeric_limits<double>::max_digits10)
+	    << source_number;
+	for (double l : compute_latencies) {
+		out << "," << l;
+	}
+	out << "\r\n";
+}
+
+void sink::run(const string &mode, const string &compute_latency_csv,
+	       bool use_fastica)
+{
+	const string csv = compute_latency_csv + "_" + mode + ".csv";
+	struct sockaddr_in client_addr_control;
+	socklen_t addr_len;
+	char buf[1024];
+	ssize_t n;
+	int opt = 1;
+	int conn;
+
+	cout << "* Sink starts. Mode: " << mode << endl;
+	sock_control_ = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock_control_ < 0) {
+		sys_error("Failed to create the control socket");
+	}
+	setsockopt(sock_control_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	if (bind(sock_control_,
+		 reinterpret_cast<const struct sockaddr *>(&server_addr_control_),
+		 sizeof(server_addr_control_)) != 0) {
+		sys_error("Failed to bind the control socket");
+	}
+	listen(sock_control_, 1);
+
+	while (!g_force_quit) {
+		addr_len = sizeof(client_addr_control);
+		conn = accept(sock_control_,
+			      reinterpret_cast<struct sockaddr *>(
+				      &client_addr_control),
+			      &addr_len);
+		if (conn < 0) {
+			// Interrupted by the signal handler.
+			if (errno == EINTR) {
+				continue;
+			}
+			sys_error("Failed to accept the control connection");
+		}
+		cout << "Get a connection from "
+		     << inet_ntoa(client_addr_control.sin_addr) << ":"
+		     << ntohs(client_addr_control.sin_port) << endl;
+
+		// Context: wav_range,source_number,total_msg_num
+		n = recv(conn, buf, sizeof(buf) - 1, 0);
+		buf[max(n, static_cast<ssize_t>(0))] = '\0';
+		uint32_t wav_range = 0, source_number = 0, total_msg_num = 0;
+		if (sscanf(buf, "%u,%u,%u", &wav_range, &source_number,
+			   &total_msg_num) != 3) {
+			close(conn);
+			throw runtime_error("Invalid session context!");
+		}
+		send(conn, "INIT_ACK", strlen("INIT_ACK"), 0);
+		n = recv(conn, buf, sizeof(buf) - 1, 0);
+		buf[max(n, static_cast<ssize_t>(0))] = '\0';
+		close(conn);
+		if (string(buf) != "CONTROL_CLOSE") {
+			throw runtime_error(
+				"Failed to handle control close message!");
+		}
+
+		handle_session(mode, source_number, total_msg_num, csv,
+			       use_fastica);
+		cout << "Finish the session from "
+		     << inet_ntoa(client_addr_control.sin_addr) << ":"
+		     << ntohs(client_addr_control.sin_port) << endl;
+	}
+	cout << "* Sink stops." << endl;
+}
+
+void sink::probe()
+{
+	vector<double> probe_latencies;
+	size_t len;
+
+	cout << "Receive probing packets." << endl;
+	for (int i = 0; i < 100 + 1; ++i) {
+		auto start = chrono::steady_clock::now();
+		rx_->next(len);
+		auto end = chrono::steady_clock::now();
+		probe_latencies.push_back(
+			chrono::duration<double>(end - start).count());
+	}
+
+	ofstream out("./network_latency.csv", ios::app);
+	out << setprecision(numeric_limits<double>::max_digits10);
+	for (size_t i = 1; i < probe_latencies.size(); ++i) {
+		out << (i > 1 ? "," : "") << probe_latencies[i];
+	}
+	out << "\r\n";
+}
+
+static struct sockaddr_in make_addr(const string &ip, uint16_t port)
+{
+	struct sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+		throw runtime_error("Invalid IPv4 address: " + ip);
+	}
+	return addr;
+}
+
+} // namespace meica
+
+int main(int argc, char *argv[])
+{
+	string mode = "store_forward";
+	string compute_latency_csv = "server_compute_latency";
+	string server_ip = "10.0.3.11";
+	string client_ip = "10.0.1.11";
+	uint16_t port = 9999;
+	bool use_fastica = false;
+	bool probe = false;
+	string trace_json;
+
+	try {
+		po::options_description desc(
+			"Native MEICA server (data destination), usage:");
+		// clang-format off
+		desc.add_options()
+                        ("help,h", "Produce help message")
+                        ("verbose,v", "Print debug information")
+                        ("mode,m", po::value<string>(), "Working mode of the server: store_forward, compute_forward or no_compute. The default is store_forward.")
+                        ("probe", "Receive probing packets.")
+                        ("compute_latency_csv", po::value<string>(), "Basename of the CSV file to store compute latency results on the server.")
+                        ("use_fastica", "Run FastICA for comparision.")
+                        ("server_ip", po::value<string>(), "IP address of the server.")
+                        ("client_ip", po::value<string>(), "IP address of the client, ACKs are sent to it.")
+                        ("port", po::value<uint16_t>(), "UDP port of the data, the control port is port + 1.")
+                        ("trace_json", po::value<string>(), "Write the trace records of the VNFs and the sink (compute_forward mode) to this Chrome trace JSON file.");
+		// clang-format on
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			cout << desc << "\n";
+			return 1;
+		}
+		if (vm.count("verbose")) {
+			meica::g_verbose = true;
+		}
+		if (vm.count("mode")) {
+			mode = vm["mode"].as<string>();
+		}
+		if (vm.count("probe")) {
+			probe = true;
+		}
+		if (vm.count("compute_latency_csv")) {
+			compute_latency_csv =
+				vm["compute_latency_csv"].as<string>();
+		}
+		if (vm.count("use_fastica")) {
+			use_fastica = true;
+		}
+		if (vm.count("server_ip")) {
+			server_ip = vm["server_ip"].as<string>();
+		}
+		if (vm.count("client_ip")) {
+			client_ip = vm["client_ip"].as<string>();
+		}
+		if (vm.count("port")) {
+			port = vm["port"].as<uint16_t>();
+		}
+		if (vm.count("trace_json")) {
+			trace_json = vm["trace_json"].as<string>();
+		}
+	} catch (exception &e) {
+		cerr << "Error:" << e.what() << endl;
+		return 1;
+	}
+
+	if (mode != "store_forward" && mode != "compute_forward" &&
+	    mode != "no_compute") {
+		cerr << "Error: Unknown mode: " << mode << endl;
+		return 1;
+	}
+	if (use_fastica) {
+		compute_latency_csv = "fastica_" + compute_latency_csv;
+		cout << "Use FastICA as comparison. CSV file: "
+		     << compute_latency_csv << endl;
+	}
+
+	// Without SA_RESTART, so a blocking accept() returns on the signals.
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = meica::signal_handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, nullptr);
+	sigaction(SIGTERM, &sa, nullptr);
+
+	try {
+		meica::sink s(meica::make_addr(server_ip, port),
+			      meica::make_addr(client_ip, port),
+			      meica::make_addr(server_ip, port + 1));
+		if (!trace_json.empty()) {
+			s.enable_trace(trace_json);
+		}
+		if (probe) {
+			s.probe();
+		} else {
+			s.run(mode, compute_latency_csv, use_fastica);
+		}
+	} catch (exception &e) {
+		cerr << "Server stops with error: " << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * meica_stats.cpp
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "meica_stats.hpp"
+
+using namespace std;
+
+namespace meica
+{
+level_stats_accumulator::level_stats_accumulator(uint32_t base)
+	: base_(max(base, 2U)), valid_(true), hdr_bytes_(), hdr_len_(0),
+	  hdr_(), levels_(0), col_(0), sample_(), sample_len_(0), buckets_()
+{
+}
+
+void level_stats_accumulator::reset()
+{
+	valid_ = true;
+	hdr_len_ = 0;
+	levels_ = 0;
+	col_ = 0;
+	sample_len_ = 0;
+}
+
+bool level_stats_accumulator::feed(const uint8_t *data, size_t len)
+{
+	size_t n;
+
+	if (!valid_) {
+		return false;
+	}
+
+	if (hdr_len_ < RAW_MATRIX_HEADER_LEN) {
+		n = min(len, RAW_MATRIX_HEADER_LEN - hdr_len_);
+		memcpy(hdr_bytes_ + hdr_len_, data, n);
+		hdr_len_ += n;
+		data += n;
+		len -= n;
+		if (hdr_len_ < RAW_MATRIX_HEADER_LEN) {
+			return true;
+		}
+		if (!parse_raw_matrix_header(hdr_bytes_, hdr_len_, hdr_) ||
+		    hdr_.dtype != raw_dtype::FLOAT64 ||
+		    hdr_.order != raw_order::F || hdr_.rows == 0) {
+			valid_ = false;
+			return false;
+		}
+		levels_ = meica_level_num(hdr_.rows, hdr_.cols, base_);
+		sample_.resize(hdr_.rows);
+		// Buffers are kept over messages with the same shape.
+		buckets_.resize(levels_);
+		for (auto &b : buckets_) {
+			b.count = 0;
+			b.sum.assign(hdr_.rows, 0.0);
+			if (b.outer.rows != hdr_.rows) {
+				b.outer = matrix(hdr_.rows, hdr_.rows);
+			} else {
+				fill(b.outer.data.begin(), b.outer.data.end(),
+				     0.0);
+			}
+		}
+	}
+
+	// Samples are copied out of the payload since it is not aligned.
+	const size_t sample_size = hdr_.rows * sizeof(double);
+	uint8_t *sample = reinterpret_cast<uint8_t *>(sample_.data());
+	while (len > 0 && col_ < hdr_.cols) {
+		n = min(len, sample_size - sample_len_);
+		memcpy(sample + sample_len_, data, n);
+		sample_len_ += n;
+		data += n;
+		len -= n;
+		if (sample_len_ == sample_size) {
+			add_sample(sample_.data());
+			sample_len_ = 0;
+		}
+	}
+	return true;
+}
+
+void level_stats_accumulator::add_sample(const double *x)
+{
+	const size_t n = hdr_.rows;
+	uint16_t e = 0;
+	size_t p = base_;
+	size_t i, k;
+
+	// Sample 0 is used by all levels.
+	while (e + 1 < levels_ && col_ % p == 0) {
+		e += 1;
+		p *= base_;
+	}
+	sample_stats &b = buckets_[e];
+	b.count += 1;
+	// The full outer product is accumulated instead of the triangle, so
+	// the inner loop has a fixed length and is vectorized.
+	for (i = 0; i < n; ++i) {
+		const double xi = x[i];
+		double *row = &b.outer.data[i * n];
+		b.sum[i] += xi;
+		for (k = 0; k < n; ++k) {
+			row[k] += xi * x[k];
+		}
+	}
+	col_ += 1;
+}
+
+bool level_stats_accumulator::get_stats(size_t step, sample_stats &stats) const
+{
+	uint16_t e = 0;
+	size_t p = 1;
+	size_t i;
+
+	if (!complete()) {
+		return false;
+	}
+	while (p < step && e < levels_) {
+		p *= base_;
+		e += 1;
+	}
+	if (p != step || e >= levels_) {
+		return false;
+	}
+
+	stats = buckets_[e];
+	for (++e; e < levels_; ++e) {
+		const sample_stats &b = buckets_[e];
+		stats.count += b.count;
+		for (i = 0; i < b.sum.size(); ++i) {
+			stats.sum[i] += b.sum[i];
+		}
+		for (i = 0; i < b.outer.data.size(); ++i) {
+			stats.outer.data[i] += b.outer.data[i];
+		}
+	}
+	return true;
+}
+
+} // namespace meica
@@ -0,0 +1,79 @@
+/*
+ * meica_stats.hpp
+ *
+ * Sufficient statistics of the MEICA levels, accumulated while X is received.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "matrix_codec.hpp"
+#include "meica_compute.hpp"
+
+namespace meica
+{
+/**
+ * Accumulate the sample statistics of all uXs of MEICA from the raw X bytes.
+ *
+ * X must be a float64 raw matrix in Fortran order, so every sample (column)
+ * is contiguous in the byte stream and can be accumulated as soon as it is
+ * received. Level k uses the samples X[:, ::base^(levels-1-k)], so the samples
+ * are put into buckets by the largest power of base that divides their index
+ * and the statistics of a level are the sum of the buckets of its step and
+ * larger.
+ */
+class level_stats_accumulator {
+public:
+	explicit level_stats_accumulator(uint32_t base);
+
+	/* Start the accumulation of a new message. */
+	void reset();
+
+	/**
+	 * Feed the next bytes of the message. Return false if the message can
+	 * not be accumulated, the following bytes are then ignored.
+	 */
+	bool feed(const uint8_t *data, size_t len);
+
+	/* Stop the accumulation, e.g. because chunks are out of order. */
+	void invalidate()
+	{
+		valid_ = false;
+	}
+
+	/* All samples of a valid X are accumulated. */
+	bool complete() const
+	{
+		return valid_ && hdr_len_ == RAW_MATRIX_HEADER_LEN &&
+		       col_ == hdr_.cols;
+	}
+
+	/**
+	 * Get the statistics of X[:, ::step], return false if they are not
+	 * available, i.e. the accumulation is not complete or step is not a
+	 * level step.
+	 */
+	bool get_stats(size_t step, sample_stats &stats) const;
+
+private:
+	void add_sample(const double *x);
+
+	uint32_t base_;
+	bool valid_;
+	uint8_t hdr_bytes_[RAW_MATRIX_HEADER_LEN];
+	size_t hdr_len_;
+	raw_matrix_header hdr_;
+	uint16_t levels_;
+	size_t col_;
+	// Bytes of a sample that is split over multiple chunks.
+	std::vector<double> sample_;
+	size_t sample_len_;
+	std::vector<sample_stats> buckets_;
+};
+
+} // namespace meica
@@ -0,0 +1,406 @@
+/*
+ * meica_testbed.cpp
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "meica_testbed.hpp"
+
+using namespace std;
+
+namespace meica
+{
+static uint32_t le32(const char *p)
+{
+	const uint8_t *u = reinterpret_cast<const uint8_t *>(p);
+	return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<uint32_t>(u[3]) << 24);
+}
+
+static uint16_t le16(const char *p)
+{
+	const uint8_t *u = reinterpret_cast<const uint8_t *>(p);
+	return u[0] | (u[1] << 8);
+}
+
+bool mapped_file::open(const string &path)
+{
+	struct stat st;
+	int fd;
+	void *p;
+
+	close();
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps a reference of the file.
+	::close(fd);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	data_ = static_cast<const uint8_t *>(p);
+	size_ = st.st_size;
+	return true;
+}
+
+void mapped_file::close()
+{
+	if (data_ != nullptr) {
+		munmap(const_cast<uint8_t *>(data_), size_);
+		data_ = nullptr;
+		size_ = 0;
+	}
+}
+
+void pcm16_to_double(const uint8_t *pcm, size_t n, double *out)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	// memcpy of an unaligned sample is a plain load, so the loop is
+	// vectorized.
+	for (size_t i = 0; i < n; ++i) {
+		int16_t v;
+		memcpy(&v, pcm + 2 * i, sizeof(v));
+		out[i] = v;
+	}
+#else
+	for (size_t i = 0; i < n; ++i) {
+		out[i] = static_cast<int16_t>(
+			le16(reinterpret_cast<const char *>(pcm) + 2 * i));
+	}
+#endif
+}
+
+/**
+ * Find the samples of a mono 16-bit PCM WAV file in its mapping.
+ */
+static bool find_wav_pcm(const mapped_file &f, uint32_t &sample_rate,
+			 const uint8_t *&pcm, size_t &n)
+{
+	const char *p = reinterpret_cast<const char *>(f.data());
+	const char *end = p + f.size();
+	bool has_fmt = false;
+
+	if (f.size() < 12 || memcmp(p, "RIFF", 4) != 0 ||
+	    memcmp(p + 8, "WAVE", 4) != 0) {
+		return false;
+	}
+	p += 12;
+	while (end - p >= 8) {
+		const uint32_t len = le32(p + 4);
+		const char *body = p + 8;
+		if (static_cast<size_t>(end - body) < len) {
+			return false;
+		}
+		if (memcmp(p, "fmt ", 4) == 0) {
+			// PCM, mono, 16 bits per sample.
+			if (len < 16 || le16(body) != 1 || le16(body + 2) != 1 ||
+			    le16(body + 14) != 16) {
+				return false;
+			}
+			sample_rate = le32(body + 4);
+			has_fmt = true;
+		} else if (memcmp(p, "data", 4) == 0) {
+			if (!has_fmt) {
+				return false;
+			}
+			pcm = reinterpret_cast<const uint8_t *>(body);
+			n = len / 2;
+			return true;
+		}
+		// Chunks are padded to an even length, the padding of the last
+		// chunk may be missing.
+		if (static_cast<size_t>(end - body) < len + (len & 1)) {
+			break;
+		}
+		p = body + len + (len & 1);
+	}
+	return false;
+}
+
+bool read_wav(const string &path, uint32_t &sample_rate, vector<double> &samples)
+{
+	mapped_file f;
+	const uint8_t *pcm;
+	size_t n;
+
+	if (!f.open(path) || !find_wav_pcm(f, sample_rate, pcm, n)) {
+		return false;
+	}
+	samples.resize(n);
+	pcm16_to_double(pcm, n, samples.data());
+	return true;
+}
+
+bool wavs_to_matrix_S(const string &folder, double duration,
+		      size_t source_number, matrix &S, uint32_t &sample_rate)
+{
+	mapped_file f;
+	const uint8_t *pcm;
+	size_t n;
+	size_t wav_range = 0;
+
+	for (size_t i = 0; i < source_number; ++i) {
+		if (!f.open(folder + "/" + to_string(i) + ".wav") ||
+		    !find_wav_pcm(f, sample_rate, pcm, n)) {
+			return false;
+		}
+		if (i == 0) {
+			wav_range = static_cast<size_t>(duration * sample_rate);
+			S = matrix(source_number, wav_range);
+		}
+		if (wav_range > n ||
+		    static_cast<size_t>(duration * sample_rate) != wav_range) {
+			return false;
+		}
+		size_t start = n / 2 - wav_range / 2;
+		double *row = S.data.data() + i * wav_range;
+		pcm16_to_double(pcm + 2 * start, wav_range, row);
+		double mean_abs = 0.0;
+		for (size_t j = 0; j < wav_range; ++j) {
+			mean_abs += fabs(row[j]);
+		}
+		mean_abs /= wav_range;
+		for (size_t j = 0; j < wav_range; ++j) {
+			row[j] /= mean_abs;
+		}
+	}
+	return true;
+}
+
+bool wavs_to_matrix_S(const string &folder, double duration,
+		      size_t source_number, matrix &S)
+{
+	uint32_t sample_rate;
+
+	return wavs_to_matrix_S(folder, duration, source_number, S,
+				sample_rate);
+}
+
+matrix generate_matrix_A(size_t source_number, mt19937_64 &rng)
+{
+	uniform_real_distribution<double> dist(0.0, 1.0);
+	matrix A(source_number, source_number, 1.0);
+	for (size_t i = 0; i < source_number; ++i) {
+		for (size_t j = 0; j < source_number; ++j) {
+			if (i != j) {
+				A(i, j) = 0.01 + (1.0 - 0.01) * dist(rng);
+			}
+		}
+	}
+	return A;
+}
+
+static void center_rows(matrix &m)
+{
+	for (size_t i = 0; i < m.rows; ++i) {
+		double mean = 0.0;
+		for (size_t j = 0; j < m.cols; ++j) {
+			mean += m(i, j);
+		}
+		mean /= m.cols;
+		for (size_t j = 0; j < m.cols; ++j) {
+			m(i, j) -= mean;
+		}
+	}
+}
+
+static double row_dot(const matrix &a, size_t i, const matrix &b, size_t k)
+{
+	double sum = 0.0;
+	for (size_t j = 0; j < a.cols; ++j) {
+		sum += a(i, j) * b(k, j);
+	}
+	return sum;
+}
+
+double mean_si_sdr(const matrix &S, const matrix &hat_S)
+{
+	const size_t n = S.rows;
+	matrix s = S;
+	matrix e = hat_S;
+	vector<bool> used(n, false);
+	double total = 0.0;
+
+	center_rows(s);
+	center_rows(e);
+
+	matrix corr(n, n);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t k = 0; k < n; ++k) {
+			corr(i, k) = fabs(row_dot(s, i, e, k)) /
+				     sqrt(row_dot(s, i, s, i) * row_dot(e, k, e, k));
+		}
+	}
+	vector<bool> matched(n, false);
+	for (size_t r = 0; r < n; ++r) {
+		// Match the pair with the highest correlation first.
+		size_t bi = 0, bk = 0;
+		double best = -1.0;
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t k = 0; k < n; ++k) {
+				if (!matched[i] && !used[k] && corr(i, k) > best) {
+					best = corr(i, k);
+					bi = i;
+					bk = k;
+				}
+			}
+		}
+		matched[bi] = true;
+		used[bk] = true;
+
+		double alpha = row_dot(e, bk, s, bi) / row_dot(s, bi, s, bi);
+		double target = 0.0;
+		double noise = 0.0;
+		for (size_t j = 0; j < s.cols; ++j) {
+			double t = alpha * s(bi, j);
+			target += t * t;
+			noise += (t - e(bk, j)) * (t - e(bk, j));
+		}
+		total += 10.0 * log10(target / max(noise,
+						    numeric_limits<double>::min()));
+	}
+	return total / n;
+}
+
+/**
+ * |row| / max(|row|) of the rows [begin, end) of X into the contiguous rows of
+ * out.
+ */
+static void normalize_abs_rows(const matrix_view &X, size_t begin, size_t end,
+			       matrix &out)
+{
+	for (size_t i = begin; i < end; ++i) {
+		double *row = &out.data[i * out.cols];
+		double peak = 0.0;
+		for (size_t j = 0; j < X.cols; ++j) {
+			row[j] = fabs(X(i, j));
+			peak = max(peak, row[j]);
+		}
+		const double scale = (peak > 0.0) ? 1.0 / peak : 0.0;
+		for (size_t j = 0; j < X.cols; ++j) {
+			row[j] *= scale;
+		}
+	}
+}
+
+/* L1 distances of the sources [begin, end) to all estimated sources. */
+static void psnr_distances(const matrix &s, const matrix &e, size_t begin,
+			   size_t end, matrix &dist, vector<double> &signal)
+{
+	const size_t m = s.cols;
+
+	for (size_t i = begin; i < end; ++i) {
+		const double *a = &s.data[i * m];
+		double sum = 0.0;
+		for (size_t j = 0; j < m; ++j) {
+			sum += a[j];
+		}
+		signal[i] = sum;
+		for (size_t k = 0; k < e.rows; ++k) {
+			const double *b = &e.data[k * m];
+			double d = 0.0;
+			// Contiguous rows, so the loop is vectorized.
+			for (size_t j = 0; j < m; ++j) {
+				d += fabs(a[j] - b[j]);
+			}
+			dist(i, k) = d;
+		}
+	}
+}
+
+double fast_psnr(const matrix_view &S, const matrix_view &hat_S,
+		 vector<size_t> &order, unsigned threads)
+{
+	const size_t n = S.rows;
+	const size_t m = S.cols;
+	matrix s(n, m);
+	matrix e(hat_S.rows, m);
+	matrix dist(n, hat_S.rows);
+	vector<double> signal(n);
+	vector<thread> workers;
+	double amplitude_signal = 0.0;
+	double amplitude_noise = 0.0;
+
+	if (hat_S.cols != m || hat_S.rows == 0 || n == 0) {
+		throw invalid_argument("S and hat_S must have the same shape.");
+	}
+	if (threads == 0) {
+		threads = max(thread::hardware_concurrency(), 1U);
+	}
+	threads = static_cast<unsigned>(min<size_t>(threads, max(n, hat_S.rows)));
+
+	// Each worker takes an equal share of the rows of a pass.
+	auto run = [&](size_t rows, const function<void(size_t, size_t)> &f) {
+		workers.clear();
+		for (unsigned t = 1; t < threads; ++t) {
+			workers.emplace_back(f, rows * t / threads,
+					     rows * (t + 1) / threads);
+		}
+		f(0, rows / threads);
+		for (thread &w : workers) {
+			w.join();
+		}
+	};
+	run(n, [&](size_t begin, size_t end) {
+		normalize_abs_rows(S, begin, end, s);
+	});
+	run(hat_S.rows, [&](size_t begin, size_t end) {
+		normalize_abs_rows(hat_S, begin, end, e);
+	});
+	run(n, [&](size_t begin, size_t end) {
+		psnr_distances(s, e, begin, end, dist, signal);
+	});
+
+	order.assign(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t k = 1; k < hat_S.rows; ++k) {
+			if (dist(i, k) < dist(i, order[i])) {
+				order[i] = k;
+			}
+		}
+		amplitude_noise += dist(i, order[i]);
+		amplitude_signal += signal[i];
+	}
+	if (!(amplitude_noise > 0.0)) {
+		throw domain_error("No noise exists.");
+	}
+	return 20.0 * log10(amplitude_signal / amplitude_noise);
+}
+
+double amari_index(const matrix &W, const matrix &A)
+{
+	const matrix P = matmul(W, A);
+	const size_t n = P.rows;
+	double sum = 0.0;
+
+	for (size_t i = 0; i < n; ++i) {
+		double row_max = 0.0, row_sum = 0.0;
+		double col_max = 0.0, col_sum = 0.0;
+		for (size_t j = 0; j < n; ++j) {
+			row_max = max(row_max, fabs(P(i, j)));
+			row_sum += fabs(P(i, j));
+			col_max = max(col_max, fabs(P(j, i)));
+			col_sum += fabs(P(j, i));
+		}
+		sum += row_sum / row_max - 1.0 + col_sum / col_max - 1.0;
+	}
+	return sum / (2.0 * n * (n - 1));
+}
+
+} // namespace meica
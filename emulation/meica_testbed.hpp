@@ -0,0 +1,107 @@
+/*
+ * meica_testbed.hpp
+ *
+ * Native counterparts of the test bed functions in ../pyfastbss_testbed.py.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "meica_compute.hpp"
+
+namespace meica
+{
+/**
+ * Read-only memory mapping of a whole file.
+ */
+class mapped_file {
+public:
+	mapped_file() : data_(nullptr), size_(0)
+	{
+	}
+	~mapped_file()
+	{
+		close();
+	}
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	/* Map the file at path, a file mapped before is unmapped. */
+	bool open(const std::string &path);
+	void close();
+
+	const uint8_t *data() const
+	{
+		return data_;
+	}
+	size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	const uint8_t *data_;
+	size_t size_;
+};
+
+/**
+ * Convert n little-endian 16-bit PCM samples at pcm, which may be unaligned,
+ * to double. The loop is vectorized by the compiler.
+ */
+void pcm16_to_double(const uint8_t *pcm, size_t n, double *out);
+
+/**
+ * Read a mono 16-bit PCM WAV file. Samples are returned as float.
+ */
+bool read_wav(const std::string &path, uint32_t &sample_rate,
+	      std::vector<double> &samples);
+
+/**
+ * Generate S from the wav files <folder>/0.wav ... <folder>/<n-1>.wav.
+ *
+ * Same as pyfbss_tb.wavs_to_matrix_S with fixed sources: duration seconds
+ * are taken from the middle of each file and normalized by the mean of the
+ * absolute values. The files are mapped and only the taken samples are
+ * converted. sample_rate is set to the one of the files.
+ */
+bool wavs_to_matrix_S(const std::string &folder, double duration,
+		      size_t source_number, matrix &S, uint32_t &sample_rate);
+bool wavs_to_matrix_S(const std::string &folder, double duration,
+		      size_t source_number, matrix &S);
+
+/**
+ * Random mixing matrix: a_ii = 1 and a_ij in [0.01, 1) for i != j.
+ */
+matrix generate_matrix_A(size_t source_number, std::mt19937_64 &rng);
+
+/**
+ * Mean scale-invariant SDR (dB) of hat_S against S. Estimated sources are
+ * greedily matched to the references by the absolute correlation.
+ */
+double mean_si_sdr(const matrix &S, const matrix &hat_S);
+
+/**
+ * Same as pyfbss_tb.fast_psnr: The rows of S and hat_S are normalized by
+ * their maximal absolute values, each source is matched to the estimated
+ * source with the smallest L1 distance of the absolute values and the PSNR
+ * (dB) of all sources is returned. order[i] is the row of hat_S matched to
+ * source i. The distances are computed by up to threads threads (0 for all
+ * CPUs) over the sources. Throw std::invalid_argument if the shapes differ
+ * and std::domain_error if there is no noise.
+ */
+double fast_psnr(const matrix_view &S, const matrix_view &hat_S,
+		 std::vector<size_t> &order, unsigned threads = 1);
+
+/**
+ * Amari performance index of the global matrix W @ A, 0 for a perfect
+ * separation.
+ */
+double amari_index(const matrix &W, const matrix &A);
+
+} // namespace meica
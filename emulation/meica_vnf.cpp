@@ -5,16 +5,21 @@
  */
 
 #include <signal.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <numeric>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -40,7 +45,16 @@ namespace py = pybind11;
 namespace po = boost::program_options;
 #include <boost/asio/ip/host_name.hpp>
 
+#include "admission_control.hpp"
+#include "matrix_codec.hpp"
+#include "meica_compute.hpp"
+#include "meica_data_parallel.hpp"
+#include "meica_online.hpp"
+#include "meica_stats.hpp"
 #include "meica_vnf_utils.hpp"
+#include "perf_counters.hpp"
+#include "py_worker.hpp"
+#include "result_cache.hpp"
 
 using namespace std;
 
@@ -48,10 +62,42 @@ namespace meica
 {
 /* MEICA VNF related constants */
 static constexpr uint16_t BURST_SIZE = 128; // burst size for both RX and TX.
-static constexpr uint16_t MAX_CHUNK_SIZE = 1400; // bytes
+// Mbufs of the RX pool for jumbo chunks.
+static constexpr unsigned int NUM_RX_MBUFS = 8191;
+
+/**
+ * Options of the native compute engine, see solver_params.
+ */
+struct native_engine_conf {
+	size_t stochastic_samples;
+	bool mixed_precision;
+	uint32_t speculative_starts;
+	vector<unsigned> speculative_cpus;
+};
+
+/**
+ * Options of the cross-hop tracing, see trace_record.
+ */
+struct trace_conf {
+	bool enabled;
+	uint16_t node_id;
+};
+
+/**
+ * Conversion of TSC timestamps into the wall clock (ns since the epoch) of the
+ * trace records. It is calibrated once, so reading a timestamp on the fast
+ * path is only a rte_rdtsc().
+ */
+struct trace_clock {
+	uint64_t tsc0;
+	uint64_t ns0;
+	uint64_t hz;
+};
 
 /* TODO:  <26-01-21, Zuo>: Remove this global variable. */
 struct rte_mempool *fast_forward_pool = NULL;
+struct tx_cksum_conf tx_cksum_conf;
+struct trace_clock trace_clock;
 
 /**
  * Working states of the MEICA VNF.
@@ -66,6 +112,36 @@ enum class VNF_STATE {
 	SEND_UW_CHUNKS,
 };
 
+const char *vnf_state_name(VNF_STATE state)
+{
+	switch (state) {
+	case VNF_STATE::RESET:
+		return "RESET";
+	case VNF_STATE::FORWARD_X_CHUNKS:
+		return "FORWARD_X_CHUNKS";
+	case VNF_STATE::RECV_UW_CHUNKS:
+		return "RECV_UW_CHUNKS";
+	case VNF_STATE::TRY_FORWARD_UW_CHUNKS:
+		return "TRY_FORWARD_UW_CHUNKS";
+	case VNF_STATE::PROCESS_CHUNKS:
+		return "PROCESS_CHUNKS";
+	case VNF_STATE::SEND_UW_CHUNKS:
+		return "SEND_UW_CHUNKS";
+	}
+	return "UNKNOWN";
+}
+
+/**
+ * uW of the current message, received as uW chunks or piggybacked on the final
+ * X chunk. It is replaced by the result of this VNF.
+ */
+struct uW_state {
+	bool valid;
+	bool has_final_result;
+	uint16_t iter_num;
+	vector<uint8_t> bytes;
+};
+
 /**
  * Information struct of the MEICA VNF.
  */
@@ -77,6 +153,9 @@ struct vnf_info {
 /* Global variables.*/
 static volatile bool g_force_quit = false;
 static bool g_verbose = false;
+// Local maximal chunk payload size, the chunk size of a flow is negotiated up
+// to it.
+static uint16_t g_max_chunk_size = DEFAULT_CHUNK_SIZE;
 
 static void signal_handler(int signum)
 {
@@ -85,6 +164,160 @@ static void signal_handler(int signum)
 	}
 }
 
+void init_trace_clock(struct trace_clock &clock)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	clock.tsc0 = rte_rdtsc();
+	clock.ns0 = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+		    static_cast<uint64_t>(ts.tv_nsec);
+	clock.hz = rte_get_tsc_hz();
+}
+
+uint64_t tsc_to_ns(const struct trace_clock &clock, uint64_t tsc)
+{
+	if (tsc == 0) {
+		return 0;
+	}
+	const uint64_t cycles = tsc - clock.tsc0;
+	return clock.ns0 + cycles / clock.hz * 1000000000ULL +
+	       (cycles % clock.hz) * 1000000000ULL / clock.hz;
+}
+
+/**
+ * Performance counters of the calling thread, opened on the first use. They
+ * are not open if perf events are not available.
+ */
+perf_counters &thread_perf_counters()
+{
+	static thread_local perf_counters counters;
+	static thread_local bool opened = false;
+	string error;
+
+	if (!opened) {
+		opened = true;
+		if (!counters.open(error)) {
+			RTE_LOG(WARNING, USER1,
+				"No performance counters on lcore %u: %s.\n",
+				rte_lcore_id(), error.c_str());
+		}
+	}
+	return counters;
+}
+
+/**
+ * Performance counters of the stages of the current message. They are added
+ * to the statistics with the shape of the message when it is done, so all
+ * stages of a message have the same key.
+ */
+class perf_recorder : public level_observer {
+public:
+	explicit perf_recorder(const perf_counters &counters)
+		: counters_(counters), start_(), level_start_(), pending_()
+	{
+	}
+
+	void begin()
+	{
+		start_ = counters_.read();
+	}
+
+	void end(const string &stage)
+	{
+		add(stage, counters_.read() - start_);
+	}
+
+	void add(const string &stage, const struct perf_sample &delta)
+	{
+		pending_.emplace_back(stage, delta);
+	}
+
+	void level_begin(uint16_t level) override
+	{
+		level_start_ = counters_.read();
+	}
+
+	void level_end(uint16_t level) override
+	{
+		add("level " + to_string(level),
+		    counters_.read() - level_start_);
+	}
+
+	void commit(perf_stats &stats, uint32_t sources, uint64_t msg_bytes)
+	{
+		for (const auto &p : pending_) {
+			stats.add(p.first, sources, msg_bytes, p.second);
+		}
+		pending_.clear();
+	}
+
+	void discard()
+	{
+		pending_.clear();
+	}
+
+private:
+	const perf_counters &counters_;
+	struct perf_sample start_;
+	struct perf_sample level_start_;
+	vector<pair<string, struct perf_sample> > pending_;
+};
+
+/**
+ * Number of sources (0 if X is not a raw matrix) and size in bytes of the
+ * message in the chunk buffers, chunks can be out of order.
+ */
+void get_message_shape(const vector<struct rte_mbuf *> &chunk_buf,
+		       const vector<struct service_header_cpu> &service_hdr_buf,
+		       uint32_t &sources, uint64_t &msg_bytes)
+{
+	uint8_t buf[RAW_MATRIX_HEADER_LEN];
+	struct raw_matrix_header hdr;
+	uint32_t payload_len;
+	const void *p;
+	size_t i;
+
+	sources = 0;
+	msg_bytes = 0;
+	for (i = 0; i < chunk_buf.size(); ++i) {
+		payload_len = service_hdr_buf[i].chunk_len - SERVICE_HEADER_LEN;
+		msg_bytes += payload_len;
+		if (service_hdr_buf[i].chunk_num != 0 ||
+		    payload_len < RAW_MATRIX_HEADER_LEN) {
+			continue;
+		}
+		p = rte_pktmbuf_read(chunk_buf[i], ALL_HEADERS_LEN,
+				     RAW_MATRIX_HEADER_LEN, buf);
+		if (p != nullptr &&
+		    parse_raw_matrix_header(static_cast<const uint8_t *>(p),
+					    RAW_MATRIX_HEADER_LEN, hdr)) {
+			sources = hdr.rows;
+		}
+	}
+}
+
+/**
+ * Prepare checksums and send a burst of chunks. Unsent chunks are freed.
+ */
+uint16_t send_burst(const struct ffpp_munf_manager &manager,
+		    struct rte_mbuf **tx_buf, uint16_t nb_pkts)
+{
+	uint16_t nb_prep = 0;
+	uint16_t nb_tx = 0;
+	uint16_t i;
+
+	if (nb_pkts == 0) {
+		return 0;
+	}
+	nb_prep = prepare_tx_cksum(tx_cksum_conf, tx_buf, nb_pkts);
+	nb_tx = rte_eth_tx_burst(manager.tx_port_id, 0, tx_buf, nb_prep);
+	for (i = nb_tx; i < nb_pkts; ++i) {
+		rte_pktmbuf_free(tx_buf[i]);
+	}
+	return nb_tx;
+}
+
 /**
  * Main loop for store and forward mode.
  */
@@ -115,42 +348,34 @@ void run_store_forward_loop(const struct ffpp_munf_manager &manager)
 				rte_pktmbuf_free(m);
 				continue;
 			}
-			disable_udp_cksum(m);
 			tx_buf[t] = rx_buf[r];
 			++t;
 		}
 
-		fw_num +=
-			rte_eth_tx_burst(manager.tx_port_id, 0, tx_buf, nb_rx);
+		fw_num += send_burst(manager, tx_buf, t);
 		RTE_LOG(DEBUG, USER1, "[FWD] Totally forwarded %lu packets.\n",
 			fw_num);
 	}
 }
 
 /**
- * De-fragment all chunks of a message and return the message data.
+ * De-fragment all chunks of a message into msg_data.
+ *
+ * msg_data is reused across messages to avoid reallocations.
  */
-string defragment(const vector<struct rte_mbuf *> &chunk_buf,
-		  const vector<struct service_header_cpu> &service_hdr_buf)
+void defragment(const vector<struct rte_mbuf *> &chunk_buf,
+		const vector<struct service_header_cpu> &service_hdr_buf,
+		vector<uint8_t> &msg_data)
 {
-	service_header_cpu service_hdr;
-
-	string msg_data;
-	const uint8_t *payload = nullptr;
 	assert(chunk_buf.size() == service_hdr_buf.size());
 	auto iter_hdr = service_hdr_buf.cbegin();
 	auto iter_chunk = chunk_buf.cbegin();
 
+	msg_data.clear();
 	for (iter_hdr, iter_chunk; iter_hdr < service_hdr_buf.cend();
 	     ++iter_hdr, ++iter_chunk) {
-		payload = rte_pktmbuf_mtod_offset((*iter_chunk), uint8_t *,
-						  SERVICE_HEADER_OFFSET +
-							  SERVICE_HEADER_LEN);
-		msg_data.append((char *)payload,
-				((*iter_hdr).chunk_len - SERVICE_HEADER_LEN));
+		append_chunk_payload(*iter_chunk, *iter_hdr, msg_data);
 	}
-
-	return msg_data;
 }
 
 void reset_bufs(vector<struct rte_mbuf *> &chunk_buf,
@@ -165,6 +390,50 @@ void reset_bufs(vector<struct rte_mbuf *> &chunk_buf,
 	service_hdr_buf.clear();
 }
 
+/**
+ * Accumulate the payload of a data chunk into the statistics and the CRC of X
+ * (if not nullptr). They are only valid if all chunks arrive in order,
+ * otherwise they are computed from the reassembled X.
+ */
+void inline accumulate_chunk(level_stats_accumulator *stats,
+			     crc32c_stream *X_crc, const struct rte_mbuf *m,
+			     const struct service_header_cpu &service_hdr,
+			     size_t expected_chunk_num)
+{
+	uint32_t remain = service_hdr.chunk_len - SERVICE_HEADER_LEN;
+	uint32_t skip = ALL_HEADERS_LEN;
+	uint32_t len;
+	const uint8_t *data;
+
+	if (service_hdr.chunk_num != expected_chunk_num) {
+		if (stats != nullptr) {
+			stats->invalidate();
+		}
+		if (X_crc != nullptr) {
+			X_crc->invalidate();
+		}
+		return;
+	}
+	// The payload of a jumbo chunk can span several segments.
+	for (; m != nullptr && remain > 0; m = m->next) {
+		if (skip >= m->data_len) {
+			skip -= m->data_len;
+			continue;
+		}
+		len = std::min(static_cast<uint32_t>(m->data_len - skip),
+			       remain);
+		data = rte_pktmbuf_mtod_offset(m, const uint8_t *, skip);
+		if (stats != nullptr) {
+			stats->feed(data, len);
+		}
+		if (X_crc != nullptr) {
+			X_crc->feed(data, len);
+		}
+		remain -= len;
+		skip = 0;
+	}
+}
+
 bool inline check_service_hdr_buf(
 	const vector<struct service_header_cpu> &service_hdr_buf)
 {
@@ -185,16 +454,38 @@ bool inline check_service_hdr_buf(
 	return true;
 }
 
+/**
+ * Receive all chunks of a message, data chunks are fast forwarded.
+ *
+ * If stats is not nullptr, the payloads of in-order data chunks are
+ * accumulated into it while they are still in the cache, so the whitening of
+ * all MEICA levels does not need another pass over X. Similarly, the CRC of X
+ * is computed into X_crc if it is not nullptr.
+ *
+ * If held_X_chunk is not nullptr, the copy of the final data chunk is not
+ * sent but returned in it when it has an extension area or hold_final_X is
+ * true, so the uW of this VNF can be piggybacked on it.
+ *
+ * If first_rx_tsc is not nullptr, the TSC of the first received chunk is
+ * stored in it.
+ */
 bool recv_send_chunks(const struct ffpp_munf_manager &manager,
 		      vector<struct rte_mbuf *> &chunk_buf,
-		      vector<struct service_header_cpu> &service_hdr_buf)
+		      vector<struct service_header_cpu> &service_hdr_buf,
+		      level_stats_accumulator *stats = nullptr,
+		      crc32c_stream *X_crc = nullptr,
+		      struct rte_mbuf **held_X_chunk = nullptr,
+		      bool hold_final_X = false,
+		      uint64_t *first_rx_tsc = nullptr)
 {
 	struct rte_mbuf *m;
 	struct rte_mbuf *m_copy;
 	struct rte_mbuf *rx_buf[BURST_SIZE];
+	struct rte_mbuf *tx_buf[BURST_SIZE];
 	struct service_header_cpu service_hdr;
 
 	uint16_t r = 0;
+	uint16_t t = 0;
 	uint16_t nb_rx = 0;
 	bool recv_timeout = false;
 
@@ -209,6 +500,7 @@ bool recv_send_chunks(const struct ffpp_munf_manager &manager,
 			rte_delay_us_sleep(1e3);
 			continue;
 		}
+		t = 0;
 		for (r = 0; r < nb_rx; ++r) {
 			m = rx_buf[r];
 			if (!is_valid_chunk(m)) {
@@ -216,16 +508,38 @@ bool recv_send_chunks(const struct ffpp_munf_manager &manager,
 				continue;
 			}
 			service_hdr = unpack_service_header(m);
+			if (!chunk_lengths_valid(m, service_hdr)) {
+				RTE_LOG(DEBUG, USER1,
+					"Drop a chunk with invalid lengths.\n");
+				rte_pktmbuf_free(m);
+				continue;
+			}
 			// Fast forward all data messages
 			if (service_hdr.msg_type == 0) {
 				m_copy = deepcopy_chunk(fast_forward_pool, m);
-				disable_udp_cksum(m_copy);
-				rte_eth_tx_burst(manager.tx_port_id, 0, &m_copy,
-						 1);
+				if (held_X_chunk != nullptr &&
+				    service_hdr.chunk_num ==
+					    service_hdr.total_chunk_num - 1 &&
+				    (hold_final_X ||
+				     (service_hdr.msg_flags & MSG_FLAG_EXT) != 0)) {
+					*held_X_chunk = m_copy;
+				} else {
+					tx_buf[t] = m_copy;
+					++t;
+				}
+				if (stats != nullptr || X_crc != nullptr) {
+					accumulate_chunk(stats, X_crc, m,
+							 service_hdr,
+							 service_hdr_buf.size());
+				}
+			}
+			if (first_rx_tsc != nullptr && chunk_buf.empty()) {
+				*first_rx_tsc = rte_rdtsc();
 			}
 			chunk_buf.push_back(m);
 			service_hdr_buf.push_back(service_hdr);
 		}
+		send_burst(manager, tx_buf, t);
 		if (service_hdr_buf.back().chunk_num ==
 		    service_hdr_buf.back().total_chunk_num - 1) {
 			break;
@@ -278,61 +592,11 @@ void recover_chunks(vector<struct rte_mbuf *> &chunk_buf,
 	reorder(service_hdr_buf, indices);
 }
 
-/**
- * Update IP and UDP total length fields with the given chunk payload length.
- */
-void update_l3_l4_header(struct rte_mbuf *m, uint32_t payload_len)
-{
-	struct rte_ipv4_hdr *ipv4_hdr;
-	struct rte_udp_hdr *udp_hdr;
-	ipv4_hdr = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
-					   sizeof(struct rte_ether_hdr));
-	udp_hdr = (struct rte_udp_hdr *)((unsigned char *)ipv4_hdr +
-					 sizeof(struct rte_ipv4_hdr));
-
-	uint16_t udp_dgram_len =
-		payload_len + SERVICE_HEADER_LEN + sizeof(struct rte_udp_hdr);
-	uint16_t ip_total_length = udp_dgram_len + sizeof(struct rte_ipv4_hdr);
-	udp_hdr->dgram_len = rte_cpu_to_be_16(udp_dgram_len);
-	ipv4_hdr->total_length = rte_cpu_to_be_16(ip_total_length);
-}
-
-struct rte_mbuf *create_uW_chunk(struct rte_mempool *pool,
-				 const struct rte_mbuf *m_data_full,
-				 const struct service_header_cpu &hdr,
-				 const string &payload)
-{
-	struct rte_mbuf *m_result;
-	assert(m_data_full->data_len == 1458);
-	assert(m_data_full->pkt_len == 1458);
-	// Copy everything from the m_data_full and add new payload.
-	m_result = deepcopy_chunk(fast_forward_pool, m_data_full);
-	rte_pktmbuf_trim(m_result, MAX_CHUNK_SIZE);
-	assert(m_result->data_len == 58);
-	assert(m_result->pkt_len == 58);
-	// Pack the new header
-	pack_service_header(m_result, hdr);
-	// Add payload
-	rte_pktmbuf_append(m_result, payload.size());
-
-	uint8_t *payload_offset = rte_pktmbuf_mtod_offset(
-		m_result, uint8_t *,
-		SERVICE_HEADER_OFFSET + SERVICE_HEADER_LEN);
-	rte_memcpy(payload_offset, payload.c_str(), payload.size());
-
-	if (unlikely(m_result->data_len != MAX_CHUNK_SIZE)) {
-		update_l3_l4_header(m_result, payload.size());
-	}
-
-	return m_result;
-}
-
-void update_uW_chunk_buf(const struct ffpp_munf_manager &manager,
-			 vector<struct rte_mbuf *> &uW_chunk_buf,
-			 const struct rte_mbuf *m_data_full,
+void update_uW_chunk_buf(vector<struct rte_mbuf *> &uW_chunk_buf,
+			 const struct chunk_header_template &hdr_tmpl,
 			 const struct service_header_cpu hdr_template,
 			 bool has_final_result, uint16_t new_iter_num,
-			 string new_uW_bytes)
+			 const uint8_t *new_uW_data, size_t new_uW_len)
 
 {
 	struct service_header_cpu new_hdr = hdr_template;
@@ -346,87 +610,277 @@ void update_uW_chunk_buf(const struct ffpp_munf_manager &manager,
 	new_hdr.iter_num = new_iter_num;
 	new_hdr.data_chunk_num = 0;
 
-	new_hdr.total_chunk_num =
-		std::ceil(double(new_uW_bytes.size()) / MAX_CHUNK_SIZE);
-
-	// Replace previous uW with the new_uW_bytes
+	// Replace previous uW with the new uW.
 	for (auto m : uW_chunk_buf) {
 		rte_pktmbuf_free(m);
 	}
 	uW_chunk_buf.clear();
 
-	string payload;
-	for (auto i = 0; i < new_uW_bytes.size(); i += MAX_CHUNK_SIZE) {
-		payload = new_uW_bytes.substr(i, MAX_CHUNK_SIZE);
-		new_hdr.chunk_len = payload.size() + SERVICE_HEADER_LEN;
-		new_hdr.chunk_num = i;
-		uW_chunk_buf.push_back(create_uW_chunk(
-			manager.pool, m_data_full, new_hdr, payload));
-	}
-}
-
-void process_chunks(const struct ffpp_munf_manager &manager,
-		    const struct rte_mbuf *m_data_full,
-		    struct service_header_cpu hdr_template,
-		    const string &X_bytes,
-		    vector<struct rte_mbuf *> &uW_chunk_buf,
-		    vector<struct service_header_cpu> &uW_service_hdr_buf,
-		    const uint32_t max_rounds)
-{
-	auto meica_vnf_module = py::module::import("meica_vnf");
-	auto run_meica_dist_func = meica_vnf_module.attr("run_meica_dist");
-	bool has_final_result = false;
-	string uW_bytes = "";
-	uint16_t iter_num = 0;
-
-	if (uW_chunk_buf.size() != 0) {
-		uW_bytes = defragment(uW_chunk_buf, uW_service_hdr_buf);
-		assert(uW_bytes.size() != 0);
-		iter_num = uW_service_hdr_buf.back().iter_num;
-	} else {
-		iter_num = 0;
+	if (!create_chunks(fast_forward_pool, hdr_tmpl, new_hdr, new_uW_data,
+			   new_uW_len, hdr_tmpl.chunk_size, uW_chunk_buf)) {
+		rte_exit(EXIT_FAILURE, "Failed to create uW chunks!\n");
+	}
+}
+
+/**
+ * Read the uW piggybacked on the held final X chunk m. Return false if m has
+ * no uW extension.
+ */
+bool read_uW_ext(struct rte_mbuf *m, struct uW_state &uW, vector<uint8_t> &ext)
+{
+	struct uW_ext value;
+
+	if (m == nullptr || !read_chunk_ext(m, unpack_service_header(m), ext) ||
+	    !parse_uW_ext(ext.data(), ext.size(), value)) {
+		return false;
+	}
+	uW.valid = true;
+	uW.has_final_result = (value.msg_flags == 1);
+	uW.iter_num = value.iter_num;
+	uW.bytes.assign(value.data, value.data + value.len);
+	return true;
+}
+
+/**
+ * Send the new uW piggybacked on the held final X chunk when piggyback_uW is
+ * true and it fits into the chunk, otherwise as uW chunks. The old uW
+ * extension of the held chunk is removed in the latter case.
+ */
+void update_uW_output(struct rte_mbuf *held_X_chunk, bool piggyback_uW,
+		      vector<struct rte_mbuf *> &uW_chunk_buf,
+		      vector<struct service_header_cpu> &uW_service_hdr_buf,
+		      const struct chunk_header_template &hdr_tmpl,
+		      const struct service_header_cpu hdr_template,
+		      const struct uW_state &uW, vector<uint8_t> &ext)
+{
+	ext.clear();
+	if (held_X_chunk != nullptr && piggyback_uW &&
+	    uW.bytes.size() + UW_EXT_HEADER_LEN <= UINT16_MAX) {
+		append_uW_ext(ext, uW.has_final_result ? 1 : 0, uW.iter_num,
+			      uW.bytes.data(), uW.bytes.size());
+		if (write_chunk_ext(held_X_chunk, ext, hdr_tmpl.chunk_size)) {
+			reset_bufs(uW_chunk_buf, uW_service_hdr_buf);
+			return;
+		}
+		RTE_LOG(DEBUG, USER1,
+			"uW does not fit into the final X chunk, send uW chunks.\n");
+		ext.clear();
+	}
+	if (held_X_chunk != nullptr) {
+		write_chunk_ext(held_X_chunk, ext, UINT16_MAX);
+	}
+	update_uW_chunk_buf(uW_chunk_buf, hdr_tmpl, hdr_template,
+			    uW.has_final_result, uW.iter_num, uW.bytes.data(),
+			    uW.bytes.size());
+	uW_service_hdr_buf.clear();
+}
+
+/**
+ * Attach the received trace records and the record rec of this VNF to the
+ * chunk that carries the uW: the last uW chunk, or the held final X chunk with
+ * the piggybacked uW. Other TLVs of the chunk are kept. Tracing is best
+ * effort, the records are not sent if they do not fit into the chunk.
+ */
+void attach_trace(struct rte_mbuf *held_X_chunk,
+		  const vector<struct rte_mbuf *> &uW_chunk_buf,
+		  const vector<uint8_t> &trace_ext,
+		  const struct trace_record &rec, uint16_t max_chunk_size,
+		  vector<uint8_t> &ext)
+{
+	struct rte_mbuf *m =
+		uW_chunk_buf.empty() ? held_X_chunk : uW_chunk_buf.back();
+	vector<uint8_t> out;
+
+	if (m == nullptr) {
+		return;
+	}
+	read_chunk_ext(m, unpack_service_header(m), ext);
+	copy_ext_tlvs(ext.data(), ext.size(), ext_tlv_type::TRACE, false, out);
+	out.insert(out.end(), trace_ext.begin(), trace_ext.end());
+	append_trace_ext(out, rec);
+	if (!write_chunk_ext(m, out, max_chunk_size)) {
+		RTE_LOG(DEBUG, USER1,
+			"Trace records do not fit into the uW chunk.\n");
+	}
+}
+
+/**
+ * Run MEICA in Python on X and uW. If perf is not nullptr, the performance
+ * counters of the Python call on the worker lcore are stored in it.
+ */
+void process_chunks_python(py_worker &worker, const vector<uint8_t> &X_bytes,
+			   struct uW_state &uW, const uint32_t max_rounds,
+			   struct perf_sample *perf = nullptr)
+{
+	if (!worker.started()) {
+		worker.start();
+	}
+
+	if (!uW.valid) {
+		uW.bytes.clear();
+		uW.iter_num = 0;
+	}
+
+	// Call the run_meica_dist function defined in ./meica_vnf.py on the
+	// compute lcore. X and uW are passed as memoryviews without copies.
+	worker.run([&](const py::object &run_meica_dist_func) {
+		struct perf_sample begin = {};
+		if (perf != nullptr) {
+			begin = thread_perf_counters().read();
+		}
+		py::buffer bytes_out = run_meica_dist_func(
+			make_memoryview(X_bytes.data(), X_bytes.size()),
+			make_memoryview(uW.bytes.data(), uW.bytes.size()),
+			uW.iter_num, max_rounds);
+		py::buffer_info info = bytes_out.request();
+		const uint8_t *out = static_cast<const uint8_t *>(info.ptr);
+		size_t out_len = info.size * info.itemsize;
+		if (out_len < 2) {
+			throw runtime_error("Invalid result of run_meica_dist.");
+		}
+		uW.valid = true;
+		uW.has_final_result = (out[0] == 1);
+		uW.iter_num = out[1];
+		uW.bytes.assign(out + 2, out + out_len);
+		if (perf != nullptr) {
+			*perf = thread_perf_counters().read() - begin;
+		}
+	});
+}
+
+/**
+ * Run the native solver on X and uW. Return false if the message can not be
+ * processed natively, i.e. X or uW is not in the raw float64 encoding.
+ * If the solver fails, e.g. on a uW that does not match X, the received uW is
+ * kept and forwarded unchanged. Without a received uW, false is returned so
+ * the message is processed in Python.
+ */
+bool process_chunks_native(solver &s, const vector<uint8_t> &X_bytes,
+			   struct uW_state &uW, const uint32_t max_rounds)
+{
+	matrix_view X;
+	struct solver_state state = {};
+
+	if (!view_raw_matrix(X_bytes.data(), X_bytes.size(), X)) {
+		return false;
+	}
+	if (uW.valid) {
+		if (!decode_raw_matrix(uW.bytes.data(), uW.bytes.size(),
+				       state.uW)) {
+			return false;
+		}
+		state.iter_num = uW.iter_num;
 	}
 
-	// Call the run_meica_dist function defined in ./meica_vnf.py
-	string bytes_out = run_meica_dist_func(static_cast<py::bytes>(X_bytes),
-					       static_cast<py::bytes>(uW_bytes),
-					       iter_num, max_rounds)
-				   .cast<string>();
-	if (uint8_t(bytes_out.at(0)) == 1) {
-		has_final_result = true;
+	try {
+		s.run(X, state, max_rounds);
+	} catch (const exception &e) {
+		RTE_LOG(WARNING, USER1, "Native %s solver failed: %s, %s.\n",
+			algorithm_name(s.algorithm()), e.what(),
+			uW.valid ? "forward the received uW" :
+				   "run MEICA in Python");
+		return uW.valid;
+	}
+	// The uW buffer is reused for the encoded result.
+	encode_raw_matrix(state.uW, uW.bytes);
+	uW.valid = true;
+	uW.has_final_result = state.has_final_result;
+	uW.iter_num = state.iter_num;
+	return true;
+}
+
+/**
+ * Key of the result of X and the received uW.
+ */
+struct result_key make_result_key(const crc32c_stream &X_crc,
+				  const struct uW_state &uW, ica_algorithm algo)
+{
+	struct result_key key = {
+		.X_crc = X_crc.value(),
+		.X_len = X_crc.length(),
+		.uW_crc = 0,
+		.iter_num = 0,
+		.algorithm = static_cast<uint8_t>(algo),
+	};
+	if (uW.valid) {
+		key.uW_crc = crc32c(0, uW.bytes.data(), uW.bytes.size());
+		key.iter_num = uW.iter_num;
+	}
+	return key;
+}
+
+/**
+ * Replace uW with the cached result of key. Return false on a cache miss.
+ */
+bool load_cached_result(result_cache &cache, const struct result_key &key,
+			struct uW_state &uW)
+{
+	const struct cached_result *result = cache.lookup(key);
+	if (result == nullptr) {
+		return false;
 	}
-	uint8_t new_iter_num = uint8_t(bytes_out.at(1));
-	string new_uW_bytes = bytes_out.substr(2);
+	uW.valid = true;
+	uW.has_final_result = result->has_final_result;
+	uW.iter_num = result->iter_num;
+	uW.bytes.assign(result->uW.begin(), result->uW.end());
+	return true;
+}
+
+void print_cache_stats(const result_cache &cache)
+{
+	const struct result_cache_stats &stats = cache.stats();
+	cout << "[MEICA] Result cache: hits: " << stats.hits
+	     << ", misses: " << stats.misses
+	     << ", evictions: " << stats.evictions
+	     << ", entries: " << cache.size() << "/" << cache.capacity()
+	     << endl;
+}
 
-	// The m_data_full is a ugly workaround for poor default packet
-	// generation support from DPDK. Should be replaced with a better
-	// mechanism.
-	update_uW_chunk_buf(manager, uW_chunk_buf, m_data_full, hdr_template,
-			    has_final_result, new_iter_num, new_uW_bytes);
-	return;
+void print_admission_stats(const admission_controller &admission)
+{
+	const struct admission_stats &stats = admission.stats();
+	cout << "[MEICA] Admission control: computed: " << stats.admitted
+	     << ", shed: " << stats.shed << " (mempool: " << stats.shed_by_pool
+	     << ")" << endl;
+}
+
+/* Fraction of free mbufs of the pool. */
+double pool_free_fraction(const struct rte_mempool *pool)
+{
+	return static_cast<double>(rte_mempool_avail_count(pool)) / pool->size;
+}
+
+/**
+ * Get the ICA algorithm requested by the data message.
+ */
+ica_algorithm get_algorithm(const struct service_header_cpu &X_hdr)
+{
+	uint8_t id = X_hdr.msg_flags & ICA_ALGORITHM_MASK;
+	if (id >= ICA_ALGORITHM_NUM) {
+		RTE_LOG(WARNING, USER1,
+			"Unknown algorithm %u, fall back to MEICA.\n", id);
+		return ica_algorithm::MEICA;
+	}
+	return static_cast<ica_algorithm>(id);
 }
 
 /**
  * The operation performed before sending all chunks.
  *
- * - Handle checksums.
  * - Could be used to add recoded chunks with RLNC.
  */
 void pre_send_chunks(vector<struct rte_mbuf *> &chunk_buf)
 {
-	for (auto c : chunk_buf) {
-		recalc_ipv4_udp_cksum(c);
-	}
 }
 
 void send_chunks(const struct ffpp_munf_manager &manager,
 		 vector<struct rte_mbuf *> &chunk_buf)
 {
 	pre_send_chunks(chunk_buf);
-	uint64_t tx_num = 0;
-	// TODO (Zuo): Optimize to burst TX.
-	for (auto c : chunk_buf) {
-		tx_num += rte_eth_tx_burst(manager.tx_port_id, 0, &c, 1);
+	for (size_t i = 0; i < chunk_buf.size(); i += BURST_SIZE) {
+		uint16_t nb_tx = std::min(static_cast<size_t>(BURST_SIZE),
+					  chunk_buf.size() - i);
+		send_burst(manager, chunk_buf.data() + i, nb_tx);
 	}
 	RTE_LOG(DEBUG, USER1, "[MEICA] Send %lu chunks.\n", chunk_buf.size());
 }
@@ -435,7 +889,13 @@ void send_chunks(const struct ffpp_munf_manager &manager,
  * Main loop for compute and forward mode.
  */
 void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
-			      bool is_leader, uint32_t max_rounds)
+			      bool is_leader, uint32_t max_rounds,
+			      const string &engine,
+			      const struct native_engine_conf &native_conf,
+			      bool piggyback_uW, size_t result_cache_size,
+			      const struct trace_conf &trace,
+			      const string &perf_csv,
+			      const struct admission_params *admission_conf)
 {
 	struct rte_mbuf *m;
 	struct rte_mbuf *rx_buf[BURST_SIZE];
@@ -450,25 +910,120 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 
 	cout << "[MEICA] Enter compute and forward loop." << endl;
 	cout << "\t- Maximal allowed processing rounds: " << max_rounds << endl;
+	cout << "\t- Compute engine: " << engine << endl;
+	if (native_conf.stochastic_samples > 0) {
+		cout << "\t- Subsampled Newton iterations from "
+		     << native_conf.stochastic_samples << " samples" << endl;
+	}
+	if (native_conf.mixed_precision) {
+		cout << "\t- Mixed precision Newton iterations" << endl;
+	}
+	if (native_conf.speculative_starts > 1) {
+		cout << "\t- Speculative starts of the first MEICA level: "
+		     << native_conf.speculative_starts << endl;
+	}
+	if (piggyback_uW) {
+		cout << "\t- Piggyback uW on the final X chunk" << endl;
+	}
+	if (result_cache_size > 0) {
+		cout << "\t- Result cache entries: " << result_cache_size
+		     << endl;
+	}
+	if (trace.enabled) {
+		cout << "\t- Trace records of node " << trace.node_id << endl;
+	}
+	// Performance counters of the states and MEICA levels, the disabled
+	// recorder costs only a check per state.
+	perf_stats perf;
+	unique_ptr<perf_recorder> recorder;
+	struct perf_sample py_perf = {};
+	uint32_t msg_sources = 0;
+	uint64_t msg_bytes = 0;
+	if (!perf_csv.empty() && thread_perf_counters().is_open()) {
+		recorder.reset(new perf_recorder(thread_perf_counters()));
+		cout << "\t- Performance counters: " << perf_csv << endl;
+	}
+	// Messages with a received uW are passed through under overload, so a
+	// downstream VNF continues from the same iteration.
+	unique_ptr<admission_controller> admission;
+	if (admission_conf != nullptr) {
+		admission.reset(new admission_controller(*admission_conf));
+		cout << "\t- Admission control: maximal utilization: "
+		     << admission_conf->max_utilization
+		     << ", minimal free mempool: "
+		     << admission_conf->min_free_pool << endl;
+	}
 
 	vector<struct rte_mbuf *> X_chunk_buf;
 	vector<struct rte_mbuf *> uW_chunk_buf;
-	string X_bytes = "";
+	// Reassembly buffers, reused for all messages.
+	vector<uint8_t> X_bytes;
+	vector<uint8_t> ext;
+	struct uW_state uW = {};
+	// Copy of the final X chunk which is sent with the uW extension.
+	struct rte_mbuf *held_X_chunk = nullptr;
 	vector<struct service_header_cpu> X_service_hdr_buf;
 	vector<struct service_header_cpu> uW_service_hdr_buf;
+	struct chunk_header_template hdr_tmpl = {};
 
 	struct vnf_info info = {
 		.state = VNF_STATE::FORWARD_X_CHUNKS,
 		.message_count = 0,
 	};
 
-	py::scoped_interpreter guard{};
+	// Solvers are created once and reused for all messages.
+	vector<unique_ptr<solver> > solvers;
+	for (uint8_t id = 0; id < ICA_ALGORITHM_NUM; ++id) {
+		auto algo = static_cast<ica_algorithm>(id);
+		auto params = default_solver_params(algo);
+		params.stochastic_min_samples = native_conf.stochastic_samples;
+		params.mixed_precision = native_conf.mixed_precision;
+		params.speculative_starts = native_conf.speculative_starts;
+		solvers.push_back(make_solver(algo, params));
+		solvers.back()->set_worker_cpus(native_conf.speculative_cpus);
+	}
+	// Statistics of the current X, only used by the native engine.
+	level_stats_accumulator X_stats(
+		default_solver_params(ica_algorithm::MEICA).ext_multi_ica);
+	level_stats_accumulator *X_stats_ptr =
+		(engine == "native") ? &X_stats : nullptr;
+	// The Python engine only supports MEICA. With the native engine, it is
+	// started on demand for messages that are not in the raw encoding.
+	py_worker worker("meica_vnf", "run_meica_dist");
+	if (engine == "python") {
+		worker.start();
+	}
+	// Results of repeated X, e.g. replays and retransmissions.
+	result_cache cache(result_cache_size);
+	crc32c_stream X_crc;
+	crc32c_stream *X_crc_ptr = cache.enabled() ? &X_crc : nullptr;
+	struct result_key key = {};
+	ica_algorithm algo = ica_algorithm::MEICA;
+	bool processed = false;
+	bool cached = false;
+	bool X_ready = false;
+	// Trace records of the upstream VNFs and TSCs of the current message.
+	vector<uint8_t> trace_ext;
+	struct trace_record trace_rec = {};
+	uint64_t rx_first_tsc = 0;
+	uint64_t rx_last_tsc = 0;
+	uint64_t compute_start_tsc = 0;
+	uint64_t compute_end_tsc = 0;
+	VNF_STATE state;
 	while (!g_force_quit) {
+		state = info.state;
+		if (recorder) {
+			recorder->begin();
+		}
 		switch (info.state) {
 		case VNF_STATE::RESET:
 			RTE_LOG(DEBUG, USER1, "State: Reset VNF!\n");
 			reset_bufs(X_chunk_buf, X_service_hdr_buf);
 			reset_bufs(uW_chunk_buf, uW_service_hdr_buf);
+			if (held_X_chunk != nullptr) {
+				rte_pktmbuf_free(held_X_chunk);
+				held_X_chunk = nullptr;
+			}
 			info.state = VNF_STATE::FORWARD_X_CHUNKS;
 			break;
 
@@ -477,9 +1032,35 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 			       X_service_hdr_buf.size() == 0);
 			RTE_LOG(DEBUG, USER1,
 				"State: Receive and send X chunks.\n");
+			X_stats.reset();
+			X_crc.reset();
+			uW.valid = false;
+			trace_ext.clear();
+			compute_start_tsc = 0;
+			compute_end_tsc = 0;
 			if (recv_send_chunks(manager, X_chunk_buf,
-					     X_service_hdr_buf) == true) {
-				if (is_leader == true) {
+					     X_service_hdr_buf, X_stats_ptr,
+					     X_crc_ptr, &held_X_chunk,
+					     piggyback_uW, &rx_first_tsc) == true) {
+				rx_last_tsc = rte_rdtsc();
+				if (admission) {
+					admission->on_arrival(
+						static_cast<double>(rx_last_tsc) /
+						rte_get_tsc_hz());
+				}
+				// A piggybacked uW replaces the uW chunks.
+				if (read_uW_ext(held_X_chunk, uW, ext)) {
+					if (trace.enabled) {
+						copy_ext_tlvs(ext.data(),
+							      ext.size(),
+							      ext_tlv_type::TRACE,
+							      true, trace_ext);
+					}
+					info.state =
+						uW.has_final_result ?
+							VNF_STATE::SEND_UW_CHUNKS :
+							VNF_STATE::PROCESS_CHUNKS;
+				} else if (is_leader == true) {
 					info.state = VNF_STATE::PROCESS_CHUNKS;
 				} else {
 					info.state = VNF_STATE::RECV_UW_CHUNKS;
@@ -496,13 +1077,28 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 			       uW_service_hdr_buf.size() == 0);
 			recv_send_chunks(manager, uW_chunk_buf,
 					 uW_service_hdr_buf);
+			rx_last_tsc = rte_rdtsc();
+			if (trace.enabled &&
+			    read_chunk_ext(uW_chunk_buf.back(),
+					   uW_service_hdr_buf.back(), ext)) {
+				copy_ext_tlvs(ext.data(), ext.size(),
+					      ext_tlv_type::TRACE, true,
+					      trace_ext);
+			}
+			defragment(uW_chunk_buf, uW_service_hdr_buf, uW.bytes);
+			uW.valid = true;
+			// The last uW chunk can have an extension area.
+			uW.has_final_result =
+				((uW_service_hdr_buf.front().msg_flags &
+				  ~MSG_FLAG_EXT) == 1);
+			uW.iter_num = uW_service_hdr_buf.back().iter_num;
 			info.state = VNF_STATE::TRY_FORWARD_UW_CHUNKS;
 			break;
 
 		case VNF_STATE::TRY_FORWARD_UW_CHUNKS:
 			RTE_LOG(DEBUG, USER1,
 				"State: Try to fast forward uW chunks with final result.\n");
-			if (uW_service_hdr_buf.front().msg_flags == 1) {
+			if (uW.has_final_result) {
 				RTE_LOG(DEBUG, USER1,
 					"Current uW message is fast forwarded!\n");
 				info.state = VNF_STATE::SEND_UW_CHUNKS;
@@ -515,6 +1111,16 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 			RTE_LOG(DEBUG, USER1,
 				"State: Process chunks. Data chunk buffer size: %lu, result chunk buffer size: %lu.\n",
 				X_chunk_buf.size(), uW_chunk_buf.size());
+			// The leader has no uW to pass through.
+			if (admission && uW.valid &&
+			    !admission->admit(
+				    pool_free_fraction(fast_forward_pool))) {
+				RTE_LOG(DEBUG, USER1,
+					"Overload: pass the uW of iteration %u through.\n",
+					uW.iter_num);
+				info.state = VNF_STATE::SEND_UW_CHUNKS;
+				break;
+			}
 			if (!check_service_hdr_buf(X_service_hdr_buf)) {
 				RTE_LOG(DEBUG, USER1,
 					"ISSUE: Need chunk recovery!\n");
@@ -524,29 +1130,112 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 				rte_exit(EXIT_FAILURE,
 					 "Failed to recover data chunks!");
 			}
+			if (!header_template_matches(hdr_tmpl,
+						     X_chunk_buf.front())) {
+				capture_header_template(hdr_tmpl,
+							X_chunk_buf.front());
+			}
+			update_flow_chunk_size(hdr_tmpl, X_service_hdr_buf,
+					       g_max_chunk_size);
+
+			compute_start_tsc = rte_rdtsc();
+			algo = get_algorithm(X_service_hdr_buf.front());
+			cached = false;
+			X_ready = false;
+			if (cache.enabled()) {
+				// Out-of-order X is hashed after the reassembly.
+				if (!X_crc.valid()) {
+					defragment(X_chunk_buf, X_service_hdr_buf,
+						   X_bytes);
+					X_ready = true;
+					X_crc.reset();
+					X_crc.feed(X_bytes.data(), X_bytes.size());
+				}
+				key = make_result_key(X_crc, uW, algo);
+				cached = load_cached_result(cache, key, uW);
+				RTE_LOG(DEBUG, USER1, "Result cache %s: %08x.\n",
+					cached ? "hit" : "miss", key.X_crc);
+			}
 			// MARK: ASSUME result chunks are always in order.
-			X_bytes = defragment(X_chunk_buf, X_service_hdr_buf);
-
-			process_chunks(manager, X_chunk_buf.front(),
-				       X_service_hdr_buf.front(), X_bytes,
-				       uW_chunk_buf, uW_service_hdr_buf,
-				       max_rounds);
-
-			// Original X chunks are useless now, cleanup them.
-			// ONLY the uW_chunk_buf needs to be sent.
-			for (auto m : X_chunk_buf) {
-				rte_pktmbuf_free(m);
+			if (!cached && !X_ready) {
+				defragment(X_chunk_buf, X_service_hdr_buf, X_bytes);
+			}
+			processed = cached;
+			if (!processed && engine == "native") {
+				solver &s = *solvers[static_cast<uint8_t>(algo)];
+				s.set_level_stats(X_stats.complete() ? &X_stats :
+								       nullptr);
+				s.set_level_observer(recorder.get());
+				processed = process_chunks_native(s, X_bytes, uW,
+								  max_rounds);
+				s.set_level_stats(nullptr);
+				s.set_level_observer(nullptr);
+			}
+			if (!processed) {
+				if (algo != ica_algorithm::MEICA) {
+					RTE_LOG(WARNING, USER1,
+						"%s is only supported by the native engine with raw matrices, run MEICA.\n",
+						algorithm_name(algo));
+				}
+				process_chunks_python(worker, X_bytes, uW,
+						      max_rounds,
+						      recorder ? &py_perf :
+								 nullptr);
+				if (recorder) {
+					recorder->add("python", py_perf);
+				}
 			}
+			if (!cached && cache.enabled()) {
+				cache.insert(key,
+					     cached_result{ uW.has_final_result,
+							    uW.iter_num,
+							    uW.bytes });
+			}
+			compute_end_tsc = rte_rdtsc();
+			// Cache hits would lower the estimated compute cost.
+			if (admission && !cached) {
+				admission->on_compute(
+					static_cast<double>(compute_end_tsc -
+							    compute_start_tsc) /
+					rte_get_tsc_hz());
+			}
+			update_uW_output(held_X_chunk, piggyback_uW,
+					 uW_chunk_buf, uW_service_hdr_buf,
+					 hdr_tmpl, X_service_hdr_buf.front(), uW,
+					 ext);
 
 			info.state = VNF_STATE::SEND_UW_CHUNKS;
 			break;
 
 		case VNF_STATE::SEND_UW_CHUNKS:
 			RTE_LOG(DEBUG, USER1, "State: Send uW chunks.\n");
+			if (trace.enabled) {
+				trace_rec.node_id = trace.node_id;
+				trace_rec.rx_first =
+					tsc_to_ns(trace_clock, rx_first_tsc);
+				trace_rec.rx_last =
+					tsc_to_ns(trace_clock, rx_last_tsc);
+				trace_rec.compute_start =
+					tsc_to_ns(trace_clock, compute_start_tsc);
+				trace_rec.compute_end =
+					tsc_to_ns(trace_clock, compute_end_tsc);
+				trace_rec.tx = tsc_to_ns(trace_clock, rte_rdtsc());
+				attach_trace(held_X_chunk, uW_chunk_buf, trace_ext,
+					     trace_rec,
+					     hdr_tmpl.chunk_size != 0 ?
+						     hdr_tmpl.chunk_size :
+						     g_max_chunk_size,
+					     ext);
+			}
+			// The final X chunk goes before the uW chunks.
+			if (held_X_chunk != nullptr) {
+				send_burst(manager, &held_X_chunk, 1);
+				held_X_chunk = nullptr;
+			}
 			send_chunks(manager, uW_chunk_buf);
 
-			X_chunk_buf.clear();
-			X_service_hdr_buf.clear();
+			// Original X chunks are useless now, cleanup them.
+			reset_bufs(X_chunk_buf, X_service_hdr_buf);
 			uW_chunk_buf.clear();
 			uW_service_hdr_buf.clear();
 
@@ -557,19 +1246,511 @@ void run_compute_forward_loop(const struct ffpp_munf_manager &manager,
 			cerr << "Unknown state!" << endl;
 			g_force_quit = true;
 		}
+		if (recorder) {
+			recorder->end(vnf_state_name(state));
+			if (state == VNF_STATE::FORWARD_X_CHUNKS) {
+				get_message_shape(X_chunk_buf, X_service_hdr_buf,
+						  msg_sources, msg_bytes);
+			} else if (state == VNF_STATE::SEND_UW_CHUNKS) {
+				recorder->commit(perf, msg_sources, msg_bytes);
+			} else if (state == VNF_STATE::RESET) {
+				recorder->discard();
+			}
+		}
+	}
+	if (cache.enabled()) {
+		print_cache_stats(cache);
+	}
+	if (admission) {
+		print_admission_stats(*admission);
+	}
+	if (recorder) {
+		ofstream out(perf_csv);
+		perf.dump(out);
+		cout << "[MEICA] Performance counters are written to "
+		     << perf_csv << endl;
+	}
+} // Python worker stops here (RAII).
+
+/**
+ * Message that is reassembled while its chunks arrive, chunks must be in
+ * order.
+ */
+struct msg_reassembly {
+	vector<uint8_t> bytes;
+	uint16_t next_chunk;
+	bool broken;
+};
+
+/**
+ * Append the payload of the chunk m to its message. Return true if the
+ * message is complete.
+ */
+bool reassemble_chunk(struct msg_reassembly &msg, const struct rte_mbuf *m,
+		      const struct service_header_cpu &service_hdr)
+{
+	if (service_hdr.chunk_num == 0) {
+		msg.bytes.clear();
+		msg.next_chunk = 0;
+		msg.broken = false;
+	}
+	if (msg.broken || service_hdr.chunk_num != msg.next_chunk) {
+		msg.broken = true;
+		return false;
+	}
+	append_chunk_payload(m, service_hdr, msg.bytes);
+	msg.next_chunk += 1;
+	return service_hdr.chunk_num == service_hdr.total_chunk_num - 1;
+}
+
+/**
+ * Send a reduction or broadcast message with the header template of its
+ * direction.
+ */
+void send_dp_message(const struct ffpp_munf_manager &manager,
+		     const struct chunk_header_template &tmpl,
+		     struct service_header_cpu hdr, uint8_t msg_type,
+		     const dp_message &msg, vector<uint8_t> &bytes,
+		     vector<struct rte_mbuf *> &chunk_buf)
+{
+	encode_dp_message(msg, bytes);
+	hdr.msg_type = msg_type;
+	hdr.msg_flags = 0;
+	hdr.iter_num = msg.iter;
+	hdr.data_chunk_num = 0;
+	chunk_buf.clear();
+	if (!create_chunks(fast_forward_pool, tmpl, hdr, bytes.data(),
+			   bytes.size(), tmpl.chunk_size, chunk_buf)) {
+		rte_exit(EXIT_FAILURE, "Failed to create chunks!\n");
+	}
+	send_chunks(manager, chunk_buf);
+	chunk_buf.clear();
+}
+
+/**
+ * Header template of the broadcasts: the reversed one of the X flow to the
+ * UDP port DP_BROADCAST_UDP_PORT.
+ */
+void make_broadcast_template(const struct chunk_header_template &down_tmpl,
+			     struct chunk_header_template &up_tmpl)
+{
+	struct rte_udp_hdr *udp_hdr;
+
+	reverse_header_template(down_tmpl, up_tmpl);
+	udp_hdr = reinterpret_cast<struct rte_udp_hdr *>(
+		up_tmpl.hdr + sizeof(struct rte_ether_hdr) +
+		sizeof(struct rte_ipv4_hdr));
+	udp_hdr->dst_port = rte_cpu_to_be_16(DP_BROADCAST_UDP_PORT);
+}
+
+/**
+ * Main loop for the data-parallel mode.
+ *
+ * The VNF owns the column range rank of size of X and runs the Newton
+ * iteration of FastICA together with the other VNFs of the chain, see
+ * ./meica_data_parallel.hpp. X chunks are forwarded unchanged while they are
+ * reassembled. Reductions (msg_type 4) go downstream with the header template
+ * of the X flow, broadcasts (msg_type 5) go upstream with the reversed one,
+ * see make_broadcast_template().
+ * The last VNF sends the final uW downstream.
+ */
+void run_data_parallel_loop(const struct ffpp_munf_manager &manager,
+			    uint32_t rank, uint32_t size)
+{
+	struct rte_mbuf *m;
+	struct rte_mbuf *rx_buf[BURST_SIZE];
+	struct rte_mbuf *tx_buf[BURST_SIZE];
+	struct service_header_cpu service_hdr;
+	uint16_t r = 0;
+	uint16_t t = 0;
+	uint16_t nb_rx = 0;
+
+	cout << "[MEICA] Enter data parallel loop." << endl;
+	cout << "\t- Rank " << rank << " of " << size << " VNFs" << endl;
+
+	dp_node node(default_solver_params(ica_algorithm::FASTICA), rank, size);
+	struct msg_reassembly X_msg = {};
+	struct msg_reassembly reduction_msg = {};
+	struct msg_reassembly broadcast_msg = {};
+	vector<struct service_header_cpu> X_service_hdr_buf;
+	struct chunk_header_template down_tmpl = {};
+	struct chunk_header_template up_tmpl = {};
+	vector<struct rte_mbuf *> chunk_buf;
+	vector<uint8_t> bytes;
+	dp_message msg;
+	matrix uW;
+	matrix_view X;
+	bool done;
+
+	// Forwarded chunks must leave before the generated messages.
+	auto flush = [&]() {
+		send_burst(manager, tx_buf, t);
+		t = 0;
+	};
+	// Pass the reduction msg on or finish it on the last VNF. A single VNF
+	// runs all iterations locally.
+	auto pass_reduction = [&]() {
+		const struct service_header_cpu &X_hdr =
+			X_service_hdr_buf.front();
+		flush();
+		if (!node.is_last()) {
+			send_dp_message(manager, down_tmpl, X_hdr,
+					DP_REDUCTION_MSG_TYPE, msg, bytes,
+					chunk_buf);
+			return;
+		}
+		while (true) {
+			const bool finished = node.finish(msg, uW);
+			if (rank > 0) {
+				send_dp_message(manager, up_tmpl, X_hdr,
+						DP_BROADCAST_MSG_TYPE, msg,
+						bytes, chunk_buf);
+			}
+			if (finished) {
+				RTE_LOG(DEBUG, USER1,
+					"[DP] Done after %u iterations.\n",
+					msg.iter);
+				encode_raw_matrix(uW, bytes);
+				update_uW_chunk_buf(chunk_buf, down_tmpl, X_hdr,
+						    true, 1, bytes.data(),
+						    bytes.size());
+				send_chunks(manager, chunk_buf);
+				chunk_buf.clear();
+				return;
+			}
+			if (rank > 0) {
+				return;
+			}
+			node.begin_reduction(msg);
+		}
+	};
+
+	while (!g_force_quit) {
+		nb_rx = rte_eth_rx_burst(manager.rx_port_id, 0, rx_buf,
+					 BURST_SIZE);
+		if (nb_rx == 0) {
+			rte_delay_us_sleep(1e3);
+			continue;
+		}
+		t = 0;
+		for (r = 0; r < nb_rx; ++r) {
+			m = rx_buf[r];
+			if (!is_valid_chunk(m)) {
+				rte_pktmbuf_free(m);
+				continue;
+			}
+			service_hdr = unpack_service_header(m);
+			if (!chunk_lengths_valid(m, service_hdr)) {
+				rte_pktmbuf_free(m);
+				continue;
+			}
+			switch (service_hdr.msg_type) {
+			case 0:
+				if (service_hdr.chunk_num == 0) {
+					node.stop();
+					X_service_hdr_buf.clear();
+					if (!header_template_matches(down_tmpl,
+								     m)) {
+						capture_header_template(
+							down_tmpl, m);
+					}
+				}
+				X_service_hdr_buf.push_back(service_hdr);
+				done = reassemble_chunk(X_msg, m, service_hdr);
+				tx_buf[t++] = m;
+				if (!done) {
+					if (X_msg.broken) {
+						RTE_LOG(DEBUG, USER1,
+							"[DP] Out-of-order X chunk, skip the message.\n");
+					}
+					break;
+				}
+				if (!view_raw_matrix(X_msg.bytes.data(),
+						     X_msg.bytes.size(), X) ||
+				    X.rows == 0 || X.cols == 0) {
+					RTE_LOG(WARNING, USER1,
+						"[DP] X is not a raw float64 matrix, skip the message.\n");
+					break;
+				}
+				update_flow_chunk_size(down_tmpl,
+						       X_service_hdr_buf,
+						       g_max_chunk_size);
+				make_broadcast_template(down_tmpl, up_tmpl);
+				node.start(X);
+				if (node.is_first()) {
+					node.begin_reduction(msg);
+					pass_reduction();
+				}
+				break;
+
+			case DP_REDUCTION_MSG_TYPE:
+				done = reassemble_chunk(reduction_msg, m,
+							service_hdr);
+				rte_pktmbuf_free(m);
+				if (done &&
+				    decode_dp_message(reduction_msg.bytes.data(),
+						      reduction_msg.bytes.size(),
+						      msg) &&
+				    node.add_partial(msg)) {
+					pass_reduction();
+				}
+				break;
+
+			case DP_BROADCAST_MSG_TYPE:
+				done = reassemble_chunk(broadcast_msg, m,
+							service_hdr);
+				// Broadcasts are forwarded unchanged upstream.
+				if (node.is_first()) {
+					rte_pktmbuf_free(m);
+				} else {
+					tx_buf[t++] = m;
+				}
+				if (done &&
+				    decode_dp_message(broadcast_msg.bytes.data(),
+						      broadcast_msg.bytes.size(),
+						      msg) &&
+				    node.apply(msg) && node.is_first() &&
+				    node.phase() != dp_phase::DONE) {
+					node.begin_reduction(msg);
+					pass_reduction();
+				}
+				break;
+
+			default:
+				tx_buf[t++] = m;
+			}
+		}
+		flush();
+	}
+}
+
+/* Maximal number of streams separated at the same time. */
+static constexpr size_t MAX_ONLINE_FLOWS = 16;
+
+/**
+ * Separation state of a stream, i.e. the X frames of one flow.
+ */
+struct online_flow {
+	struct chunk_header_template tmpl;
+	struct msg_reassembly frame;
+	vector<struct service_header_cpu> service_hdr_buf;
+	unique_ptr<online_separator> separator;
+	uint64_t last_used;
+};
+
+/**
+ * Get the stream of the X chunk m, a new stream replaces the least recently
+ * used one if there are too many.
+ */
+struct online_flow &get_online_flow(vector<struct online_flow> &flows,
+				    const struct rte_mbuf *m,
+				    const online_params &params, uint64_t now)
+{
+	auto it = find_if(flows.begin(), flows.end(),
+			  [&](const struct online_flow &f) {
+				  return header_template_matches(f.tmpl, m);
+			  });
+	if (it == flows.end()) {
+		if (flows.size() < MAX_ONLINE_FLOWS) {
+			flows.emplace_back();
+			it = flows.end() - 1;
+		} else {
+			it = min_element(flows.begin(), flows.end(),
+					 [](const struct online_flow &a,
+					    const struct online_flow &b) {
+						 return a.last_used < b.last_used;
+					 });
+			RTE_LOG(DEBUG, USER1,
+				"[ONLINE] Too many streams, replace a stream.\n");
+		}
+		it->tmpl = {};
+		capture_header_template(it->tmpl, m);
+		it->frame = {};
+		it->service_hdr_buf.clear();
+		it->separator.reset(new online_separator(params));
+	}
+	it->last_used = now;
+	return *it;
+}
+
+/**
+ * Main loop for the online mode.
+ *
+ * Each X message of a flow is a frame of a continuous stream, see
+ * ./meica_online.hpp. X chunks are forwarded unchanged while they are
+ * reassembled. After each frame, a fixed number of Newton updates continue
+ * the separation of the stream and its current uW is sent downstream as a
+ * final result of the frame. Other messages, e.g. uW of upstream VNFs, are
+ * forwarded unchanged.
+ */
+void run_online_loop(const struct ffpp_munf_manager &manager,
+		     const online_params &params)
+{
+	struct rte_mbuf *m;
+	struct rte_mbuf *rx_buf[BURST_SIZE];
+	struct rte_mbuf *tx_buf[BURST_SIZE];
+	struct service_header_cpu service_hdr;
+	uint16_t r = 0;
+	uint16_t t = 0;
+	uint16_t nb_rx = 0;
+
+	cout << "[MEICA] Enter online loop." << endl;
+	cout << "\t- Newton updates per frame: " << params.newton_steps
+	     << ", window: " << params.window
+	     << " samples, whitening memory: " << params.memory << " samples"
+	     << endl;
+
+	vector<struct online_flow> flows;
+	vector<struct rte_mbuf *> chunk_buf;
+	vector<uint8_t> bytes;
+	matrix_view X;
+	uint64_t frame_num = 0;
+	uint64_t compute_start_tsc;
+
+	flows.reserve(MAX_ONLINE_FLOWS);
+	while (!g_force_quit) {
+		nb_rx = rte_eth_rx_burst(manager.rx_port_id, 0, rx_buf,
+					 BURST_SIZE);
+		if (nb_rx == 0) {
+			rte_delay_us_sleep(1e3);
+			continue;
+		}
+		t = 0;
+		for (r = 0; r < nb_rx; ++r) {
+			m = rx_buf[r];
+			if (!is_valid_chunk(m)) {
+				rte_pktmbuf_free(m);
+				continue;
+			}
+			service_hdr = unpack_service_header(m);
+			if (!chunk_lengths_valid(m, service_hdr)) {
+				rte_pktmbuf_free(m);
+				continue;
+			}
+			if (service_hdr.msg_type != 0) {
+				tx_buf[t++] = m;
+				continue;
+			}
+			struct online_flow &flow =
+				get_online_flow(flows, m, params, frame_num);
+			if (service_hdr.chunk_num == 0) {
+				flow.service_hdr_buf.clear();
+			}
+			flow.service_hdr_buf.push_back(service_hdr);
+			const bool done =
+				reassemble_chunk(flow.frame, m, service_hdr);
+			tx_buf[t++] = m;
+			if (!done) {
+				continue;
+			}
+			if (!view_raw_matrix(flow.frame.bytes.data(),
+					     flow.frame.bytes.size(), X) ||
+			    X.rows == 0 || X.cols == 0) {
+				RTE_LOG(WARNING, USER1,
+					"[ONLINE] X is not a raw float64 matrix, skip the frame.\n");
+				continue;
+			}
+			update_flow_chunk_size(flow.tmpl, flow.service_hdr_buf,
+					       g_max_chunk_size);
+			compute_start_tsc = rte_rdtsc();
+			encode_raw_matrix(flow.separator->update(X), bytes);
+			RTE_LOG(DEBUG, USER1,
+				"[ONLINE] Frame %lu of the stream: %lu samples, convergence %g, %.3f ms.\n",
+				flow.separator->frame_count(), X.cols,
+				flow.separator->convergence(),
+				1e3 * (rte_rdtsc() - compute_start_tsc) /
+					rte_get_tsc_hz());
+			frame_num += 1;
+			// The frame goes before its uW.
+			send_burst(manager, tx_buf, t);
+			t = 0;
+			update_uW_chunk_buf(chunk_buf, flow.tmpl,
+					    flow.service_hdr_buf.front(), true,
+					    params.newton_steps, bytes.data(),
+					    bytes.size());
+			send_chunks(manager, chunk_buf);
+			chunk_buf.clear();
+		}
+		send_burst(manager, tx_buf, t);
+	}
+	cout << "[MEICA] Separated frames: " << frame_num << endl;
+}
+
+/**
+ * The number at the end of the host name, e.g. 2 for vnf2. Fall back to 0 if
+ * there is none or it is not a valid node ID.
+ */
+uint16_t host_node_id(const string &host_name)
+{
+	size_t pos = host_name.find_last_not_of("0123456789");
+	unsigned long id;
+
+	pos = (pos == string::npos) ? 0 : pos + 1;
+	if (pos == host_name.size()) {
+		cerr << "Warning: No number at the end of the host name "
+		     << host_name << ", the node ID is 0." << endl;
+		return 0;
+	}
+	try {
+		id = stoul(host_name.substr(pos));
+	} catch (const out_of_range &) {
+		id = TRACE_SINK_NODE_ID;
+	}
+	if (id >= TRACE_SINK_NODE_ID) {
+		cerr << "Warning: The number at the end of the host name "
+		     << host_name << " is not a valid node ID, the node ID is 0."
+		     << endl;
+		return 0;
 	}
-} // Python interpretor stops here (RAII).
+	return static_cast<uint16_t>(id);
+}
 } // namespace meica
 
 int main(int argc, char *argv[])
 {
 	bool is_leader = false;
+	bool piggyback_uW = false;
+	size_t result_cache_size = 0;
+	string perf_csv;
+	bool use_admission_control = false;
+	struct meica::admission_params admission_conf = {
+		.max_utilization = 0.9,
+		.min_free_pool = 0.25,
+		.ewma_weight = 0.2,
+	};
+	meica::online_params online_conf = meica::default_online_params();
+	uint32_t dp_rank = 0;
+	uint32_t dp_size = 1;
 	string mode = "store_forward";
+	string engine = "native";
 	uint32_t max_rounds = 4;
+	struct meica::native_engine_conf native_conf = {
+		.stochastic_samples = 0,
+		.mixed_precision = false,
+		.speculative_starts = 1,
+		.speculative_cpus = {},
+	};
 	string core = "1";
 	uint32_t mem = 512;
 	string host_name = boost::asio::ip::host_name();
+	string file_prefix;
 	string iface = host_name + "-s" + host_name.back();
+	// Node ID of the trace records, by default the number at the end of the
+	// host name, e.g. 2 for vnf2.
+	struct meica::trace_conf trace_conf = {
+		.enabled = false,
+		.node_id = 0,
+	};
+	struct meica::port_backend_conf backend_conf = {
+		.backend = "af_packet",
+		.iface = "",
+		.pcap_rx = "",
+		.pcap_tx = "",
+		.memif_rx = "",
+		.memif_tx = "",
+		.tx_iface = "",
+		.max_chunk_size = meica::DEFAULT_CHUNK_SIZE,
+	};
 	meica::g_force_quit = false;
 
 	try {
@@ -581,9 +1762,34 @@ int main(int argc, char *argv[])
                         ("verbose,v", "Enable verbose mode.")
                         ("leader,l", "Run as the leader node.")
                         ("iface,i", po::value<string>(), "The name of the IO interface.")
-                        ("mode,m", po::value<string>(), "Set VNF mode. The default is store_forward.")
+                        ("backend,b", po::value<string>(), "Set the port backend: af_packet, af_xdp, pcap or ring. The default is af_packet.")
+                        ("pcap_rx", po::value<string>(), "The pcap file to read packets from (pcap backend).")
+                        ("pcap_tx", po::value<string>(), "The pcap file to write packets to (pcap backend).")
+                        ("memif_rx", po::value<string>(), "Receive chunks from the memif socket of the upstream VNF on the same host instead of the IO interface.")
+                        ("memif_tx", po::value<string>(), "Send chunks to the downstream VNF on the same host via a memif port listening on this socket.")
+                        ("tx_iface", po::value<string>(), "Send chunks on this interface instead of the IO interface.")
+                        ("file_prefix", po::value<string>(), "The EAL file prefix, it must differ for the VNFs on the same host. The default is the host name.")
+                        ("mode,m", po::value<string>(), "Set VNF mode: store_forward, compute_forward, data_parallel or online. The default is store_forward.")
+                        ("dp_rank", po::value<uint32_t>(), "The position of this VNF in the chain (from 0) in the data_parallel mode.")
+                        ("dp_size", po::value<uint32_t>(), "The number of VNFs of the chain in the data_parallel mode. The default is 1.")
+                        ("online_steps", po::value<uint32_t>(), "The number of Newton updates per frame in the online mode. The default is 3.")
+                        ("online_window", po::value<size_t>(), "The number of the latest samples of a stream the Newton updates run on in the online mode. The default is 8000.")
+                        ("online_memory", po::value<size_t>(), "The time constant (samples) of the whitening statistics of a stream in the online mode. The default is 32000.")
                         ("max_rounds", po::value<uint32_t>(), "Set the maximal allowed computing iterations.")
-                        ("core,c", po::value<string>(), "The CPU cores (split by comma) to use. For example, 0,1 will use first two CPU cores.")
+                        ("engine,e", po::value<string>(), "Set the compute engine: native or python. The default is native.")
+                        ("stochastic_newton", po::value<size_t>(), "Run the early Newton iterations of the native engine on subsets of at least this number of samples. The default 0 always uses all samples.")
+                        ("mixed_precision", "Run the Newton kernels of the native engine on float32 samples, reductions, decorrelation and whitening stay in float64.")
+                        ("speculative_starts", po::value<uint32_t>(), "Run this number of differently seeded starts of the first MEICA level in parallel, the first one reaching the tolerance wins. The default 1 disables it.")
+                        ("speculative_cores", po::value<string>(), "The CPU cores (split by comma) to pin the speculative starts to, they should not be in the core list.")
+                        ("piggyback_uW", "Send uW in an extension of the final X chunk instead of uW chunks when it fits. Followers always accept both.")
+                        ("result_cache", po::value<size_t>(), "Cache the uW results of this number of distinct X and uW inputs (LRU), repeated inputs are not computed again. The default 0 disables the cache.")
+                        ("trace", "Append the receive, compute and send timestamps of this VNF to the uW of each message (compute_forward mode).")
+                        ("node_id", po::value<uint16_t>(), "The node ID of the trace records (with --trace). The default is the number at the end of the host name.")
+                        ("admission_control", po::value<double>(), "Pass messages through without compute when the VNF would compute more than this fraction of the time (e.g. 0.9) or the mempool runs low. Disabled by default.")
+                        ("min_free_pool", po::value<double>(), "The minimal fraction of free chunk mbufs with admission control. The default is 0.25.")
+                        ("perf_csv", po::value<string>(), "Sample the hardware performance counters around each state and MEICA level (compute_forward mode) and write them per message shape to this CSV file when the VNF stops.")
+                        ("core,c", po::value<string>(), "The CPU cores (split by comma) to use. For example, 0,1 will use first two CPU cores. The second core runs the Python compute worker.")
+                        ("max_chunk_size", po::value<uint32_t>(), "The maximal chunk payload size (bytes), up to 8956 for a 9000B jumbo frame MTU. The chunk size of a flow is the sender's one up to it. The default is 1400.")
                         ("mem", po::value<uint32_t>(), "Set the amount of memory to preallocate at startup.");
 		po::variables_map vm;
 		po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -603,15 +1809,108 @@ int main(int argc, char *argv[])
                 if (vm.count("iface")) {
                         iface = vm["iface"].as<string>();
                 }
+                if (vm.count("backend")) {
+                        backend_conf.backend = vm["backend"].as<string>();
+                }
+                if (vm.count("pcap_rx")) {
+                        backend_conf.pcap_rx = vm["pcap_rx"].as<string>();
+                }
+                if (vm.count("pcap_tx")) {
+                        backend_conf.pcap_tx = vm["pcap_tx"].as<string>();
+                }
+                if (vm.count("memif_rx")) {
+                        backend_conf.memif_rx = vm["memif_rx"].as<string>();
+                }
+                if (vm.count("memif_tx")) {
+                        backend_conf.memif_tx = vm["memif_tx"].as<string>();
+                }
+                if (vm.count("tx_iface")) {
+                        backend_conf.tx_iface = vm["tx_iface"].as<string>();
+                }
+                if (vm.count("file_prefix")) {
+                        file_prefix = vm["file_prefix"].as<string>();
+                }
                 if (vm.count("mode")) {
                         mode = vm["mode"].as<string>();
                 }
+                if (vm.count("dp_rank")) {
+                        dp_rank = vm["dp_rank"].as<uint32_t>();
+                }
+                if (vm.count("dp_size")) {
+                        dp_size = vm["dp_size"].as<uint32_t>();
+                }
+                if (vm.count("online_steps")) {
+                        online_conf.newton_steps = vm["online_steps"].as<uint32_t>();
+                }
+                if (vm.count("online_window")) {
+                        online_conf.window = vm["online_window"].as<size_t>();
+                }
+                if (vm.count("online_memory")) {
+                        online_conf.memory = vm["online_memory"].as<size_t>();
+                }
+                if (vm.count("engine")) {
+                        engine = vm["engine"].as<string>();
+                }
                 if (vm.count("max_rounds")) {
                         max_rounds = vm["max_rounds"].as<uint32_t>();
                 }
+                if (vm.count("stochastic_newton")) {
+                        native_conf.stochastic_samples = vm["stochastic_newton"].as<size_t>();
+                }
+                if (vm.count("mixed_precision")) {
+                        native_conf.mixed_precision = true;
+                }
+                if (vm.count("piggyback_uW")) {
+                        piggyback_uW = true;
+                }
+                if (vm.count("result_cache")) {
+                        result_cache_size = vm["result_cache"].as<size_t>();
+                }
+                // The node ID is only used by the trace records.
+                if (vm.count("trace")) {
+                        trace_conf.enabled = true;
+                        if (vm.count("node_id")) {
+                                trace_conf.node_id = vm["node_id"].as<uint16_t>();
+                        } else {
+                                trace_conf.node_id = meica::host_node_id(host_name);
+                        }
+                        if (trace_conf.node_id == meica::TRACE_SINK_NODE_ID) {
+                                cerr << "Error: The node ID " << trace_conf.node_id
+                                     << " is reserved for the sink." << endl;
+                                return 1;
+                        }
+                }
+                if (vm.count("admission_control")) {
+                        admission_conf.max_utilization = vm["admission_control"].as<double>();
+                        use_admission_control = true;
+                }
+                if (vm.count("min_free_pool")) {
+                        admission_conf.min_free_pool = vm["min_free_pool"].as<double>();
+                }
+                if (vm.count("perf_csv")) {
+                        perf_csv = vm["perf_csv"].as<string>();
+                }
+                if (vm.count("speculative_starts")) {
+                        native_conf.speculative_starts = max(vm["speculative_starts"].as<uint32_t>(), 1U);
+                }
+                if (vm.count("speculative_cores")) {
+                        istringstream iss(vm["speculative_cores"].as<string>());
+                        string cpu;
+                        while (getline(iss, cpu, ',')) {
+                                native_conf.speculative_cpus.push_back(stoul(cpu));
+                        }
+                }
                 if (vm.count("core")) {
                         core = vm["core"].as<string>();
                 }
+                if (vm.count("max_chunk_size")) {
+                        uint32_t chunk_size = vm["max_chunk_size"].as<uint32_t>();
+                        if (chunk_size == 0 || chunk_size > meica::MAX_JUMBO_CHUNK_SIZE) {
+                                cerr << "Error: Invalid maximal chunk size: " << chunk_size << endl;
+                                return 1;
+                        }
+                        meica::g_max_chunk_size = static_cast<uint16_t>(chunk_size);
+                }
                 if (vm.count("mem")) {
                         mem = vm["mem"].as<uint32_t>();
                 }
@@ -620,13 +1919,52 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	if (mode == "store_forward" || mode == "compute_forward") {
+	if (mode == "store_forward" || mode == "compute_forward" ||
+	    mode == "data_parallel" || mode == "online") {
 		cout << "[MEICA] Current working mode: " << mode << endl;
 	} else {
 		cerr << "Error: Unknown mode: " << mode << endl;
 		return 0;
 	}
-                cout << "- Iterface name: " << iface << endl;
+	if (mode == "data_parallel" && (dp_size == 0 || dp_rank >= dp_size)) {
+		cerr << "Error: Invalid rank " << dp_rank << " of " << dp_size
+		     << " VNFs." << endl;
+		return 0;
+	}
+	// The reductions are broadcast back upstream on the receive port.
+	if (mode == "data_parallel" &&
+	    (!backend_conf.memif_rx.empty() || !backend_conf.memif_tx.empty() ||
+	     !backend_conf.tx_iface.empty())) {
+		cerr << "Error: The data_parallel mode sends on the receive port, "
+		     << "memif and TX interfaces are not supported." << endl;
+		return 0;
+	}
+	if (mode == "online" &&
+	    (online_conf.newton_steps == 0 || online_conf.window == 0 ||
+	     online_conf.memory == 0)) {
+		cerr << "Error: Invalid online mode options." << endl;
+		return 0;
+	}
+	if (use_admission_control &&
+	    !(admission_conf.max_utilization > 0.0)) {
+		cerr << "Error: Invalid maximal utilization: "
+		     << admission_conf.max_utilization << endl;
+		return 0;
+	}
+	if (engine != "native" && engine != "python") {
+		cerr << "Error: Unknown engine: " << engine << endl;
+		return 0;
+	}
+	if (!meica::is_valid_backend(backend_conf.backend)) {
+		cerr << "Error: Unknown backend: " << backend_conf.backend << endl;
+		return 0;
+	}
+	backend_conf.iface = iface;
+	backend_conf.max_chunk_size = meica::g_max_chunk_size;
+	if (file_prefix.empty()) {
+		file_prefix = host_name;
+	}
+                cout << "- Iterface name: " << iface << "; Backend: " << backend_conf.backend << endl;
         cout << "- Core list: " << core << "; Preallocated memory: " << mem <<endl;
         cout << "- Host name: " << host_name << endl;
 	if (is_leader == true) {
@@ -634,22 +1972,28 @@ int main(int argc, char *argv[])
 	}
 
         // Init DPDK EAL.
-        string file_prefix_conf = "--file-prefix=" + host_name;
-        string vdev_conf = "net_af_packet0,iface=" + iface;
-        const char *rte_argv[] = {
+        string file_prefix_conf = "--file-prefix=" + file_prefix;
+        const vector<string> vdev_confs = meica::get_vdev_confs(backend_conf);
+        string mem_conf = to_string(mem);
+        vector<const char *> rte_argv = {
                 "-l", core.c_str(),
-                "-m", to_string(mem).c_str(), "--no-huge", "--no-pci", file_prefix_conf.c_str(),
-                "--vdev", vdev_conf.c_str(),
-                nullptr};
-        int rte_argc = static_cast<int>(sizeof(rte_argv) / sizeof(rte_argv[0])) - 1;
+                "-m", mem_conf.c_str(), "--no-huge", "--no-pci", file_prefix_conf.c_str()};
+        for (const string &vdev_conf : vdev_confs) {
+                cout << "- EAL vdev: " << vdev_conf << endl;
+                rte_argv.push_back("--vdev");
+                rte_argv.push_back(vdev_conf.c_str());
+        }
+        rte_argv.push_back(nullptr);
+        int rte_argc = static_cast<int>(rte_argv.size()) - 1;
 	int ret;
-        ret = rte_eal_init(rte_argc, const_cast<char **>(rte_argv));
+        ret = rte_eal_init(rte_argc, const_cast<char **>(rte_argv.data()));
 	if (ret < 0) {
 		rte_exit(EXIT_FAILURE, "Invalid EAL arguments.\n");
 	}
 
 	signal(SIGINT, meica::signal_handler);
 	signal(SIGTERM, meica::signal_handler);
+	meica::init_trace_clock(meica::trace_clock);
 
         if (meica::g_verbose== true) {
                 rte_log_set_level(RTE_LOGTYPE_USER1, RTE_LOG_DEBUG);
@@ -662,24 +2006,59 @@ int main(int argc, char *argv[])
 
         // WARN: Temporary work around... The number of X chunks to buffer is
         // currently too large for typical DPDK applications...
+        // Chunks up to the maximal chunk size fit into a single mbuf.
         meica::fast_forward_pool = rte_pktmbuf_pool_create("fast_forward_pool", 4096,
-                        256, 0, RTE_MBUF_DEFAULT_BUF_SIZE,
+                        256, 0, std::max(static_cast<uint16_t>(RTE_MBUF_DEFAULT_BUF_SIZE),
+                                meica::chunk_data_room_size(meica::g_max_chunk_size)),
                 rte_socket_id());
         if (meica::fast_forward_pool== NULL)
                 rte_exit(EXIT_FAILURE, "Cannot init the fast forward pool!\n");
+        // The default RX pool of the munf manager only fits standard frames.
+        if (meica::chunk_data_room_size(meica::g_max_chunk_size) > RTE_MBUF_DEFAULT_BUF_SIZE) {
+                pool = rte_pktmbuf_pool_create("rx_pool", meica::NUM_RX_MBUFS, 256, 0,
+                                meica::chunk_data_room_size(meica::g_max_chunk_size),
+                                rte_socket_id());
+                if (pool == NULL)
+                        rte_exit(EXIT_FAILURE, "Cannot init the RX pool!\n");
+        }
 
 	ffpp_munf_init_manager(&munf_manager, "test_manager", pool);
 	if (ret < 0) {
 		rte_exit(EXIT_FAILURE, "Cannot get the MAC address.\n");
 	}
+	// Chunks are sent on the second port of get_vdev_confs() if there is one.
+	if (vdev_confs.size() > 1 && munf_manager.tx_port_id == munf_manager.rx_port_id) {
+		if (!meica::setup_tx_port(1, meica::fast_forward_pool)) {
+			rte_exit(EXIT_FAILURE, "Cannot init the TX port.\n");
+		}
+		munf_manager.tx_port_id = 1;
+	}
+	meica::tx_cksum_conf = meica::get_tx_cksum_conf(munf_manager.tx_port_id);
+	cout << "- TX checksum offload: IPv4: " << meica::tx_cksum_conf.hw_ipv4_cksum
+	     << ", UDP: " << meica::tx_cksum_conf.hw_udp_cksum << endl;
 
 	if (mode == "store_forward") {
 		meica::run_store_forward_loop(munf_manager);
 	} else if (mode == "compute_forward") {
-		meica::run_compute_forward_loop(munf_manager, is_leader, max_rounds);
+		meica::run_compute_forward_loop(munf_manager, is_leader, max_rounds,
+						engine, native_conf, piggyback_uW,
+						result_cache_size, trace_conf,
+						perf_csv,
+						use_admission_control ?
+							&admission_conf :
+							nullptr);
+	} else if (mode == "data_parallel") {
+		meica::run_data_parallel_loop(munf_manager, dp_rank, dp_size);
+	} else if (mode == "online") {
+		meica::run_online_loop(munf_manager, online_conf);
 	}
 
 	cout << "Main loop ends, run cleanups..." << endl;
+	if (munf_manager.tx_port_id != munf_manager.rx_port_id) {
+		rte_eth_dev_stop(munf_manager.tx_port_id);
+		rte_eth_dev_close(munf_manager.tx_port_id);
+		munf_manager.tx_port_id = munf_manager.rx_port_id;
+	}
 	ffpp_munf_cleanup_manager(&munf_manager);
 	rte_eal_cleanup();
 
@@ -4,9 +4,12 @@
 """
 About: Python script for distributed MEICA processing.
        This script is loaded and called by the fast path implemented in ./meica_vnf.cpp
+
+       The module is imported only once by the persistent compute worker of the
+       VNF. X and uW are passed as memoryviews over the reassembly buffers of the
+       VNF, they are only valid during the call.
 """
 
-import pickle
 import struct
 import sys
 import typing
@@ -15,27 +18,29 @@ sys.path.insert(0, "../")
 
 from pyfastbss_core import pyfbss
 
+import matrix_codec
+
 # This is used as the default payload size for each chunk.
 MEICA_IP_TOTAL_LEN: typing.Final = 1400  # bytes
 EXTRACTION_BASE: typing.Final = 2
 
 
 def run_meica_dist(
-    X_bytes: bytes,
-    uW_bytes: bytes,
+    X_bytes: memoryview,
+    uW_bytes: memoryview,
     iter_num: int,
     max_rounds: int,
 ) -> bytes:
     """Run distributed MEICA on bytes_in and return the calculated result.
 
-    :param x_bytes: X matrix in bytes.
-    :param uW_bytes: uW in bytes.
+    :param x_bytes: X matrix in bytes (pickle or raw encoding).
+    :param uW_bytes: uW in bytes (pickle or raw encoding).
     :param iter_num: Current iteration number.
     :param max_rounds: Maximal allowed iteration rounds to run meica_dist.
 
-    :return bytes_out: Return has_final_result + new_iter_num + uW_next
+    :return bytes_out: Return has_final_result + new_iter_num + uW_next (raw encoding)
     """
-    X = pickle.loads(X_bytes)
+    X = matrix_codec.decode(X_bytes)
     uXs = pyfbss.meica_generate_uxs(X, ext_multi_ica=EXTRACTION_BASE)
 
     # Get the initial uW to iterate.
@@ -46,7 +51,7 @@ def run_meica_dist(
     else:
         assert len(uW_bytes) != 0
         # uW_prev should be contained in the result chunks.
-        uW_prev = pickle.loads(uW_bytes)
+        uW_prev = matrix_codec.decode(uW_bytes)
         iter_start_index = iter_num
 
     # Set to True if break_by_tol or all iterations have finished.
@@ -78,8 +83,7 @@ def run_meica_dist(
         new_iter_num = index + 1
         result_data = uW_next
 
-    # WARN: Use bytearray if there is performance issues.
-    bytes_out = struct.pack("!BB", int(has_final_result), new_iter_num) + pickle.dumps(
-        result_data
-    )
+    bytes_out = struct.pack(
+        "!BB", int(has_final_result), new_iter_num
+    ) + matrix_codec.encode_raw(result_data)
     return bytes_out
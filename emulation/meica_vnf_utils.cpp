@@ -2,27 +2,24 @@
  * meica_vnf_utils.cpp
  */
 
+#include <limits.h>
+#include <linux/if_packet.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 
+#include <rte_ethdev.h>
+
 #include "meica_vnf_utils.hpp"
 
 using namespace std;
 
 namespace meica
 {
-struct _service_header {
-	uint8_t msg_type;
-	uint8_t msg_flags;
-	rte_be16_t total_msg_num;
-	rte_be16_t msg_num;
-	rte_be16_t total_chunk_num;
-	rte_be16_t chunk_num;
-	rte_be16_t chunk_len;
-	rte_be16_t data_chunk_num;
-	rte_be16_t iter_num;
-};
-
 void print_service_header(const struct service_header_cpu &hdr)
 {
 	cout << "--- MEICA Service header:" << endl;
@@ -39,68 +36,175 @@ void print_service_header(const struct service_header_cpu &hdr)
 
 struct service_header_cpu unpack_service_header(struct rte_mbuf *m)
 {
-	struct service_header_cpu hdr_cpu;
-	hdr_cpu.msg_flags = 0;
-
-	struct _service_header *hdr_ptr;
-
-	hdr_ptr = rte_pktmbuf_mtod_offset(m, struct _service_header *,
-					  SERVICE_HEADER_OFFSET);
-
-	hdr_cpu.msg_type = hdr_ptr->msg_type;
-	hdr_cpu.msg_flags = hdr_ptr->msg_flags;
-	hdr_cpu.total_msg_num = rte_be_to_cpu_16(hdr_ptr->total_msg_num);
-	hdr_cpu.msg_num = rte_be_to_cpu_16(hdr_ptr->msg_num);
-	hdr_cpu.total_chunk_num = rte_be_to_cpu_16(hdr_ptr->total_chunk_num);
-	hdr_cpu.chunk_num = rte_be_to_cpu_16(hdr_ptr->chunk_num);
-	hdr_cpu.chunk_len = rte_be_to_cpu_16(hdr_ptr->chunk_len);
-	hdr_cpu.data_chunk_num = rte_be_to_cpu_16(hdr_ptr->data_chunk_num);
-	hdr_cpu.iter_num = rte_be_to_cpu_16(hdr_ptr->iter_num);
-
-	return hdr_cpu;
+	return parse_service_header(rte_pktmbuf_mtod_offset(
+		m, const uint8_t *, SERVICE_HEADER_OFFSET));
 }
 
 void pack_service_header(struct rte_mbuf *m,
 			 const struct service_header_cpu &hdr)
 {
-	struct _service_header *hdr_ptr;
-	hdr_ptr = rte_pktmbuf_mtod_offset(m, struct _service_header *,
-					  SERVICE_HEADER_OFFSET);
-	hdr_ptr->msg_type = hdr.msg_type;
-	hdr_ptr->msg_flags = hdr.msg_flags;
-	hdr_ptr->total_msg_num = rte_cpu_to_be_16(hdr.total_msg_num);
-	hdr_ptr->msg_num = rte_cpu_to_be_16(hdr.msg_num);
-	hdr_ptr->total_chunk_num = rte_cpu_to_be_16(hdr.total_chunk_num);
-	hdr_ptr->chunk_num = rte_cpu_to_be_16(hdr.chunk_num);
-	hdr_ptr->chunk_len = rte_cpu_to_be_16(hdr.chunk_len);
-	hdr_ptr->data_chunk_num = rte_cpu_to_be_16(hdr.data_chunk_num);
-	hdr_ptr->iter_num = rte_cpu_to_be_16(hdr.iter_num);
+	write_service_header(
+		rte_pktmbuf_mtod_offset(m, uint8_t *, SERVICE_HEADER_OFFSET),
+		hdr);
+}
+
+/**
+ * Append len bytes of src to the mbuf chain head. Segments are added from pool
+ * when the last segment is full. Return false if a segment can not be
+ * allocated.
+ */
+static bool append_to_chain(struct rte_mempool *pool, struct rte_mbuf *head,
+			    const uint8_t *src, uint32_t len)
+{
+	struct rte_mbuf *seg = rte_pktmbuf_lastseg(head);
+	struct rte_mbuf *next;
+	uint16_t n;
+
+	while (len > 0) {
+		if (rte_pktmbuf_tailroom(seg) == 0) {
+			next = rte_pktmbuf_alloc(pool);
+			if (next == nullptr) {
+				return false;
+			}
+			seg->next = next;
+			head->nb_segs += 1;
+			seg = next;
+		}
+		n = static_cast<uint16_t>(
+			std::min(len, static_cast<uint32_t>(
+					      rte_pktmbuf_tailroom(seg))));
+		rte_memcpy(rte_pktmbuf_mtod_offset(seg, uint8_t *,
+						   seg->data_len),
+			   src, n);
+		seg->data_len += n;
+		head->pkt_len += n;
+		src += n;
+		len -= n;
+	}
+	return true;
 }
 
 struct rte_mbuf *deepcopy_chunk(struct rte_mempool *pool,
 				const struct rte_mbuf *m)
 {
-	assert(m != nullptr && pool != nullptr);
-	if (m->nb_segs > 1) {
-		rte_exit(EXIT_FAILURE,
-			 "Deep copy doest not support scattered segments.\n");
-	}
+	const struct rte_mbuf *seg;
 	struct rte_mbuf *m_copy;
+
+	assert(m != nullptr && pool != nullptr);
 	m_copy = rte_pktmbuf_alloc(pool);
 	if (m_copy == nullptr) {
 		rte_exit(EXIT_FAILURE, "Failed to allocate the m_copy!\n");
 	}
-	m_copy->data_len = m->data_len;
-	m_copy->pkt_len = m->pkt_len;
-	if (rte_pktmbuf_headroom(m) != RTE_PKTMBUF_HEADROOM) {
-		rte_exit(EXIT_FAILURE, "mbuf's header room is not default.\n");
+	for (seg = m; seg != nullptr; seg = seg->next) {
+		if (!append_to_chain(pool, m_copy,
+				     rte_pktmbuf_mtod(seg, const uint8_t *),
+				     seg->data_len)) {
+			rte_exit(EXIT_FAILURE,
+				 "Failed to allocate the m_copy!\n");
+		}
 	}
-	rte_memcpy(rte_pktmbuf_mtod(m_copy, uint8_t *),
-		   rte_pktmbuf_mtod(m, uint8_t *), m->data_len);
 	return m_copy;
 }
 
-void disable_udp_cksum(struct rte_mbuf *m)
+bool chunk_lengths_valid(const struct rte_mbuf *m,
+			 const struct service_header_cpu &hdr)
+{
+	const struct rte_ipv4_hdr *ipv4_hdr;
+	const struct rte_udp_hdr *udp_hdr;
+	uint32_t ip_len;
+	uint32_t dgram_len;
+
+	if (m->data_len < ALL_HEADERS_LEN) {
+		return false;
+	}
+	ipv4_hdr = rte_pktmbuf_mtod_offset(m, const struct rte_ipv4_hdr *,
+					   sizeof(struct rte_ether_hdr));
+	udp_hdr = (const struct rte_udp_hdr *)((const unsigned char *)ipv4_hdr +
+					       sizeof(struct rte_ipv4_hdr));
+	ip_len = rte_be_to_cpu_16(ipv4_hdr->total_length);
+	dgram_len = rte_be_to_cpu_16(udp_hdr->dgram_len);
+
+	return hdr.chunk_len >= SERVICE_HEADER_LEN &&
+	       sizeof(struct rte_udp_hdr) + hdr.chunk_len <= dgram_len &&
+	       sizeof(struct rte_ipv4_hdr) + dgram_len <= ip_len &&
+	       sizeof(struct rte_ether_hdr) + ip_len <= m->pkt_len;
+}
+
+void append_chunk_payload(const struct rte_mbuf *m,
+			  const struct service_header_cpu &hdr,
+			  vector<uint8_t> &out)
+{
+	const size_t old_len = out.size();
+	const uint32_t len = hdr.chunk_len - SERVICE_HEADER_LEN;
+	const void *payload;
+
+	out.resize(old_len + len);
+	// Only payloads that span several segments are copied into out.
+	payload = rte_pktmbuf_read(m, ALL_HEADERS_LEN, len,
+				   out.data() + old_len);
+	assert(payload != nullptr);
+	if (payload != out.data() + old_len) {
+		rte_memcpy(out.data() + old_len, payload, len);
+	}
+}
+
+bool read_chunk_ext(const struct rte_mbuf *m,
+		    const struct service_header_cpu &hdr,
+		    vector<uint8_t> &ext)
+{
+	const struct rte_udp_hdr *udp_hdr = rte_pktmbuf_mtod_offset(
+		m, const struct rte_udp_hdr *,
+		sizeof(struct rte_ether_hdr) + sizeof(struct rte_ipv4_hdr));
+	const uint32_t dgram_len = rte_be_to_cpu_16(udp_hdr->dgram_len);
+	const uint32_t chunk_end = sizeof(struct rte_udp_hdr) + hdr.chunk_len;
+	const void *p;
+
+	ext.clear();
+	if ((hdr.msg_flags & MSG_FLAG_EXT) == 0 || dgram_len <= chunk_end) {
+		return false;
+	}
+	ext.resize(dgram_len - chunk_end);
+	p = rte_pktmbuf_read(m, SERVICE_HEADER_OFFSET + hdr.chunk_len,
+			     ext.size(), ext.data());
+	if (p == nullptr) {
+		ext.clear();
+		return false;
+	}
+	if (p != ext.data()) {
+		rte_memcpy(ext.data(), p, ext.size());
+	}
+	return true;
+}
+
+bool write_chunk_ext(struct rte_mbuf *m, const vector<uint8_t> &ext,
+		     uint16_t max_chunk_size)
+{
+	struct service_header_cpu hdr = unpack_service_header(m);
+	const uint32_t payload_len = hdr.chunk_len - SERVICE_HEADER_LEN;
+	const uint32_t keep = ALL_HEADERS_LEN + payload_len;
+	struct rte_mbuf *last = rte_pktmbuf_lastseg(m);
+	uint8_t *p;
+
+	if (payload_len + ext.size() > max_chunk_size ||
+	    m->pkt_len - keep > last->data_len ||
+	    ext.size() > rte_pktmbuf_tailroom(last) + (m->pkt_len - keep)) {
+		return false;
+	}
+	// Remove the old extension area and the Ethernet padding.
+	rte_pktmbuf_trim(m, m->pkt_len - keep);
+	if (!ext.empty()) {
+		p = (uint8_t *)rte_pktmbuf_append(m, ext.size());
+		rte_memcpy(p, ext.data(), ext.size());
+		hdr.msg_flags |= MSG_FLAG_EXT;
+	} else {
+		hdr.msg_flags &= ~MSG_FLAG_EXT;
+	}
+	pack_service_header(m, hdr);
+	update_l3_l4_header(m, payload_len + ext.size());
+	return true;
+}
+
+void update_l3_l4_header(struct rte_mbuf *m, uint32_t payload_len)
 {
 	struct rte_ipv4_hdr *ipv4_hdr;
 	struct rte_udp_hdr *udp_hdr;
@@ -108,20 +212,483 @@ void disable_udp_cksum(struct rte_mbuf *m)
 					   sizeof(struct rte_ether_hdr));
 	udp_hdr = (struct rte_udp_hdr *)((unsigned char *)ipv4_hdr +
 					 sizeof(struct rte_ipv4_hdr));
-	udp_hdr->dgram_cksum = 0;
+
+	uint16_t udp_dgram_len =
+		payload_len + SERVICE_HEADER_LEN + sizeof(struct rte_udp_hdr);
+	uint16_t ip_total_length = udp_dgram_len + sizeof(struct rte_ipv4_hdr);
+	udp_hdr->dgram_len = rte_cpu_to_be_16(udp_dgram_len);
+	ipv4_hdr->total_length = rte_cpu_to_be_16(ip_total_length);
+	// Drop the RX flags of a received chunk, the checksums are updated by
+	// prepare_tx_cksum().
+	m->ol_flags = TX_CKSUM_FLAGS;
+}
+
+void capture_header_template(struct chunk_header_template &tmpl,
+			     const struct rte_mbuf *m)
+{
+	assert(m->data_len >= ALL_HEADERS_LEN);
+	rte_memcpy(tmpl.hdr, rte_pktmbuf_mtod(m, const uint8_t *),
+		   ALL_HEADERS_LEN);
+	tmpl.valid = true;
+	tmpl.chunk_size = DEFAULT_CHUNK_SIZE;
+}
+
+void update_flow_chunk_size(
+	struct chunk_header_template &tmpl,
+	const vector<struct service_header_cpu> &service_hdr_buf,
+	uint16_t max_chunk_size)
+{
+	const struct service_header_cpu &hdr = service_hdr_buf.front();
+
+	if (hdr.total_chunk_num > 1 && hdr.chunk_len > SERVICE_HEADER_LEN) {
+		tmpl.chunk_size = hdr.chunk_len - SERVICE_HEADER_LEN;
+	}
+	tmpl.chunk_size = std::min(tmpl.chunk_size, max_chunk_size);
 }
 
-void recalc_ipv4_udp_cksum(struct rte_mbuf *m)
+void reverse_header_template(const struct chunk_header_template &tmpl,
+			     struct chunk_header_template &reversed)
 {
+	struct rte_ether_hdr *eth_hdr;
 	struct rte_ipv4_hdr *ipv4_hdr;
 	struct rte_udp_hdr *udp_hdr;
-	ipv4_hdr = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *,
-					   sizeof(struct rte_ether_hdr));
-	udp_hdr = (struct rte_udp_hdr *)((unsigned char *)ipv4_hdr +
-					 sizeof(struct rte_ipv4_hdr));
-	udp_hdr->dgram_cksum = 0;
-	ipv4_hdr->hdr_checksum = 0;
-	ipv4_hdr->hdr_checksum = rte_ipv4_cksum(ipv4_hdr);
+	struct rte_ether_addr mac;
+	rte_be32_t addr;
+	rte_be16_t port;
+
+	assert(tmpl.valid);
+	reversed = tmpl;
+	eth_hdr = reinterpret_cast<struct rte_ether_hdr *>(reversed.hdr);
+	ipv4_hdr = reinterpret_cast<struct rte_ipv4_hdr *>(eth_hdr + 1);
+	udp_hdr = reinterpret_cast<struct rte_udp_hdr *>(ipv4_hdr + 1);
+	// The headers are packed, fields are swapped by value.
+	mac = eth_hdr->d_addr;
+	eth_hdr->d_addr = eth_hdr->s_addr;
+	eth_hdr->s_addr = mac;
+	addr = ipv4_hdr->src_addr;
+	ipv4_hdr->src_addr = ipv4_hdr->dst_addr;
+	ipv4_hdr->dst_addr = addr;
+	port = udp_hdr->src_port;
+	udp_hdr->src_port = udp_hdr->dst_port;
+	udp_hdr->dst_port = port;
+}
+
+bool header_template_matches(const struct chunk_header_template &tmpl,
+			     const struct rte_mbuf *m)
+{
+	// Source and destination IPv4 addresses and UDP ports are contiguous.
+	constexpr uint32_t flow_offset = sizeof(struct rte_ether_hdr) +
+					 offsetof(struct rte_ipv4_hdr, src_addr);
+	constexpr uint32_t flow_len = 2 * sizeof(rte_be32_t) +
+				      2 * sizeof(rte_be16_t);
+	if (!tmpl.valid) {
+		return false;
+	}
+	return memcmp(tmpl.hdr + flow_offset,
+		      rte_pktmbuf_mtod_offset(m, const uint8_t *, flow_offset),
+		      flow_len) == 0;
+}
+
+bool create_chunks(struct rte_mempool *pool,
+		   const struct chunk_header_template &tmpl,
+		   struct service_header_cpu hdr, const uint8_t *data,
+		   size_t data_len, uint16_t chunk_size,
+		   vector<struct rte_mbuf *> &chunk_buf)
+{
+	assert(tmpl.valid);
+	if (chunk_size == 0) {
+		return false;
+	}
+	// total_chunk_num and chunk_num are 16 bits in the service header.
+	const size_t chunk_num = (data_len + chunk_size - 1) / chunk_size;
+	if (chunk_num > UINT16_MAX) {
+		return false;
+	}
+	uint16_t total_chunk_num = chunk_num;
+	size_t first = chunk_buf.size();
+	chunk_buf.resize(first + total_chunk_num);
+	if (rte_pktmbuf_alloc_bulk(pool, chunk_buf.data() + first,
+				   total_chunk_num) != 0) {
+		chunk_buf.resize(first);
+		return false;
+	}
+
+	hdr.total_chunk_num = total_chunk_num;
+	struct rte_mbuf *m;
+	uint8_t *pkt;
+	size_t offset = 0;
+	uint16_t payload_len;
+	for (uint16_t i = 0; i < total_chunk_num; ++i) {
+		m = chunk_buf[first + i];
+		payload_len = std::min(static_cast<size_t>(chunk_size),
+				       data_len - offset);
+		pkt = (uint8_t *)rte_pktmbuf_append(m, ALL_HEADERS_LEN);
+		rte_memcpy(pkt, tmpl.hdr, ALL_HEADERS_LEN);
+		if (!append_to_chain(pool, m, data + offset, payload_len)) {
+			for (size_t j = first; j < chunk_buf.size(); ++j) {
+				rte_pktmbuf_free(chunk_buf[j]);
+			}
+			chunk_buf.resize(first);
+			return false;
+		}
+		update_l3_l4_header(m, payload_len);
+
+		hdr.chunk_num = i;
+		hdr.chunk_len = payload_len + SERVICE_HEADER_LEN;
+		pack_service_header(m, hdr);
+		offset += payload_len;
+	}
+
+	return true;
+}
+
+struct tx_cksum_conf get_tx_cksum_conf(uint16_t port_id)
+{
+	struct rte_eth_dev_info dev_info;
+	struct rte_eth_txq_info qinfo;
+	struct tx_cksum_conf conf = {
+		.port_id = port_id,
+		.hw_ipv4_cksum = false,
+		.hw_udp_cksum = false,
+	};
+	uint64_t offloads;
+
+	// The offloads must be enabled on the TX queue, not only supported.
+	if (rte_eth_dev_info_get(port_id, &dev_info) != 0 ||
+	    rte_eth_tx_queue_info_get(port_id, 0, &qinfo) != 0) {
+		return conf;
+	}
+	offloads = dev_info.tx_offload_capa & qinfo.conf.offloads;
+	conf.hw_ipv4_cksum = (offloads & DEV_TX_OFFLOAD_IPV4_CKSUM) != 0;
+	conf.hw_udp_cksum = (offloads & DEV_TX_OFFLOAD_UDP_CKSUM) != 0;
+	return conf;
+}
+
+/**
+ * Accumulate 16-bit one's complement sum of a buffer.
+ *
+ * 32-bit words are summed into independent 64-bit accumulators, so the loop
+ * can be vectorized by the compiler and carries only need to be folded once at
+ * the end.
+ */
+static inline uint64_t cksum_accumulate(const uint8_t *buf, size_t len,
+					uint64_t sum)
+{
+	uint64_t acc[4] = { sum, 0, 0, 0 };
+	uint32_t w[4];
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		memcpy(w, buf + i, 16);
+		acc[0] += w[0];
+		acc[1] += w[1];
+		acc[2] += w[2];
+		acc[3] += w[3];
+	}
+	for (; i + 4 <= len; i += 4) {
+		memcpy(w, buf + i, 4);
+		acc[0] += w[0];
+	}
+	if (i + 2 <= len) {
+		uint16_t h;
+		memcpy(&h, buf + i, 2);
+		acc[1] += h;
+		i += 2;
+	}
+	if (i < len) {
+		// The odd byte is padded with zero in network byte order.
+		uint8_t tail[2] = { buf[i], 0 };
+		uint16_t h;
+		memcpy(&h, tail, 2);
+		acc[2] += h;
+	}
+
+	return acc[0] + acc[1] + acc[2] + acc[3];
+}
+
+static inline uint16_t cksum_fold(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return static_cast<uint16_t>(sum);
+}
+
+/**
+ * Pseudo header: addresses, protocol and UDP length. The sum is accumulated in
+ * network byte order like the rest of the datagram.
+ */
+static inline uint64_t pseudo_header_sum(const struct rte_ipv4_hdr *ipv4_hdr,
+					 const struct rte_udp_hdr *udp_hdr)
+{
+	uint64_t sum = 0;
+	sum += ipv4_hdr->src_addr;
+	sum += ipv4_hdr->dst_addr;
+	sum += rte_cpu_to_be_16(static_cast<uint16_t>(IPPROTO_UDP));
+	sum += udp_hdr->dgram_len;
+	return sum;
+}
+
+static inline uint16_t udp_cksum_finish(uint64_t sum)
+{
+	uint16_t cksum = static_cast<uint16_t>(~cksum_fold(sum));
+	// RFC 768: A calculated checksum of zero is transmitted as all ones.
+	if (cksum == 0) {
+		cksum = 0xffff;
+	}
+	return cksum;
+}
+
+uint16_t sw_ipv4_udp_cksum(const struct rte_ipv4_hdr *ipv4_hdr,
+			   const struct rte_udp_hdr *udp_hdr)
+{
+	uint16_t dgram_len = rte_be_to_cpu_16(udp_hdr->dgram_len);
+	uint64_t sum = pseudo_header_sum(ipv4_hdr, udp_hdr);
+	sum = cksum_accumulate(reinterpret_cast<const uint8_t *>(udp_hdr),
+			       dgram_len, sum);
+	return udp_cksum_finish(sum);
+}
+
+uint16_t sw_ipv4_udp_cksum(const struct rte_mbuf *m)
+{
+	constexpr uint32_t udp_offset =
+		sizeof(struct rte_ether_hdr) + sizeof(struct rte_ipv4_hdr);
+	const struct rte_ipv4_hdr *ipv4_hdr = rte_pktmbuf_mtod_offset(
+		m, const struct rte_ipv4_hdr *, sizeof(struct rte_ether_hdr));
+	const struct rte_udp_hdr *udp_hdr = rte_pktmbuf_mtod_offset(
+		m, const struct rte_udp_hdr *, udp_offset);
+	const struct rte_mbuf *seg;
+	uint32_t remain = rte_be_to_cpu_16(udp_hdr->dgram_len);
+	uint32_t skip = udp_offset;
+	uint32_t len;
+	size_t pos = 0;
+	uint64_t sum;
+	uint16_t part;
+
+	if (m->nb_segs == 1) {
+		return sw_ipv4_udp_cksum(ipv4_hdr, udp_hdr);
+	}
+	sum = pseudo_header_sum(ipv4_hdr, udp_hdr);
+	for (seg = m; seg != nullptr && remain > 0; seg = seg->next) {
+		if (skip >= seg->data_len) {
+			skip -= seg->data_len;
+			continue;
+		}
+		len = std::min(static_cast<uint32_t>(seg->data_len - skip),
+			       remain);
+		part = cksum_fold(cksum_accumulate(
+			rte_pktmbuf_mtod_offset(seg, const uint8_t *, skip),
+			len, 0));
+		// A segment starting at an odd offset of the datagram is summed
+		// with swapped bytes (RFC 1071).
+		if (pos & 1) {
+			part = static_cast<uint16_t>((part << 8) | (part >> 8));
+		}
+		sum += part;
+		pos += len;
+		remain -= len;
+		skip = 0;
+	}
+	return udp_cksum_finish(sum);
+}
+
+uint16_t prepare_tx_cksum(const struct tx_cksum_conf &conf,
+			  struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+{
+	struct rte_ipv4_hdr *ipv4_hdr;
+	struct rte_udp_hdr *udp_hdr;
+	struct rte_mbuf *m;
+	uint16_t i;
+
+	for (i = 0; i < nb_pkts; ++i) {
+		m = tx_pkts[i];
+		// Forwarded chunks keep their valid checksums.
+		if ((m->ol_flags & TX_CKSUM_FLAGS) != TX_CKSUM_FLAGS) {
+			continue;
+		}
+		ipv4_hdr = rte_pktmbuf_mtod_offset(
+			m, struct rte_ipv4_hdr *, sizeof(struct rte_ether_hdr));
+		udp_hdr = (struct rte_udp_hdr *)((unsigned char *)ipv4_hdr +
+						 sizeof(struct rte_ipv4_hdr));
+		ipv4_hdr->hdr_checksum = 0;
+		udp_hdr->dgram_cksum = 0;
+		m->l2_len = sizeof(struct rte_ether_hdr);
+		m->l3_len = sizeof(struct rte_ipv4_hdr);
+		m->ol_flags &= ~TX_CKSUM_FLAGS;
+
+		if (conf.hw_ipv4_cksum) {
+			m->ol_flags |= PKT_TX_IPV4 | PKT_TX_IP_CKSUM;
+		} else {
+			ipv4_hdr->hdr_checksum = rte_ipv4_cksum(ipv4_hdr);
+		}
+
+		if (conf.hw_udp_cksum) {
+			m->ol_flags |= PKT_TX_IPV4 | PKT_TX_UDP_CKSUM;
+			udp_hdr->dgram_cksum =
+				rte_ipv4_phdr_cksum(ipv4_hdr, m->ol_flags);
+		} else {
+			udp_hdr->dgram_cksum = sw_ipv4_udp_cksum(m);
+		}
+	}
+
+	if (conf.hw_ipv4_cksum || conf.hw_udp_cksum) {
+		return rte_eth_tx_prepare(conf.port_id, 0, tx_pkts, nb_pkts);
+	}
+	return nb_pkts;
+}
+
+static const vector<string> VALID_BACKENDS = { "af_packet", "af_xdp", "pcap",
+					       "ring" };
+
+// Kernel drivers with native AF_XDP zero-copy support (Linux v5.4).
+static const vector<string> XDP_ZERO_COPY_DRIVERS = { "i40e", "ixgbe", "ice",
+						      "mlx5_core" };
+
+bool is_valid_backend(const string &backend)
+{
+	return std::find(VALID_BACKENDS.begin(), VALID_BACKENDS.end(),
+			 backend) != VALID_BACKENDS.end();
+}
+
+bool xdp_zero_copy_supported(const string &iface)
+{
+	// Virtual interfaces like veth have no device symlink.
+	string driver_link = "/sys/class/net/" + iface + "/device/driver";
+	char buf[PATH_MAX];
+	ssize_t len = readlink(driver_link.c_str(), buf, sizeof(buf) - 1);
+	if (len < 0) {
+		return false;
+	}
+	buf[len] = '\0';
+	string driver = string(buf);
+	driver = driver.substr(driver.find_last_of('/') + 1);
+
+	return std::find(XDP_ZERO_COPY_DRIVERS.begin(),
+			 XDP_ZERO_COPY_DRIVERS.end(),
+			 driver) != XDP_ZERO_COPY_DRIVERS.end();
+}
+
+/**
+ * vdev of the backend on iface, the device name ends with index.
+ */
+// Default frame size of the af_packet PMD.
+static constexpr uint32_t AF_PACKET_FRAME_SIZE = 2048;
+
+/**
+ * Frame size of the af_packet ring (TPACKET_V2) that holds a chunk with a
+ * payload of chunk_size bytes, 0 if the default one is large enough.
+ */
+static uint32_t af_packet_frame_size(uint16_t chunk_size)
+{
+	const uint32_t page_size = static_cast<uint32_t>(getpagesize());
+	const uint32_t len =
+		TPACKET_ALIGN(TPACKET2_HDRLEN) + ALL_HEADERS_LEN + chunk_size;
+
+	if (len <= AF_PACKET_FRAME_SIZE) {
+		return 0;
+	}
+	// A frame may not span blocks and blocks are page aligned.
+	return (len + page_size - 1) / page_size * page_size;
+}
+
+static string get_backend_vdev(const struct port_backend_conf &conf,
+			       const string &iface, int index)
+{
+	const string id = to_string(index);
+
+	if (conf.backend == "af_packet") {
+		string vdev_conf = "net_af_packet" + id + ",iface=" + iface;
+		const uint32_t frame_size =
+			af_packet_frame_size(conf.max_chunk_size);
+		if (frame_size > 0) {
+			vdev_conf += ",blocksz=" + to_string(frame_size) +
+				     ",framesz=" + to_string(frame_size);
+		}
+		return vdev_conf;
+	} else if (conf.backend == "af_xdp") {
+		string vdev_conf = "net_af_xdp" + id + ",iface=" + iface +
+				   ",start_queue=0,queue_count=1";
+		if (xdp_zero_copy_supported(iface)) {
+			vdev_conf += ",pmd_zero_copy=1";
+		}
+		return vdev_conf;
+	} else if (conf.backend == "pcap") {
+		if (!conf.pcap_rx.empty() && !conf.pcap_tx.empty()) {
+			return "net_pcap" + id + ",rx_pcap=" + conf.pcap_rx +
+			       ",tx_pcap=" + conf.pcap_tx;
+		}
+		return "net_pcap" + id + ",iface=" + iface;
+	} else if (conf.backend == "ring") {
+		return "net_ring" + id;
+	}
+
+	return "";
+}
+
+string get_vdev_conf(const struct port_backend_conf &conf)
+{
+	return get_backend_vdev(conf, conf.iface, 0);
+}
+
+vector<string> get_vdev_confs(const struct port_backend_conf &conf)
+{
+	vector<string> vdevs;
+
+	// The upstream VNF is the memif master of the socket.
+	if (!conf.memif_rx.empty()) {
+		vdevs.push_back("net_memif0,role=slave,id=0,socket=" +
+				conf.memif_rx);
+	} else {
+		vdevs.push_back(get_vdev_conf(conf));
+	}
+	if (!conf.memif_tx.empty()) {
+		vdevs.push_back("net_memif1,role=master,id=0,socket=" +
+				conf.memif_tx);
+	} else if (!conf.tx_iface.empty() && conf.tx_iface != conf.iface) {
+		vdevs.push_back(get_backend_vdev(conf, conf.tx_iface, 1));
+	} else if (!conf.memif_rx.empty()) {
+		// Send to the network on iface.
+		vdevs.push_back(get_backend_vdev(conf, conf.iface, 1));
+	}
+	for (const string &v : vdevs) {
+		if (v.empty()) {
+			return vector<string>();
+		}
+	}
+	return vdevs;
+}
+
+bool setup_tx_port(uint16_t port_id, struct rte_mempool *pool)
+{
+	struct rte_eth_conf port_conf;
+	struct rte_eth_dev_info dev_info;
+	uint16_t nb_rxd = 128;
+	uint16_t nb_txd = 512;
+	const int socket_id = rte_eth_dev_socket_id(port_id);
+
+	memset(&port_conf, 0, sizeof(port_conf));
+	port_conf.rxmode.mq_mode = ETH_MQ_RX_NONE;
+	// Checksum offloads used by prepare_tx_cksum() if supported.
+	if (rte_eth_dev_info_get(port_id, &dev_info) == 0) {
+		port_conf.txmode.offloads =
+			dev_info.tx_offload_capa &
+			(DEV_TX_OFFLOAD_IPV4_CKSUM | DEV_TX_OFFLOAD_UDP_CKSUM);
+	}
+	if (rte_eth_dev_configure(port_id, 1, 1, &port_conf) != 0 ||
+	    rte_eth_dev_adjust_nb_rx_tx_desc(port_id, &nb_rxd, &nb_txd) != 0) {
+		return false;
+	}
+	if (rte_eth_rx_queue_setup(port_id, 0, nb_rxd,
+				   static_cast<unsigned int>(socket_id),
+				   nullptr, pool) != 0 ||
+	    rte_eth_tx_queue_setup(port_id, 0, nb_txd,
+				   static_cast<unsigned int>(socket_id),
+				   nullptr) != 0) {
+		return false;
+	}
+	return rte_eth_dev_start(port_id) == 0;
 }
 
 } // namespace meica
@@ -13,33 +13,37 @@
 #include <rte_mempool.h>
 #include <rte_udp.h>
 
+#include <string>
 #include <vector>
 
+#include "service_header.hpp"
+
 namespace meica
 {
-/**
- * MEICA service header (little-endian): Check the header definition in ./meica_host.py.
- */
-struct service_header_cpu {
-	uint8_t msg_type;
-	uint8_t msg_flags;
-	rte_le16_t total_msg_num;
-	rte_le16_t msg_num;
-	rte_le16_t total_chunk_num;
-	rte_le16_t chunk_num;
-	rte_le16_t chunk_len;
-	rte_le16_t data_chunk_num;
-	rte_le16_t iter_num;
-};
-
 constexpr uint32_t SERVICE_HEADER_OFFSET = sizeof(struct rte_ether_hdr) +
 					   sizeof(struct rte_ipv4_hdr) +
 					   sizeof(struct rte_udp_hdr);
 
-constexpr uint32_t SERVICE_HEADER_LEN = sizeof(struct service_header_cpu);
-
 constexpr uint32_t ALL_HEADERS_LEN = SERVICE_HEADER_OFFSET + SERVICE_HEADER_LEN;
 
+// Chunk payload size (bytes) that fits the 1500B MTU. The maximal one is
+// MAX_JUMBO_CHUNK_SIZE of ./service_header.hpp.
+constexpr uint16_t DEFAULT_CHUNK_SIZE = 1400;
+static_assert(MAX_JUMBO_CHUNK_SIZE == 9000 - sizeof(struct rte_ipv4_hdr) -
+						     sizeof(struct rte_udp_hdr) -
+						     SERVICE_HEADER_LEN,
+	      "Invalid jumbo chunk size");
+
+/**
+ * Data room of a mbuf pool so that chunks with payloads up to chunk_size fit
+ * into a single segment.
+ */
+inline uint16_t chunk_data_room_size(uint16_t chunk_size)
+{
+	return static_cast<uint16_t>(RTE_PKTMBUF_HEADROOM + ALL_HEADERS_LEN +
+				     chunk_size);
+}
+
 void print_service_header(const struct service_header_cpu &hdr);
 
 // Pack and unpack the MEICA service header from DPDK's mbuf.
@@ -50,14 +54,213 @@ void pack_service_header(struct rte_mbuf *m,
 
 // Functions for rte_mbuf processing.
 
+/**
+ * Copy the chunk m into new mbufs from pool. Segmented chunks are linearized
+ * when they fit into a single mbuf of the pool, otherwise the copy is also
+ * segmented.
+ */
 struct rte_mbuf *deepcopy_chunk(struct rte_mempool *pool,
 				const struct rte_mbuf *m);
 
-void disable_udp_cksum(struct rte_mbuf *m);
-void recalc_ipv4_udp_cksum(struct rte_mbuf *m);
+/**
+ * Check the length fields of the chunk m with the service header hdr: the
+ * chunk length must cover the service header and fit into the UDP datagram,
+ * which must fit into the IPv4 packet and the mbuf chain.
+ */
+bool chunk_lengths_valid(const struct rte_mbuf *m,
+			 const struct service_header_cpu &hdr);
+
+/**
+ * Append the payload of the chunk m to out, m can be segmented.
+ */
+void append_chunk_payload(const struct rte_mbuf *m,
+			  const struct service_header_cpu &hdr,
+			  std::vector<uint8_t> &out);
+
+/**
+ * Copy the extension area (see MSG_FLAG_EXT) of the chunk m into ext. Return
+ * false if the chunk has no extension area.
+ */
+bool read_chunk_ext(const struct rte_mbuf *m,
+		    const struct service_header_cpu &hdr,
+		    std::vector<uint8_t> &ext);
+
+/**
+ * Replace the extension area of the chunk m with ext, an empty ext removes it.
+ * MSG_FLAG_EXT and the IP and UDP lengths are updated. Return false if the
+ * chunk with ext would be larger than max_chunk_size or does not fit into the
+ * mbuf, m is then not modified.
+ */
+bool write_chunk_ext(struct rte_mbuf *m, const std::vector<uint8_t> &ext,
+		     uint16_t max_chunk_size);
+
+/**
+ * Update IP and UDP total length fields with the given chunk payload length.
+ * The chunk is marked with TX_CKSUM_FLAGS, see prepare_tx_cksum().
+ */
+void update_l3_l4_header(struct rte_mbuf *m, uint32_t payload_len);
+
+// Functions for chunk generation.
+
+/**
+ * Pre-built Ethernet, IPv4, UDP and service headers of a flow.
+ *
+ * It is captured once from the first data chunk of the flow and then stamped
+ * into newly allocated mbufs, so generated chunks do not need to copy and trim
+ * a full received chunk.
+ */
+struct chunk_header_template {
+	uint8_t hdr[ALL_HEADERS_LEN] __rte_aligned(RTE_CACHE_LINE_SIZE);
+	bool valid;
+	// Negotiated chunk payload size of the flow.
+	uint16_t chunk_size;
+};
+
+void capture_header_template(struct chunk_header_template &tmpl,
+			     const struct rte_mbuf *m);
+
+/**
+ * Negotiate the chunk size of the flow with the received chunks of a message:
+ * The peer's chunk size is the payload length of the first of several chunks,
+ * it is used up to the local maximal chunk size. A message with a single chunk
+ * keeps the current chunk size.
+ */
+void update_flow_chunk_size(
+	struct chunk_header_template &tmpl,
+	const std::vector<struct service_header_cpu> &service_hdr_buf,
+	uint16_t max_chunk_size);
+
+/**
+ * Template of the reverse flow, i.e. towards the source of the flow of tmpl:
+ * Ethernet and IPv4 addresses and UDP ports are swapped.
+ */
+void reverse_header_template(const struct chunk_header_template &tmpl,
+			     struct chunk_header_template &reversed);
+
+/**
+ * Check if the chunk m belongs to the flow of the template (same addresses and
+ * ports).
+ */
+bool header_template_matches(const struct chunk_header_template &tmpl,
+			     const struct rte_mbuf *m);
+
+/**
+ * Fragment data into chunks with the header template.
+ *
+ * The chunk related fields (total_chunk_num, chunk_num and chunk_len) of hdr
+ * are set for each chunk, other fields are copied. Mbufs are allocated in bulk
+ * and the payload is copied directly from data. A chunk which does not fit
+ * into a single mbuf of the pool is segmented. Return false if data needs
+ * more chunks than the 16 bits total_chunk_num field holds or if mbufs can
+ * not be allocated.
+ */
+bool create_chunks(struct rte_mempool *pool,
+		   const struct chunk_header_template &tmpl,
+		   struct service_header_cpu hdr, const uint8_t *data,
+		   size_t data_len, uint16_t chunk_size,
+		   std::vector<struct rte_mbuf *> &chunk_buf);
+
+// Functions for the TX-prepare stage.
 
 /**
- * Check if a mbuf is a valid chunk.
+ * Marks a chunk whose headers or payload are rewritten, e.g. by
+ * update_l3_l4_header(). Only the checksums of marked chunks are updated
+ * before TX.
+ */
+constexpr uint64_t TX_CKSUM_FLAGS = PKT_TX_IPV4 | PKT_TX_IP_CKSUM |
+				    PKT_TX_UDP_CKSUM;
+
+/**
+ * Checksum offloads enabled on the TX port.
+ */
+struct tx_cksum_conf {
+	uint16_t port_id;
+	bool hw_ipv4_cksum;
+	bool hw_udp_cksum;
+};
+
+struct tx_cksum_conf get_tx_cksum_conf(uint16_t port_id);
+
+/**
+ * Calculate IPv4 and UDP checksum of a UDP datagram in software.
+ */
+uint16_t sw_ipv4_udp_cksum(const struct rte_ipv4_hdr *ipv4_hdr,
+			   const struct rte_udp_hdr *udp_hdr);
+
+/**
+ * Same as above for the UDP datagram of the chunk m, the datagram can span
+ * several segments.
+ */
+uint16_t sw_ipv4_udp_cksum(const struct rte_mbuf *m);
+
+/**
+ * Prepare IPv4 and UDP checksums of a burst of chunks before TX.
+ *
+ * Only chunks marked with TX_CKSUM_FLAGS are updated, forwarded chunks are
+ * sent as received. The checksums are offloaded to the port when the offloads
+ * are enabled on it, otherwise they are calculated in software. Return the
+ * number of chunks that are ready to be sent.
+ */
+uint16_t prepare_tx_cksum(const struct tx_cksum_conf &conf,
+			  struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
+
+// Functions for the EAL port setup.
+
+/**
+ * Configuration of the (virtual) port used by the VNF.
+ *
+ * - af_packet: Kernel packet socket on iface. Works everywhere, but every packet
+ *   is copied through the kernel.
+ * - af_xdp: AF_XDP socket on iface. Zero-copy is enabled when the driver of
+ *   iface supports it.
+ * - pcap: Read from pcap_rx and write to pcap_tx when both are given, otherwise
+ *   use libpcap on iface. Useful as a hermetic test stand-in.
+ * - ring: Loop-back port based on rte_rings. Useful as a hermetic test stand-in.
+ *
+ * Chunks are received and sent on the same port by default. To chain VNFs on
+ * the same host without the kernel, chunks can be received from a memif port
+ * (memif_rx, the socket of the upstream VNF) and sent on a second port: a
+ * memif port (memif_tx, the socket of this VNF) or a port of the backend on
+ * tx_iface.
+ */
+struct port_backend_conf {
+	std::string backend;
+	std::string iface;
+	std::string pcap_rx;
+	std::string pcap_tx;
+	std::string memif_rx;
+	std::string memif_tx;
+	std::string tx_iface;
+	// Maximal chunk payload size, af_packet frames are sized for it.
+	uint16_t max_chunk_size;
+};
+
+bool is_valid_backend(const std::string &backend);
+
+bool xdp_zero_copy_supported(const std::string &iface);
+
+/**
+ * Build the value of the EAL --vdev argument for the given backend
+ * configuration. An empty string is returned for unknown backends.
+ */
+std::string get_vdev_conf(const struct port_backend_conf &conf);
+
+/**
+ * Build the values of the EAL --vdev arguments of the receive port (port 0)
+ * and, if chunks are sent on a second port, of the send port (port 1). An
+ * empty vector is returned for unknown backends.
+ */
+std::vector<std::string> get_vdev_confs(const struct port_backend_conf &conf);
+
+/**
+ * Configure and start a port that is only used to send chunks, e.g. the
+ * second port of get_vdev_confs(). Its single RX queue takes mbufs from pool.
+ * The supported checksum offloads are enabled. Return false on errors.
+ */
+bool setup_tx_port(uint16_t port_id, struct rte_mempool *pool);
+
+/**
+ * Check if a mbuf is a valid chunk. All headers must be in the first segment.
  */
 bool inline is_valid_chunk(struct rte_mbuf *m)
 {
@@ -65,6 +268,9 @@ bool inline is_valid_chunk(struct rte_mbuf *m)
 	struct rte_ipv4_hdr *ipv4_hdr;
 	struct rte_udp_hdr *udp_hdr;
 
+	if (m->data_len < ALL_HEADERS_LEN) {
+		return false;
+	}
 	eth_hdr = rte_pktmbuf_mtod(m, struct rte_ether_hdr *);
 
 	if (eth_hdr->ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4)) {
@@ -0,0 +1,178 @@
+/*
+ * mixture_cache.cpp
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "matrix_codec.hpp"
+#include "mixture_cache.hpp"
+
+using namespace std;
+
+namespace meica
+{
+/* All fields are little-endian. */
+static void store_le64(uint8_t *p, uint64_t v)
+{
+	for (size_t i = 0; i < 8; ++i) {
+		p[i] = (v >> (8 * i)) & 0xff;
+	}
+}
+
+static uint64_t load_le64(const uint8_t *p)
+{
+	uint64_t v = 0;
+
+	for (size_t i = 0; i < 8; ++i) {
+		v |= static_cast<uint64_t>(p[i]) << (8 * i);
+	}
+	return v;
+}
+
+static void store_le32(uint8_t *p, uint32_t v)
+{
+	for (size_t i = 0; i < 4; ++i) {
+		p[i] = (v >> (8 * i)) & 0xff;
+	}
+}
+
+static uint32_t load_le32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) |
+	       (static_cast<uint32_t>(p[1]) << 8) |
+	       (static_cast<uint32_t>(p[2]) << 16) |
+	       (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/* Offsets of the fields in the header. */
+enum : size_t {
+	OFF_VERSION = 8,
+	OFF_SOURCE_NUMBER = 12,
+	OFF_SAMPLE_RATE = 16,
+	OFF_DURATION = 24,
+	OFF_SEED = 32,
+	OFF_S = 40,
+	OFF_A = 48,
+	OFF_X = 56,
+};
+
+static size_t align_up(size_t len)
+{
+	return (len + MIXTURE_CACHE_ALIGN - 1) / MIXTURE_CACHE_ALIGN *
+	       MIXTURE_CACHE_ALIGN;
+}
+
+bool write_mixture_cache(const string &path, const string &folder,
+			 const mixture_params &params)
+{
+	matrix S;
+	uint32_t sample_rate;
+	uint64_t duration_bits;
+	vector<uint8_t> sections[3];
+	vector<uint8_t> buf(MIXTURE_CACHE_HEADER_LEN, 0);
+
+	if (params.source_number == 0 ||
+	    !wavs_to_matrix_S(folder, params.duration, params.source_number, S,
+			      sample_rate)) {
+		return false;
+	}
+	mt19937_64 rng(params.seed);
+	const matrix A = generate_matrix_A(params.source_number, rng);
+	encode_raw_matrix(S, sections[0], raw_order::C);
+	encode_raw_matrix(A, sections[1], raw_order::C);
+	encode_raw_matrix(matmul(A, S), sections[2], raw_order::F);
+
+	memcpy(buf.data(), MIXTURE_CACHE_MAGIC, sizeof(MIXTURE_CACHE_MAGIC));
+	store_le32(&buf[OFF_VERSION], MIXTURE_CACHE_VERSION);
+	store_le32(&buf[OFF_SOURCE_NUMBER], params.source_number);
+	store_le32(&buf[OFF_SAMPLE_RATE], sample_rate);
+	memcpy(&duration_bits, &params.duration, sizeof(duration_bits));
+	store_le64(&buf[OFF_DURATION], duration_bits);
+	store_le64(&buf[OFF_SEED], params.seed);
+	for (size_t i = 0; i < 3; ++i) {
+		buf.resize(align_up(buf.size()), 0);
+		store_le64(&buf[OFF_S + 8 * i], buf.size());
+		buf.insert(buf.end(), sections[i].begin(), sections[i].end());
+	}
+
+	const string tmp_path = path + ".tmp." + to_string(getpid());
+	{
+		ofstream out(tmp_path, ios::binary | ios::trunc);
+		if (!out.write(reinterpret_cast<const char *>(buf.data()),
+			       buf.size())) {
+			remove(tmp_path.c_str());
+			return false;
+		}
+	}
+	if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+		remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool mixture_cache::open(const string &path)
+{
+	const uint8_t *data;
+	size_t size;
+	uint64_t duration_bits;
+	uint64_t offs[3];
+	matrix_view *views[3] = { &S_, &A_, &X_ };
+	raw_matrix_header hdr;
+
+	if (!file_.open(path)) {
+		return false;
+	}
+	data = file_.data();
+	size = file_.size();
+	if (size < MIXTURE_CACHE_HEADER_LEN ||
+	    memcmp(data, MIXTURE_CACHE_MAGIC, sizeof(MIXTURE_CACHE_MAGIC)) !=
+		    0 ||
+	    load_le32(data + OFF_VERSION) != MIXTURE_CACHE_VERSION) {
+		file_.close();
+		return false;
+	}
+	params_.source_number = load_le32(data + OFF_SOURCE_NUMBER);
+	sample_rate_ = load_le32(data + OFF_SAMPLE_RATE);
+	duration_bits = load_le64(data + OFF_DURATION);
+	memcpy(&params_.duration, &duration_bits, sizeof(params_.duration));
+	params_.seed = load_le64(data + OFF_SEED);
+	for (size_t i = 0; i < 3; ++i) {
+		offs[i] = load_le64(data + OFF_S + 8 * i);
+		// view_raw_matrix checks the alignment.
+		if (offs[i] >= size ||
+		    !view_raw_matrix(data + offs[i], size - offs[i],
+				     *views[i])) {
+			file_.close();
+			return false;
+		}
+	}
+
+	const size_t n = params_.source_number;
+	parse_raw_matrix_header(data + offs[2], size - offs[2], hdr);
+	if (hdr.order != raw_order::F || S_.rows != n || A_.rows != n ||
+	    A_.cols != n || X_.rows != n || X_.cols != S_.cols) {
+		file_.close();
+		return false;
+	}
+	X_raw_ = data + offs[2];
+	X_raw_len_ = RAW_MATRIX_HEADER_LEN + X_.rows * X_.cols * sizeof(double);
+	return true;
+}
+
+bool mixture_cache::matches(const mixture_params &params) const
+{
+	return file_.data() != nullptr &&
+	       params_.source_number == params.source_number &&
+	       params_.seed == params.seed &&
+	       fabs(params_.duration - params.duration) < 1e-9;
+}
+
+} // namespace meica
@@ -0,0 +1,107 @@
+/*
+ * mixture_cache.hpp
+ *
+ * Cache file of the mixtures S, A and X of the benchmarks, check
+ * ./mixture_cache.py for the definition.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+
+#include "meica_compute.hpp"
+#include "meica_testbed.hpp"
+
+namespace meica
+{
+constexpr uint8_t MIXTURE_CACHE_MAGIC[8] = { 'M', 'E', 'I', 'C',
+					     'A', 'M', 'I', 'X' };
+constexpr uint32_t MIXTURE_CACHE_VERSION = 1;
+constexpr size_t MIXTURE_CACHE_HEADER_LEN = 64;
+// Alignment of the matrices in the file.
+constexpr size_t MIXTURE_CACHE_ALIGN = 64;
+
+struct mixture_params {
+	uint32_t source_number;
+	// Seconds of each source.
+	double duration;
+	// Seed of the mixing matrix A.
+	uint64_t seed;
+};
+
+/**
+ * Generate S from the wav files in folder (wavs_to_matrix_S), A with the
+ * seeded generate_matrix_A and X = A @ S and store them in the cache file at
+ * path. The cache is written to a temporary file which is renamed, so readers
+ * never map a partial cache.
+ */
+bool write_mixture_cache(const std::string &path, const std::string &folder,
+			 const mixture_params &params);
+
+/**
+ * A mapped cache file, the matrices are viewed without copies.
+ */
+class mixture_cache {
+public:
+	mixture_cache() : params_(), sample_rate_(0), S_(), A_(), X_(),
+		X_raw_(nullptr), X_raw_len_(0)
+	{
+	}
+
+	/* Map and validate the cache file at path. */
+	bool open(const std::string &path);
+
+	/* True if the cache was generated with params. */
+	bool matches(const mixture_params &params) const;
+
+	const mixture_params &params() const
+	{
+		return params_;
+	}
+	uint32_t sample_rate() const
+	{
+		return sample_rate_;
+	}
+	const matrix_view &S() const
+	{
+		return S_;
+	}
+	const matrix_view &A() const
+	{
+		return A_;
+	}
+	/* Column-major like the X messages. */
+	const matrix_view &X() const
+	{
+		return X_;
+	}
+
+	/**
+	 * X as a column-major raw matrix (./matrix_codec.hpp), i.e. the
+	 * payload of an X message.
+	 */
+	const uint8_t *X_raw() const
+	{
+		return X_raw_;
+	}
+	size_t X_raw_len() const
+	{
+		return X_raw_len_;
+	}
+
+private:
+	mapped_file file_;
+	mixture_params params_;
+	uint32_t sample_rate_;
+	matrix_view S_;
+	matrix_view A_;
+	matrix_view X_;
+	const uint8_t *X_raw_;
+	size_t X_raw_len_;
+};
+
+} // namespace meica
@@ -0,0 +1,62 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+
+"""
+About: Reader of the mixture cache files written by ./build/meica_sender.
+
+A cache file stores the sources S, the mixing matrix A and the mixtures
+X = A @ S of a benchmark, so the clients do not decode the wav files and mix
+them again on every run. The file begins with a 64 bytes header:
+
+  magic "MEICAMIX" (8B), version (4B), source number (4B), sample rate (4B),
+  reserved (4B), duration in seconds (float64), seed of A (8B),
+  offsets of S, A and X (8B each).
+
+All fields are little-endian. Each offset is 64 bytes aligned and points to a
+matrix in the raw encoding of ./matrix_codec.py: S and A in C order and X in F
+order, i.e. the X section is the payload of an X message. The matrices are
+viewed on a mapping of the file without copies.
+"""
+
+import mmap
+import struct
+import typing
+
+import numpy as np
+
+import matrix_codec
+
+MAGIC: typing.Final[bytes] = b"MEICAMIX"
+VERSION: typing.Final[int] = 1
+HEADER_FMT: typing.Final[str] = "<8sIIIIdQQQQ"
+HEADER_LEN: typing.Final[int] = struct.calcsize(HEADER_FMT)
+
+
+class MixtureCache:
+    def __init__(self, path: str):
+        with open(path, "rb") as f:
+            self._mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (
+            magic,
+            version,
+            self.source_number,
+            self.sample_rate,
+            _,
+            self.duration,
+            self.seed,
+            *offsets,
+        ) = struct.unpack_from(HEADER_FMT, self._mm)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{path} is not a mixture cache file.")
+        buf = memoryview(self._mm)
+        self.S, self.A, self.X = (matrix_codec.decode_raw(buf[o:]) for o in offsets)
+        rows, cols = self.X.shape
+        # X in the raw encoding, sent without serialization.
+        x_len = matrix_codec.RAW_HEADER_LEN + rows * cols * self.X.itemsize
+        self.X_raw = buf[offsets[2] : offsets[2] + x_len]
+
+    def matches(self, duration: float, source_number: int) -> bool:
+        return self.source_number == source_number and np.isclose(
+            self.duration, duration
+        )
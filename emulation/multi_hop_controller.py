@@ -47,6 +47,9 @@ APP_INSTANCE_NAME = "multi_hop_api_app"
 CLIENT_IP = "10.0.1.11"
 SERVER_IP = "10.0.3.11"
 SERVER_UDP_PORT = 9999
+# Broadcasts of the data-parallel VNFs, DP_BROADCAST_UDP_PORT of
+# ./meica_data_parallel.hpp.
+DP_BROADCAST_UDP_PORT = 9998
 
 
 class MultiHopRest(app_manager.RyuApp):
@@ -216,6 +219,15 @@ class MultiHopRest(app_manager.RyuApp):
             and udp.dst_port == SERVER_UDP_PORT
         ):
             return True
+        # The broadcasts go back upstream and must pass every VNF on the way,
+        # other flows from the server (e.g. ACKs) are forwarded on layer 2.
+        if (
+            ip.src == SERVER_IP
+            and ip.dst == CLIENT_IP
+            and udp.src_port == SERVER_UDP_PORT
+            and udp.dst_port == DP_BROADCAST_UDP_PORT
+        ):
+            return True
 
         return False
 
@@ -0,0 +1,144 @@
+/*
+ * perf_counters.cpp
+ */
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#include "perf_counters.hpp"
+
+using namespace std;
+
+namespace meica
+{
+static const uint64_t PERF_EVENT_CONFIGS[] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+constexpr int perf_counters::EVENT_NUM;
+
+static int perf_event_open(uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	// The calling thread on any CPU.
+	return static_cast<int>(
+		syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+perf_counters::perf_counters() : slot_num_(0)
+{
+	for (int i = 0; i < EVENT_NUM; ++i) {
+		fds_[i] = -1;
+		slots_[i] = -1;
+	}
+}
+
+perf_counters::~perf_counters()
+{
+	close_all();
+}
+
+void perf_counters::close_all()
+{
+	for (int i = 0; i < EVENT_NUM; ++i) {
+		if (fds_[i] >= 0) {
+			close(fds_[i]);
+		}
+		fds_[i] = -1;
+		slots_[i] = -1;
+	}
+	slot_num_ = 0;
+}
+
+bool perf_counters::open(string &error)
+{
+	close_all();
+	// The cycles are the group leader, so all counters are scheduled
+	// together.
+	for (int i = 0; i < EVENT_NUM; ++i) {
+		fds_[i] = perf_event_open(PERF_EVENT_CONFIGS[i], fds_[0]);
+		if (fds_[i] < 0) {
+			if (i == 0) {
+				error = string("perf_event_open failed: ") +
+					strerror(errno);
+				return false;
+			}
+			continue;
+		}
+		slots_[i] = slot_num_;
+		slot_num_ += 1;
+	}
+	ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+struct perf_sample perf_counters::read() const
+{
+	// nr, time_enabled, time_running and the values of the group.
+	uint64_t buf[3 + EVENT_NUM] = {};
+	uint64_t values[EVENT_NUM] = {};
+	double scale = 1.0;
+
+	if (!is_open() ||
+	    ::read(fds_[0], buf, sizeof(buf)) < static_cast<ssize_t>(
+						       3 * sizeof(uint64_t))) {
+		return perf_sample{};
+	}
+	if (buf[2] > 0 && buf[2] < buf[1]) {
+		scale = static_cast<double>(buf[1]) / buf[2];
+	}
+	for (int i = 0; i < EVENT_NUM; ++i) {
+		if (slots_[i] >= 0 && static_cast<uint64_t>(slots_[i]) < buf[0]) {
+			values[i] = static_cast<uint64_t>(buf[3 + slots_[i]] *
+							  scale);
+		}
+	}
+	return perf_sample{ values[0], values[1], values[2], values[3] };
+}
+
+void perf_stats::add(const string &stage, uint32_t sources,
+		     uint64_t msg_bytes, const struct perf_sample &delta)
+{
+	total &t = totals_[key{ sources, msg_bytes, stage }];
+	t.count += 1;
+	t.sum += delta;
+}
+
+void perf_stats::dump(ostream &out) const
+{
+	out << "sources,msg_bytes,stage,count,cycles,instructions,ipc,llc_misses,branch_misses\n";
+	for (const auto &e : totals_) {
+		const double n = static_cast<double>(e.second.count);
+		const struct perf_sample &s = e.second.sum;
+		out << e.first.sources << "," << e.first.msg_bytes << ","
+		    << e.first.stage << "," << e.second.count << ","
+		    << fixed << setprecision(1) << s.cycles / n << ","
+		    << s.instructions / n << "," << setprecision(3)
+		    << (s.cycles > 0 ?
+				static_cast<double>(s.instructions) / s.cycles :
+				0.0)
+		    << "," << setprecision(1) << s.llc_misses / n << ","
+		    << s.branch_misses / n << "\n";
+	}
+	out << defaultfloat;
+}
+
+} // namespace meica
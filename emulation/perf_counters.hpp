@@ -0,0 +1,133 @@
+/*
+ * perf_counters.hpp
+ *
+ * Hardware performance counters (perf_event_open) of the compute and packet
+ * stages of the VNFs.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace meica
+{
+struct perf_sample {
+	uint64_t cycles;
+	uint64_t instructions;
+	// Last level cache misses, as far as the CPU supports them.
+	uint64_t llc_misses;
+	uint64_t branch_misses;
+};
+
+inline struct perf_sample operator-(const struct perf_sample &a,
+				    const struct perf_sample &b)
+{
+	return perf_sample{ a.cycles - b.cycles,
+			    a.instructions - b.instructions,
+			    a.llc_misses - b.llc_misses,
+			    a.branch_misses - b.branch_misses };
+}
+
+inline struct perf_sample &operator+=(struct perf_sample &a,
+				      const struct perf_sample &b)
+{
+	a.cycles += b.cycles;
+	a.instructions += b.instructions;
+	a.llc_misses += b.llc_misses;
+	a.branch_misses += b.branch_misses;
+	return a;
+}
+
+/**
+ * Counters of the calling thread in user space. They count from open() on,
+ * a stage is measured by the difference of two reads.
+ */
+class perf_counters {
+public:
+	perf_counters();
+	~perf_counters();
+
+	perf_counters(const perf_counters &) = delete;
+	perf_counters &operator=(const perf_counters &) = delete;
+
+	/**
+	 * Open the counters. Return false with the reason in error if the
+	 * cycles are not available, e.g. because of perf_event_paranoid.
+	 * Other unsupported events are counted as 0.
+	 */
+	bool open(std::string &error);
+
+	bool is_open() const
+	{
+		return fds_[0] >= 0;
+	}
+
+	/**
+	 * Current counts, scaled up if the counters were multiplexed. All 0
+	 * if the counters are not open.
+	 */
+	struct perf_sample read() const;
+
+private:
+	static constexpr int EVENT_NUM = 4;
+
+	void close_all();
+
+	int fds_[EVENT_NUM];
+	// Position of the events in the read group, -1 if not counted.
+	int slots_[EVENT_NUM];
+	int slot_num_;
+};
+
+/**
+ * Counters aggregated per stage and message shape, i.e. the number of sources
+ * (0 if X is not a raw matrix) and the size of X in bytes.
+ */
+class perf_stats {
+public:
+	void add(const std::string &stage, uint32_t sources,
+		 uint64_t msg_bytes, const struct perf_sample &delta);
+
+	bool empty() const
+	{
+		return totals_.empty();
+	}
+
+	/**
+	 * Write the mean counts per occurrence of each stage and shape as CSV
+	 * with a header line.
+	 */
+	void dump(std::ostream &out) const;
+
+private:
+	struct key {
+		uint32_t sources;
+		uint64_t msg_bytes;
+		std::string stage;
+
+		bool operator<(const key &other) const
+		{
+			if (sources != other.sources) {
+				return sources < other.sources;
+			}
+			if (msg_bytes != other.msg_bytes) {
+				return msg_bytes < other.msg_bytes;
+			}
+			return stage < other.stage;
+		}
+	};
+
+	struct total {
+		uint64_t count;
+		struct perf_sample sum;
+	};
+
+	std::map<key, total> totals_;
+};
+
+} // namespace meica
@@ -0,0 +1,189 @@
+/*
+ * py_worker.cpp
+ */
+
+#include <exception>
+
+#include <rte_common.h>
+#include <rte_eal.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_log.h>
+#include <rte_pause.h>
+
+#include "py_worker.hpp"
+
+using namespace std;
+
+namespace meica
+{
+py_worker::py_worker(const string &module_name, const string &func_name)
+	: module_name_(module_name), func_name_(func_name), func_(),
+	  lcore_id_(LCORE_ID_ANY), started_(false), state_(IDLE),
+	  job_(nullptr), error_()
+{
+}
+
+py_worker::~py_worker()
+{
+	stop();
+}
+
+void py_worker::load_func()
+{
+	func_ = py::module::import(module_name_.c_str())
+			.attr(func_name_.c_str());
+}
+
+bool py_worker::exec_job(const job_t &job)
+{
+	try {
+		job(func_);
+	} catch (const exception &e) {
+		error_ = e.what();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Entry of the compute lcore: own the interpreter and poll for jobs.
+ */
+int py_worker::lcore_main(void *arg)
+{
+	py_worker *w = static_cast<py_worker *>(arg);
+	int s;
+
+	// Do not override the signal handlers of the VNF.
+	py::scoped_interpreter guard{ false };
+	try {
+		w->load_func();
+	} catch (const exception &e) {
+		w->error_ = e.what();
+		w->state_.store(FAILED, memory_order_release);
+		return -1;
+	}
+	w->state_.store(IDLE, memory_order_release);
+
+	while (true) {
+		s = w->state_.load(memory_order_acquire);
+		if (s == STOP) {
+			break;
+		}
+		if (s != PENDING) {
+			rte_pause();
+			continue;
+		}
+		s = w->exec_job(*w->job_) ? DONE : FAILED;
+		w->state_.store(s, memory_order_release);
+	}
+
+	// Handles must be released before the interpreter is finalized.
+	w->func_ = py::object();
+	return 0;
+}
+
+void py_worker::start()
+{
+	unsigned lcore_id;
+
+	if (started_) {
+		return;
+	}
+
+	lcore_id = rte_get_next_lcore(-1, 1, 0);
+	if (lcore_id >= RTE_MAX_LCORE) {
+		py::initialize_interpreter(false);
+		try {
+			load_func();
+		} catch (const exception &e) {
+			rte_exit(EXIT_FAILURE, "Failed to load %s.%s: %s\n",
+				 module_name_.c_str(), func_name_.c_str(),
+				 e.what());
+		}
+		RTE_LOG(INFO, USER1,
+			"Python worker runs inline on lcore %u (no free lcore).\n",
+			rte_lcore_id());
+		started_ = true;
+		return;
+	}
+
+	// PENDING without a job: the worker is loading the module.
+	state_.store(PENDING, memory_order_release);
+	if (rte_eal_remote_launch(lcore_main, this, lcore_id) != 0) {
+		rte_exit(EXIT_FAILURE,
+			 "Failed to launch the Python worker on lcore %u.\n",
+			 lcore_id);
+	}
+	while (state_.load(memory_order_acquire) == PENDING) {
+		rte_pause();
+	}
+	if (state_.load(memory_order_acquire) == FAILED) {
+		rte_exit(EXIT_FAILURE, "Failed to load %s.%s: %s\n",
+			 module_name_.c_str(), func_name_.c_str(),
+			 error_.c_str());
+	}
+	lcore_id_ = lcore_id;
+	started_ = true;
+	RTE_LOG(INFO, USER1, "Python worker runs on lcore %u.\n", lcore_id_);
+}
+
+void py_worker::run(const job_t &job)
+{
+	int s;
+
+	if (!started_) {
+		rte_exit(EXIT_FAILURE, "The Python worker is not started.\n");
+	}
+	if (lcore_id_ == LCORE_ID_ANY) {
+		if (!exec_job(job)) {
+			rte_exit(EXIT_FAILURE, "Python job failed: %s\n",
+				 error_.c_str());
+		}
+		return;
+	}
+
+	job_ = &job;
+	state_.store(PENDING, memory_order_release);
+	while ((s = state_.load(memory_order_acquire)) == PENDING) {
+		rte_pause();
+	}
+	job_ = nullptr;
+	if (s == FAILED) {
+		rte_exit(EXIT_FAILURE, "Python job failed: %s\n",
+			 error_.c_str());
+	}
+	state_.store(IDLE, memory_order_relaxed);
+}
+
+void py_worker::stop()
+{
+	if (!started_) {
+		return;
+	}
+	started_ = false;
+	if (lcore_id_ == LCORE_ID_ANY) {
+		func_ = py::object();
+		py::finalize_interpreter();
+		return;
+	}
+	state_.store(STOP, memory_order_release);
+	rte_eal_wait_lcore(lcore_id_);
+	lcore_id_ = LCORE_ID_ANY;
+	state_.store(IDLE, memory_order_relaxed);
+}
+
+py::memoryview make_memoryview(const uint8_t *data, size_t len)
+{
+	// A memoryview can not be created on a NULL buffer.
+	static const uint8_t empty = 0;
+
+	if (len == 0) {
+		data = &empty;
+	}
+	return py::memoryview(py::buffer_info(
+		const_cast<uint8_t *>(data), sizeof(uint8_t), "B", 1,
+		{ static_cast<ssize_t>(len) }, { 1 }));
+}
+
+} // namespace meica
@@ -0,0 +1,86 @@
+/*
+ * py_worker.hpp
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include <pybind11/embed.h>
+
+namespace meica
+{
+namespace py = pybind11;
+
+/**
+ * Persistent worker of the embedded Python interpreter.
+ *
+ * The module is imported and the function handle is resolved once in start().
+ * If the EAL has a slave lcore, the interpreter lives on the first one and the
+ * GIL is never taken by the packet IO lcore. Otherwise the worker runs inline
+ * on the calling lcore.
+ *
+ * Jobs are executed one at a time, run() blocks until the job is finished.
+ */
+class py_worker {
+public:
+	/* A job is called with the GIL held and the cached function handle. */
+	using job_t = std::function<void(const py::object &func)>;
+
+	py_worker(const std::string &module_name, const std::string &func_name);
+	~py_worker();
+
+	py_worker(const py_worker &) = delete;
+	py_worker &operator=(const py_worker &) = delete;
+
+	void start();
+	void run(const job_t &job);
+	void stop();
+
+	bool started() const
+	{
+		return started_;
+	}
+
+	/* The lcore of the interpreter, LCORE_ID_ANY when running inline. */
+	unsigned lcore_id() const
+	{
+		return lcore_id_;
+	}
+
+private:
+	enum worker_state : int {
+		IDLE,
+		PENDING,
+		DONE,
+		FAILED,
+		STOP,
+	};
+
+	static int lcore_main(void *arg);
+	void load_func();
+	bool exec_job(const job_t &job);
+
+	std::string module_name_;
+	std::string func_name_;
+	py::object func_;
+	unsigned lcore_id_;
+	bool started_;
+	std::atomic<int> state_;
+	const job_t *job_;
+	std::string error_;
+};
+
+/**
+ * Wrap a read-only byte buffer into a memoryview without copying.
+ *
+ * The caller must keep the buffer unchanged until the view is released.
+ */
+py::memoryview make_memoryview(const uint8_t *data, size_t len);
+
+} // namespace meica
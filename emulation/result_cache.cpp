@@ -0,0 +1,136 @@
+/*
+ * result_cache.cpp
+ */
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "result_cache.hpp"
+
+using namespace std;
+
+namespace meica
+{
+/* Reflected CRC32C polynomial. */
+static constexpr uint32_t CRC32C_POLY = 0x82f63b78;
+
+/**
+ * Tables of the slicing-by-8 software CRC32C, table[k][b] is the CRC of byte b
+ * followed by k zero bytes.
+ */
+struct crc32c_tables {
+	uint32_t table[8][256];
+
+	crc32c_tables()
+	{
+		uint32_t b, k, c;
+
+		for (b = 0; b < 256; ++b) {
+			c = b;
+			for (k = 0; k < 8; ++k) {
+				c = (c >> 1) ^ ((c & 1) ? CRC32C_POLY : 0);
+			}
+			table[0][b] = c;
+		}
+		for (b = 0; b < 256; ++b) {
+			for (k = 1; k < 8; ++k) {
+				c = table[k - 1][b];
+				table[k][b] = (c >> 8) ^ table[0][c & 0xff];
+			}
+		}
+	}
+};
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *data, size_t len)
+{
+	static const crc32c_tables t;
+	uint64_t word;
+
+	for (; len >= 8; len -= 8, data += 8) {
+		memcpy(&word, data, 8);
+		// Little-endian layout is assumed like the rest of the VNFs.
+		word ^= crc;
+		crc = t.table[7][word & 0xff] ^ t.table[6][(word >> 8) & 0xff] ^
+		      t.table[5][(word >> 16) & 0xff] ^
+		      t.table[4][(word >> 24) & 0xff] ^
+		      t.table[3][(word >> 32) & 0xff] ^
+		      t.table[2][(word >> 40) & 0xff] ^
+		      t.table[1][(word >> 48) & 0xff] ^ t.table[0][word >> 56];
+	}
+	for (; len > 0; --len, ++data) {
+		crc = (crc >> 8) ^ t.table[0][(crc ^ *data) & 0xff];
+	}
+	return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_hw(uint32_t crc, const uint8_t *data, size_t len)
+{
+	uint64_t c = crc;
+	uint64_t word;
+
+	for (; len >= 8; len -= 8, data += 8) {
+		memcpy(&word, data, 8);
+		c = _mm_crc32_u64(c, word);
+	}
+	crc = static_cast<uint32_t>(c);
+	for (; len > 0; --len, ++data) {
+		crc = _mm_crc32_u8(crc, *data);
+	}
+	return crc;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const uint8_t *data, size_t len)
+{
+#if defined(__x86_64__)
+	static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+	if (has_sse42) {
+		return ~crc32c_hw(~crc, data, len);
+	}
+#endif
+	return ~crc32c_sw(~crc, data, len);
+}
+
+result_cache::result_cache(size_t capacity)
+	: capacity_(capacity), entries_(), index_(), stats_()
+{
+}
+
+const cached_result *result_cache::lookup(const result_key &key)
+{
+	auto it = index_.find(key);
+	if (it == index_.end()) {
+		stats_.misses += 1;
+		return nullptr;
+	}
+	stats_.hits += 1;
+	entries_.splice(entries_.begin(), entries_, it->second);
+	return &it->second->second;
+}
+
+void result_cache::insert(const result_key &key, const cached_result &result)
+{
+	if (capacity_ == 0) {
+		return;
+	}
+	auto it = index_.find(key);
+	if (it != index_.end()) {
+		it->second->second = result;
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return;
+	}
+	if (entries_.size() == capacity_) {
+		index_.erase(entries_.back().first);
+		entries_.pop_back();
+		stats_.evictions += 1;
+	}
+	entries_.emplace_front(key, result);
+	index_[key] = entries_.begin();
+}
+
+} // namespace meica
@@ -0,0 +1,178 @@
+/*
+ * result_cache.hpp
+ *
+ * Cache of the compute results of repeated X payloads.
+ * This module does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace meica
+{
+/**
+ * CRC32C (Castagnoli) of data, continued from the CRC crc of the preceding
+ * bytes (0 for the first bytes). The SSE4.2 CRC32 instruction is used when the
+ * CPU supports it.
+ */
+uint32_t crc32c(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * CRC32C of a message which is fed in pieces, e.g. the payloads of its chunks
+ * in order.
+ */
+class crc32c_stream {
+public:
+	crc32c_stream() : valid_(true), crc_(0), len_(0)
+	{
+	}
+
+	/* Start a new message. */
+	void reset()
+	{
+		valid_ = true;
+		crc_ = 0;
+		len_ = 0;
+	}
+
+	void feed(const uint8_t *data, size_t len)
+	{
+		if (valid_) {
+			crc_ = crc32c(crc_, data, len);
+			len_ += len;
+		}
+	}
+
+	/* Stop hashing, e.g. because chunks are out of order. */
+	void invalidate()
+	{
+		valid_ = false;
+	}
+
+	bool valid() const
+	{
+		return valid_;
+	}
+	uint32_t value() const
+	{
+		return crc_;
+	}
+	uint64_t length() const
+	{
+		return len_;
+	}
+
+private:
+	bool valid_;
+	uint32_t crc_;
+	uint64_t len_;
+};
+
+/**
+ * Inputs that determine a compute result: X (CRC32C and length), the received
+ * uW (CRC32C, 0 without uW), its iteration number and the ICA algorithm.
+ */
+struct result_key {
+	uint32_t X_crc;
+	uint64_t X_len;
+	uint32_t uW_crc;
+	uint16_t iter_num;
+	uint8_t algorithm;
+
+	bool operator==(const result_key &other) const
+	{
+		return X_crc == other.X_crc && X_len == other.X_len &&
+		       uW_crc == other.uW_crc && iter_num == other.iter_num &&
+		       algorithm == other.algorithm;
+	}
+};
+
+struct result_key_hash {
+	size_t operator()(const result_key &k) const
+	{
+		uint64_t h = (static_cast<uint64_t>(k.X_crc) << 32) | k.uW_crc;
+		h ^= (k.X_len << 24) ^ (static_cast<uint64_t>(k.iter_num) << 8) ^
+		     k.algorithm;
+		// Mix the bits (splitmix64 finalizer).
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+		return static_cast<size_t>(h ^ (h >> 31));
+	}
+};
+
+/**
+ * uW computed by the VNF for a result_key.
+ */
+struct cached_result {
+	bool has_final_result;
+	uint16_t iter_num;
+	std::vector<uint8_t> uW;
+};
+
+struct result_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+/**
+ * Bounded LRU cache of compute results.
+ *
+ * Keys are only CRC32Cs of the inputs, so two different inputs with the same
+ * CRCs and lengths share a result.
+ */
+class result_cache {
+public:
+	/* A cache with capacity 0 is disabled, lookups always miss. */
+	explicit result_cache(size_t capacity);
+
+	/**
+	 * Return the result of key and mark it as the most recently used one,
+	 * or nullptr if it is not cached. The result stays valid until the
+	 * next insert().
+	 */
+	const cached_result *lookup(const result_key &key);
+
+	/**
+	 * Insert or replace the result of key, the least recently used result
+	 * is evicted if the cache is full.
+	 */
+	void insert(const result_key &key, const cached_result &result);
+
+	bool enabled() const
+	{
+		return capacity_ > 0;
+	}
+	size_t size() const
+	{
+		return entries_.size();
+	}
+	size_t capacity() const
+	{
+		return capacity_;
+	}
+	const result_cache_stats &stats() const
+	{
+		return stats_;
+	}
+
+private:
+	typedef std::pair<result_key, cached_result> entry;
+
+	size_t capacity_;
+	// Most recently used first.
+	std::list<entry> entries_;
+	std::unordered_map<result_key, std::list<entry>::iterator,
+			   result_key_hash>
+		index_;
+	result_cache_stats stats_;
+};
+
+} // namespace meica
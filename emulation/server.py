@@ -111,9 +111,10 @@ class Server(meica_host.MEICAHost):
         # iter_num = hdr.iter_num
 
         if msg_type == 0:
-            self.logger.debug("Start running centralized MEICA.")
+            algorithm = meica_host.get_algorithm(hdr.msg_flags)
+            self.logger.debug(f"Start running centralized {algorithm}.")
             X = self.defragment(chunks)
-            pyfbss.meica(X, ext_multi_ica=self.extraction_base)
+            pyfbss.fastbss(algorithm, X, ext_multi_ica=self.extraction_base)
             self.send_ack()
         else:
             raise RuntimeError(f"Invalid or unknown message type {msg_type}!")
@@ -0,0 +1,290 @@
+/*
+ * service_header.hpp
+ *
+ * MEICA service header shared by the VNFs and the native end hosts.
+ * This header does not depend on DPDK.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace meica
+{
+/**
+ * MEICA service header in CPU byte order: Check the header definition in
+ * ./meica_host.py.
+ */
+struct service_header_cpu {
+	uint8_t msg_type;
+	uint8_t msg_flags;
+	uint16_t total_msg_num;
+	uint16_t msg_num;
+	uint16_t total_chunk_num;
+	uint16_t chunk_num;
+	uint16_t chunk_len;
+	uint16_t data_chunk_num;
+	uint16_t iter_num;
+};
+
+constexpr uint32_t SERVICE_HEADER_LEN = sizeof(struct service_header_cpu);
+
+static_assert(SERVICE_HEADER_LEN == 16, "Invalid MEICA service header size");
+
+// Maximal chunk payload (bytes) of a 9000B jumbo frame MTU: IPv4 (20B), UDP
+// (8B) and the service header.
+constexpr uint16_t MAX_JUMBO_CHUNK_SIZE = 9000 - 20 - 8 - SERVICE_HEADER_LEN;
+
+/* On the wire, all 16-bit fields are in network byte order. */
+inline uint16_t load_be16(const uint8_t *p)
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline void store_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = static_cast<uint8_t>(v >> 8);
+	p[1] = static_cast<uint8_t>(v & 0xff);
+}
+
+/**
+ * Parse the service header at data, at least SERVICE_HEADER_LEN bytes must be
+ * readable.
+ */
+inline struct service_header_cpu parse_service_header(const uint8_t *data)
+{
+	struct service_header_cpu hdr;
+
+	hdr.msg_type = data[0];
+	hdr.msg_flags = data[1];
+	hdr.total_msg_num = load_be16(data + 2);
+	hdr.msg_num = load_be16(data + 4);
+	hdr.total_chunk_num = load_be16(data + 6);
+	hdr.chunk_num = load_be16(data + 8);
+	hdr.chunk_len = load_be16(data + 10);
+	hdr.data_chunk_num = load_be16(data + 12);
+	hdr.iter_num = load_be16(data + 14);
+	return hdr;
+}
+
+inline void write_service_header(uint8_t *data,
+				 const struct service_header_cpu &hdr)
+{
+	data[0] = hdr.msg_type;
+	data[1] = hdr.msg_flags;
+	store_be16(data + 2, hdr.total_msg_num);
+	store_be16(data + 4, hdr.msg_num);
+	store_be16(data + 6, hdr.total_chunk_num);
+	store_be16(data + 8, hdr.chunk_num);
+	store_be16(data + 10, hdr.chunk_len);
+	store_be16(data + 12, hdr.data_chunk_num);
+	store_be16(data + 14, hdr.iter_num);
+}
+
+/**
+ * msg_flags bit of a chunk with an extension area. The extension area is a
+ * list of TLVs between the end of the chunk (chunk_len) and the end of the
+ * UDP datagram, so receivers which do not know it only see the chunk. Each TLV
+ * is a type (1B), the length of the value (2B) and the value. Only the last
+ * chunk of a message has an extension area.
+ */
+constexpr uint8_t MSG_FLAG_EXT = 0x10;
+constexpr size_t EXT_TLV_HEADER_LEN = 3;
+
+enum class ext_tlv_type : uint8_t {
+	// uW piggybacked on the final chunk of X, see uW_ext.
+	UW = 1,
+	// Timestamps of a VNF that handled the message, see trace_record.
+	TRACE = 2,
+};
+
+inline void append_ext_tlv(std::vector<uint8_t> &ext, ext_tlv_type type,
+			   const uint8_t *value, uint16_t len)
+{
+	const size_t off = ext.size();
+
+	ext.resize(off + EXT_TLV_HEADER_LEN + len);
+	ext[off] = static_cast<uint8_t>(type);
+	store_be16(&ext[off + 1], len);
+	std::copy(value, value + len, ext.begin() + off + EXT_TLV_HEADER_LEN);
+}
+
+/**
+ * Find the first TLV of the given type in the extension area, return false if
+ * there is none or the area is malformed.
+ */
+inline bool find_ext_tlv(const uint8_t *ext, size_t ext_len,
+			 ext_tlv_type type, const uint8_t *&value,
+			 uint16_t &len)
+{
+	size_t off = 0;
+
+	while (ext_len - off >= EXT_TLV_HEADER_LEN) {
+		len = load_be16(ext + off + 1);
+		if (ext_len - off - EXT_TLV_HEADER_LEN < len) {
+			return false;
+		}
+		if (ext[off] == static_cast<uint8_t>(type)) {
+			value = ext + off + EXT_TLV_HEADER_LEN;
+			return true;
+		}
+		off += EXT_TLV_HEADER_LEN + len;
+	}
+	return false;
+}
+
+/**
+ * Append the TLVs of the extension area whose type is (keep true) or is not
+ * (keep false) the given type to out. Return false if the area is malformed.
+ */
+inline bool copy_ext_tlvs(const uint8_t *ext, size_t ext_len,
+			  ext_tlv_type type, bool keep,
+			  std::vector<uint8_t> &out)
+{
+	size_t off = 0;
+	uint16_t len;
+
+	while (ext_len - off >= EXT_TLV_HEADER_LEN) {
+		len = load_be16(ext + off + 1);
+		if (ext_len - off - EXT_TLV_HEADER_LEN < len) {
+			return false;
+		}
+		if ((ext[off] == static_cast<uint8_t>(type)) == keep) {
+			out.insert(out.end(), ext + off,
+				   ext + off + EXT_TLV_HEADER_LEN + len);
+		}
+		off += EXT_TLV_HEADER_LEN + len;
+	}
+	return off == ext_len;
+}
+
+/**
+ * Value of the UW TLV: msg_flags (1B) and iter_num (2B) of the replaced uW
+ * message, then the uW bytes (a raw matrix with the native engine).
+ */
+struct uW_ext {
+	uint8_t msg_flags;
+	uint16_t iter_num;
+	const uint8_t *data;
+	size_t len;
+};
+
+constexpr size_t UW_EXT_HEADER_LEN = 3;
+
+inline void append_uW_ext(std::vector<uint8_t> &ext, uint8_t msg_flags,
+			  uint16_t iter_num, const uint8_t *data, size_t len)
+{
+	std::vector<uint8_t> value(UW_EXT_HEADER_LEN + len);
+
+	value[0] = msg_flags;
+	store_be16(&value[1], iter_num);
+	std::copy(data, data + len, value.begin() + UW_EXT_HEADER_LEN);
+	append_ext_tlv(ext, ext_tlv_type::UW, value.data(),
+		       static_cast<uint16_t>(value.size()));
+}
+
+inline bool parse_uW_ext(const uint8_t *ext, size_t ext_len,
+			 struct uW_ext &uW)
+{
+	const uint8_t *value;
+	uint16_t len;
+
+	if (!find_ext_tlv(ext, ext_len, ext_tlv_type::UW, value, len) ||
+	    len < UW_EXT_HEADER_LEN) {
+		return false;
+	}
+	uW.msg_flags = value[0];
+	uW.iter_num = load_be16(value + 1);
+	uW.data = value + UW_EXT_HEADER_LEN;
+	uW.len = len - UW_EXT_HEADER_LEN;
+	return true;
+}
+
+/* Node ID of the trace records of the sink, not used by any VNF. */
+constexpr uint16_t TRACE_SINK_NODE_ID = UINT16_MAX;
+
+/**
+ * Value of a TRACE TLV: node ID (2B) and the wall clock timestamps (ns since
+ * the epoch, 8B each) of a VNF: first chunk received, all inputs received,
+ * compute started and ended (0 if it did not compute) and result sent. Each
+ * VNF appends a TRACE TLV to the ones it received with the uW.
+ */
+struct trace_record {
+	uint16_t node_id;
+	uint64_t rx_first;
+	uint64_t rx_last;
+	uint64_t compute_start;
+	uint64_t compute_end;
+	uint64_t tx;
+};
+
+constexpr size_t TRACE_RECORD_LEN = 2 + 5 * 8;
+
+inline void store_be64(uint8_t *p, uint64_t v)
+{
+	for (int i = 7; i >= 0; --i) {
+		p[i] = static_cast<uint8_t>(v & 0xff);
+		v >>= 8;
+	}
+}
+
+inline uint64_t load_be64(const uint8_t *p)
+{
+	uint64_t v = 0;
+	for (int i = 0; i < 8; ++i) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+inline void append_trace_ext(std::vector<uint8_t> &ext,
+			     const struct trace_record &rec)
+{
+	uint8_t value[TRACE_RECORD_LEN];
+
+	store_be16(value, rec.node_id);
+	store_be64(value + 2, rec.rx_first);
+	store_be64(value + 10, rec.rx_last);
+	store_be64(value + 18, rec.compute_start);
+	store_be64(value + 26, rec.compute_end);
+	store_be64(value + 34, rec.tx);
+	append_ext_tlv(ext, ext_tlv_type::TRACE, value, TRACE_RECORD_LEN);
+}
+
+/**
+ * Get the records of all TRACE TLVs of the extension area in order, return
+ * false if the area is malformed.
+ */
+inline bool parse_trace_ext(const uint8_t *ext, size_t ext_len,
+			    std::vector<struct trace_record> &records)
+{
+	std::vector<uint8_t> tlvs;
+	struct trace_record rec;
+	size_t off;
+
+	records.clear();
+	if (!copy_ext_tlvs(ext, ext_len, ext_tlv_type::TRACE, true, tlvs)) {
+		return false;
+	}
+	for (off = 0; off < tlvs.size();
+	     off += EXT_TLV_HEADER_LEN + load_be16(&tlvs[off + 1])) {
+		const uint8_t *value = &tlvs[off + EXT_TLV_HEADER_LEN];
+		if (load_be16(&tlvs[off + 1]) < TRACE_RECORD_LEN) {
+			return false;
+		}
+		rec.node_id = load_be16(value);
+		rec.rx_first = load_be64(value + 2);
+		rec.rx_last = load_be64(value + 10);
+		rec.compute_start = load_be64(value + 18);
+		rec.compute_end = load_be64(value + 26);
+		rec.tx = load_be64(value + 34);
+		records.push_back(rec);
+	}
+	return true;
+}
+
+} // namespace meica
@@ -0,0 +1,91 @@
+/*
+ * test_admission_control.cpp
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include "admission_control.hpp"
+
+using namespace meica;
+
+static const admission_params params = { 0.9, 0.25, 0.5 };
+
+/* Messages every interval (s) that take compute (s) when admitted. */
+static admission_stats run(double interval, double compute, int msg_num)
+{
+	admission_controller ctrl(params);
+
+	for (int i = 0; i < msg_num; ++i) {
+		ctrl.on_arrival(i * interval);
+		if (ctrl.admit(1.0)) {
+			ctrl.on_compute(compute);
+		}
+	}
+	return ctrl.stats();
+}
+
+static void test_steady_load()
+{
+	admission_stats s = run(1.0, 0.5, 100);
+	assert(s.admitted == 100 && s.shed == 0);
+
+	// Exactly at the maximal utilization.
+	s = run(1.0, 0.9, 100);
+	assert(s.admitted == 100 && s.shed == 0);
+
+	// Twice the capacity: 0.45 of the messages are computed.
+	s = run(1.0, 2.0, 1000);
+	assert(s.admitted + s.shed == 1000 && s.shed_by_pool == 0);
+	assert(std::fabs(s.admitted / 1000.0 - 0.45) < 0.01);
+}
+
+static void test_backlog()
+{
+	admission_controller ctrl(params);
+
+	ctrl.on_arrival(0.0);
+	assert(ctrl.admit(1.0));
+	ctrl.on_compute(1.0);
+	// Messages that queued up during the computation.
+	for (int i = 0; i < 5; ++i) {
+		ctrl.on_arrival(1.0 + i * 1e-4);
+		assert(!ctrl.admit(1.0));
+	}
+	assert(ctrl.utilization() > 1.0);
+	// The next message after an idle time is computed again.
+	ctrl.on_arrival(3.0);
+	assert(ctrl.admit(1.0));
+	assert(ctrl.stats().admitted == 2 && ctrl.stats().shed == 5);
+}
+
+static void test_pool()
+{
+	admission_controller ctrl(params);
+
+	ctrl.on_arrival(0.0);
+	assert(!ctrl.admit(0.1));
+	// The credit is kept for the next message.
+	ctrl.on_arrival(1e-3);
+	assert(ctrl.admit(0.5));
+	assert(ctrl.stats().shed_by_pool == 1 && ctrl.stats().shed == 1);
+
+	bool thrown = false;
+	try {
+		admission_controller invalid({ 0.0, 0.25, 0.5 });
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+int main()
+{
+	test_steady_load();
+	test_backlog();
+	test_pool();
+	return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * test_cnn_compute.cpp
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "cnn_compute.hpp"
+
+using namespace meica;
+
+static std::vector<float> random_vector(size_t n, std::mt19937_64 &rng)
+{
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<float> v(n);
+	for (float &x : v) {
+		x = dist(rng);
+	}
+	return v;
+}
+
+/**
+ * Small audio classifier: a strided convolution, max pooling, a convolution
+ * with padding, a pointwise convolution, global pooling and a dense head.
+ */
+static cnn_model build_model(std::mt19937_64 &rng)
+{
+	cnn_model model;
+	model.add_layer(cnn_layer_type::CONV1D, cnn_activation::RELU, 2, 8, 5,
+			2, 2, random_vector(8 * 2 * 5, rng),
+			random_vector(8, rng));
+	model.add_layer(cnn_layer_type::MAX_POOL1D, cnn_activation::NONE, 8, 8,
+			2, 2, 0, {}, {});
+	model.add_layer(cnn_layer_type::CONV1D, cnn_activation::RELU, 8, 16, 3,
+			1, 1, random_vector(16 * 8 * 3, rng),
+			random_vector(16, rng));
+	model.add_layer(cnn_layer_type::CONV1D, cnn_activation::NONE, 16, 4, 1,
+			1, 0, random_vector(4 * 16, rng),
+			random_vector(4, rng));
+	model.add_layer(cnn_layer_type::GLOBAL_AVG_POOL, cnn_activation::NONE,
+			4, 4, 1, 1, 0, {}, {});
+	model.add_layer(cnn_layer_type::DENSE, cnn_activation::NONE, 4, 3, 1, 1,
+			0, random_vector(3 * 4, rng), random_vector(3, rng));
+	return model;
+}
+
+/**
+ * Direct (not lowered) evaluation of the layers in double.
+ */
+static std::vector<double> reference(const cnn_model &model,
+				     const std::vector<float> &input,
+				     cnn_shape in, cnn_shape &out)
+{
+	std::vector<double> x(input.begin(), input.end());
+	cnn_shape s = in;
+
+	for (const auto &l : model.layers()) {
+		std::vector<double> y;
+		cnn_shape next;
+		assert(model.output_shape(&l - model.layers().data(),
+					  &l - model.layers().data() + 1, s,
+					  next));
+		y.assign(next.channels * next.length, 0.0);
+		for (size_t o = 0; o < next.channels; ++o) {
+			for (size_t j = 0; j < next.length; ++j) {
+				double v = 0.0;
+				switch (l.type) {
+				case cnn_layer_type::CONV1D:
+					v = l.bias[o];
+					for (size_t c = 0; c < s.channels; ++c) {
+						for (size_t t = 0; t < l.kernel;
+						     ++t) {
+							long p = static_cast<long>(
+									 j * l.stride +
+									 t) -
+								 l.padding;
+							if (p < 0 ||
+							    p >= static_cast<long>(
+									 s.length)) {
+								continue;
+							}
+							v += l.weight[(o * s.channels +
+								       c) * l.kernel +
+								      t] *
+							     x[c * s.length + p];
+						}
+					}
+					break;
+				case cnn_layer_type::MAX_POOL1D:
+					v = x[o * s.length + j * l.stride];
+					for (size_t t = 1; t < l.kernel; ++t) {
+						v = std::max(
+							v, x[o * s.length +
+							     j * l.stride + t]);
+					}
+					break;
+				case cnn_layer_type::GLOBAL_AVG_POOL:
+					for (size_t t = 0; t < s.length; ++t) {
+						v += x[o * s.length + t];
+					}
+					v /= s.length;
+					break;
+				case cnn_layer_type::DENSE:
+					v = l.bias[o];
+					for (size_t i = 0; i < x.size(); ++i) {
+						v += l.weight[o * x.size() + i] *
+						     x[i];
+					}
+					break;
+				}
+				if (l.activation == cnn_activation::RELU) {
+					v = std::max(v, 0.0);
+				}
+				y[o * next.length + j] = v;
+			}
+		}
+		x.swap(y);
+		s = next;
+	}
+	out = s;
+	return x;
+}
+
+static void test_inference()
+{
+	std::mt19937_64 rng(1);
+	cnn_model model = build_model(rng);
+
+	for (size_t length : { 64, 1000, 333 }) {
+		cnn_shape in = { 2, length };
+		cnn_shape out;
+		cnn_shape ref_out;
+		std::vector<float> input = random_vector(2 * length, rng);
+		const float *y = model.run(input.data(), in, out);
+		std::vector<double> ref = reference(model, input, in, ref_out);
+		assert(out.channels == 3 && out.length == 1);
+		assert(ref_out.channels == out.channels &&
+		       ref_out.length == out.length);
+		for (size_t i = 0; i < ref.size(); ++i) {
+			assert(std::fabs(y[i] - ref[i]) <
+			       1e-4 * (1.0 + std::fabs(ref[i])));
+		}
+	}
+
+	// The arena is only grown by longer inputs.
+	cnn_shape out;
+	std::vector<float> input = random_vector(2 * 500, rng);
+	const float *y0 = model.run(input.data(), cnn_shape{ 2, 500 }, out);
+	const float *y1 = model.run(input.data(), cnn_shape{ 2, 200 }, out);
+	assert(y0 == y1);
+
+	// Running the layers in two parts gives the same result.
+	cnn_shape mid;
+	cnn_shape out2;
+	const float *full = model.run(input.data(), cnn_shape{ 2, 500 }, out);
+	std::vector<float> expected(full, full + out.channels * out.length);
+	const float *part = model.run(input.data(), cnn_shape{ 2, 500 }, mid, 0,
+				      3);
+	std::vector<float> act(part, part + mid.channels * mid.length);
+	const float *y2 = model.run(act.data(), mid, out2, 3,
+				    model.layers().size());
+	assert(out2.channels == out.channels && out2.length == out.length);
+	for (size_t i = 0; i < expected.size(); ++i) {
+		assert(std::fabs(y2[i] - expected[i]) < 1e-5);
+	}
+
+	// Input that does not fit the first layer.
+	bool thrown = false;
+	try {
+		model.run(input.data(), cnn_shape{ 3, 100 }, out);
+	} catch (const std::invalid_argument &e) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+static void test_weight_file()
+{
+	std::mt19937_64 rng(2);
+	cnn_model model = build_model(rng);
+	cnn_model loaded;
+	std::vector<uint8_t> buf;
+	std::vector<uint8_t> buf2;
+
+	model.save(buf);
+	assert(loaded.load(buf.data(), buf.size()));
+	assert(loaded.in_channels() == 2);
+	assert(loaded.layers().size() == model.layers().size());
+	loaded.save(buf2);
+	assert(buf == buf2);
+	for (size_t i = 0; i < model.layers().size(); ++i) {
+		assert(loaded.layers()[i].weight == model.layers()[i].weight);
+	}
+
+	// The largest weight of each output channel is quantized to 127.
+	const cnn_layer &l = model.layers()[0];
+	const size_t cols = l.in_channels * l.kernel;
+	assert(l.qweight.size() == l.weight.size());
+	for (size_t o = 0; o < l.out_channels; ++o) {
+		int qmax = 0;
+		for (size_t i = 0; i < cols; ++i) {
+			qmax = std::max(qmax, std::abs(static_cast<int>(
+						      l.qweight[o * cols + i])));
+		}
+		assert(qmax == 127);
+	}
+
+	assert(!loaded.load(buf.data(), buf.size() - 1));
+	buf[0] = 'X';
+	assert(!loaded.load(buf.data(), buf.size()));
+}
+
+static void test_layer_split()
+{
+	std::mt19937_64 rng(3);
+	cnn_model model = build_model(rng);
+	const size_t n = model.layers().size();
+
+	std::vector<double> costs =
+		measure_layer_costs(model, cnn_shape{ 2, 1000 }, 2);
+	assert(costs.size() == n);
+	for (double c : costs) {
+		assert(c >= 0.0);
+	}
+
+	// The heavy layers are split, the light ones are grouped.
+	std::vector<size_t> split =
+		balance_layer_split({ 4.0, 1.0, 1.0, 1.0, 1.0, 4.0 }, 3);
+	assert((split == std::vector<size_t>{ 0, 1, 5, 6 }));
+	split = balance_layer_split({ 1.0, 1.0, 1.0, 1.0 }, 2);
+	assert((split == std::vector<size_t>{ 0, 2, 4 }));
+	// More parts than layers.
+	split = balance_layer_split({ 1.0, 2.0 }, 5);
+	assert((split == std::vector<size_t>{ 0, 1, 2 }));
+	split = balance_layer_split({ 1.0, 2.0 }, 1);
+	assert((split == std::vector<size_t>{ 0, 2 }));
+
+	// Running the stages one after another gives the full result.
+	split = balance_layer_split(costs, 3);
+	assert(split.front() == 0 && split.back() == n);
+	std::vector<float> x = random_vector(2 * 1000, rng);
+	cnn_shape s = { 2, 1000 };
+	cnn_shape out;
+	const float *full = model.run(x.data(), s, out);
+	std::vector<float> expected(full, full + out.channels * out.length);
+	for (size_t i = 0; i + 1 < split.size(); ++i) {
+		cnn_shape next;
+		const float *y = model.run(x.data(), s, next, split[i],
+					   split[i + 1]);
+		x.assign(y, y + next.channels * next.length);
+		s = next;
+	}
+	assert(s.channels == out.channels && s.length == out.length);
+	for (size_t i = 0; i < expected.size(); ++i) {
+		assert(std::fabs(x[i] - expected[i]) < 1e-5);
+	}
+}
+
+int main()
+{
+	test_inference();
+	test_weight_file();
+	test_layer_split();
+	return 0;
+}
@@ -0,0 +1,882 @@
+/*
+ * test_meica_compute.cpp
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "matrix_codec.hpp"
+#include "meica_batch.hpp"
+#include "meica_compute.hpp"
+#include "meica_data_parallel.hpp"
+#include "meica_online.hpp"
+#include "meica_stats.hpp"
+#include "meica_testbed.hpp"
+#include "mixture_cache.hpp"
+
+using namespace meica;
+
+static constexpr size_t SOURCE_NUM = 3;
+static constexpr size_t SAMPLE_NUM = 8192;
+
+static bool is_identity(const matrix &m, double eps)
+{
+	for (size_t i = 0; i < m.rows; ++i) {
+		for (size_t j = 0; j < m.cols; ++j) {
+			if (std::fabs(m(i, j) - (i == j ? 1.0 : 0.0)) > eps) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* Bit-exact equality, e.g. of the elements copied by the codec. */
+static bool same_bits(double a, double b)
+{
+	return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+/* std::isfinite() is folded to true with -ffast-math, check the exponent. */
+static bool finite_bits(double x)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &x, sizeof(bits));
+	return ((bits >> 52) & 0x7ff) != 0x7ff;
+}
+
+static matrix random_matrix(size_t rows, size_t cols, std::mt19937_64 &rng)
+{
+	std::uniform_real_distribution<double> dist(-1.0, 1.0);
+	matrix m(rows, cols);
+	for (double &v : m.data) {
+		v = dist(rng);
+	}
+	return m;
+}
+
+/**
+ * Non-Gaussian test sources: sine, square and sawtooth waves.
+ */
+static matrix generate_sources()
+{
+	matrix S(SOURCE_NUM, SAMPLE_NUM);
+	for (size_t j = 0; j < SAMPLE_NUM; ++j) {
+		double t = static_cast<double>(j);
+		S(0, j) = std::sin(t * 0.05);
+		S(1, j) = std::sin(t * 0.013) > 0 ? 1.0 : -1.0;
+		S(2, j) = std::fmod(t * 0.007, 1.0) - 0.5;
+	}
+	return S;
+}
+
+static void test_linalg()
+{
+	std::mt19937_64 rng(1);
+	matrix R = random_matrix(5, 5, rng);
+	matrix A = matmul(R, transpose(R));
+	std::vector<double> D;
+	matrix P;
+	matrix inv;
+
+	sym_eig(A, D, P);
+	assert(is_identity(matmul(transpose(P), P), 1e-10));
+	for (size_t i = 0; i < 5; ++i) {
+		for (size_t j = 0; j < 5; ++j) {
+			double sum = 0.0;
+			for (size_t k = 0; k < 5; ++k) {
+				sum += P(i, k) * D[k] * P(j, k);
+			}
+			assert(std::fabs(sum - A(i, j)) < 1e-10);
+		}
+	}
+
+	assert(inverse(R, inv));
+	assert(is_identity(matmul(R, inv), 1e-10));
+	assert(!inverse(matrix(2, 2), inv));
+
+	assert(is_identity(matmul(decorrelation(R), transpose(decorrelation(R))),
+			   1e-10));
+}
+
+static void test_whitening()
+{
+	std::mt19937_64 rng(2);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix X = matmul(A, generate_sources());
+	whitening w;
+
+	for (size_t step : { 1, 3 }) {
+		matrix_view v = matrix_view::of(X).subsample(step);
+		whiten_with_inv_V(v, w);
+		assert(w.Xt.rows == v.cols && w.Xt.cols == SOURCE_NUM);
+		assert(is_identity(matmul(w.V, w.V_inv), 1e-8));
+		// Xw @ Xw.T == m * I
+		matrix C = matmul(transpose(w.Xt), w.Xt);
+		for (double &c : C.data) {
+			c /= v.cols;
+		}
+		assert(is_identity(C, 1e-8));
+	}
+
+	// A constant row makes the covariance singular: finite whitening and
+	// separation.
+	for (size_t j = 0; j < SAMPLE_NUM; ++j) {
+		X(2, j) = 1.0;
+	}
+	whiten_with_inv_V(matrix_view::of(X), w);
+	for (double x : w.Xt.data) {
+		assert(finite_bits(x));
+	}
+	auto s = make_solver(ica_algorithm::MEICA,
+			     default_solver_params(ica_algorithm::MEICA));
+	const matrix W = separate(*s, matrix_view::of(X));
+	for (double x : W.data) {
+		assert(finite_bits(x));
+	}
+}
+
+static void test_solvers()
+{
+	std::mt19937_64 rng(3);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix S = generate_sources();
+	matrix X = matmul(A, S);
+
+	for (uint8_t id = 0; id < ICA_ALGORITHM_NUM; ++id) {
+		ica_algorithm algo = static_cast<ica_algorithm>(id);
+		ica_algorithm parsed;
+		assert(parse_algorithm(algorithm_name(algo), parsed));
+		assert(parsed == algo);
+
+		auto s = make_solver(algo, default_solver_params(algo));
+		assert(s->algorithm() == algo);
+		matrix W = separate(*s, matrix_view::of(X));
+		assert(W.rows == SOURCE_NUM && W.cols == SOURCE_NUM);
+		assert(amari_index(W, A) < 0.05);
+		assert(mean_si_sdr(S, matmul(W, X)) > 20.0);
+	}
+}
+
+/**
+ * Running MEICA level by level on different nodes gives the same result as
+ * running all levels on a single node.
+ */
+/* Records the levels that are observed, begin and end must alternate. */
+class test_level_observer : public level_observer {
+public:
+	std::vector<uint16_t> levels;
+	bool in_level = false;
+
+	void level_begin(uint16_t level) override
+	{
+		assert(!in_level);
+		in_level = true;
+		levels.push_back(level);
+	}
+	void level_end(uint16_t level) override
+	{
+		assert(in_level && levels.back() == level);
+		in_level = false;
+	}
+};
+
+static void test_meica_distributed()
+{
+	std::mt19937_64 rng(4);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix X = matmul(A, generate_sources());
+	solver_params params = default_solver_params(ica_algorithm::MEICA);
+	// Disable the fast break to run all levels.
+	params.tol = 0.0;
+	meica_solver full(params);
+	solver_state state = {};
+	uint16_t levels = full.level_num(matrix_view::of(X));
+
+	assert(levels == 11); // 2^11 <= 8192 / 3
+	matrix W = separate(full, matrix_view::of(X));
+
+	for (uint16_t node = 0; node < levels; ++node) {
+		meica_solver s(params);
+		test_level_observer observer;
+		s.set_level_observer(&observer);
+		assert(!state.has_final_result);
+		s.run(matrix_view::of(X), state, 1);
+		assert(state.iter_num == node + 1);
+		assert(observer.levels.size() == 1 &&
+		       observer.levels[0] == node && !observer.in_level);
+	}
+	assert(state.has_final_result);
+	assert(state.uW.data == W.data);
+}
+
+static void test_raw_matrix_codec()
+{
+	std::mt19937_64 rng(5);
+	matrix m = random_matrix(3, 7, rng);
+	std::vector<uint8_t> buf;
+	matrix_view v;
+	matrix decoded;
+
+	encode_raw_matrix(m, buf);
+	assert(buf.size() == RAW_MATRIX_HEADER_LEN + 3 * 7 * sizeof(double));
+	assert(is_raw_matrix(buf.data(), buf.size()));
+	assert(view_raw_matrix(buf.data(), buf.size(), v));
+	assert(v.rows == 3 && v.cols == 7);
+	assert(decode_raw_matrix(buf.data(), buf.size(), decoded));
+	assert(decoded.data == m.data);
+	for (size_t i = 0; i < 3; ++i) {
+		for (size_t j = 0; j < 7; ++j) {
+			assert(same_bits(v(i, j), m(i, j)));
+		}
+	}
+	assert(!view_raw_matrix(buf.data(), buf.size() - 1, v));
+
+	// Empty matrices and sizes which overflow are rejected.
+	raw_matrix_header hdr;
+	std::vector<uint8_t> bad = buf;
+	memset(&bad[4], 0, 4);
+	assert(!parse_raw_matrix_header(bad.data(), bad.size(), hdr));
+	assert(!decode_raw_matrix(bad.data(), bad.size(), decoded));
+	bad = buf;
+	memset(&bad[8], 0, 4);
+	assert(!view_raw_matrix(bad.data(), bad.size(), v));
+	// 2^31 x 2^30 float64 elements are 2^64 bytes.
+	bad = buf;
+	memcpy(&bad[4], "\x00\x00\x00\x80", 4);
+	memcpy(&bad[8], "\x00\x00\x00\x40", 4);
+	assert(!parse_raw_matrix(bad.data(), bad.size(), hdr));
+
+	encode_raw_matrix(m, buf, raw_order::F);
+	assert(decode_raw_matrix(buf.data(), buf.size(), decoded));
+	assert(decoded.data == m.data);
+	encode_raw_matrix(m, buf);
+
+	// Fortran order: rows and columns are swapped in memory.
+	buf[3] = 1;
+	buf[4] = 7;
+	buf[8] = 3;
+	assert(view_raw_matrix(buf.data(), buf.size(), v));
+	assert(v.rows == 7 && v.cols == 3);
+	for (size_t i = 0; i < 7; ++i) {
+		for (size_t j = 0; j < 3; ++j) {
+			assert(same_bits(v(i, j), m(j, i)));
+		}
+	}
+
+	std::vector<float> f(m.data.begin(), m.data.end());
+	encode_raw_matrix_f32(f.data(), 3, 7, buf);
+	assert(buf.size() == RAW_MATRIX_HEADER_LEN + 3 * 7 * sizeof(float));
+	assert(!view_raw_matrix(buf.data(), buf.size(), v));
+	assert(decode_raw_matrix(buf.data(), buf.size(), decoded));
+	assert(decoded.rows == 3 && decoded.cols == 7);
+	for (size_t i = 0; i < f.size(); ++i) {
+		assert(same_bits(decoded.data[i], static_cast<double>(f[i])));
+	}
+}
+
+/**
+ * Statistics accumulated over chunks give the same whitening as the full
+ * pass over X.
+ */
+static void test_level_stats()
+{
+	std::mt19937_64 rng(6);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix X = matmul(A, generate_sources());
+	const matrix_view v = matrix_view::of(X);
+	solver_params params = default_solver_params(ica_algorithm::MEICA);
+	level_stats_accumulator acc(params.ext_multi_ica);
+	std::vector<uint8_t> buf;
+	sample_stats stats;
+	whitening w_full;
+	whitening w_stats;
+
+	encode_raw_matrix(X, buf, raw_order::F);
+	// Chunk payloads split the header and the samples.
+	for (int round = 0; round < 2; ++round) {
+		acc.reset();
+		for (size_t off = 0; off < buf.size(); off += 1393) {
+			assert(acc.feed(buf.data() + off,
+					std::min<size_t>(1393, buf.size() - off)));
+			assert(off + 1393 >= buf.size() || !acc.complete());
+		}
+		assert(acc.complete());
+	}
+
+	uint16_t levels = meica_level_num(X.rows, X.cols, params.ext_multi_ica);
+	for (size_t step = 1, k = 0; k < levels; step *= 2, ++k) {
+		assert(acc.get_stats(step, stats));
+		assert(stats.count == v.subsample(step).cols);
+		whiten_with_inv_V(v.subsample(step), w_full);
+		whiten_with_stats(v.subsample(step), stats, w_stats);
+		// V.T @ V is the inverse covariance, independent of the signs
+		// of the eigenvectors.
+		matrix P_full = matmul(transpose(w_full.V), w_full.V);
+		matrix P_stats = matmul(transpose(w_stats.V), w_stats.V);
+		for (size_t i = 0; i < P_full.data.size(); ++i) {
+			assert(std::fabs(P_full.data[i] - P_stats.data[i]) <
+			       1e-8 * (1.0 + std::fabs(P_full.data[i])));
+		}
+	}
+	assert(!acc.get_stats(3, stats));
+	assert(!acc.get_stats(size_t(1) << levels, stats));
+
+	// Solvers give the same result with the accumulated statistics.
+	meica_solver with_stats(params);
+	meica_solver without_stats(params);
+	with_stats.set_level_stats(&acc);
+	matrix W = separate(with_stats, v);
+	assert(amari_index(W, A) < 0.05);
+	matrix W_ref = separate(without_stats, v);
+	for (size_t i = 0; i < W.data.size(); ++i) {
+		assert(std::fabs(W.data[i] - W_ref.data[i]) < 1e-6);
+	}
+
+	// C order X can not be accumulated.
+	encode_raw_matrix(X, buf);
+	acc.reset();
+	assert(!acc.feed(buf.data(), buf.size()));
+	assert(!acc.complete());
+}
+
+/**
+ * The batched MEICA gives the same result as running the messages one by one.
+ */
+static void test_meica_batch()
+{
+	constexpr size_t K = 5;
+	std::mt19937_64 rng(7);
+	matrix S = generate_sources();
+	solver_params params = default_solver_params(ica_algorithm::MEICA);
+	std::vector<matrix> As;
+	std::vector<matrix> Xs;
+	std::vector<matrix_view> views;
+
+	for (size_t b = 0; b < K; ++b) {
+		As.push_back(generate_matrix_A(SOURCE_NUM, rng));
+		Xs.push_back(matmul(As.back(), S));
+	}
+	for (const auto &X : Xs) {
+		views.push_back(matrix_view::of(X));
+	}
+
+	for (uint32_t max_rounds : { 0, 3 }) {
+		meica_solver ref(params);
+		meica_batch_solver batch(params);
+		std::vector<solver_state> ref_states(K, solver_state{});
+		std::vector<solver_state> states(K, solver_state{});
+
+		for (size_t b = 0; b < K; ++b) {
+			ref.run(views[b], ref_states[b], max_rounds);
+		}
+		batch.run_batch(views, states, max_rounds);
+		for (size_t b = 0; b < K; ++b) {
+			assert(states[b].iter_num == ref_states[b].iter_num);
+			assert(states[b].has_final_result ==
+			       ref_states[b].has_final_result);
+			for (size_t i = 0; i < states[b].uW.data.size(); ++i) {
+				assert(std::fabs(states[b].uW.data[i] -
+						 ref_states[b].uW.data[i]) < 1e-8);
+			}
+		}
+		// Continue the unfinished messages in another batch.
+		for (int r = 0; max_rounds != 0 && r < 4; ++r) {
+			batch.run_batch(views, states, max_rounds);
+		}
+		for (size_t b = 0; b < K; ++b) {
+			assert(states[b].has_final_result);
+			assert(amari_index(states[b].uW, As[b]) < 0.05);
+		}
+	}
+}
+
+/**
+ * The subsampled Newton iteration converges to the full sample solution.
+ */
+static void test_stochastic_newton()
+{
+	std::mt19937_64 rng(8);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix S = generate_sources();
+	matrix X = matmul(A, S);
+
+	newton_sampler off(SAMPLE_NUM, 0);
+	assert(off.full() && !off.update(0.5));
+	newton_sampler sampler(SAMPLE_NUM, 512);
+	assert(sampler.stride() == 16);
+	assert(!sampler.update(0.5));
+	// Convergence stops decreasing.
+	assert(sampler.update(0.6) && sampler.stride() == 8);
+	// Convergence below the sampling noise of 1024 samples.
+	assert(sampler.update(0.01) && sampler.stride() == 4);
+
+	for (uint8_t id = 0; id < ICA_ALGORITHM_NUM; ++id) {
+		ica_algorithm algo = static_cast<ica_algorithm>(id);
+		solver_params params = default_solver_params(algo);
+		auto full = make_solver(algo, params);
+		params.stochastic_min_samples = 512;
+		auto sto = make_solver(algo, params);
+
+		matrix W_full = separate(*full, matrix_view::of(X));
+		matrix W = separate(*sto, matrix_view::of(X));
+		matrix W_full_inv;
+		assert(inverse(W_full, W_full_inv));
+		assert(amari_index(W, W_full_inv) < 0.01);
+		assert(amari_index(W, A) < 0.05);
+		assert(mean_si_sdr(S, matmul(W, X)) > 20.0);
+	}
+}
+
+/**
+ * The float32 Newton kernels separate as well as the float64 ones.
+ */
+static void test_mixed_precision()
+{
+	std::mt19937_64 rng(9);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix S = generate_sources();
+	matrix X = matmul(A, S);
+	whitening w;
+
+	whiten_with_inv_V(matrix_view::of(X), w);
+	std::vector<float> Xt32(w.Xt.data.begin(), w.Xt.data.end());
+	matrix B = decorrelation(random_matrix(SOURCE_NUM, SOURCE_NUM, rng));
+	matrix B32 = B;
+	double lim = newton_step(B, w.Xt);
+	double lim32 = newton_step(B32, Xt32);
+	assert(std::fabs(lim - lim32) < 1e-4);
+	for (size_t i = 0; i < B.data.size(); ++i) {
+		assert(std::fabs(B.data[i] - B32.data[i]) < 1e-4);
+	}
+
+	// The reductions are in float64, so the error does not grow with the
+	// number of samples: Same float32 samples in both precisions.
+	std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+	Xt32.resize(SOURCE_NUM << 20);
+	for (float &v : Xt32) {
+		v = dist(rng);
+	}
+	matrix Xt(Xt32.size() / SOURCE_NUM, SOURCE_NUM);
+	std::copy(Xt32.begin(), Xt32.end(), Xt.data.begin());
+	B = decorrelation(random_matrix(SOURCE_NUM, SOURCE_NUM, rng));
+	B32 = B;
+	newton_step(B, Xt);
+	newton_step(B32, Xt32);
+	for (size_t i = 0; i < B.data.size(); ++i) {
+		assert(std::fabs(B.data[i] - B32.data[i]) < 1e-6);
+	}
+
+	for (uint8_t id = 0; id < ICA_ALGORITHM_NUM; ++id) {
+		ica_algorithm algo = static_cast<ica_algorithm>(id);
+		solver_params params = default_solver_params(algo);
+		params.mixed_precision = true;
+		auto s = make_solver(algo, params);
+		matrix W = separate(*s, matrix_view::of(X));
+		assert(amari_index(W, A) < 0.05);
+		assert(mean_si_sdr(S, matmul(W, X)) > 20.0);
+	}
+}
+
+/**
+ * Regression of the mixed precision on the mixtures of the wav files in
+ * folder: The SI-SDR is the same as the one of float64 within 0.5 dB.
+ */
+static void test_mixed_precision_wavs(const std::string &folder)
+{
+	for (size_t source_number : { 2, 4 }) {
+		matrix S;
+		assert(wavs_to_matrix_S(folder, 1.0, source_number, S));
+		for (ica_algorithm algo :
+		     { ica_algorithm::MEICA, ica_algorithm::FASTICA }) {
+			std::mt19937_64 rng(10);
+			double sdr = 0.0;
+			double sdr32 = 0.0;
+			for (uint64_t r = 0; r < 3; ++r) {
+				matrix X = matmul(
+					generate_matrix_A(source_number, rng), S);
+				solver_params params = default_solver_params(algo);
+				params.seed = r;
+				auto s = make_solver(algo, params);
+				params.mixed_precision = true;
+				auto s32 = make_solver(algo, params);
+				sdr += mean_si_sdr(
+					S, matmul(separate(*s, matrix_view::of(X)),
+						  X));
+				sdr32 += mean_si_sdr(
+					S,
+					matmul(separate(*s32, matrix_view::of(X)),
+					       X));
+			}
+			assert(std::fabs(sdr - sdr32) / 3 < 0.5);
+		}
+	}
+}
+
+/**
+ * The speculative starts of MEICA run in parallel and are cancelled.
+ */
+static void test_speculative_starts()
+{
+	std::mt19937_64 rng(11);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix S = generate_sources();
+	matrix X = matmul(A, S);
+	whitening w;
+
+	whiten_with_inv_V(matrix_view::of(X), w);
+	matrix B = decorrelation(random_matrix(SOURCE_NUM, SOURCE_NUM, rng));
+	const matrix B0 = B;
+	std::atomic<bool> cancel(true);
+	assert(!newton_iteration_auto_break(B, w, 100, 1e-4, 0.9, 0, &cancel));
+	assert(B.data == B0.data);
+
+	solver_params params = default_solver_params(ica_algorithm::MEICA);
+	params.speculative_starts = 4;
+	meica_solver s(params);
+	s.set_worker_cpus({ 0 });
+	for (int r = 0; r < 3; ++r) {
+		matrix W = separate(s, matrix_view::of(X));
+		assert(amari_index(W, A) < 0.05);
+		assert(mean_si_sdr(S, matmul(W, X)) > 20.0);
+	}
+}
+
+/**
+ * Separate X with nodes data-parallel VNFs, the reduction and broadcast
+ * messages are passed encoded along the chain.
+ */
+static matrix run_data_parallel(const matrix &X, uint32_t nodes,
+				uint32_t &iterations)
+{
+	const solver_params params =
+		default_solver_params(ica_algorithm::FASTICA);
+	std::vector<dp_node> chain;
+	std::vector<uint8_t> buf;
+	dp_message msg;
+	matrix uW;
+
+	for (uint32_t r = 0; r < nodes; ++r) {
+		chain.emplace_back(params, r, nodes);
+		chain.back().start(matrix_view::of(X));
+	}
+	iterations = 0;
+	while (true) {
+		chain.front().begin_reduction(msg);
+		for (uint32_t r = 1; r < nodes; ++r) {
+			encode_dp_message(msg, buf);
+			assert(decode_dp_message(buf.data(), buf.size(), msg));
+			assert(chain[r].add_partial(msg));
+		}
+		assert(msg.count == X.cols);
+		const bool done = chain.back().finish(msg, uW);
+		iterations += 1;
+		for (uint32_t r = nodes - 1; r-- > 0;) {
+			encode_dp_message(msg, buf);
+			assert(decode_dp_message(buf.data(), buf.size(), msg));
+			assert(chain[r].apply(msg));
+			// A broadcast is only applied once.
+			assert(!chain[r].apply(msg));
+		}
+		if (done) {
+			break;
+		}
+	}
+	for (const auto &node : chain) {
+		assert(node.phase() == dp_phase::DONE);
+	}
+	return uW;
+}
+
+static void test_data_parallel()
+{
+	std::mt19937_64 rng(12);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix S = generate_sources();
+	matrix X = matmul(A, S);
+	uint32_t iterations;
+
+	size_t begin, end, covered = 0;
+	for (uint32_t r = 0; r < 3; ++r) {
+		dp_column_range(10, r, 3, begin, end);
+		assert(begin == covered && end > begin);
+		covered = end;
+	}
+	assert(covered == 10);
+
+	// Same result as FastICA on a single node.
+	auto s = make_solver(ica_algorithm::FASTICA,
+			     default_solver_params(ica_algorithm::FASTICA));
+	matrix W_ref = separate(*s, matrix_view::of(X));
+	for (uint32_t nodes : { 1, 2, 3 }) {
+		matrix W = run_data_parallel(X, nodes, iterations);
+		assert(iterations > 1);
+		assert(W.rows == SOURCE_NUM && W.cols == SOURCE_NUM);
+		for (size_t i = 0; i < W.data.size(); ++i) {
+			assert(std::fabs(W.data[i] - W_ref.data[i]) <
+			       1e-6 * (1.0 + std::fabs(W_ref.data[i])));
+		}
+		assert(amari_index(W, A) < 0.05);
+	}
+
+	// Reductions of another iteration are rejected.
+	dp_node node(default_solver_params(ica_algorithm::FASTICA), 1, 2);
+	dp_message msg = { dp_phase::NEWTON, 0, 0,
+			   matrix(SOURCE_NUM, SOURCE_NUM + 1) };
+	node.start(matrix_view::of(X));
+	assert(!node.add_partial(msg));
+	msg.phase = dp_phase::WHITENING;
+	assert(node.add_partial(msg));
+	std::vector<uint8_t> buf;
+	encode_dp_message(msg, buf);
+	assert(!decode_dp_message(buf.data(), DP_MESSAGE_HEADER_LEN - 1, msg));
+	buf[0] = 7;
+	assert(!decode_dp_message(buf.data(), buf.size(), msg));
+}
+
+static void test_online_separator()
+{
+	std::mt19937_64 rng(13);
+	matrix A = generate_matrix_A(SOURCE_NUM, rng);
+	matrix S = generate_sources();
+	matrix X = matmul(A, S);
+	const matrix_view Xv = matrix_view::of(X);
+	online_params params = default_online_params();
+	const size_t frame_len = 1024;
+
+	// Consecutive and half-overlapping frames.
+	for (size_t hop : { frame_len, frame_len / 2 }) {
+		online_separator sep(params);
+		for (size_t begin = 0; begin + frame_len <= SAMPLE_NUM;
+		     begin += hop) {
+			matrix_view frame = Xv;
+			frame.data += begin;
+			frame.cols = frame_len;
+			const matrix &uW = sep.update(frame);
+			assert(uW.rows == SOURCE_NUM && uW.cols == SOURCE_NUM);
+		}
+		assert(sep.frame_count() == (SAMPLE_NUM - frame_len) / hop + 1);
+		assert(amari_index(sep.uW(), A) < 0.1);
+	}
+
+	// A frame with another number of sources starts a new stream.
+	online_separator sep(params);
+	matrix_view frame = Xv;
+	frame.cols = frame_len;
+	sep.update(frame);
+	frame.rows = 2;
+	assert(sep.update(frame).rows == 2 && sep.frame_count() == 1);
+
+	bool thrown = false;
+	params.newton_steps = 0;
+	try {
+		online_separator invalid(params);
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+static void test_fast_psnr()
+{
+	std::mt19937_64 rng(14);
+	std::normal_distribution<double> noise(0.0, 0.01);
+	matrix S = generate_sources();
+	const size_t order_ref[SOURCE_NUM] = { 2, 0, 1 };
+	std::vector<size_t> order;
+
+	// Permuted, scaled and noisy estimation.
+	matrix hat_S(SOURCE_NUM, SAMPLE_NUM);
+	for (size_t i = 0; i < SOURCE_NUM; ++i) {
+		for (size_t j = 0; j < SAMPLE_NUM; ++j) {
+			hat_S(order_ref[i], j) =
+				-3.0 * (i + 1) * S(i, j) + noise(rng);
+		}
+	}
+	const double psnr = fast_psnr(matrix_view::of(S),
+				      matrix_view::of(hat_S), order);
+	assert(psnr > 20.0);
+	for (size_t i = 0; i < SOURCE_NUM; ++i) {
+		assert(order[i] == order_ref[i]);
+	}
+	// Same result with threads and a Fortran order view.
+	matrix St = transpose(S);
+	matrix_view S_F = { St.data.data(), SOURCE_NUM, SAMPLE_NUM, 1,
+			    SOURCE_NUM };
+	assert(std::fabs(fast_psnr(S_F, matrix_view::of(hat_S), order, 4) -
+			 psnr) < 1e-9);
+	assert(order[0] == order_ref[0]);
+
+	bool thrown = false;
+	try {
+		fast_psnr(matrix_view::of(S), matrix_view::of(S), order);
+	} catch (const std::domain_error &) {
+		thrown = true;
+	}
+	assert(thrown);
+	thrown = false;
+	try {
+		fast_psnr(matrix_view::of(S), matrix_view::of(St), order);
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+/* Write a mono 16-bit PCM WAV file with an odd-sized chunk before fmt. */
+static void write_test_wav(const std::string &path,
+			   const std::vector<int16_t> &samples)
+{
+	const uint32_t data_len = samples.size() * 2;
+	std::vector<uint8_t> f;
+	auto put = [&f](const void *p, size_t len) {
+		const uint8_t *b = static_cast<const uint8_t *>(p);
+		f.insert(f.end(), b, b + len);
+	};
+	auto put32 = [&put](uint32_t v) { put(&v, 4); };
+	auto put16 = [&put](uint16_t v) { put(&v, 2); };
+
+	put("RIFF", 4);
+	put32(4 + 8 + 3 + 1 + 8 + 16 + 8 + data_len);
+	put("WAVE", 4);
+	put("LIST", 4);
+	put32(3);
+	put("abc\0", 4);
+	put("fmt ", 4);
+	put32(16);
+	put16(1);
+	put16(1);
+	put32(8000);
+	put32(16000);
+	put16(2);
+	put16(16);
+	put("data", 4);
+	put32(data_len);
+	put(samples.data(), data_len);
+
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char *>(f.data()), f.size());
+}
+
+/**
+ * The mapped wav loader and the mixture cache on generated wav files.
+ */
+static void test_mixture_cache()
+{
+	char dir[] = "/tmp/test_mixture_cacheXXXXXX";
+	assert(mkdtemp(dir) != nullptr);
+	const std::string folder(dir);
+	const size_t n = 2;
+	std::mt19937_64 rng(15);
+	std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+
+	std::vector<int16_t> samples(16003);
+	for (size_t i = 0; i < n; ++i) {
+		for (int16_t &v : samples) {
+			v = static_cast<int16_t>(dist(rng));
+		}
+		write_test_wav(folder + "/" + std::to_string(i) + ".wav",
+			       samples);
+	}
+	uint32_t sample_rate = 0;
+	std::vector<double> wav;
+	assert(read_wav(folder + "/1.wav", sample_rate, wav));
+	assert(sample_rate == 8000 && wav.size() == samples.size());
+	for (size_t j = 0; j < wav.size(); ++j) {
+		assert(static_cast<int16_t>(wav[j]) == samples[j]);
+	}
+	// Unaligned samples.
+	std::vector<uint8_t> pcm(7);
+	const int16_t pcm_ref[3] = { -2, INT16_MIN, 300 };
+	memcpy(pcm.data() + 1, pcm_ref, sizeof(pcm_ref));
+	double pcm_out[3];
+	pcm16_to_double(pcm.data() + 1, 3, pcm_out);
+	for (size_t j = 0; j < 3; ++j) {
+		assert(static_cast<int16_t>(pcm_out[j]) == pcm_ref[j]);
+	}
+
+	const mixture_params params = { .source_number = n,
+					.duration = 1.5,
+					.seed = 3 };
+	const std::string path = folder + "/mixture.cache";
+	assert(write_mixture_cache(path, folder, params));
+	mixture_cache cache;
+	assert(cache.open(path));
+	assert(cache.matches(params) && cache.sample_rate() == 8000);
+	mixture_params other = params;
+	other.seed = 4;
+	assert(!cache.matches(other));
+
+	matrix S;
+	assert(wavs_to_matrix_S(folder, 1.5, n, S) && S.cols == 12000);
+	std::mt19937_64 A_rng(params.seed);
+	const matrix A = generate_matrix_A(n, A_rng);
+	const matrix X = matmul(A, S);
+	matrix X_raw;
+	assert(decode_raw_matrix(cache.X_raw(), cache.X_raw_len(), X_raw));
+	assert(cache.X().cols == S.cols && cache.X().row_stride == 1);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			assert(std::fabs(cache.A()(i, j) - A(i, j)) < 1e-15);
+		}
+		for (size_t j = 0; j < S.cols; ++j) {
+			assert(std::fabs(cache.S()(i, j) - S(i, j)) < 1e-15);
+			assert(std::fabs(cache.X()(i, j) - X(i, j)) < 1e-12);
+			assert(std::fabs(X_raw(i, j) - X(i, j)) < 1e-12);
+		}
+	}
+
+	// Truncated caches and wav files are rejected.
+	for (const char *name : { "mixture.cache", "1.wav" }) {
+		const std::string p = folder + "/" + name;
+		std::ifstream in(p, std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+					std::istreambuf_iterator<char>());
+		std::ofstream(p, std::ios::binary)
+			.write(bytes.data(), bytes.size() - 8);
+	}
+	assert(!cache.open(path));
+	assert(!read_wav(folder + "/1.wav", sample_rate, wav));
+
+	for (const char *name : { "0.wav", "1.wav", "mixture.cache" }) {
+		remove((folder + "/" + name).c_str());
+	}
+	rmdir(dir);
+}
+
+/* argv[1] is the folder of the wav files for the regression tests. */
+int main(int argc, char *argv[])
+{
+	test_linalg();
+	test_whitening();
+	test_solvers();
+	test_meica_distributed();
+	test_raw_matrix_codec();
+	test_level_stats();
+	test_meica_batch();
+	test_stochastic_newton();
+	test_mixed_precision();
+	test_speculative_starts();
+	test_data_parallel();
+	test_online_separator();
+	test_fast_psnr();
+	test_mixture_cache();
+	if (argc > 1) {
+		test_mixed_precision_wavs(argv[1]);
+	}
+	return 0;
+}
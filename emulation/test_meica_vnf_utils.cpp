@@ -5,11 +5,453 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <cstring>
 #include <random>
+#include <string>
+#include <vector>
 
 #include "meica_vnf_utils.hpp"
 
+using namespace meica;
+
+/**
+ * Reference checksum: 16-bit big-endian words over the pseudo header and the
+ * whole UDP datagram.
+ */
+static uint16_t ref_udp_cksum_verify(const uint8_t *ip, const uint8_t *udp,
+				     uint16_t dgram_len)
+{
+	uint32_t sum = 0;
+	for (int i = 12; i < 20; i += 2) {
+		sum += (ip[i] << 8) | ip[i + 1];
+	}
+	sum += IPPROTO_UDP;
+	sum += dgram_len;
+	for (uint16_t i = 0; i < dgram_len; i += 2) {
+		uint16_t lo = (i + 1 < dgram_len) ? udp[i + 1] : 0;
+		sum += (udp[i] << 8) | lo;
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	return static_cast<uint16_t>(sum);
+}
+
+static void test_sw_ipv4_udp_cksum()
+{
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<int> byte(0, 255);
+	uint8_t buf[sizeof(struct rte_ipv4_hdr) + 2048];
+
+	for (uint16_t payload_len : { 0, 1, 2, 3, 15, 16, 17, 1400, 1401 }) {
+		struct rte_ipv4_hdr *ip = (struct rte_ipv4_hdr *)buf;
+		struct rte_udp_hdr *udp =
+			(struct rte_udp_hdr *)(buf + sizeof(*ip));
+		uint16_t dgram_len = sizeof(*udp) + payload_len;
+		for (auto &b : buf) {
+			b = byte(gen);
+		}
+		udp->dgram_len = rte_cpu_to_be_16(dgram_len);
+		udp->dgram_cksum = 0;
+		udp->dgram_cksum = sw_ipv4_udp_cksum(ip, udp);
+		assert(udp->dgram_cksum != 0);
+		assert(ref_udp_cksum_verify(buf, (uint8_t *)udp, dgram_len) ==
+		       0xffff);
+	}
+}
+
+/**
+ * The service header is in network byte order like ServiceHeader of
+ * ./meica_host.py.
+ */
+static void test_service_header()
+{
+	const uint8_t wire[SERVICE_HEADER_LEN] = { 0, 3, 0, 1, 0, 0, 0x04, 0x4a,
+						   0x01, 0x02, 0x05, 0x88, 0x04,
+						   0x4a, 0, 7 };
+	uint8_t buf[SERVICE_HEADER_LEN];
+	struct service_header_cpu hdr = parse_service_header(wire);
+
+	assert(hdr.msg_type == 0 && hdr.msg_flags == 3);
+	assert(hdr.total_msg_num == 1 && hdr.msg_num == 0);
+	assert(hdr.total_chunk_num == 1098 && hdr.chunk_num == 258);
+	assert(hdr.chunk_len == 1416 && hdr.data_chunk_num == 1098);
+	assert(hdr.iter_num == 7);
+	write_service_header(buf, hdr);
+	for (uint32_t i = 0; i < SERVICE_HEADER_LEN; ++i) {
+		assert(buf[i] == wire[i]);
+	}
+}
+
+/**
+ * Mbuf segment on a plain buffer, mbufs of a pool are not needed to walk a
+ * chain.
+ */
+static void init_segment(struct rte_mbuf &m, uint8_t *buf, uint16_t len)
+{
+	memset(&m, 0, sizeof(m));
+	m.buf_addr = buf;
+	m.data_len = len;
+	m.pkt_len = len;
+	m.nb_segs = 1;
+}
+
+/**
+ * A jumbo chunk split into segments at odd offsets gives the same checksum
+ * and payload as the linear one.
+ */
+static void test_segmented_chunk()
+{
+	const uint16_t payload_len = 3001;
+	const uint16_t pkt_len = ALL_HEADERS_LEN + payload_len;
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::vector<uint8_t> pkt(pkt_len);
+	struct service_header_cpu hdr = {};
+
+	for (auto &b : pkt) {
+		b = byte(gen);
+	}
+	struct rte_ipv4_hdr *ip =
+		(struct rte_ipv4_hdr *)(pkt.data() + sizeof(struct rte_ether_hdr));
+	struct rte_udp_hdr *udp = (struct rte_udp_hdr *)(ip + 1);
+	ip->total_length =
+		rte_cpu_to_be_16(pkt_len - sizeof(struct rte_ether_hdr));
+	udp->dgram_len = rte_cpu_to_be_16(
+		pkt_len - sizeof(struct rte_ether_hdr) - sizeof(*ip));
+	udp->dgram_cksum = 0;
+	hdr.chunk_len = payload_len + SERVICE_HEADER_LEN;
+	write_service_header(pkt.data() + SERVICE_HEADER_OFFSET, hdr);
+
+	struct rte_mbuf linear;
+	init_segment(linear, pkt.data(), pkt_len);
+	const uint16_t cksum = sw_ipv4_udp_cksum(&linear);
+	assert(cksum == sw_ipv4_udp_cksum(ip, udp));
+
+	// Headers and 43 bytes of payload, then 1501 and 1457 bytes.
+	const uint16_t split[] = { ALL_HEADERS_LEN + 43, 1501, 1457 };
+	std::vector<std::vector<uint8_t> > bufs;
+	struct rte_mbuf segs[3];
+	size_t off = 0;
+	for (int i = 0; i < 3; ++i) {
+		bufs.emplace_back(pkt.begin() + off,
+				  pkt.begin() + off + split[i]);
+		init_segment(segs[i], bufs.back().data(), split[i]);
+		off += split[i];
+	}
+	assert(off == pkt_len);
+	segs[0].next = &segs[1];
+	segs[1].next = &segs[2];
+	segs[0].nb_segs = 3;
+	segs[0].pkt_len = pkt_len;
+	assert(sw_ipv4_udp_cksum(&segs[0]) == cksum);
+
+	struct service_header_cpu parsed = unpack_service_header(&segs[0]);
+	assert(chunk_lengths_valid(&segs[0], parsed));
+	std::vector<uint8_t> payload = { 1, 2 };
+	append_chunk_payload(&segs[0], parsed, payload);
+	assert(payload.size() == 2U + payload_len);
+	assert(memcmp(payload.data() + 2, pkt.data() + ALL_HEADERS_LEN,
+		      payload_len) == 0);
+
+	// Length fields beyond the datagram or the chain.
+	parsed.chunk_len += 1;
+	assert(!chunk_lengths_valid(&segs[0], parsed));
+	parsed.chunk_len = SERVICE_HEADER_LEN - 1;
+	assert(!chunk_lengths_valid(&segs[0], parsed));
+	parsed.chunk_len = payload_len + SERVICE_HEADER_LEN;
+	segs[0].pkt_len -= 1;
+	assert(!chunk_lengths_valid(&segs[0], parsed));
+}
+
+/**
+ * Only the checksums of rewritten chunks are updated, forwarded chunks are
+ * sent as received.
+ */
+static void test_prepare_tx_cksum()
+{
+	const uint16_t payload_len = 101;
+	const uint16_t pkt_len = ALL_HEADERS_LEN + payload_len;
+	const struct tx_cksum_conf conf = { 0, false, false };
+	std::mt19937 gen(9);
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::vector<uint8_t> rewritten(pkt_len);
+	struct rte_mbuf m[2];
+	struct rte_mbuf *burst[2] = { &m[0], &m[1] };
+
+	for (auto &b : rewritten) {
+		b = byte(gen);
+	}
+	std::vector<uint8_t> forwarded = rewritten;
+	init_segment(m[0], rewritten.data(), pkt_len);
+	init_segment(m[1], forwarded.data(), pkt_len);
+	// RX flags of a received chunk.
+	m[0].ol_flags = 1ULL << 7;
+	m[1].ol_flags = 1ULL << 7;
+	update_l3_l4_header(&m[0], payload_len);
+	assert(m[0].ol_flags == TX_CKSUM_FLAGS);
+
+	const std::vector<uint8_t> before = forwarded;
+	assert(prepare_tx_cksum(conf, burst, 2) == 2);
+	assert(forwarded == before && m[1].ol_flags == (1ULL << 7));
+	// Checksums in software, no TX flags are left.
+	const uint8_t *ip = rewritten.data() + sizeof(struct rte_ether_hdr);
+	const uint8_t *udp = ip + sizeof(struct rte_ipv4_hdr);
+	assert(ref_udp_cksum_verify(ip, udp,
+				    pkt_len - (udp - rewritten.data())) ==
+	       0xffff);
+	assert(m[0].ol_flags == 0);
+}
+
+static void test_flow_chunk_size()
+{
+	struct chunk_header_template tmpl = {};
+	std::vector<struct service_header_cpu> hdrs(2);
+
+	tmpl.chunk_size = DEFAULT_CHUNK_SIZE;
+	hdrs[0].total_chunk_num = 2;
+	hdrs[0].chunk_len = 8000 + SERVICE_HEADER_LEN;
+	update_flow_chunk_size(tmpl, hdrs, MAX_JUMBO_CHUNK_SIZE);
+	assert(tmpl.chunk_size == 8000);
+	update_flow_chunk_size(tmpl, hdrs, 4000);
+	assert(tmpl.chunk_size == 4000);
+
+	// A single chunk does not tell the peer's chunk size.
+	hdrs.resize(1);
+	hdrs[0].total_chunk_num = 1;
+	hdrs[0].chunk_len = 100 + SERVICE_HEADER_LEN;
+	update_flow_chunk_size(tmpl, hdrs, MAX_JUMBO_CHUNK_SIZE);
+	assert(tmpl.chunk_size == 4000);
+	assert(MAX_JUMBO_CHUNK_SIZE == 8956);
+}
+
+/* Data needing more chunks than the header field holds is rejected. */
+static void test_create_chunks_range()
+{
+	struct chunk_header_template tmpl = {};
+	struct service_header_cpu hdr = {};
+	std::vector<struct rte_mbuf *> chunk_buf;
+
+	tmpl.valid = true;
+	// Rejected before any mbuf is allocated or any byte of data is read.
+	assert(!create_chunks(nullptr, tmpl, hdr, nullptr,
+			      (UINT16_MAX + size_t(1)) * 100, 100, chunk_buf));
+	assert(!create_chunks(nullptr, tmpl, hdr, nullptr, 100, 0, chunk_buf));
+	assert(chunk_buf.empty());
+}
+
+static void test_reverse_header_template()
+{
+	struct chunk_header_template tmpl = {};
+	struct chunk_header_template reversed;
+	struct chunk_header_template twice;
+
+	for (uint32_t i = 0; i < ALL_HEADERS_LEN; ++i) {
+		tmpl.hdr[i] = static_cast<uint8_t>(i);
+	}
+	tmpl.valid = true;
+	tmpl.chunk_size = 1000;
+	reverse_header_template(tmpl, reversed);
+	const auto *eth = reinterpret_cast<const struct rte_ether_hdr *>(
+		reversed.hdr);
+	const auto *ip = reinterpret_cast<const struct rte_ipv4_hdr *>(eth + 1);
+	const auto *udp = reinterpret_cast<const struct rte_udp_hdr *>(ip + 1);
+	const auto *orig_ip = reinterpret_cast<const struct rte_ipv4_hdr *>(
+		tmpl.hdr + sizeof(struct rte_ether_hdr));
+	const auto *orig_udp =
+		reinterpret_cast<const struct rte_udp_hdr *>(orig_ip + 1);
+	assert(memcmp(&eth->d_addr, tmpl.hdr + 6, 6) == 0);
+	assert(memcmp(&eth->s_addr, tmpl.hdr, 6) == 0);
+	assert(ip->src_addr == orig_ip->dst_addr &&
+	       ip->dst_addr == orig_ip->src_addr);
+	assert(udp->src_port == orig_udp->dst_port &&
+	       udp->dst_port == orig_udp->src_port);
+	// The service header is not changed.
+	assert(memcmp(reversed.hdr + SERVICE_HEADER_OFFSET,
+		      tmpl.hdr + SERVICE_HEADER_OFFSET, SERVICE_HEADER_LEN) == 0);
+	assert(reversed.chunk_size == 1000);
+
+	reverse_header_template(reversed, twice);
+	assert(memcmp(twice.hdr, tmpl.hdr, ALL_HEADERS_LEN) == 0);
+}
+
+static void test_ext_tlv()
+{
+	const uint8_t uW[5] = { 1, 2, 3, 4, 5 };
+	const uint8_t other[2] = { 9, 9 };
+	std::vector<uint8_t> ext;
+	struct uW_ext value;
+
+	assert(!parse_uW_ext(ext.data(), ext.size(), value));
+	// Unknown TLVs are skipped.
+	append_ext_tlv(ext, static_cast<ext_tlv_type>(7), other, 2);
+	append_uW_ext(ext, 1, 300, uW, sizeof(uW));
+	assert(ext.size() ==
+	       2 * EXT_TLV_HEADER_LEN + 2 + UW_EXT_HEADER_LEN + sizeof(uW));
+	assert(parse_uW_ext(ext.data(), ext.size(), value));
+	assert(value.msg_flags == 1 && value.iter_num == 300);
+	assert(value.len == sizeof(uW) && memcmp(value.data, uW, 5) == 0);
+	// Truncated TLV.
+	assert(!parse_uW_ext(ext.data(), ext.size() - 1, value));
+}
+
+/**
+ * Trace records of two hops after a uW TLV, as a VNF forwards them.
+ */
+static void test_trace_ext()
+{
+	const uint8_t uW[3] = { 1, 2, 3 };
+	const struct trace_record hop1 = { 1, 1000, 2000, 2500, 9000,
+					   0x0123456789abcdefULL };
+	const struct trace_record hop2 = { 513, 10000, 11000, 0, 0, 12000 };
+	std::vector<struct trace_record> records;
+	std::vector<uint8_t> ext;
+	std::vector<uint8_t> out;
+	struct uW_ext value;
+
+	append_uW_ext(ext, 0, 1, uW, sizeof(uW));
+	append_trace_ext(ext, hop1);
+	assert(ext.size() == 2 * EXT_TLV_HEADER_LEN + UW_EXT_HEADER_LEN +
+				     sizeof(uW) + TRACE_RECORD_LEN);
+
+	// Replace the uW and keep the trace records.
+	append_uW_ext(out, 1, 2, uW, 1);
+	assert(copy_ext_tlvs(ext.data(), ext.size(), ext_tlv_type::TRACE,
+			     true, out));
+	append_trace_ext(out, hop2);
+	assert(parse_uW_ext(out.data(), out.size(), value));
+	assert(value.msg_flags == 1 && value.len == 1);
+	assert(parse_trace_ext(out.data(), out.size(), records));
+	assert(records.size() == 2);
+	assert(records[0].node_id == 1 && records[0].rx_first == 1000 &&
+	       records[0].rx_last == 2000 && records[0].compute_start == 2500 &&
+	       records[0].compute_end == 9000 &&
+	       records[0].tx == 0x0123456789abcdefULL);
+	assert(records[1].node_id == 513 && records[1].compute_start == 0 &&
+	       records[1].tx == 12000);
+
+	// Without the trace records.
+	ext.clear();
+	assert(copy_ext_tlvs(out.data(), out.size(), ext_tlv_type::TRACE,
+			     false, ext));
+	assert(parse_trace_ext(ext.data(), ext.size(), records));
+	assert(records.empty());
+	assert(parse_uW_ext(ext.data(), ext.size(), value));
+	assert(!copy_ext_tlvs(out.data(), out.size() - 1, ext_tlv_type::TRACE,
+			      true, ext));
+	assert(!parse_trace_ext(out.data(), out.size() - 1, records));
+}
+
+/**
+ * uW extension on a chunk: added, replaced by a larger one and removed.
+ */
+static void test_chunk_ext()
+{
+	const uint16_t payload_len = 200;
+	std::vector<uint8_t> buf(RTE_PKTMBUF_HEADROOM + 2048, 0);
+	std::vector<uint8_t> ext;
+	std::vector<uint8_t> read;
+	struct service_header_cpu hdr = {};
+	struct rte_mbuf m;
+
+	init_segment(m, buf.data(), ALL_HEADERS_LEN + payload_len);
+	m.buf_len = buf.size();
+	uint8_t *pkt = rte_pktmbuf_mtod(&m, uint8_t *);
+	for (uint16_t i = 0; i < payload_len; ++i) {
+		pkt[ALL_HEADERS_LEN + i] = static_cast<uint8_t>(i);
+	}
+	hdr.msg_flags = 3;
+	hdr.chunk_len = payload_len + SERVICE_HEADER_LEN;
+	write_service_header(pkt + SERVICE_HEADER_OFFSET, hdr);
+	update_l3_l4_header(&m, payload_len);
+	assert(!read_chunk_ext(&m, hdr, read));
+
+	const uint8_t uW[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	append_uW_ext(ext, 0, 2, uW, sizeof(uW));
+	// The extension does not fit into the chunk size.
+	assert(!write_chunk_ext(&m, ext, payload_len + 1));
+	assert(write_chunk_ext(&m, ext, DEFAULT_CHUNK_SIZE));
+	hdr = unpack_service_header(&m);
+	assert(hdr.msg_flags == (3 | MSG_FLAG_EXT));
+	assert(hdr.chunk_len == payload_len + SERVICE_HEADER_LEN);
+	assert(chunk_lengths_valid(&m, hdr));
+	assert(read_chunk_ext(&m, hdr, read) && read == ext);
+
+	ext.clear();
+	append_uW_ext(ext, 1, 3, uW, 4);
+	append_uW_ext(ext, 1, 3, uW, 8);
+	assert(write_chunk_ext(&m, ext, DEFAULT_CHUNK_SIZE));
+	hdr = unpack_service_header(&m);
+	assert(read_chunk_ext(&m, hdr, read) && read == ext);
+	assert(m.pkt_len == ALL_HEADERS_LEN + payload_len + ext.size());
+
+	ext.clear();
+	assert(write_chunk_ext(&m, ext, DEFAULT_CHUNK_SIZE));
+	hdr = unpack_service_header(&m);
+	assert(hdr.msg_flags == 3 && !read_chunk_ext(&m, hdr, read));
+	assert(m.pkt_len == ALL_HEADERS_LEN + payload_len);
+	for (uint16_t i = 0; i < payload_len; ++i) {
+		assert(pkt[ALL_HEADERS_LEN + i] == static_cast<uint8_t>(i));
+	}
+}
+
+static void test_vdev_confs()
+{
+	struct port_backend_conf conf = { "af_packet", "eth0", "", "", "", "",
+					  "", DEFAULT_CHUNK_SIZE };
+	std::vector<std::string> vdevs = get_vdev_confs(conf);
+
+	assert(vdevs.size() == 1 && vdevs[0] == get_vdev_conf(conf));
+	assert(vdevs[0] == "net_af_packet0,iface=eth0");
+	// Jumbo chunks do not fit into the default 2048 bytes frames.
+	conf.max_chunk_size = MAX_JUMBO_CHUNK_SIZE;
+	assert(get_vdev_conf(conf) ==
+	       "net_af_packet0,iface=eth0,blocksz=12288,framesz=12288");
+	conf.max_chunk_size = DEFAULT_CHUNK_SIZE;
+	// Same interface for both directions.
+	conf.tx_iface = "eth0";
+	assert(get_vdev_confs(conf).size() == 1);
+
+	conf.tx_iface = "eth1";
+	vdevs = get_vdev_confs(conf);
+	assert(vdevs.size() == 2 && vdevs[1] == "net_af_packet1,iface=eth1");
+
+	// First VNF of a memif chain.
+	conf.tx_iface = "";
+	conf.memif_tx = "/tmp/vnf1.sock";
+	vdevs = get_vdev_confs(conf);
+	assert(vdevs.size() == 2 && vdevs[0] == "net_af_packet0,iface=eth0");
+	assert(vdevs[1] == "net_memif1,role=master,id=0,socket=/tmp/vnf1.sock");
+
+	// Intermediate VNF.
+	conf.memif_rx = "/tmp/vnf1.sock";
+	conf.memif_tx = "/tmp/vnf2.sock";
+	vdevs = get_vdev_confs(conf);
+	assert(vdevs.size() == 2);
+	assert(vdevs[0] == "net_memif0,role=slave,id=0,socket=/tmp/vnf1.sock");
+	assert(vdevs[1] == "net_memif1,role=master,id=0,socket=/tmp/vnf2.sock");
+
+	// Last VNF sends to the network.
+	conf.memif_tx = "";
+	vdevs = get_vdev_confs(conf);
+	assert(vdevs.size() == 2 && vdevs[1] == "net_af_packet1,iface=eth0");
+
+	conf.backend = "unknown";
+	assert(get_vdev_confs(conf).empty());
+}
+
 int main()
 {
+	test_sw_ipv4_udp_cksum();
+	test_service_header();
+	test_segmented_chunk();
+	test_prepare_tx_cksum();
+	test_flow_chunk_size();
+	test_create_chunks_range();
+	test_reverse_header_template();
+	test_ext_tlv();
+	test_trace_ext();
+	test_chunk_ext();
+	test_vdev_confs();
 	return 0;
 }
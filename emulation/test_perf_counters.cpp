@@ -0,0 +1,61 @@
+/*
+ * test_perf_counters.cpp
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "perf_counters.hpp"
+
+using namespace meica;
+
+static void test_perf_counters()
+{
+	perf_counters counters;
+	std::string error;
+	volatile uint64_t sum = 0;
+
+	assert(!counters.is_open());
+	assert(counters.read().cycles == 0);
+	// Containers and CI machines often do not allow perf events.
+	if (!counters.open(error)) {
+		std::cout << "Skip the counters: " << error << std::endl;
+		return;
+	}
+	const struct perf_sample begin = counters.read();
+	for (uint64_t i = 0; i < 1000000; ++i) {
+		sum += i;
+	}
+	const struct perf_sample delta = counters.read() - begin;
+	assert(delta.cycles > 0 && delta.instructions >= 1000000);
+}
+
+static void test_perf_stats()
+{
+	perf_stats stats;
+	std::ostringstream out;
+
+	assert(stats.empty());
+	stats.add("PROCESS_CHUNKS", 3, 1000, perf_sample{ 100, 200, 4, 2 });
+	stats.add("PROCESS_CHUNKS", 3, 1000, perf_sample{ 300, 200, 6, 4 });
+	stats.add("level 0", 3, 1000, perf_sample{ 50, 25, 0, 0 });
+	stats.add("PROCESS_CHUNKS", 4, 1000, perf_sample{ 10, 10, 0, 0 });
+	assert(!stats.empty());
+	stats.dump(out);
+	assert(out.str() ==
+	       "sources,msg_bytes,stage,count,cycles,instructions,ipc,llc_misses,branch_misses\n"
+	       "3,1000,PROCESS_CHUNKS,2,200.0,200.0,1.000,5.0,3.0\n"
+	       "3,1000,level 0,1,50.0,25.0,0.500,0.0,0.0\n"
+	       "4,1000,PROCESS_CHUNKS,1,10.0,10.0,1.000,0.0,0.0\n");
+}
+
+int main()
+{
+	test_perf_counters();
+	test_perf_stats();
+	return 0;
+}
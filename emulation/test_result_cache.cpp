@@ -0,0 +1,100 @@
+/*
+ * test_result_cache.cpp
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <cstring>
+#include <vector>
+
+#include "result_cache.hpp"
+
+using namespace meica;
+
+static void test_crc32c()
+{
+	const char *check = "123456789";
+	std::vector<uint8_t> data(1000);
+
+	// Check value of CRC-32C.
+	assert(crc32c(0, reinterpret_cast<const uint8_t *>(check),
+		      strlen(check)) == 0xe3069283);
+	assert(crc32c(0, nullptr, 0) == 0);
+
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<uint8_t>(i * 7 + 3);
+	}
+	const uint32_t full = crc32c(0, data.data(), data.size());
+	// Fed in unaligned pieces as chunk payloads.
+	crc32c_stream s;
+	size_t off = 0;
+	for (size_t len : { 1, 13, 400, 8, 578 }) {
+		s.feed(data.data() + off, len);
+		off += len;
+	}
+	assert(off == data.size());
+	assert(s.valid() && s.value() == full && s.length() == data.size());
+
+	data[500] ^= 1;
+	assert(crc32c(0, data.data(), data.size()) != full);
+
+	s.invalidate();
+	s.feed(data.data(), 1);
+	assert(!s.valid() && s.length() == data.size());
+	s.reset();
+	assert(s.valid() && s.value() == 0 && s.length() == 0);
+}
+
+static result_key make_key(uint32_t X_crc)
+{
+	return result_key{ X_crc, 1000, 0, 0, 0 };
+}
+
+static void test_lru()
+{
+	result_cache cache(2);
+	cached_result r = { false, 1, { 1, 2, 3 } };
+
+	assert(cache.lookup(make_key(1)) == nullptr);
+	cache.insert(make_key(1), r);
+	r.uW = { 4 };
+	cache.insert(make_key(2), r);
+	const cached_result *hit = cache.lookup(make_key(1));
+	assert(hit != nullptr && hit->iter_num == 1 &&
+	       (hit->uW == std::vector<uint8_t>{ 1, 2, 3 }));
+
+	// Key 2 is the least recently used one.
+	cache.insert(make_key(3), r);
+	assert(cache.size() == 2);
+	assert(cache.lookup(make_key(2)) == nullptr);
+	assert(cache.lookup(make_key(1)) != nullptr);
+	assert(cache.lookup(make_key(3)) != nullptr);
+
+	// All fields are part of the key.
+	result_key k = make_key(3);
+	k.iter_num = 1;
+	assert(cache.lookup(k) == nullptr);
+	k = make_key(3);
+	k.uW_crc = 5;
+	assert(cache.lookup(k) == nullptr);
+
+	// Replacing a result does not evict.
+	r.has_final_result = true;
+	cache.insert(make_key(3), r);
+	assert(cache.lookup(make_key(3))->has_final_result);
+	assert(cache.stats().hits == 4 && cache.stats().misses == 4 &&
+	       cache.stats().evictions == 1);
+
+	result_cache disabled(0);
+	disabled.insert(make_key(1), r);
+	assert(!disabled.enabled() && disabled.size() == 0);
+	assert(disabled.lookup(make_key(1)) == nullptr);
+}
+
+int main()
+{
+	test_crc32c();
+	test_lru();
+	return 0;
+}
@@ -23,6 +23,14 @@ from mininet.term import makeTerm
 
 
 PARENT_DIR = os.path.abspath(os.path.join(os.path.curdir, os.pardir))
+# Host directory of the memif sockets shared by the VNF containers.
+MEMIF_DIR = "/tmp/meica_memif"
+# Chunk payload sizes of ./meica_vnf_utils.hpp and ./service_header.hpp.
+DEFAULT_CHUNK_SIZE = 1400
+MAX_JUMBO_CHUNK_SIZE = 8956
+# IPv4, UDP and service headers of a chunk.
+CHUNK_HEADERS_LEN = 20 + 8 + 16
+JUMBO_MTU = 9000
 
 
 class MeicaDistTest(object):
@@ -80,8 +88,40 @@ class MeicaDistTest(object):
             },
         )
 
-    def run_multi_htop(self, node_num, vnf_type, vnf_mode, max_rounds):
+    @staticmethod
+    def get_chaining_args(node_num, vnf_chaining):
+        """Get the chaining options of each VNF.
+
+        With memif, the first VNF receives from its switch and the last one
+        sends to its switch, chunks between the VNFs bypass the switches.
+        """
+        if vnf_chaining == "veth" or node_num < 2:
+            return [""] * node_num
+        chaining_args = []
+        for n in range(1, node_num + 1):
+            args = []
+            if n > 1:
+                args.append(f"--memif_rx {MEMIF_DIR}/vnf{n-1}.sock")
+            if n < node_num:
+                args.append(f"--memif_tx {MEMIF_DIR}/vnf{n}.sock")
+            chaining_args.append(" ".join(args))
+        return chaining_args
+
+    def run_multi_htop(
+        self,
+        node_num,
+        vnf_type,
+        vnf_mode,
+        max_rounds,
+        vnf_backend,
+        vnf_chaining,
+        max_chunk_size,
+    ):
         info("* Running multi_hop test.\n")
+        if vnf_chaining == "memif":
+            if vnf_mode == "data_parallel":
+                raise ValueError("The data_parallel mode does not support memif chaining.")
+            os.makedirs(MEMIF_DIR, exist_ok=True)
 
         info("*** Adding network nodes.\n")
         host_addr_base = 10
@@ -114,6 +154,7 @@ class MeicaDistTest(object):
                         },
                         "/dev": {"bind": "/dev", "mode": "rw"},
                         PARENT_DIR: {"bind": "/in-network_bss", "mode": "rw"},
+                        MEMIF_DIR: {"bind": MEMIF_DIR, "mode": "rw"},
                     },
                     "working_dir": "/in-network_bss/emulation",
                 },
@@ -142,6 +183,12 @@ class MeicaDistTest(object):
 
         self.net.start()
 
+        if max_chunk_size + CHUNK_HEADERS_LEN > 1500:
+            info(f"*** Set the MTU of all links to {JUMBO_MTU}.\n")
+            for link in self.net.links:
+                link.intf1.setMTU(JUMBO_MTU)
+                link.intf2.setMTU(JUMBO_MTU)
+
         c0 = self.net.get("c0")
         makeTerm(c0, cmd="ryu-manager ./multi_hop_controller.py ; read")
 
@@ -157,33 +204,74 @@ class MeicaDistTest(object):
         ret = self.server.cmd(f"ping -c 3 {self.client.IP()}")
         print(ret)
 
-        print(f"*** Deploy VNFs, VNF type:{vnf_type}, VNF mode: {vnf_mode}")
+        print(
+            f"*** Deploy VNFs, VNF type:{vnf_type}, VNF mode: {vnf_mode}, chaining: {vnf_chaining}"
+        )
 
         vnf_type_map = {"meica": "./build/meica_vnf", "cnn": "./build/cnn_vnf"}
         vnf_bin = vnf_type_map[vnf_type]
+        vnf_bin = f"{vnf_bin} --backend {vnf_backend} --max_chunk_size {max_chunk_size}"
+        chaining_args = self.get_chaining_args(len(self._vnfs), vnf_chaining)
 
         if vnf_mode == "null":
             return
         elif vnf_mode == "store_forward":
-            for v in self._vnfs:
+            for idx, v in enumerate(self._vnfs):
                 v.cmd(
-                    f"cd /in-network_bss/emulation && {vnf_bin} --mode store_forward & 2>&1"
+                    f"cd /in-network_bss/emulation && {vnf_bin} {chaining_args[idx]} --mode store_forward & 2>&1"
                 )
                 time.sleep(1)  # Avoid memory corruption among VNFs.
         elif vnf_mode == "compute_forward":
             v = self._vnfs[0]
             # Max rounds are not used in cnn.
             v.cmd(
-                f"cd /in-network_bss/emulation && {vnf_bin} --mode compute_forward --leader --max_rounds {max_rounds} & 2>&1"
+                f"cd /in-network_bss/emulation && {vnf_bin} {chaining_args[0]} --mode compute_forward --leader --max_rounds {max_rounds} & 2>&1"
             )
-            for v in self._vnfs[1:]:
+            for idx, v in enumerate(self._vnfs[1:], start=1):
                 v.cmd(
-                    f"cd /in-network_bss/emulation && {vnf_bin} --mode compute_forward --max_rounds {max_rounds} & 2>&1"
+                    f"cd /in-network_bss/emulation && {vnf_bin} {chaining_args[idx]} --mode compute_forward --max_rounds {max_rounds} & 2>&1"
                 )
+        elif vnf_mode == "data_parallel":
+            if vnf_type != "meica":
+                raise ValueError("The data_parallel mode is only supported by meica VNFs.")
+            for idx, v in enumerate(self._vnfs):
+                v.cmd(
+                    f"cd /in-network_bss/emulation && {vnf_bin} --mode data_parallel --dp_rank {idx} --dp_size {len(self._vnfs)} & 2>&1"
+                )
+                time.sleep(1)  # Avoid memory corruption among VNFs.
+        elif vnf_mode == "online":
+            if vnf_type != "meica":
+                raise ValueError("The online mode is only supported by meica VNFs.")
+            # The first VNF separates the streams, the others forward the
+            # frames and their uW.
+            for idx, v in enumerate(self._vnfs):
+                mode = "online" if idx == 0 else "store_forward"
+                v.cmd(
+                    f"cd /in-network_bss/emulation && {vnf_bin} {chaining_args[idx]} --mode {mode} & 2>&1"
+                )
+                time.sleep(1)  # Avoid memory corruption among VNFs.
 
-    def run(self, topo, node_num, vnf_type, vnf_mode, max_rounds):
+    def run(
+        self,
+        topo,
+        node_num,
+        vnf_type,
+        vnf_mode,
+        max_rounds,
+        vnf_backend,
+        vnf_chaining,
+        max_chunk_size,
+    ):
         if topo == "multi_hop":
-            self.run_multi_htop(node_num, vnf_type, vnf_mode, max_rounds)
+            self.run_multi_htop(
+                node_num,
+                vnf_type,
+                vnf_mode,
+                max_rounds,
+                vnf_backend,
+                vnf_chaining,
+                max_chunk_size,
+            )
 
 
 if __name__ == "__main__":
@@ -213,9 +301,29 @@ if __name__ == "__main__":
         "--vnf_mode",
         type=str,
         default="store_forward",
-        choices=["null", "store_forward", "compute_forward"],
+        choices=["null", "store_forward", "compute_forward", "data_parallel", "online"],
         help="Mode to run all VNFs.",
     )
+    parser.add_argument(
+        "--vnf_backend",
+        type=str,
+        default="af_packet",
+        choices=["af_packet", "af_xdp"],
+        help="Port backend of all VNFs.",
+    )
+    parser.add_argument(
+        "--vnf_chaining",
+        type=str,
+        default="veth",
+        choices=["veth", "memif"],
+        help="Pass chunks between the VNFs via their switches (veth) or via shared memory (memif).",
+    )
+    parser.add_argument(
+        "--max_chunk_size",
+        type=int,
+        default=DEFAULT_CHUNK_SIZE,
+        help=f"Maximal chunk payload size of all VNFs, up to {MAX_JUMBO_CHUNK_SIZE}. The links use a {JUMBO_MTU}B MTU if the chunks do not fit a 1500B MTU.",
+    )
 
     parser.add_argument(
         "-r",
@@ -225,6 +333,8 @@ if __name__ == "__main__":
         help="Maximal allowed computing iterations.",
     )
     args = parser.parse_args()
+    if not 0 < args.max_chunk_size <= MAX_JUMBO_CHUNK_SIZE:
+        parser.error(f"--max_chunk_size must be in (0, {MAX_JUMBO_CHUNK_SIZE}].")
 
     home_dir = os.path.expanduser("~")
     xresources_path = os.path.join(home_dir, ".Xresources")
@@ -248,6 +358,9 @@ if __name__ == "__main__":
             vnf_type=args.vnf_type,
             vnf_mode=args.vnf_mode,
             max_rounds=args.max_rounds,
+            vnf_backend=args.vnf_backend,
+            vnf_chaining=args.vnf_chaining,
+            max_chunk_size=args.max_chunk_size,
         )
         info("*** Enter CLI\n")
         CLI(test.net)
@@ -5,6 +5,12 @@ import glob
 import time
 import museval
 
+try:
+    # Native evaluation built in ./emulation/build, see ./emulation/README.md.
+    import meica_eval
+except ImportError:
+    meica_eval = None
+
 
 '''
 # FAST BSS TESTBED Version 0.1.0:
@@ -248,6 +254,7 @@ class PyFastbssTestbed:
         # Usage:
 
             Calculate the psnr of the estimated source signals (matrix hat_S)
+            with the native module meica_eval if it is available
 
         # Parameters:
 
@@ -259,6 +266,9 @@ class PyFastbssTestbed:
 
             The mean value of psnr of each sources
         '''
+        if meica_eval is not None:
+            SNR, order = meica_eval.fast_psnr(S, hat_S)
+            return SNR, np.asarray(hat_S)[order]
         original_hat_S = hat_S
         S = np.dot(np.diag(1/(np.max(abs(S), axis=1))), S)
         hat_S = np.dot(np.diag(1/(np.max(abs(hat_S), axis=1))), hat_S)